@@ -25,6 +25,8 @@ struct _EAddressbookModelPrivate {
 
 	/* Query Results */
 	GPtrArray *contacts;
+	/* gchar *uid ~> index into 'contacts' */
+	GHashTable *uid_index;
 
 	/* Signal Handler IDs */
 	gulong create_contact_id;
@@ -60,6 +62,7 @@ enum {
 	CONTACT_ADDED,
 	CONTACTS_REMOVED,
 	CONTACT_CHANGED,
+	CONTACTS_CHANGED,
 	MODEL_CHANGED,
 	STOP_STATE_CHANGED,
 	LAST_SIGNAL
@@ -77,6 +80,33 @@ free_data (EAddressbookModel *model)
 	array = model->priv->contacts;
 	g_ptr_array_foreach (array, (GFunc) g_object_unref, NULL);
 	g_ptr_array_set_size (array, 0);
+
+	g_hash_table_remove_all (model->priv->uid_index);
+}
+
+static void
+index_contact (EAddressbookModel *model,
+	       EContact *contact,
+	       guint index)
+{
+	const gchar *uid;
+
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+	if (uid)
+		g_hash_table_insert (model->priv->uid_index, g_strdup (uid), GUINT_TO_POINTER (index));
+}
+
+static gint
+find_contact_by_uid (EAddressbookModel *model,
+		     const gchar *uid)
+{
+	gpointer value = NULL;
+
+	if (!uid || !g_hash_table_lookup_extended (model->priv->uid_index, uid, NULL, &value))
+		return -1;
+
+	return GPOINTER_TO_INT (value);
 }
 
 static void
@@ -149,6 +179,7 @@ view_create_contact_cb (EBookClientView *client_view,
 	while (contact_list != NULL) {
 		EContact *contact = contact_list->data;
 
+		index_contact (model, contact, array->len);
 		g_ptr_array_add (array, g_object_ref (contact));
 		contact_list = contact_list->next;
 	}
@@ -172,51 +203,55 @@ view_remove_contact_cb (EBookClientView *client_view,
                         const GSList *ids,
                         EAddressbookModel *model)
 {
-	/* XXX we should keep a hash around instead of this O(n*m) loop */
 	const GSList *iter;
 	GArray *indices;
 	GPtrArray *array;
-	gint ii;
+	guint ii, jj;
 
 	array = model->priv->contacts;
 	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 
 	for (iter = ids; iter != NULL; iter = iter->next) {
 		const gchar *target_uid = iter->data;
+		gint index;
 
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *contact;
-			const gchar *uid;
+		index = find_contact_by_uid (model, target_uid);
+		if (index < 0)
+			continue;
 
-			contact = array->pdata[ii];
-			/* check if already removed */
-			if (!contact)
-				continue;
+		g_hash_table_remove (model->priv->uid_index, target_uid);
 
-			uid = e_contact_get_const (contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
+		g_object_unref (array->pdata[index]);
+		array->pdata[index] = NULL;
+		g_array_append_val (indices, index);
+	}
 
-			if (strcmp (uid, target_uid) == 0) {
-				g_object_unref (contact);
-				g_array_append_val (indices, ii);
-				array->pdata[ii] = NULL;
-				break;
-			}
-		}
+	if (!indices->len) {
+		g_array_free (indices, TRUE);
+		return;
 	}
 
-	/* Sort the 'indices' array in descending order, since
-	 * g_ptr_array_remove_index() shifts subsequent elements
-	 * down one position to fill the gap. */
+	/* Sort the 'indices' array in descending order, the order
+	 * in which the listeners can delete the rows one by one. */
 	g_array_sort (indices, sort_descending);
 
-	for (ii = 0; ii < indices->len; ii++) {
-		gint index;
+	/* Close the gaps in one pass, starting at the lowest removed
+	 * index, and update the index of every moved contact. */
+	ii = g_array_index (indices, gint, indices->len - 1);
+
+	for (jj = ii; ii < array->len; ii++) {
+		EContact *contact = array->pdata[ii];
+
+		if (!contact)
+			continue;
 
-		index = g_array_index (indices, gint, ii);
-		g_ptr_array_remove_index (array, index);
+		array->pdata[jj] = contact;
+		index_contact (model, contact, jj);
+		jj++;
 	}
 
+	g_ptr_array_set_size (array, jj);
+
 	g_signal_emit (model, signals[CONTACTS_REMOVED], 0, indices);
 	g_array_free (indices, TRUE);
 
@@ -229,46 +264,42 @@ view_modify_contact_cb (EBookClientView *client_view,
                         EAddressbookModel *model)
 {
 	GPtrArray *array;
+	GArray *indices;
 
 	array = model->priv->contacts;
+	indices = g_array_new (FALSE, FALSE, sizeof (gint));
 
 	while (contact_list != NULL) {
 		EContact *new_contact = contact_list->data;
 		const gchar *target_uid;
-		gint ii;
+		gint index;
 
 		target_uid = e_contact_get_const (new_contact, E_CONTACT_UID);
 		g_warn_if_fail (target_uid != NULL);
 
+		contact_list = contact_list->next;
+
 		/* skip contacts without UID */
-		if (!target_uid) {
-			contact_list = contact_list->next;
+		if (!target_uid)
 			continue;
-		}
-
-		for (ii = 0; ii < array->len; ii++) {
-			EContact *old_contact;
-			const gchar *uid;
 
-			old_contact = array->pdata[ii];
-			g_return_if_fail (old_contact != NULL);
-
-			uid = e_contact_get_const (old_contact, E_CONTACT_UID);
-			g_return_if_fail (uid != NULL);
+		index = find_contact_by_uid (model, target_uid);
+		if (index < 0)
+			continue;
 
-			if (strcmp (uid, target_uid) != 0)
-				continue;
+		g_object_unref (array->pdata[index]);
+		array->pdata[index] = e_contact_duplicate (new_contact);
 
-			g_object_unref (old_contact);
-			array->pdata[ii] = e_contact_duplicate (new_contact);
+		g_array_append_val (indices, index);
+	}
 
-			g_signal_emit (
-				model, signals[CONTACT_CHANGED], 0, ii);
-			break;
-		}
+	/* Notify about a bulk change at once */
+	if (indices->len == 1)
+		g_signal_emit (model, signals[CONTACT_CHANGED], 0, g_array_index (indices, gint, 0));
+	else if (indices->len > 1)
+		g_signal_emit (model, signals[CONTACTS_CHANGED], 0, indices);
 
-		contact_list = contact_list->next;
-	}
+	g_array_free (indices, TRUE);
 }
 
 static void
@@ -564,6 +595,7 @@ addressbook_model_finalize (GObject *object)
 	EAddressbookModel *self = E_ADDRESSBOOK_MODEL (object);
 
 	g_ptr_array_free (self->priv->contacts, TRUE);
+	g_hash_table_destroy (self->priv->uid_index);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_addressbook_model_parent_class)->finalize (object);
@@ -734,6 +766,16 @@ e_addressbook_model_class_init (EAddressbookModelClass *class)
 		G_TYPE_NONE, 1,
 		G_TYPE_INT);
 
+	signals[CONTACTS_CHANGED] = g_signal_new (
+		"contacts_changed",
+		G_OBJECT_CLASS_TYPE (object_class),
+		G_SIGNAL_RUN_LAST,
+		G_STRUCT_OFFSET (EAddressbookModelClass, contacts_changed),
+		NULL, NULL,
+		g_cclosure_marshal_VOID__POINTER,
+		G_TYPE_NONE, 1,
+		G_TYPE_POINTER);
+
 	signals[MODEL_CHANGED] = g_signal_new (
 		"model_changed",
 		G_OBJECT_CLASS_TYPE (object_class),
@@ -758,6 +800,7 @@ e_addressbook_model_init (EAddressbookModel *model)
 {
 	model->priv = e_addressbook_model_get_instance_private (model);
 	model->priv->contacts = g_ptr_array_new ();
+	model->priv->uid_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	model->priv->first_get_view = TRUE;
 }
 
@@ -845,20 +888,18 @@ gint
 e_addressbook_model_find (EAddressbookModel *model,
                           EContact *contact)
 {
-	GPtrArray *array;
-	gint ii;
+	const gchar *uid;
+	guint index;
 
 	g_return_val_if_fail (E_IS_ADDRESSBOOK_MODEL (model), -1);
 	g_return_val_if_fail (E_IS_CONTACT (contact), -1);
 
-	array = model->priv->contacts;
-	for (ii = 0; ii < array->len; ii++) {
-		EContact *candidate = array->pdata[ii];
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (uid)
+		return find_contact_by_uid (model, uid);
 
-		if (contact == candidate ||
-		    g_strcmp0 (e_contact_get_const (contact, E_CONTACT_UID), e_contact_get_const (candidate, E_CONTACT_UID)) == 0)
-			return ii;
-	}
+	if (g_ptr_array_find (model->priv->contacts, contact, &index))
+		return index;
 
 	return -1;
 }
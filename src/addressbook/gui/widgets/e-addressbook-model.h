@@ -60,6 +60,8 @@ struct _EAddressbookModelClass {
 						 gpointer id_list);
 	void		(*contact_changed)	(EAddressbookModel *model,
 						 gint index);
+	void		(*contacts_changed)	(EAddressbookModel *model,
+						 gpointer indices);
 	void		(*model_changed)	(EAddressbookModel *model);
 	void		(*stop_state_changed)	(EAddressbookModel *model);
 };
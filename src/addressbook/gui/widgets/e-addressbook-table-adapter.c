@@ -57,7 +57,7 @@ typedef enum _EAddressField {
 struct _EAddressbookTableAdapterPrivate {
 	EAddressbookModel *model;
 
-	gint create_contact_id, remove_contact_id, modify_contact_id, model_changed_id;
+	gint create_contact_id, remove_contact_id, modify_contact_id, modify_contacts_id, model_changed_id;
 
 	GHashTable *emails;
 };
@@ -128,11 +128,13 @@ unlink_model (EAddressbookTableAdapter *adapter)
 	g_signal_handler_disconnect (priv->model, priv->create_contact_id);
 	g_signal_handler_disconnect (priv->model, priv->remove_contact_id);
 	g_signal_handler_disconnect (priv->model, priv->modify_contact_id);
+	g_signal_handler_disconnect (priv->model, priv->modify_contacts_id);
 	g_signal_handler_disconnect (priv->model, priv->model_changed_id);
 
 	priv->create_contact_id = 0;
 	priv->remove_contact_id = 0;
 	priv->modify_contact_id = 0;
+	priv->modify_contacts_id = 0;
 	priv->model_changed_id = 0;
 
 	g_object_unref (priv->model);
@@ -494,10 +496,14 @@ remove_contacts (EAddressbookModel *model,
 	g_hash_table_remove_all (adapter->priv->emails);
 
 	e_table_model_pre_change (E_TABLE_MODEL (adapter));
-	if (count == 1)
+
+	/* The indices are sorted in descending order; a contiguous
+	 * range can be deleted without rebuilding the whole table. */
+	if (count > 0 &&
+	    g_array_index (indices, gint, 0) - g_array_index (indices, gint, count - 1) == count - 1)
 		e_table_model_rows_deleted (
 			E_TABLE_MODEL (adapter),
-			g_array_index (indices, gint, 0), 1);
+			g_array_index (indices, gint, count - 1), count);
 	else
 		e_table_model_changed (E_TABLE_MODEL (adapter));
 }
@@ -514,6 +520,20 @@ modify_contact (EAddressbookModel *model,
 	e_table_model_row_changed (E_TABLE_MODEL (adapter), index);
 }
 
+static void
+modify_contacts (EAddressbookModel *model,
+                 gpointer data,
+                 EAddressbookTableAdapter *adapter)
+{
+	/* clear whole cache */
+	g_hash_table_remove_all (adapter->priv->emails);
+
+	/* One change for the whole batch, instead of re-sorting
+	 * the table after each modified row. */
+	e_table_model_pre_change (E_TABLE_MODEL (adapter));
+	e_table_model_changed (E_TABLE_MODEL (adapter));
+}
+
 static void
 model_changed (EAddressbookModel *model,
                EAddressbookTableAdapter *adapter)
@@ -546,6 +566,10 @@ e_addressbook_table_adapter_construct (EAddressbookTableAdapter *adapter,
 		priv->model, "contact_changed",
 		G_CALLBACK (modify_contact), adapter);
 
+	priv->modify_contacts_id = g_signal_connect (
+		priv->model, "contacts_changed",
+		G_CALLBACK (modify_contacts), adapter);
+
 	priv->model_changed_id = g_signal_connect (
 		priv->model, "model_changed",
 		G_CALLBACK (model_changed), adapter);
@@ -28,6 +28,11 @@
    but only those affected when unselecting all. */
 #define TRACK_N_SELECTED 5
 
+/* How many contacts can be cached at most; when reached, those
+   far from the visible range are dropped and read again on demand,
+   thus the memory use does not grow with the size of the book */
+#define MAX_CACHED_ITEMS 1000
+
 static GtkTargetEntry dnd_types[] = {
 	{ (gchar *) "text/x-source-vcard", 0, E_CONTACT_CARD_BOX_DND_TYPE_SOURCE_VCARD_LIST },
 	{ (gchar *) "text/x-vcard", 0, E_CONTACT_CARD_BOX_DND_TYPE_VCARD_LIST }
@@ -55,6 +60,7 @@ struct _EContactCardContainer {
 
 	GPtrArray *cards; /* EContactCard * */
 	GArray *items; /* ItemState */
+	guint n_cached_items; /* how many 'items' have set the 'item' */
 	guint items_range_start;
 	guint items_range_length;
 	gint n_cols;
@@ -372,6 +378,35 @@ e_contact_card_container_schedule_range_read (EContactCardContainer *self,
 	e_contact_card_container_read_next_range (self);
 }
 
+static void
+e_contact_card_container_trim_cache (EContactCardContainer *self)
+{
+	guint keep_start, keep_end, ii;
+
+	if (self->n_cached_items <= MAX_CACHED_ITEMS)
+		return;
+
+	/* Keep the items around the visible range, to not re-read them on a short scroll */
+	keep_start = self->items_range_start > MAX_CACHED_ITEMS / 4 ? self->items_range_start - (MAX_CACHED_ITEMS / 4) : 0;
+	keep_end = MIN (self->items->len, self->items_range_start + self->items_range_length + (MAX_CACHED_ITEMS / 4));
+
+	for (ii = 0; ii < self->items->len && self->n_cached_items > 0; ii++) {
+		ItemState *state;
+
+		if (ii == keep_start && keep_start < keep_end) {
+			ii = keep_end - 1;
+			continue;
+		}
+
+		state = &g_array_index (self->items, ItemState, ii);
+
+		if (state->item) {
+			g_clear_object (&state->item);
+			self->n_cached_items--;
+		}
+	}
+}
+
 static void
 e_contact_card_container_got_items_cb (GObject *source_object,
 				       GAsyncResult *result,
@@ -403,6 +438,7 @@ e_contact_card_container_got_items_cb (GObject *source_object,
 				GtkWidget *card;
 
 				state->item = g_object_ref (item);
+				self->n_cached_items++;
 
 				selected_or_focused_changed = selected_or_focused_changed || state->selected || item_index == self->focused_index;
 
@@ -427,6 +463,7 @@ e_contact_card_container_got_items_cb (GObject *source_object,
 	g_warn_if_fail (self->ongoing_range_read == gid);
 	self->ongoing_range_read = NULL;
 
+	e_contact_card_container_trim_cache (self);
 	e_contact_card_container_read_next_range (self);
 
 	g_clear_error (&local_error);
@@ -966,6 +1003,7 @@ e_contact_card_container_set_n_items (EContactCardContainer *self,
 		state->selected = FALSE;
 	}
 
+	self->n_cached_items = 0;
 	self->tracked_selected_index = 0;
 	self->n_known_selected = 0;
 
@@ -2630,5 +2668,7 @@ e_contact_card_box_refresh (EContactCardBox *self)
 		g_clear_object (&item_state->item);
 	}
 
+	self->priv->container->n_cached_items = 0;
+
 	e_contact_card_container_update (self->priv->container);
 }
@@ -15,6 +15,21 @@
 #define LOCK_PROPS() g_rec_mutex_lock (&data_model->priv->props_lock)
 #define UNLOCK_PROPS() g_rec_mutex_unlock (&data_model->priv->props_lock)
 
+/* Recurrences are expanded in buckets of this size, thus moving the time
+   range by a week does not expand the whole series again, only the part
+   which had not been expanded yet. */
+#define EXPANSION_BUCKET_SIZE (28 * 24 * 60 * 60)
+
+/* How many buckets can be remembered for one component; the expansion
+   starts over when the time range goes beyond it. */
+#define EXPANSION_MAX_BUCKETS 16
+
+/* How many components one recurrence expansion job handles */
+#define EXPAND_CHUNK_SIZE 16
+
+/* How long to wait for other expansion jobs before delivering the results */
+#define EXPAND_NOTIFY_DELAY_MS 250
+
 struct _ECalDataModelPrivate {
 	GThread *main_thread;
 	ESourceRegistry *registry;
@@ -39,6 +54,9 @@ struct _ECalDataModelPrivate {
 
 	guint32 views_update_freeze;
 	gboolean views_update_required;
+
+	gint pending_expand_jobs;
+	guint notify_recurrences_id;
 };
 
 enum {
@@ -68,6 +86,13 @@ typedef struct _ComponentData {
 	gboolean is_detached;
 } ComponentData;
 
+typedef struct _ExpansionData {
+	gchar *icomp_str; /* the component the instances were generated from */
+	time_t covered_start;
+	time_t covered_end;
+	GHashTable *instances; /* ECalComponentId ~> ComponentData */
+} ExpansionData;
+
 typedef struct _ViewData {
 	gint ref_count;
 	GRecMutex lock;
@@ -84,9 +109,11 @@ typedef struct _ViewData {
 	GHashTable *components; /* ECalComponentId ~> ComponentData */
 	GHashTable *lost_components; /* ECalComponentId ~> ComponentData; when re-running view, valid till 'complete' is received */
 	gboolean received_complete;
-	GSList *to_expand_recurrences; /* ICalComponent */
 	GSList *expanded_recurrences; /* ComponentData */
-	gint pending_expand_recurrences; /* how many is waiting to be processed */
+	gint pending_expand_recurrences; /* how many jobs is waiting to be processed */
+	gint finished_expand_recurrences; /* how many jobs finished since the last notify */
+	GHashTable *expansions; /* gchar *uid ~> ExpansionData */
+	guint expansions_stamp; /* increased with each invalidated expansion */
 
 	GCancellable *cancellable;
 } ViewData;
@@ -127,6 +154,32 @@ component_data_free (gpointer ptr)
 	}
 }
 
+static ExpansionData *
+expansion_data_new (gchar *icomp_str) /* (transfer full) */
+{
+	ExpansionData *expansion;
+
+	expansion = g_new0 (ExpansionData, 1);
+	expansion->icomp_str = icomp_str;
+	expansion->instances = g_hash_table_new_full (
+		(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
+		(GDestroyNotify) e_cal_component_id_free, component_data_free);
+
+	return expansion;
+}
+
+static void
+expansion_data_free (gpointer ptr)
+{
+	ExpansionData *expansion = ptr;
+
+	if (expansion) {
+		g_hash_table_destroy (expansion->instances);
+		g_free (expansion->icomp_str);
+		g_free (expansion);
+	}
+}
+
 static gboolean
 component_data_equal (ComponentData *comp_data1,
 		      ComponentData *comp_data2)
@@ -208,6 +261,7 @@ view_data_new (ECalClient *client)
 	view_data->components = g_hash_table_new_full (
 		e_cal_component_id_hash, e_cal_component_id_equal,
 		e_cal_component_id_free, component_data_free);
+	view_data->expansions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, expansion_data_free);
 
 	return view_data;
 }
@@ -259,8 +313,8 @@ view_data_unref (gpointer ptr)
 			g_hash_table_destroy (view_data->components);
 			if (view_data->lost_components)
 				g_hash_table_destroy (view_data->lost_components);
-			g_slist_free_full (view_data->to_expand_recurrences, g_object_unref);
 			g_slist_free_full (view_data->expanded_recurrences, component_data_free);
+			g_hash_table_destroy (view_data->expansions);
 			g_rec_mutex_clear (&view_data->lock);
 			g_free (view_data);
 		}
@@ -283,6 +337,20 @@ view_data_unlock (ViewData *view_data)
 	g_rec_mutex_unlock (&view_data->lock);
 }
 
+/* Expects the view_data to be locked */
+static void
+view_data_invalidate_expansion (ViewData *view_data,
+				const gchar *uid)
+{
+	g_return_if_fail (view_data != NULL);
+
+	if (uid)
+		g_hash_table_remove (view_data->expansions, uid);
+
+	/* The expansion can be used by the expand thread at the moment */
+	view_data->expansions_stamp++;
+}
+
 static SubscriberData *
 subscriber_data_new (ECalDataModelSubscriber *subscriber,
 		     time_t range_start,
@@ -972,112 +1040,149 @@ cal_data_model_gather_components (gpointer key,
 	}
 }
 
-typedef struct _NotifyRecurrencesData {
-	ECalDataModel *data_model;
-	ECalClient *client;
-} NotifyRecurrencesData;
-
-static gboolean
-cal_data_model_notify_recurrences_cb (gpointer user_data)
+/* Expects the view_data to be locked */
+static void
+cal_data_model_notify_view_recurrences (ECalDataModel *data_model,
+					ViewData *view_data)
 {
-	NotifyRecurrencesData *notif_data = user_data;
-	ECalDataModel *data_model;
-	ViewData *view_data;
+	GHashTable *gathered_uids;
+	GHashTable *known_instances;
+	GSList *expanded_recurrences, *link;
+	gint n_finished;
 
-	g_return_val_if_fail (notif_data != NULL, FALSE);
+	n_finished = view_data->finished_expand_recurrences;
+	view_data->finished_expand_recurrences = 0;
 
-	data_model = notif_data->data_model;
+	if (!n_finished && !view_data->expanded_recurrences)
+		return;
 
-	LOCK_PROPS ();
+	expanded_recurrences = view_data->expanded_recurrences;
+	view_data->expanded_recurrences = NULL;
 
-	view_data = g_hash_table_lookup (data_model->priv->views, notif_data->client);
-	if (view_data)
-		view_data_ref (view_data);
+	gathered_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	known_instances = g_hash_table_new_full (
+		(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
+		(GDestroyNotify) e_cal_component_id_free, component_data_free);
 
-	UNLOCK_PROPS ();
+	for (link = expanded_recurrences; link && view_data->is_used; link = g_slist_next (link)) {
+		ComponentData *comp_data = link->data;
+		ICalComponent *icomp;
+		const gchar *uid;
 
-	if (view_data) {
-		GHashTable *gathered_uids;
-		GHashTable *known_instances;
-		GSList *expanded_recurrences, *link;
+		if (!comp_data)
+			continue;
 
-		view_data_lock (view_data);
-		expanded_recurrences = view_data->expanded_recurrences;
-		view_data->expanded_recurrences = NULL;
+		icomp = e_cal_component_get_icalcomponent (comp_data->component);
+		if (!icomp || !i_cal_component_get_uid (icomp))
+			continue;
 
-		cal_data_model_freeze_all_subscribers (data_model);
+		uid = i_cal_component_get_uid (icomp);
 
-		gathered_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-		known_instances = g_hash_table_new_full (
-			(GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
-			(GDestroyNotify) e_cal_component_id_free, component_data_free);
+		if (!g_hash_table_contains (gathered_uids, uid)) {
+			GatherComponentsData gather_data;
 
-		for (link = expanded_recurrences; link && view_data->is_used; link = g_slist_next (link)) {
-			ComponentData *comp_data = link->data;
-			ICalComponent *icomp;
-			const gchar *uid;
+			gather_data.uid = uid;
+			gather_data.pcomponent_ids = NULL;
+			gather_data.component_ids_hash = known_instances;
+			gather_data.copy_ids = TRUE;
+			gather_data.all_instances = FALSE;
 
-			if (!comp_data)
-				continue;
+			g_hash_table_foreach (view_data->components,
+				cal_data_model_gather_components, &gather_data);
 
-			icomp = e_cal_component_get_icalcomponent (comp_data->component);
-			if (!icomp || !i_cal_component_get_uid (icomp))
-				continue;
+			g_hash_table_insert (gathered_uids, g_strdup (uid), GINT_TO_POINTER (1));
+		}
 
-			uid = i_cal_component_get_uid (icomp);
+		/* Steal the comp_data */
+		link->data = NULL;
 
-			if (!g_hash_table_contains (gathered_uids, uid)) {
-				GatherComponentsData gather_data;
+		cal_data_model_process_added_component (data_model, view_data, comp_data, known_instances);
+	}
 
-				gather_data.uid = uid;
-				gather_data.pcomponent_ids = NULL;
-				gather_data.component_ids_hash = known_instances;
-				gather_data.copy_ids = TRUE;
-				gather_data.all_instances = FALSE;
+	if (view_data->is_used && g_hash_table_size (known_instances) > 0) {
+		cal_data_model_remove_components (data_model, view_data->client, known_instances, view_data->components);
+		g_hash_table_remove_all (known_instances);
+	}
 
-				g_hash_table_foreach (view_data->components,
-					cal_data_model_gather_components, &gather_data);
+	/* g_atomic_int_add() returns the value before the addition */
+	if (n_finished > 0 &&
+	    g_atomic_int_add (&view_data->pending_expand_recurrences, -n_finished) == n_finished &&
+	    view_data->is_used && view_data->lost_components && view_data->received_complete) {
+		cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
+		g_hash_table_destroy (view_data->lost_components);
+		view_data->lost_components = NULL;
+	}
 
-				g_hash_table_insert (gathered_uids, g_strdup (uid), GINT_TO_POINTER (1));
-			}
+	g_hash_table_destroy (gathered_uids);
+	g_hash_table_destroy (known_instances);
 
-			/* Steal the comp_data */
-			link->data = NULL;
+	g_slist_free_full (expanded_recurrences, component_data_free);
+}
 
-			cal_data_model_process_added_component (data_model, view_data, comp_data, known_instances);
-		}
+/* Delivers the expanded recurrences of all the clients at once,
+   thus the subscribers are frozen and thawed only once. */
+static gboolean
+cal_data_model_notify_recurrences_cb (gpointer user_data)
+{
+	ECalDataModel *data_model = user_data;
+	GHashTableIter iter;
+	gpointer value;
+	GSList *views = NULL, *link;
 
-		if (view_data->is_used && g_hash_table_size (known_instances) > 0) {
-			cal_data_model_remove_components (data_model, view_data->client, known_instances, view_data->components);
-			g_hash_table_remove_all (known_instances);
-		}
+	g_return_val_if_fail (E_IS_CAL_DATA_MODEL (data_model), FALSE);
 
-		if (g_atomic_int_dec_and_test (&view_data->pending_expand_recurrences) &&
-		    view_data->is_used && view_data->lost_components && view_data->received_complete) {
-			cal_data_model_remove_components (data_model, view_data->client, view_data->lost_components, NULL);
-			g_hash_table_destroy (view_data->lost_components);
-			view_data->lost_components = NULL;
-		}
+	LOCK_PROPS ();
 
-		g_hash_table_destroy (gathered_uids);
-		g_hash_table_destroy (known_instances);
+	/* The source could be replaced with a sooner one meanwhile */
+	if (data_model->priv->notify_recurrences_id == g_source_get_id (g_main_current_source ()))
+		data_model->priv->notify_recurrences_id = 0;
 
-		view_data_unlock (view_data);
+	g_hash_table_iter_init (&iter, data_model->priv->views);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ViewData *view_data = value;
 
-		cal_data_model_thaw_all_subscribers (data_model);
+		views = g_slist_prepend (views, view_data_ref (view_data));
+	}
 
-		view_data_unref (view_data);
+	UNLOCK_PROPS ();
 
-		g_slist_free_full (expanded_recurrences, component_data_free);
+	cal_data_model_freeze_all_subscribers (data_model);
+
+	for (link = views; link; link = g_slist_next (link)) {
+		ViewData *view_data = link->data;
+
+		view_data_lock (view_data);
+		cal_data_model_notify_view_recurrences (data_model, view_data);
+		view_data_unlock (view_data);
 	}
 
-	g_clear_object (&notif_data->client);
-	g_clear_object (&notif_data->data_model);
-	g_slice_free (NotifyRecurrencesData, notif_data);
+	cal_data_model_thaw_all_subscribers (data_model);
+
+	g_slist_free_full (views, view_data_unref);
 
 	return FALSE;
 }
 
+static void
+cal_data_model_schedule_notify_recurrences (ECalDataModel *data_model,
+					    gboolean immediately)
+{
+	LOCK_PROPS ();
+
+	if (immediately && data_model->priv->notify_recurrences_id) {
+		g_source_remove (data_model->priv->notify_recurrences_id);
+		data_model->priv->notify_recurrences_id = 0;
+	}
+
+	if (!data_model->priv->notify_recurrences_id) {
+		data_model->priv->notify_recurrences_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+			immediately ? 1 : EXPAND_NOTIFY_DELAY_MS, cal_data_model_notify_recurrences_cb,
+			g_object_ref (data_model), g_object_unref);
+	}
+
+	UNLOCK_PROPS ();
+}
+
 typedef struct
 {
 	ECalClient *client;
@@ -1138,87 +1243,244 @@ cal_data_model_instance_generated (ICalComponent *icomp,
 }
 
 static void
-cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
-					  gpointer user_data)
+cal_data_model_generate_instances (ECalDataModel *data_model,
+				   ECalClient *client,
+				   ICalComponent *icomp,
+				   time_t range_start,
+				   time_t range_end,
+				   GSList **pexpanded_recurrences,
+				   GCancellable *cancellable)
 {
-	ECalClient *client = user_data;
-	GSList *to_expand_recurrences, *link;
-	GSList *expanded_recurrences = NULL;
-	GCancellable *cancellable;
-	time_t range_start, range_end;
-	ViewData *view_data;
+	GenerateInstancesData gid;
 
-	g_return_if_fail (E_IS_CAL_DATA_MODEL (data_model));
+	gid.client = client;
+	gid.pexpanded_recurrences = pexpanded_recurrences;
+	gid.zone = g_object_ref (data_model->priv->zone);
+	gid.skip_cancelled = data_model->priv->skip_cancelled;
 
-	LOCK_PROPS ();
+	e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end, cancellable,
+		cal_data_model_instance_generated, &gid);
 
-	view_data = g_hash_table_lookup (data_model->priv->views, client);
-	if (view_data)
-		view_data_ref (view_data);
+	g_clear_object (&gid.zone);
+}
 
-	range_start = data_model->priv->range_start;
-	range_end = data_model->priv->range_end;
+static void
+cal_data_model_expand_into (ECalDataModel *data_model,
+			    ECalClient *client,
+			    ICalComponent *icomp,
+			    ExpansionData *expansion,
+			    time_t range_start,
+			    time_t range_end,
+			    GCancellable *cancellable)
+{
+	GSList *generated = NULL, *link;
 
-	UNLOCK_PROPS ();
+	cal_data_model_generate_instances (data_model, client, icomp, range_start, range_end, &generated, cancellable);
+
+	/* Instances crossing the bucket border are generated twice, the hash table deduplicates them */
+	for (link = generated; link; link = g_slist_next (link)) {
+		ComponentData *comp_data = link->data;
+
+		g_hash_table_insert (expansion->instances, e_cal_component_get_id (comp_data->component), comp_data);
+	}
+
+	g_slist_free (generated);
+}
+
+static time_t
+cal_data_model_expansion_bucket_start (time_t tt)
+{
+	time_t rem = tt % EXPANSION_BUCKET_SIZE;
+
+	if (rem < 0)
+		rem += EXPANSION_BUCKET_SIZE;
+
+	return tt - rem;
+}
+
+/* Expands only those buckets of the range, which are not covered by the expansion yet */
+static void
+cal_data_model_expand_missing (ECalDataModel *data_model,
+			       ECalClient *client,
+			       ICalComponent *icomp,
+			       ExpansionData *expansion,
+			       time_t range_start,
+			       time_t range_end,
+			       GCancellable *cancellable)
+{
+	time_t needed_start, needed_end;
+
+	needed_start = cal_data_model_expansion_bucket_start (range_start);
+	needed_end = cal_data_model_expansion_bucket_start (range_end) + EXPANSION_BUCKET_SIZE;
+
+	if (expansion->covered_start >= expansion->covered_end ||
+	    /* Disjoint with the covered range; the gap is not worth expanding */
+	    needed_end < expansion->covered_start ||
+	    needed_start > expansion->covered_end ||
+	    (MAX (needed_end, expansion->covered_end) - MIN (needed_start, expansion->covered_start)) / EXPANSION_BUCKET_SIZE > EXPANSION_MAX_BUCKETS) {
+		g_hash_table_remove_all (expansion->instances);
+
+		cal_data_model_expand_into (data_model, client, icomp, expansion, needed_start, needed_end, cancellable);
+
+		expansion->covered_start = needed_start;
+		expansion->covered_end = needed_end;
 
-	if (!view_data) {
-		g_object_unref (client);
 		return;
 	}
 
+	if (needed_start < expansion->covered_start) {
+		cal_data_model_expand_into (data_model, client, icomp, expansion, needed_start, expansion->covered_start, cancellable);
+		expansion->covered_start = needed_start;
+	}
+
+	if (needed_end > expansion->covered_end) {
+		cal_data_model_expand_into (data_model, client, icomp, expansion, expansion->covered_end, needed_end, cancellable);
+		expansion->covered_end = needed_end;
+	}
+}
+
+static void
+cal_data_model_expand_recurrences_cached (ECalDataModel *data_model,
+					  ViewData *view_data,
+					  ICalComponent *icomp,
+					  time_t range_start,
+					  time_t range_end,
+					  GSList **pexpanded_recurrences,
+					  GCancellable *cancellable)
+{
+	ExpansionData *expansion = NULL;
+	GHashTableIter iter;
+	gpointer value;
+	gpointer stolen_uid = NULL;
+	const gchar *uid;
+	gchar *icomp_str;
+	guint expansions_stamp;
+
+	uid = i_cal_component_get_uid (icomp);
+	icomp_str = i_cal_component_as_ical_string (icomp);
+
 	view_data_lock (view_data);
 
-	if (!view_data->is_used) {
-		view_data_unlock (view_data);
-		view_data_unref (view_data);
-		g_object_unref (client);
-		return;
+	/* Steal it, thus the lock is not held while expanding */
+	if (g_hash_table_steal_extended (view_data->expansions, uid, &stolen_uid, (gpointer *) &expansion)) {
+		g_free (stolen_uid);
+
+		if (g_strcmp0 (expansion->icomp_str, icomp_str) != 0)
+			g_clear_pointer (&expansion, expansion_data_free);
 	}
 
-	to_expand_recurrences = view_data->to_expand_recurrences;
-	view_data->to_expand_recurrences = NULL;
+	expansions_stamp = view_data->expansions_stamp;
+
+	view_data_unlock (view_data);
+
+	if (expansion)
+		g_free (icomp_str);
+	else
+		expansion = expansion_data_new (icomp_str);
+
+	cal_data_model_expand_missing (data_model, view_data->client, icomp, expansion, range_start, range_end, cancellable);
 
-	cancellable = view_data->cancellable ? g_object_ref (view_data->cancellable) : NULL;
+	g_hash_table_iter_init (&iter, expansion->instances);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ComponentData *comp_data = value;
+
+		if (comp_data->instance_start <= range_end && comp_data->instance_end >= range_start) {
+			ECalComponent *comp_copy;
+
+			comp_copy = e_cal_component_clone (comp_data->component);
+			*pexpanded_recurrences = g_slist_prepend (*pexpanded_recurrences,
+				component_data_new (comp_copy, comp_data->instance_start, comp_data->instance_end, FALSE));
+			g_object_unref (comp_copy);
+		}
+	}
+
+	view_data_lock (view_data);
+
+	/* Do not remember the expansion when it is incomplete or it had been invalidated meanwhile */
+	if (expansions_stamp == view_data->expansions_stamp &&
+	    !g_cancellable_is_cancelled (cancellable))
+		g_hash_table_insert (view_data->expansions, g_strdup (uid), expansion);
+	else
+		expansion_data_free (expansion);
 
 	view_data_unlock (view_data);
+}
+
+typedef struct _ExpandRecurrencesData {
+	ViewData *view_data;
+	GCancellable *cancellable;
+	GSList *icomps; /* ICalComponent */
+} ExpandRecurrencesData;
+
+static void
+expand_recurrences_data_free (ExpandRecurrencesData *er_data)
+{
+	if (er_data) {
+		g_clear_pointer (&er_data->view_data, view_data_unref);
+		g_clear_object (&er_data->cancellable);
+		g_slist_free_full (er_data->icomps, g_object_unref);
+		g_slice_free (ExpandRecurrencesData, er_data);
+	}
+}
+
+static void
+cal_data_model_expand_recurrences_thread (ECalDataModel *data_model,
+					  gpointer user_data)
+{
+	ExpandRecurrencesData *er_data = user_data;
+	ViewData *view_data;
+	GSList *link;
+	GSList *expanded_recurrences = NULL;
+	time_t range_start, range_end;
 
-	for (link = to_expand_recurrences; link && view_data->is_used && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+	g_return_if_fail (E_IS_CAL_DATA_MODEL (data_model));
+	g_return_if_fail (er_data != NULL);
+
+	view_data = er_data->view_data;
+
+	LOCK_PROPS ();
+
+	range_start = data_model->priv->range_start;
+	range_end = data_model->priv->range_end;
+
+	UNLOCK_PROPS ();
+
+	for (link = er_data->icomps; link && view_data->is_used && !g_cancellable_is_cancelled (er_data->cancellable); link = g_slist_next (link)) {
 		ICalComponent *icomp = link->data;
-		GenerateInstancesData gid;
 
 		if (!icomp)
 			continue;
 
-		gid.client = client;
-		gid.pexpanded_recurrences = &expanded_recurrences;
-		gid.zone = g_object_ref (data_model->priv->zone);
-		gid.skip_cancelled = data_model->priv->skip_cancelled;
+		/* Unbounded range expands everything, which is not worth remembering */
+		if (range_start == (time_t) 0 && range_end == (time_t) 0) {
+			cal_data_model_generate_instances (data_model, view_data->client, icomp, range_start, range_end,
+				&expanded_recurrences, er_data->cancellable);
+		} else {
+			cal_data_model_expand_recurrences_cached (data_model, view_data, icomp, range_start, range_end,
+				&expanded_recurrences, er_data->cancellable);
+		}
+	}
 
-		e_cal_client_generate_instances_for_object_sync (client, icomp, range_start, range_end, cancellable,
-			cal_data_model_instance_generated, &gid);
+	view_data_lock (view_data);
 
-		g_clear_object (&gid.zone);
+	/* Results of a cancelled view would mix with the new view */
+	if (expanded_recurrences && !g_cancellable_is_cancelled (er_data->cancellable)) {
+		view_data->expanded_recurrences = g_slist_concat (view_data->expanded_recurrences, expanded_recurrences);
+		expanded_recurrences = NULL;
 	}
 
-	g_slist_free_full (to_expand_recurrences, g_object_unref);
+	view_data->finished_expand_recurrences++;
 
-	view_data_lock (view_data);
-	if (expanded_recurrences)
-		view_data->expanded_recurrences = g_slist_concat (view_data->expanded_recurrences, expanded_recurrences);
-	if (view_data->is_used) {
-		NotifyRecurrencesData *notif_data;
+	view_data_unlock (view_data);
 
-		notif_data = g_slice_new0 (NotifyRecurrencesData);
-		notif_data->data_model = g_object_ref (data_model);
-		notif_data->client = g_object_ref (client);
+	g_slist_free_full (expanded_recurrences, component_data_free);
 
-		g_timeout_add (1, cal_data_model_notify_recurrences_cb, notif_data);
-	}
+	/* Deliver right away when nothing else is pending, otherwise
+	   let the other jobs finish, to not repaint the views too often */
+	cal_data_model_schedule_notify_recurrences (data_model,
+		g_atomic_int_dec_and_test (&data_model->priv->pending_expand_jobs));
 
-	view_data_unlock (view_data);
-	view_data_unref (view_data);
-	g_object_unref (client);
-	g_clear_object (&cancellable);
+	expand_recurrences_data_free (er_data);
 }
 
 static void
@@ -1278,6 +1540,14 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 			if (!icomp || !i_cal_component_get_uid (icomp))
 				continue;
 
+			/* A change of a detached instance influences the expansion too;
+			   additions before the 'complete' usually only re-populate the view,
+			   but a detached instance can be new to the cached expansion, when
+			   it had been created or changed out of the view range */
+			if (!is_add || view_data->received_complete ||
+			    e_cal_util_component_is_instance (icomp))
+				view_data_invalidate_expansion (view_data, i_cal_component_get_uid (icomp));
+
 			if (data_model->priv->expand_recurrences &&
 			    !e_cal_util_component_is_instance (icomp) &&
 			    e_cal_util_component_has_recurrences (icomp)) {
@@ -1322,15 +1592,30 @@ cal_data_model_process_modified_or_added_objects (ECalClientView *view,
 
 		cal_data_model_thaw_all_subscribers (data_model);
 
-		if (to_expand_recurrences) {
-			view_data_lock (view_data);
-			view_data->to_expand_recurrences = g_slist_concat (
-				view_data->to_expand_recurrences, to_expand_recurrences);
+		/* Split the work into chunks, thus it spreads over the thread pool */
+		while (to_expand_recurrences) {
+			ExpandRecurrencesData *er_data;
+			GSList *chunk_end;
+
+			chunk_end = g_slist_nth (to_expand_recurrences, EXPAND_CHUNK_SIZE - 1);
+
+			er_data = g_slice_new0 (ExpandRecurrencesData);
+			er_data->view_data = view_data_ref (view_data);
+			er_data->cancellable = view_data->cancellable ? g_object_ref (view_data->cancellable) : NULL;
+			er_data->icomps = to_expand_recurrences;
+
+			if (chunk_end) {
+				to_expand_recurrences = chunk_end->next;
+				chunk_end->next = NULL;
+			} else {
+				to_expand_recurrences = NULL;
+			}
+
 			g_atomic_int_inc (&view_data->pending_expand_recurrences);
-			view_data_unlock (view_data);
+			g_atomic_int_inc (&data_model->priv->pending_expand_jobs);
 
 			cal_data_model_submit_internal_thread_job (data_model,
-				cal_data_model_expand_recurrences_thread, g_object_ref (client));
+				cal_data_model_expand_recurrences_thread, er_data);
 		}
 	}
 
@@ -1400,6 +1685,8 @@ cal_data_model_view_objects_removed (ECalClientView *view,
 			const ECalComponentId *id = link->data;
 
 			if (id) {
+				view_data_invalidate_expansion (view_data, e_cal_component_id_get_uid (id));
+
 				if (!e_cal_component_id_get_rid (id)) {
 					if (!g_hash_table_contains (gathered_uids, e_cal_component_id_get_uid (id))) {
 						GatherComponentsData gather_data;
@@ -2041,6 +2328,11 @@ cal_data_model_dispose (GObject *object)
 
 	data_model->priv->disposing = TRUE;
 
+	if (data_model->priv->notify_recurrences_id) {
+		g_source_remove (data_model->priv->notify_recurrences_id);
+		data_model->priv->notify_recurrences_id = 0;
+	}
+
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_cal_data_model_parent_class)->dispose (object);
 }
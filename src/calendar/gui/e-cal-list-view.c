@@ -305,6 +305,9 @@ setup_e_table (ECalListView *cal_list_view)
 	e_table_extras_add_compare (
 		extras, "date-compare",
 		e_cell_date_edit_compare_cb);
+	e_table_extras_add_int_key (
+		extras, "date-compare",
+		e_cell_date_edit_int_key_cb);
 	e_table_extras_add_compare (
 		extras, "status-compare",
 		e_cal_model_util_status_compare_cb);
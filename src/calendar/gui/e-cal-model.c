@@ -43,6 +43,20 @@ struct _ECalModelPrivate {
 	/* Array for storing the objects. Each element is of type ECalModelComponent */
 	GPtrArray *objects;
 
+	/* ECalModelComponent * ~> IndexEntry *, for every item in 'objects' */
+	GHashTable *objects_entries;
+	/* ComponentKey * ~> ECalModelComponent *; keys are owned by 'objects_entries' */
+	GHashTable *objects_index;
+	/* gchar *uid ~> GPtrArray { ECalModelComponent * }, for lookups without client or rid */
+	GHashTable *uids_index;
+	/* Rows of the IndexEntry-s below this are known to be up to date */
+	guint rows_valid;
+
+	/* Nesting of ECalDataModelSubscriber::freeze() */
+	guint freeze_count;
+	/* Rows appended at the end of 'objects' while frozen, not notified yet */
+	guint n_pending_inserts;
+
 	ICalComponentKind kind;
 	ICalTimezone *zone;
 
@@ -1146,6 +1160,10 @@ cal_model_finalize (GObject *object)
 	}
 	g_ptr_array_free (self->priv->objects, TRUE);
 
+	g_hash_table_destroy (self->priv->objects_index);
+	g_hash_table_destroy (self->priv->uids_index);
+	g_hash_table_destroy (self->priv->objects_entries);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_cal_model_parent_class)->finalize (object);
 }
@@ -1791,44 +1809,297 @@ cal_model_value_to_string (ETableModel *etm,
 	return g_strdup ("");
 }
 
+typedef struct _ComponentKey {
+	ECalClient *client; /* not referenced */
+	gchar *uid;
+	gchar *rid; /* NULL for the main component */
+} ComponentKey;
+
+typedef struct _IndexEntry {
+	ComponentKey key;
+	guint row;
+} IndexEntry;
+
+static guint
+component_key_hash (gconstpointer ptr)
+{
+	const ComponentKey *key = ptr;
+	guint hash;
+
+	hash = g_direct_hash (key->client) ^ g_str_hash (key->uid);
+
+	if (key->rid)
+		hash = (hash * 31) + g_str_hash (key->rid);
+
+	return hash;
+}
+
+static gboolean
+component_key_equal (gconstpointer ptr1,
+		     gconstpointer ptr2)
+{
+	const ComponentKey *key1 = ptr1, *key2 = ptr2;
+
+	return key1->client == key2->client &&
+		g_strcmp0 (key1->uid, key2->uid) == 0 &&
+		g_strcmp0 (key1->rid, key2->rid) == 0;
+}
+
+static void
+index_entry_free (gpointer ptr)
+{
+	IndexEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->key.uid);
+		g_free (entry->key.rid);
+		g_free (entry);
+	}
+}
+
+static void
+cal_model_index_add (ECalModel *model,
+		     ECalModelComponent *comp_data,
+		     guint row)
+{
+	IndexEntry *entry;
+	const gchar *uid;
+
+	entry = g_new0 (IndexEntry, 1);
+	entry->key.client = comp_data->client;
+	entry->row = row;
+
+	uid = comp_data->icalcomp ? i_cal_component_get_uid (comp_data->icalcomp) : NULL;
+
+	/* Components without UID cannot be looked up, they are only reachable by their row */
+	if (uid && *uid) {
+		GPtrArray *comps;
+		gchar *rid;
+
+		rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
+		if (rid && !*rid)
+			g_clear_pointer (&rid, g_free);
+
+		entry->key.uid = g_strdup (uid);
+		entry->key.rid = rid;
+
+		/* Rows are only appended, thus the first one is also the lowest row,
+		   which is what the lookup returns for duplicates */
+		if (!g_hash_table_contains (model->priv->objects_index, &entry->key))
+			g_hash_table_insert (model->priv->objects_index, &entry->key, comp_data);
+
+		comps = g_hash_table_lookup (model->priv->uids_index, uid);
+		if (!comps) {
+			comps = g_ptr_array_new ();
+			g_hash_table_insert (model->priv->uids_index, g_strdup (uid), comps);
+		}
+
+		g_ptr_array_add (comps, comp_data);
+	}
+
+	g_hash_table_insert (model->priv->objects_entries, comp_data, entry);
+}
+
+static void
+cal_model_index_remove (ECalModel *model,
+			ECalModelComponent *comp_data)
+{
+	IndexEntry *entry;
+
+	entry = g_hash_table_lookup (model->priv->objects_entries, comp_data);
+	if (!entry)
+		return;
+
+	if (entry->key.uid) {
+		GPtrArray *comps;
+
+		comps = g_hash_table_lookup (model->priv->uids_index, entry->key.uid);
+		if (comps)
+			g_ptr_array_remove (comps, comp_data);
+
+		if (g_hash_table_lookup (model->priv->objects_index, &entry->key) == comp_data) {
+			guint ii;
+
+			g_hash_table_remove (model->priv->objects_index, &entry->key);
+
+			/* Let the next duplicate, if any, take over; the 'comps' is in the row order */
+			for (ii = 0; comps && ii < comps->len; ii++) {
+				ECalModelComponent *other = g_ptr_array_index (comps, ii);
+				IndexEntry *other_entry;
+
+				other_entry = g_hash_table_lookup (model->priv->objects_entries, other);
+
+				if (other_entry && component_key_equal (&other_entry->key, &entry->key)) {
+					g_hash_table_insert (model->priv->objects_index, &other_entry->key, other);
+					break;
+				}
+			}
+		}
+
+		if (comps && !comps->len)
+			g_hash_table_remove (model->priv->uids_index, entry->key.uid);
+	}
+
+	g_hash_table_remove (model->priv->objects_entries, comp_data);
+}
+
+static gint
+cal_model_index_get_row (ECalModel *model,
+			 ECalModelComponent *comp_data)
+{
+	IndexEntry *entry;
+
+	entry = g_hash_table_lookup (model->priv->objects_entries, comp_data);
+	if (!entry)
+		return -1;
+
+	/* Rows only move towards the beginning on remove, thus any stored row
+	   below the valid mark is exact; otherwise refresh the tail at once */
+	if (entry->row >= model->priv->rows_valid) {
+		guint ii;
+
+		for (ii = model->priv->rows_valid; ii < model->priv->objects->len; ii++) {
+			IndexEntry *other;
+
+			other = g_hash_table_lookup (model->priv->objects_entries, g_ptr_array_index (model->priv->objects, ii));
+			if (other)
+				other->row = ii;
+		}
+
+		model->priv->rows_valid = model->priv->objects->len;
+	}
+
+	return entry->row;
+}
+
+static void
+cal_model_index_clear (ECalModel *model)
+{
+	g_hash_table_remove_all (model->priv->objects_index);
+	g_hash_table_remove_all (model->priv->uids_index);
+	g_hash_table_remove_all (model->priv->objects_entries);
+	model->priv->rows_valid = 0;
+}
+
+static void
+cal_model_flush_pending_inserts (ECalModel *model)
+{
+	guint n_pending;
+
+	n_pending = model->priv->n_pending_inserts;
+	if (!n_pending)
+		return;
+
+	model->priv->n_pending_inserts = 0;
+
+	/* The e_table_model_pre_change() had been called when the first row was added */
+	e_table_model_rows_inserted (E_TABLE_MODEL (model), model->priv->objects->len - n_pending, n_pending);
+}
+
+static gboolean
+cal_model_is_pending_row (ECalModel *model,
+			  gint row)
+{
+	return model->priv->n_pending_inserts > 0 && row >= 0 &&
+		row >= model->priv->objects->len - model->priv->n_pending_inserts;
+}
+
+/* Takes ownership of the comp_data */
+static void
+cal_model_append_component (ECalModel *model,
+			    ECalModelComponent *comp_data)
+{
+	ETableModel *table_model;
+	guint row;
+
+	table_model = E_TABLE_MODEL (model);
+	row = model->priv->objects->len;
+
+	/* While frozen, notify about all the added rows at once on thaw */
+	if (model->priv->freeze_count > 0) {
+		if (!model->priv->n_pending_inserts)
+			e_table_model_pre_change (table_model);
+	} else {
+		e_table_model_pre_change (table_model);
+	}
+
+	g_ptr_array_add (model->priv->objects, comp_data);
+	cal_model_index_add (model, comp_data, row);
+
+	if (model->priv->rows_valid == row)
+		model->priv->rows_valid = row + 1;
+
+	if (model->priv->freeze_count > 0)
+		model->priv->n_pending_inserts++;
+	else
+		e_table_model_row_inserted (table_model, row);
+}
+
+/* Returns the removed comp_data, which should be freed with g_object_unref() */
+static ECalModelComponent *
+cal_model_remove_row (ECalModel *model,
+		      guint row)
+{
+	ECalModelComponent *comp_data;
+
+	g_return_val_if_fail (row < model->priv->objects->len, NULL);
+
+	comp_data = g_ptr_array_remove_index (model->priv->objects, row);
+	if (comp_data)
+		cal_model_index_remove (model, comp_data);
+
+	model->priv->rows_valid = MIN (model->priv->rows_valid, row);
+
+	return comp_data;
+}
+
 static gint
 e_cal_model_get_component_index (ECalModel *model,
 				 ECalClient *client,
 				 const ECalComponentId *id)
 {
-	gint ii;
+	ECalModelComponent *comp_data = NULL;
+	const gchar *uid, *rid;
 
-	for (ii = 0; ii < model->priv->objects->len; ii++) {
-		ECalModelComponent *comp_data = g_ptr_array_index (model->priv->objects, ii);
+	uid = e_cal_component_id_get_uid (id);
+	rid = e_cal_component_id_get_rid (id);
 
-		if (comp_data) {
-			const gchar *uid;
-			gboolean has_rid = e_cal_component_id_get_rid (id) != NULL;
+	/* Components with an empty UID or RECURRENCE-ID never match */
+	if (!uid || !*uid || (rid && !*rid))
+		return -1;
 
-			uid = i_cal_component_get_uid (comp_data->icalcomp);
+	if (client && rid) {
+		ComponentKey key;
 
-			if (uid && *uid) {
-				if ((!client || comp_data->client == client) && strcmp (uid, e_cal_component_id_get_uid (id)) == 0) {
-					if (has_rid) {
-						gchar *rid;
+		key.client = client;
+		key.uid = (gchar *) uid;
+		key.rid = (gchar *) rid;
 
-						rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
+		comp_data = g_hash_table_lookup (model->priv->objects_index, &key);
+	} else {
+		GPtrArray *comps;
+		guint ii;
 
-						if (!(rid && *rid && strcmp (rid, e_cal_component_id_get_rid (id)) == 0)) {
-							g_free (rid);
-							continue;
-						}
+		comps = g_hash_table_lookup (model->priv->uids_index, uid);
 
-						g_free (rid);
-					}
+		for (ii = 0; comps && ii < comps->len; ii++) {
+			ECalModelComponent *candidate = g_ptr_array_index (comps, ii);
+			IndexEntry *entry;
 
-					return ii;
-				}
+			entry = g_hash_table_lookup (model->priv->objects_entries, candidate);
+
+			if (entry && (!client || entry->key.client == client) &&
+			    (!rid || g_strcmp0 (entry->key.rid, rid) == 0)) {
+				comp_data = candidate;
+				break;
 			}
 		}
 	}
 
-	return -1;
+	if (!comp_data)
+		return -1;
+
+	return cal_model_index_get_row (model, comp_data);
 }
 
 static void
@@ -1853,25 +2124,38 @@ cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *
 	   component, remove any existing instances and add it from scratch. */
 	if (is_added && !e_cal_component_id_get_rid (id)) {
 		GSList *removed_comps = NULL;
+		GPtrArray *comps;
+		const gchar *uid;
+
+		uid = e_cal_component_id_get_uid (id);
+		comps = (uid && *uid) ? g_hash_table_lookup (model->priv->uids_index, uid) : NULL;
+
+		if (comps) {
+			guint ii;
 
-		for (index = 0; index < model->priv->objects->len; index++) {
-			comp_data = g_ptr_array_index (model->priv->objects, index);
+			/* Copy the list, the cal_model_remove_row() modifies it */
+			comps = g_ptr_array_copy (comps, NULL, NULL);
 
-			if (comp_data && comp_data->client == client) {
-				const gchar *uid;
+			for (ii = 0; ii < comps->len; ii++) {
+				comp_data = g_ptr_array_index (comps, ii);
 
-				uid = i_cal_component_get_uid (comp_data->icalcomp);
+				if (comp_data->client == client) {
+					index = cal_model_index_get_row (model, comp_data);
+
+					if (index < 0)
+						continue;
+
+					cal_model_flush_pending_inserts (model);
 
-				if (uid && *uid && g_strcmp0 (uid, e_cal_component_id_get_uid (id)) == 0) {
 					e_table_model_pre_change (table_model);
 
-					g_ptr_array_remove_index (model->priv->objects, index);
+					cal_model_remove_row (model, index);
 					removed_comps = g_slist_prepend (removed_comps, comp_data);
 					e_table_model_row_deleted (table_model, index);
-
-					index--;
 				}
 			}
+
+			g_ptr_array_unref (comps);
 		}
 
 		g_signal_emit (model, signals[COMPS_DELETED], 0, removed_comps);
@@ -1891,23 +2175,30 @@ cal_model_data_subscriber_component_added_or_modified (ECalDataModelSubscriber *
 	icomp = i_cal_component_clone (e_cal_component_get_icalcomponent (comp));
 
 	if (index < 0) {
-		e_table_model_pre_change (table_model);
-
 		comp_data = g_object_new (E_TYPE_CAL_MODEL_COMPONENT, NULL);
 		comp_data->is_new_component = FALSE;
 		comp_data->client = g_object_ref (client);
 		comp_data->icalcomp = icomp;
 		e_cal_model_set_instance_times (comp_data, model->priv->zone);
-		g_ptr_array_add (model->priv->objects, comp_data);
 
-		e_table_model_row_inserted (table_model, model->priv->objects->len - 1);
+		cal_model_append_component (model, comp_data);
 	} else {
-		e_table_model_pre_change (table_model);
+		gboolean is_pending = cal_model_is_pending_row (model, index);
+
+		if (!is_pending) {
+			cal_model_flush_pending_inserts (model);
+			e_table_model_pre_change (table_model);
+		}
 
 		comp_data = g_ptr_array_index (model->priv->objects, index);
+
+		cal_model_index_remove (model, comp_data);
 		e_cal_model_component_set_icalcomponent (comp_data, model, icomp);
+		cal_model_index_add (model, comp_data, index);
 
-		e_table_model_row_changed (table_model, index);
+		/* Not notified rows will be notified as inserted with the new content */
+		if (!is_pending)
+			e_table_model_row_changed (table_model, index);
 	}
 }
 
@@ -1951,10 +2242,13 @@ e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 	if (index < 0)
 		return;
 
+	/* Deliver the pending inserts first, to keep the row numbers consistent */
+	cal_model_flush_pending_inserts (model);
+
 	table_model = E_TABLE_MODEL (model);
 	e_table_model_pre_change (table_model);
 
-	comp_data = g_ptr_array_remove_index (model->priv->objects, index);
+	comp_data = cal_model_remove_row (model, index);
 	if (!comp_data) {
 		e_table_model_no_change (table_model);
 		return;
@@ -1972,19 +2266,24 @@ e_cal_model_data_subscriber_component_removed (ECalDataModelSubscriber *subscrib
 static void
 e_cal_model_data_subscriber_freeze (ECalDataModelSubscriber *subscriber)
 {
-	/* No freeze/thaw, the ETableModel doesn't notify about changes when frozen */
+	ECalModel *model = E_CAL_MODEL (subscriber);
 
-	/* ETableModel *table_model = E_TABLE_MODEL (subscriber);
-	e_table_model_freeze (table_model); */
+	/* The ETableModel doesn't notify about changes when frozen, thus
+	   only the row insertions are collected and notified on thaw */
+	model->priv->freeze_count++;
 }
 
 static void
 e_cal_model_data_subscriber_thaw (ECalDataModelSubscriber *subscriber)
 {
-	/* No freeze/thaw, the ETableModel doesn't notify about changes when frozen */
+	ECalModel *model = E_CAL_MODEL (subscriber);
+
+	g_return_if_fail (model->priv->freeze_count > 0);
 
-	/* ETableModel *table_model = E_TABLE_MODEL (subscriber);
-	e_table_model_thaw (table_model); */
+	model->priv->freeze_count--;
+
+	if (!model->priv->freeze_count)
+		cal_model_flush_pending_inserts (model);
 }
 
 static void
@@ -2528,6 +2827,9 @@ e_cal_model_init (ECalModel *model)
 	model->priv->end = (time_t) -1;
 
 	model->priv->objects = g_ptr_array_new ();
+	model->priv->objects_entries = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, index_entry_free);
+	model->priv->objects_index = g_hash_table_new (component_key_hash, component_key_equal);
+	model->priv->uids_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
 	model->priv->kind = I_CAL_NO_COMPONENT;
 
 	model->priv->use_24_hour_format = TRUE;
@@ -3527,45 +3829,6 @@ e_cal_model_set_default_source_uid (ECalModel *model,
 	g_object_notify (G_OBJECT (model), "default-source-uid");
 }
 
-static ECalModelComponent *
-search_by_id_and_client (ECalModelPrivate *priv,
-                         ECalClient *client,
-                         const ECalComponentId *id)
-{
-	gint i;
-
-	for (i = 0; i < priv->objects->len; i++) {
-		ECalModelComponent *comp_data = g_ptr_array_index (priv->objects, i);
-
-		if (comp_data) {
-			const gchar *uid;
-			gchar *rid;
-			gboolean has_rid = e_cal_component_id_get_rid (id) != NULL;
-
-			uid = i_cal_component_get_uid (comp_data->icalcomp);
-			rid = e_cal_util_component_get_recurid_as_string (comp_data->icalcomp);
-
-			if (uid && *uid) {
-				if ((!client || comp_data->client == client) &&
-				    !g_strcmp0 (e_cal_component_id_get_uid (id), uid)) {
-					if (has_rid) {
-						if (!(rid && *rid && !g_strcmp0 (e_cal_component_id_get_rid (id), rid))) {
-							g_free (rid);
-							continue;
-						}
-					}
-					g_free (rid);
-					return comp_data;
-				}
-			}
-
-			g_free (rid);
-		}
-	}
-
-	return NULL;
-}
-
 void
 e_cal_model_remove_all_objects (ECalModel *model)
 {
@@ -3576,6 +3839,8 @@ e_cal_model_remove_all_objects (ECalModel *model)
 
 	table_model = E_TABLE_MODEL (model);
 
+	cal_model_flush_pending_inserts (model);
+
 	for (ii = 0; ii < model->priv->objects->len; ii++) {
 		comp_data = g_ptr_array_index (model->priv->objects, ii);
 
@@ -3589,6 +3854,7 @@ e_cal_model_remove_all_objects (ECalModel *model)
 	e_table_model_rows_deleted (table_model, 0, ii);
 
 	g_ptr_array_set_size (model->priv->objects, 0);
+	cal_model_index_clear (model);
 
 	if (comps)
 		g_signal_emit (model, signals[COMPS_DELETED], 0, comps);
@@ -3809,12 +4075,73 @@ e_cal_model_get_component_for_client_and_uid (ECalModel *model,
 					      const ECalComponentId *id)
 {
 	ECalModelPrivate *priv;
+	gint index;
 
 	g_return_val_if_fail (E_IS_CAL_MODEL (model), NULL);
 
 	priv = model->priv;
 
-	return search_by_id_and_client (priv, client, id);
+	index = e_cal_model_get_component_index (model, client, id);
+
+	return index >= 0 ? g_ptr_array_index (priv->objects, index) : NULL;
+}
+
+/**
+ * e_cal_model_take_component:
+ * @model: an #ECalModel
+ * @comp_data: (transfer full): an #ECalModelComponent to add
+ *
+ * Appends the @comp_data at the end of the @model and notifies
+ * about the inserted row. The @model assumes ownership of the @comp_data.
+ * Use this instead of modifying the e_cal_model_get_object_array()
+ * directly, which would leave the internal component index out of sync.
+ **/
+void
+e_cal_model_take_component (ECalModel *model,
+			    ECalModelComponent *comp_data)
+{
+	g_return_if_fail (E_IS_CAL_MODEL (model));
+	g_return_if_fail (E_IS_CAL_MODEL_COMPONENT (comp_data));
+
+	cal_model_append_component (model, comp_data);
+}
+
+/**
+ * e_cal_model_remove_component:
+ * @model: an #ECalModel
+ * @comp_data: an #ECalModelComponent to remove
+ *
+ * Removes the @comp_data from the @model and notifies about the deleted row.
+ * Unlike the removals coming from the underlying #ECalDataModel, this
+ * does not emit the #ECalModel::comps-deleted signal.
+ *
+ * Returns: whether the @comp_data had been part of the @model
+ **/
+gboolean
+e_cal_model_remove_component (ECalModel *model,
+			      ECalModelComponent *comp_data)
+{
+	ETableModel *table_model;
+	gint index;
+
+	g_return_val_if_fail (E_IS_CAL_MODEL (model), FALSE);
+	g_return_val_if_fail (E_IS_CAL_MODEL_COMPONENT (comp_data), FALSE);
+
+	index = cal_model_index_get_row (model, comp_data);
+	if (index < 0)
+		return FALSE;
+
+	cal_model_flush_pending_inserts (model);
+
+	table_model = E_TABLE_MODEL (model);
+	e_table_model_pre_change (table_model);
+
+	comp_data = cal_model_remove_row (model, index);
+	g_clear_object (&comp_data);
+
+	e_table_model_row_deleted (table_model, index);
+
+	return TRUE;
 }
 
 /**
@@ -3916,6 +4243,9 @@ e_cal_model_generate_instances_sync (ECalModel *model,
 
 /**
  * e_cal_model_get_object_array
+ *
+ * The returned array is owned by the model and should not be modified,
+ * use e_cal_model_take_component() and e_cal_model_remove_component() instead.
  */
 GPtrArray *
 e_cal_model_get_object_array (ECalModel *model)
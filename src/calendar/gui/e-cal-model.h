@@ -357,6 +357,10 @@ void		e_cal_model_generate_instances_sync
 						 ECalRecurInstanceCb cb,
 						 gpointer cb_data);
 GPtrArray *	e_cal_model_get_object_array	(ECalModel *model);
+void		e_cal_model_take_component	(ECalModel *model,
+						 ECalModelComponent *comp_data);
+gboolean	e_cal_model_remove_component	(ECalModel *model,
+						 ECalModelComponent *comp_data);
 void		e_cal_model_set_instance_times	(ECalModelComponent *comp_data,
 						 const ICalTimezone *zone);
 gboolean	e_cal_model_test_row_editable	(ECalModel *model,
@@ -362,6 +362,21 @@ e_cell_date_edit_compare_cb (gconstpointer a,
 	return res;
 }
 
+/* A sort key for the ETableSorter, consistent with e_cell_date_edit_compare_cb() */
+gint64
+e_cell_date_edit_int_key_cb (gconstpointer value)
+{
+	ECellDateEditValue *dv = (ECellDateEditValue *) value;
+
+	/* NULL dates sort last. */
+	if (!dv)
+		return G_MAXINT64;
+
+	return (gint64) i_cal_time_as_timet_with_zone (
+		e_cell_date_edit_value_get_time (dv),
+		e_cell_date_edit_value_get_zone (dv));
+}
+
 struct _ECellDateEditValue {
 	ICalTime *tt;
 	ICalTimezone *zone;
@@ -82,6 +82,7 @@ void		e_cell_date_edit_text_set_use_24_hour_format
 gint		e_cell_date_edit_compare_cb	(gconstpointer a,
 						 gconstpointer b,
 						 gpointer cmp_cache);
+gint64		e_cell_date_edit_int_key_cb	(gconstpointer value);
 
 G_END_DECLS
 
@@ -65,8 +65,30 @@ struct _EMeetingStoreQueueData {
 
 	GPtrArray *call_backs;
 	GPtrArray *data;
+
+	gchar *cache_key; /* into the free/busy cache; NULL to not store the result */
 };
 
+/* Free/busy lookups of all the stores run in a shared pool */
+#define FREE_BUSY_MAX_THREADS 4
+
+/* How long the free/busy information is reused, in seconds */
+#define FREE_BUSY_CACHE_TTL (5 * 60)
+#define FREE_BUSY_CACHE_MAX_ITEMS 1000
+
+static GThreadPool *free_busy_pool = NULL;
+
+typedef struct _FreeBusyCacheItem {
+	gchar *text;
+	gint64 expires; /* g_get_monotonic_time() */
+} FreeBusyCacheItem;
+
+G_LOCK_DEFINE_STATIC (free_busy_cache);
+static GHashTable *free_busy_cache = NULL; /* gchar *key ~> FreeBusyCacheItem * */
+
+/* Used only in the main thread, see download_with_libsoup() */
+static SoupSession *free_busy_session = NULL;
+
 enum {
 	PROP_0,
 	PROP_CLIENT,
@@ -602,6 +624,7 @@ refresh_queue_remove (EMeetingStore *store,
 		g_ptr_array_free (qdata->call_backs, TRUE);
 		g_ptr_array_free (qdata->data, TRUE);
 		g_string_free (qdata->string, TRUE);
+		g_free (qdata->cache_key);
 		g_free (qdata);
 	}
 
@@ -1300,6 +1323,94 @@ find_zone (ICalProperty *in_prop,
 	return NULL;
 }
 
+static void
+free_busy_cache_item_free (gpointer ptr)
+{
+	FreeBusyCacheItem *item = ptr;
+
+	if (item) {
+		g_free (item->text);
+		g_slice_free (FreeBusyCacheItem, item);
+	}
+}
+
+static gchar *
+free_busy_cache_build_key (const gchar *source_uid,
+			   const gchar *address,
+			   time_t startt,
+			   time_t endt)
+{
+	gchar *email, *key;
+
+	email = g_ascii_strdown (e_cal_util_strip_mailto (address), -1);
+	key = g_strdup_printf ("%s\n%s\n%" G_GINT64_FORMAT "\n%" G_GINT64_FORMAT,
+		source_uid ? source_uid : "", email, (gint64) startt, (gint64) endt);
+	g_free (email);
+
+	return key;
+}
+
+static gboolean
+free_busy_cache_remove_expired_cb (gpointer key,
+				   gpointer value,
+				   gpointer user_data)
+{
+	FreeBusyCacheItem *item = value;
+	gint64 *now = user_data;
+
+	return item->expires <= *now;
+}
+
+static void
+free_busy_cache_add (const gchar *key,
+		     const gchar *text)
+{
+	FreeBusyCacheItem *item;
+	gint64 now = g_get_monotonic_time ();
+
+	G_LOCK (free_busy_cache);
+
+	if (!free_busy_cache)
+		free_busy_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, free_busy_cache_item_free);
+
+	if (g_hash_table_size (free_busy_cache) >= FREE_BUSY_CACHE_MAX_ITEMS) {
+		g_hash_table_foreach_remove (free_busy_cache, free_busy_cache_remove_expired_cb, &now);
+
+		if (g_hash_table_size (free_busy_cache) >= FREE_BUSY_CACHE_MAX_ITEMS)
+			g_hash_table_remove_all (free_busy_cache);
+	}
+
+	item = g_slice_new0 (FreeBusyCacheItem);
+	item->text = g_strdup (text);
+	item->expires = now + FREE_BUSY_CACHE_TTL * G_USEC_PER_SEC;
+
+	g_hash_table_insert (free_busy_cache, g_strdup (key), item);
+
+	G_UNLOCK (free_busy_cache);
+}
+
+/* Returns a copy of the cached free/busy information, or NULL, when not cached or expired */
+static gchar *
+free_busy_cache_dup (const gchar *key)
+{
+	FreeBusyCacheItem *item;
+	gchar *text = NULL;
+
+	G_LOCK (free_busy_cache);
+
+	item = free_busy_cache ? g_hash_table_lookup (free_busy_cache, key) : NULL;
+	if (item) {
+		if (item->expires > g_get_monotonic_time ())
+			text = g_strdup (item->text);
+		else
+			g_hash_table_remove (free_busy_cache, key);
+	}
+
+	G_UNLOCK (free_busy_cache);
+
+	return text;
+}
+
 static void
 process_callbacks (EMeetingStoreQueueData *qdata)
 {
@@ -1513,6 +1624,9 @@ process_free_busy (EMeetingStoreQueueData *qdata,
 		return;
 	}
 
+	if (qdata->cache_key)
+		free_busy_cache_add (qdata->cache_key, text);
+
 	kind = i_cal_component_isa (main_comp);
 	if (kind == I_CAL_VCALENDAR_COMPONENT) {
 		ICalCompIter *iter;
@@ -1585,12 +1699,8 @@ typedef struct {
 	ECalClient *client;
 	time_t startt;
 	time_t endt;
-	GSList *users;
-	GSList *fb_data;
+	GPtrArray *qdatas; /* EMeetingStoreQueueData *, with the same time window */
 	gchar *fb_uri;
-	gchar *email;
-	EMeetingAttendee *attendee;
-	EMeetingStoreQueueData *qdata;
 	EMeetingStore *store;
 } FreeBusyAsyncData;
 
@@ -1598,8 +1708,10 @@ static void
 free_busy_data_free (FreeBusyAsyncData *fbd)
 {
 	if (fbd) {
-		g_slist_free_full (fbd->users, g_free);
-		g_free (fbd->email);
+		g_clear_object (&fbd->client);
+		g_clear_object (&fbd->store);
+		g_ptr_array_unref (fbd->qdatas);
+		g_free (fbd->fb_uri);
 		g_slice_free (FreeBusyAsyncData, fbd);
 	}
 }
@@ -1607,46 +1719,19 @@ free_busy_data_free (FreeBusyAsyncData *fbd)
 #define USER_SUB   "%u"
 #define DOMAIN_SUB "%d"
 
-static gpointer
-freebusy_async_thread (gpointer data)
+/* Looks for fburl's of attendee with no free busy info on server */
+static void
+freebusy_async_lookup_web (FreeBusyAsyncData *fbd,
+			   EMeetingStoreQueueData *qdata)
 {
-	FreeBusyAsyncData *fbd = data;
-	EMeetingAttendee *attendee = fbd->attendee;
+	EMeetingAttendee *attendee = qdata->attendee;
+	EMeetingStorePrivate *priv = fbd->store->priv;
 	gchar *default_fb_uri = NULL;
 	gchar *fburi = NULL;
-	static GMutex mutex;
-	EMeetingStorePrivate *priv = fbd->store->priv;
-
-	if (fbd->client) {
-		/* FIXME This a workaround for getting all the free busy
-		 *       information for the users.  We should be able to
-		 *       get free busy asynchronously. */
-		g_mutex_lock (&mutex);
-		priv->num_queries++;
-		e_cal_client_get_free_busy_sync (
-			fbd->client, fbd->startt,
-			fbd->endt, fbd->users, &fbd->fb_data, NULL, NULL);
-		priv->num_queries--;
-		g_mutex_unlock (&mutex);
-
-		if (fbd->fb_data != NULL) {
-			ECalComponent *comp = fbd->fb_data->data;
-			gchar *comp_str;
-
-			comp_str = e_cal_component_get_as_string (comp);
-			process_free_busy (fbd->qdata, comp_str);
-			g_free (comp_str);
 
-			free_busy_data_free (fbd);
-			return NULL;
-		}
-	}
-
-	/* Look for fburl's of attendee with no free busy info on server */
 	if (!e_meeting_attendee_is_set_address (attendee)) {
-		process_callbacks (fbd->qdata);
-		free_busy_data_free (fbd);
-		return NULL;
+		process_callbacks (qdata);
+		return;
 	}
 
 	/* Check for free busy info on the default server */
@@ -1660,142 +1745,265 @@ freebusy_async_thread (gpointer data)
 
 	if (fburi) {
 		priv->num_queries++;
-		start_async_read (fburi, fbd->qdata);
+		start_async_read (fburi, qdata);
 		g_free (fburi);
 	} else if (default_fb_uri != NULL && !g_str_equal (default_fb_uri, "")) {
 		gchar *tmp_fb_uri;
 		gchar **split_email;
 
-		split_email = g_strsplit (fbd->email, "@", 2);
+		split_email = g_strsplit (e_cal_util_strip_mailto (e_meeting_attendee_get_address (attendee)), "@", 2);
 
 		tmp_fb_uri = replace_string (default_fb_uri, USER_SUB, split_email[0]);
 		g_free (default_fb_uri);
 		default_fb_uri = replace_string (tmp_fb_uri, DOMAIN_SUB, split_email[1]);
 
 		priv->num_queries++;
-		start_async_read (default_fb_uri, fbd->qdata);
+		start_async_read (default_fb_uri, qdata);
 		g_free (tmp_fb_uri);
 		g_strfreev (split_email);
-		g_free (default_fb_uri);
 	} else {
-		process_callbacks (fbd->qdata);
+		process_callbacks (qdata);
 	}
 
-	free_busy_data_free (fbd);
-
-	return NULL;
+	g_free (default_fb_uri);
 }
 
 #undef USER_SUB
 #undef DOMAIN_SUB
 
+/* Returns the address of the user the free/busy component belongs to */
+static const gchar *
+freebusy_get_comp_user (ECalComponent *comp)
+{
+	ICalComponent *icomp;
+	ICalProperty *prop;
+	const gchar *user = NULL;
+
+	icomp = e_cal_component_get_icalcomponent (comp);
+
+	prop = i_cal_component_get_first_property (icomp, I_CAL_ATTENDEE_PROPERTY);
+	if (prop) {
+		user = i_cal_property_get_attendee (prop);
+		g_object_unref (prop);
+	}
+
+	if (!user) {
+		prop = i_cal_component_get_first_property (icomp, I_CAL_ORGANIZER_PROPERTY);
+		if (prop) {
+			user = i_cal_property_get_organizer (prop);
+			g_object_unref (prop);
+		}
+	}
+
+	return user ? e_cal_util_strip_mailto (user) : NULL;
+}
+
+static void
+freebusy_async_thread (gpointer data,
+		       gpointer user_data)
+{
+	FreeBusyAsyncData *fbd = data;
+	EMeetingStorePrivate *priv = fbd->store->priv;
+	static GMutex mutex;
+	guint ii;
+
+	if (fbd->client) {
+		GSList *users = NULL, *fb_data = NULL, *link;
+		guint n_users;
+
+		for (ii = 0; ii < fbd->qdatas->len; ii++) {
+			EMeetingStoreQueueData *qdata = g_ptr_array_index (fbd->qdatas, ii);
+
+			users = g_slist_prepend (users, g_strdup (e_cal_util_strip_mailto (
+				e_meeting_attendee_get_address (qdata->attendee))));
+		}
+
+		users = g_slist_reverse (users);
+		n_users = fbd->qdatas->len;
+
+		/* FIXME This a workaround for getting all the free busy
+		 *       information for the users.  We should be able to
+		 *       get free busy asynchronously. */
+		g_mutex_lock (&mutex);
+		priv->num_queries++;
+		e_cal_client_get_free_busy_sync (
+			fbd->client, fbd->startt,
+			fbd->endt, users, &fb_data, NULL, NULL);
+		priv->num_queries--;
+		g_mutex_unlock (&mutex);
+
+		for (link = fb_data; link; link = g_slist_next (link)) {
+			ECalComponent *comp = link->data;
+			EMeetingStoreQueueData *qdata = NULL;
+			const gchar *user;
+
+			/* The only asked user can be assumed; the matched users are
+			   removed from the qdatas, thus use the original count */
+			if (n_users == 1) {
+				qdata = fbd->qdatas->len ? g_ptr_array_index (fbd->qdatas, 0) : NULL;
+			} else {
+				user = freebusy_get_comp_user (comp);
+
+				for (ii = 0; user && ii < fbd->qdatas->len; ii++) {
+					EMeetingStoreQueueData *adept = g_ptr_array_index (fbd->qdatas, ii);
+
+					if (adept && g_ascii_strcasecmp (user, e_cal_util_strip_mailto (
+					    e_meeting_attendee_get_address (adept->attendee))) == 0) {
+						qdata = adept;
+						break;
+					}
+				}
+			}
+
+			if (qdata && g_ptr_array_remove_fast (fbd->qdatas, qdata)) {
+				gchar *comp_str;
+
+				comp_str = e_cal_component_get_as_string (comp);
+				process_free_busy (qdata, comp_str);
+				g_free (comp_str);
+			}
+		}
+
+		g_slist_free_full (fb_data, g_object_unref);
+		g_slist_free_full (users, g_free);
+	}
+
+	/* The rest had not been found on the server */
+	for (ii = 0; ii < fbd->qdatas->len; ii++) {
+		freebusy_async_lookup_web (fbd, g_ptr_array_index (fbd->qdatas, ii));
+	}
+
+	free_busy_data_free (fbd);
+}
+
+static time_t
+meeting_time_as_timet (const EMeetingTime *mtime,
+		       ICalTimezone *zone)
+{
+	ICalTime *itt;
+	time_t tt;
+
+	itt = i_cal_time_new_null_time ();
+	i_cal_time_set_date (itt,
+		g_date_get_year (&mtime->date),
+		g_date_get_month (&mtime->date),
+		g_date_get_day (&mtime->date));
+	i_cal_time_set_time (itt,
+		mtime->hour,
+		mtime->minute,
+		0);
+	tt = i_cal_time_as_timet_with_zone (itt, zone);
+	g_clear_object (&itt);
+
+	return tt;
+}
+
 static gboolean
 refresh_busy_periods (gpointer data)
 {
 	EMeetingStore *store = E_MEETING_STORE (data);
 	EMeetingStorePrivate *priv;
-	EMeetingAttendee *attendee = NULL;
-	EMeetingStoreQueueData *qdata = NULL;
+	GPtrArray *cached, *cached_texts;
+	GSList *jobs = NULL, *link;
+	ESource *source = NULL;
 	gint i;
-	GThread *thread;
-	GError *error = NULL;
-	FreeBusyAsyncData *fbd;
 
 	priv = store->priv;
+	priv->refresh_idle_id = 0;
+
+	if (!free_busy_pool)
+		free_busy_pool = g_thread_pool_new (freebusy_async_thread, NULL, FREE_BUSY_MAX_THREADS, FALSE, NULL);
 
-	/* Check to see if there are any remaining attendees in the queue */
+	if (priv->client)
+		source = e_client_get_source (E_CLIENT (priv->client));
+
+	cached = g_ptr_array_new ();
+	cached_texts = g_ptr_array_new_with_free_func (g_free);
+
+	/* Dispatch all the attendees in the queue, which are not being refreshed yet */
 	for (i = 0; i < priv->refresh_queue->len; i++) {
+		EMeetingAttendee *attendee;
+		EMeetingStoreQueueData *qdata;
+		FreeBusyAsyncData *fbd = NULL;
+		time_t startt, endt;
+		gchar *text;
+
 		attendee = g_ptr_array_index (priv->refresh_queue, i);
-		g_return_val_if_fail (attendee != NULL, FALSE);
+		if (!attendee)
+			continue;
 
 		qdata = g_hash_table_lookup (
 			priv->refresh_data, e_cal_util_strip_mailto (
 			e_meeting_attendee_get_address (attendee)));
-		if (!qdata)
+		if (!qdata || qdata->refreshing)
 			continue;
 
-		if (!qdata->refreshing)
-			break;
-	}
+		/* Indicate we are trying to refresh it */
+		qdata->refreshing = TRUE;
 
-	/* The everything in the queue is being refreshed */
-	if (i >= priv->refresh_queue->len) {
-		priv->refresh_idle_id = 0;
-		return FALSE;
-	}
+		/* We take a ref in case we get destroyed in the gui during a callback */
+		g_object_ref (qdata->store);
 
-	/* Indicate we are trying to refresh it */
-	qdata->refreshing = TRUE;
-
-	/* We take a ref in case we get destroyed in the gui during a callback */
-	g_object_ref (qdata->store);
-
-	fbd = g_slice_new0 (FreeBusyAsyncData);
-	fbd->client = priv->client;
-	fbd->attendee = attendee;
-	fbd->users = NULL;
-	fbd->fb_data = NULL;
-	fbd->qdata = qdata;
-	fbd->fb_uri = priv->fb_uri;
-	fbd->store = store;
-	fbd->email = g_strdup (e_cal_util_strip_mailto (
-		e_meeting_attendee_get_address (attendee)));
+		g_mutex_lock (&store->priv->mutex);
+		store->priv->num_threads++;
+		g_mutex_unlock (&store->priv->mutex);
 
-	/* Check the server for free busy data */
-	if (priv->client) {
-		ICalTime *itt;
-
-		itt = i_cal_time_new_null_time ();
-		i_cal_time_set_date (itt,
-			g_date_get_year (&qdata->start.date),
-			g_date_get_month (&qdata->start.date),
-			g_date_get_day (&qdata->start.date));
-		i_cal_time_set_time (itt,
-			qdata->start.hour,
-			qdata->start.minute,
-			0);
-		fbd->startt = i_cal_time_as_timet_with_zone (itt, priv->zone);
-		g_clear_object (&itt);
-
-		itt = i_cal_time_new_null_time ();
-		i_cal_time_set_date (itt,
-			g_date_get_year (&qdata->end.date),
-			g_date_get_month (&qdata->end.date),
-			g_date_get_day (&qdata->end.date));
-		i_cal_time_set_time (itt,
-			qdata->end.hour,
-			qdata->end.minute,
-			0);
-		fbd->endt = i_cal_time_as_timet_with_zone (itt, priv->zone);
-		g_clear_object (&itt);
-
-		fbd->qdata = qdata;
-		fbd->users = g_slist_append (fbd->users, g_strdup (fbd->email));
+		startt = meeting_time_as_timet (&qdata->start, priv->zone);
+		endt = meeting_time_as_timet (&qdata->end, priv->zone);
 
-	}
+		qdata->cache_key = free_busy_cache_build_key (source ? e_source_get_uid (source) : NULL,
+			e_meeting_attendee_get_address (attendee), startt, endt);
 
-	g_mutex_lock (&store->priv->mutex);
-	store->priv->num_threads++;
-	g_mutex_unlock (&store->priv->mutex);
+		text = free_busy_cache_dup (qdata->cache_key);
+		if (text) {
+			/* Do not store it again */
+			g_clear_pointer (&qdata->cache_key, g_free);
 
-	thread = g_thread_try_new (NULL, freebusy_async_thread, fbd, &error);
-	if (!thread) {
-		free_busy_data_free (fbd);
+			g_ptr_array_add (cached, qdata);
+			g_ptr_array_add (cached_texts, text);
+			continue;
+		}
 
-		priv->refresh_idle_id = 0;
+		/* Ask the server for all the attendees with the same time window at once */
+		for (link = jobs; link; link = g_slist_next (link)) {
+			FreeBusyAsyncData *adept = link->data;
 
-		g_mutex_lock (&store->priv->mutex);
-		store->priv->num_threads--;
-		g_mutex_unlock (&store->priv->mutex);
+			if (adept->startt == startt && adept->endt == endt) {
+				fbd = adept;
+				break;
+			}
+		}
 
-		g_object_unref (store);
+		if (!fbd) {
+			fbd = g_slice_new0 (FreeBusyAsyncData);
+			fbd->client = priv->client ? g_object_ref (priv->client) : NULL;
+			fbd->startt = startt;
+			fbd->endt = endt;
+			fbd->qdatas = g_ptr_array_new ();
+			fbd->fb_uri = g_strdup (priv->fb_uri);
+			fbd->store = g_object_ref (store);
 
-		return FALSE;
+			jobs = g_slist_prepend (jobs, fbd);
+		}
+
+		g_ptr_array_add (fbd->qdatas, qdata);
 	}
 
-	g_thread_unref (thread);
+	/* Processing removes the attendee from the refresh_queue, thus do it after the loop */
+	for (i = 0; i < cached->len; i++) {
+		process_free_busy (g_ptr_array_index (cached, i), g_ptr_array_index (cached_texts, i));
+	}
 
-	return TRUE;
+	g_ptr_array_unref (cached_texts);
+	g_ptr_array_unref (cached);
+
+	for (link = jobs; link; link = g_slist_next (link)) {
+		g_thread_pool_push (free_busy_pool, link->data, NULL);
+	}
+
+	g_slist_free (jobs);
+
+	return FALSE;
 }
 
 static void
@@ -2034,33 +2242,62 @@ soup_msg_ready_cb (GObject *source_object,
 	g_clear_error (&local_error);
 }
 
-static void
-download_with_libsoup (const gchar *uri,
-                       EMeetingStoreQueueData *qdata)
+typedef struct _DownloadData {
+	gchar *uri;
+	EMeetingStoreQueueData *qdata;
+} DownloadData;
+
+static gboolean
+download_with_libsoup_in_main_cb (gpointer user_data)
 {
-	SoupSession *session;
+	DownloadData *dd = user_data;
+	const gchar *uri = dd->uri;
+	EMeetingStoreQueueData *qdata = dd->qdata;
 	SoupMessage *msg;
 
-	g_return_if_fail (uri != NULL);
-	g_return_if_fail (qdata != NULL);
-
 	msg = soup_message_new (SOUP_METHOD_GET, uri);
 	if (!msg) {
 		g_warning ("Unable to access free/busy url '%s'; malformed?", uri);
 		process_callbacks (qdata);
-		return;
+	} else {
+		g_object_set_data_full (G_OBJECT (msg), "orig-uri", g_strdup (uri), g_free);
+
+		/* Shared by all the lookups, thus the connections can be reused */
+		if (!free_busy_session)
+			free_busy_session = soup_session_new_with_options ("timeout", 30, NULL);
+
+		g_signal_connect (
+			msg, "authenticate",
+			G_CALLBACK (soup_authenticate), NULL);
+
+		soup_session_send_and_read_async (free_busy_session, msg, G_PRIORITY_DEFAULT, NULL, soup_msg_ready_cb, qdata);
+
+		g_object_unref (msg);
 	}
 
-	g_object_set_data_full (G_OBJECT (msg), "orig-uri", g_strdup (uri), g_free);
+	g_free (dd->uri);
+	g_slice_free (DownloadData, dd);
 
-	session = soup_session_new ();
-	g_object_set (session, "timeout", 30, NULL);
-	g_signal_connect (
-		msg, "authenticate",
-		G_CALLBACK (soup_authenticate), NULL);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+download_with_libsoup (const gchar *uri,
+                       EMeetingStoreQueueData *qdata)
+{
+	DownloadData *dd;
+
+	g_return_if_fail (uri != NULL);
+	g_return_if_fail (qdata != NULL);
+
+	dd = g_slice_new (DownloadData);
+	dd->uri = g_strdup (uri);
+	dd->qdata = qdata;
 
-	soup_message_headers_append (soup_message_get_request_headers (msg), "Connection", "close");
-	soup_session_send_and_read_async (session, msg, G_PRIORITY_DEFAULT, NULL, soup_msg_ready_cb, qdata);
+	/* The lookups run in several threads, but a SoupSession cannot
+	 * be used by more threads at once with libsoup 3.0, thus all
+	 * the downloads are started from the main context. */
+	g_main_context_invoke (NULL, download_with_libsoup_in_main_cb, dd);
 }
 
 static void
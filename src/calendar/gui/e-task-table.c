@@ -542,6 +542,9 @@ task_table_constructed (GObject *object)
 	e_table_extras_add_compare (
 		extras, "date-compare",
 		e_cell_date_edit_compare_cb);
+	e_table_extras_add_int_key (
+		extras, "date-compare",
+		e_cell_date_edit_int_key_cb);
 	e_table_extras_add_compare (
 		extras, "percent-compare",
 		task_table_percent_compare_cb);
@@ -1370,7 +1373,6 @@ hide_completed_rows_ready (GObject *source_object,
 	ECalClient *cal_client;
 	GSList *m, *objects = NULL;
 	gboolean changed = FALSE;
-	GPtrArray *comp_objects;
 	GError *error = NULL;
 
 	cal_client = E_CAL_CLIENT (source_object);
@@ -1397,9 +1399,6 @@ hide_completed_rows_ready (GObject *source_object,
 		return;
 	}
 
-	comp_objects = e_cal_model_get_object_array (model);
-	g_return_if_fail (comp_objects != NULL);
-
 	for (m = objects; m; m = m->next) {
 		ECalModelComponent *comp_data;
 		ECalComponentId *id;
@@ -1410,17 +1409,8 @@ hide_completed_rows_ready (GObject *source_object,
 		id = e_cal_component_get_id (comp);
 
 		comp_data = e_cal_model_get_component_for_client_and_uid (model, cal_client, id);
-		if (comp_data != NULL) {
-			guint pos;
-
-			if (g_ptr_array_find (comp_objects, comp_data, &pos)) {
-				e_table_model_pre_change (E_TABLE_MODEL (model));
-				g_ptr_array_remove_index (comp_objects, pos);
-				g_object_unref (comp_data);
-				e_table_model_row_deleted (E_TABLE_MODEL (model), pos);
-				changed = TRUE;
-			}
-		}
+		if (comp_data != NULL && e_cal_model_remove_component (model, comp_data))
+			changed = TRUE;
 		e_cal_component_id_free (id);
 		g_object_unref (comp);
 	}
@@ -1442,7 +1432,6 @@ show_completed_rows_ready (GObject *source_object,
 	ECalClient *cal_client;
 	ECalModel *model = user_data;
 	GSList *m, *objects = NULL;
-	GPtrArray *comp_objects;
 	GError *error = NULL;
 
 	cal_client = E_CAL_CLIENT (source_object);
@@ -1470,8 +1459,8 @@ show_completed_rows_ready (GObject *source_object,
 		return;
 	}
 
-	comp_objects = e_cal_model_get_object_array (model);
-	g_return_if_fail (comp_objects != NULL);
+	/* Notify about all the shown rows at once */
+	e_cal_data_model_subscriber_freeze (E_CAL_DATA_MODEL_SUBSCRIBER (model));
 
 	for (m = objects; m; m = m->next) {
 		ECalModelComponent *comp_data;
@@ -1483,7 +1472,6 @@ show_completed_rows_ready (GObject *source_object,
 		id = e_cal_component_get_id (comp);
 
 		if (!(e_cal_model_get_component_for_client_and_uid (model, cal_client, id))) {
-			e_table_model_pre_change (E_TABLE_MODEL (model));
 			comp_data = g_object_new (
 				E_TYPE_CAL_MODEL_COMPONENT, NULL);
 			comp_data->client = g_object_ref (cal_client);
@@ -1497,15 +1485,14 @@ show_completed_rows_ready (GObject *source_object,
 			comp_data->completed = NULL;
 			comp_data->color = NULL;
 
-			g_ptr_array_add (comp_objects, comp_data);
-			e_table_model_row_inserted (
-				E_TABLE_MODEL (model),
-				comp_objects->len - 1);
+			e_cal_model_take_component (model, comp_data);
 		}
 		e_cal_component_id_free (id);
 		g_object_unref (comp);
 	}
 
+	e_cal_data_model_subscriber_thaw (E_CAL_DATA_MODEL_SUBSCRIBER (model));
+
 	e_util_free_nullable_object_slist (objects);
 }
 
@@ -47,6 +47,8 @@ struct _EAttachmentPrivate {
 	GFileInfo *file_info;
 	GCancellable *cancellable;
 	CamelMimePart *mime_part;
+	GIcon *thumbnail;
+	guint thumbnail_stamp;
 	guint emblem_timeout_id;
 	gchar *disposition;
 	gint percent;
@@ -58,6 +60,7 @@ struct _EAttachmentPrivate {
 	guint initially_shown : 1;
 	guint may_reload : 1;
 	guint is_possible : 1;
+	guint thumbnail_requested : 1;
 
 	guint save_self      : 1;
 	guint save_extracted : 1;
@@ -212,60 +215,334 @@ e_attachment_notify_property_change (EAttachment *self,
 	}
 }
 
-static gboolean
-create_system_thumbnail (EAttachment *attachment,
-                         GIcon **icon)
+/* Thumbnails are created in a background thread, both for the files,
+ * by the system thumbnailer, and for the images from the MIME parts,
+ * which are decoded and downscaled directly. The attachment icon is
+ * updated when the thumbnail is ready. */
+
+#define THUMBNAIL_MAX_THREADS 2
+
+/* Fits the GTK_ICON_SIZE_DIALOG icons even on the HiDPI screens */
+#define THUMBNAIL_SIZE 128
+
+/* Thumbnails of the MIME parts, by the checksum of their content */
+#define THUMBNAIL_CACHE_MAX_ITEMS 256
+
+static GThreadPool *thumbnail_pool = NULL;
+
+static void attachment_update_icon_column (EAttachment *attachment);
+
+G_LOCK_DEFINE_STATIC (thumbnail_cache);
+static GHashTable *thumbnail_cache = NULL; /* gchar *checksum ~> GdkPixbuf * */
+static GQueue thumbnail_cache_lru = G_QUEUE_INIT; /* gchar *checksum, owned by the hash table; most recently used first */
+
+typedef struct _ThumbnailJob {
+	GWeakRef *attachment_weak_ref;
+	guint stamp;
+
+	/* Only one of them is set */
+	gchar *file_path;
+	CamelMimePart *mime_part;
+
+	/* The result */
+	gchar *thumbnail_path;
+	GdkPixbuf *pixbuf;
+} ThumbnailJob;
+
+static void
+thumbnail_job_free (gpointer ptr)
 {
-	GFile *file;
-	GFile *icon_file;
-	gchar *file_path = NULL;
-	gchar *thumbnail = NULL;
-	gboolean success = FALSE;
+	ThumbnailJob *job = ptr;
+
+	if (job) {
+		e_weak_ref_free (job->attachment_weak_ref);
+		g_free (job->file_path);
+		g_clear_object (&job->mime_part);
+		g_free (job->thumbnail_path);
+		g_clear_object (&job->pixbuf);
+		g_slice_free (ThumbnailJob, job);
+	}
+}
 
-	g_return_val_if_fail (E_IS_ATTACHMENT (attachment), FALSE);
-	g_return_val_if_fail (icon != NULL, FALSE);
+static GdkPixbuf *
+thumbnail_cache_ref (const gchar *checksum)
+{
+	GdkPixbuf *pixbuf = NULL;
 
-	file = e_attachment_ref_file (attachment);
-	if (file != NULL)
-		file_path = g_file_get_path (file);
+	G_LOCK (thumbnail_cache);
+
+	if (thumbnail_cache) {
+		gpointer key = NULL, value = NULL;
 
-	if (file_path != NULL) {
-		thumbnail = e_icon_factory_create_thumbnail (file_path);
-		g_free (file_path);
+		if (g_hash_table_lookup_extended (thumbnail_cache, checksum, &key, &value)) {
+			GList *link;
+
+			link = g_queue_find (&thumbnail_cache_lru, key);
+			if (link) {
+				g_queue_unlink (&thumbnail_cache_lru, link);
+				g_queue_push_head_link (&thumbnail_cache_lru, link);
+			}
+
+			pixbuf = g_object_ref (value);
+		}
 	}
 
-	if (thumbnail == NULL)
-		goto exit;
+	G_UNLOCK (thumbnail_cache);
+
+	return pixbuf;
+}
+
+static void
+thumbnail_cache_add (const gchar *checksum,
+		     GdkPixbuf *pixbuf)
+{
+	gchar *key;
 
-	icon_file = g_file_new_for_path (thumbnail);
+	G_LOCK (thumbnail_cache);
 
-	if (*icon != NULL)
-		g_object_unref (*icon);
+	if (!thumbnail_cache)
+		thumbnail_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
 
-	*icon = g_file_icon_new (icon_file);
+	if (!g_hash_table_contains (thumbnail_cache, checksum)) {
+		key = g_strdup (checksum);
 
-	g_object_unref (icon_file);
+		g_hash_table_insert (thumbnail_cache, key, g_object_ref (pixbuf));
+		g_queue_push_head (&thumbnail_cache_lru, key);
 
-	if (file != NULL) {
-		GFileInfo *file_info;
-		const gchar *attribute;
+		while (g_queue_get_length (&thumbnail_cache_lru) > THUMBNAIL_CACHE_MAX_ITEMS) {
+			/* This frees the key */
+			g_hash_table_remove (thumbnail_cache, g_queue_pop_tail (&thumbnail_cache_lru));
+		}
+	}
+
+	G_UNLOCK (thumbnail_cache);
+}
+
+static void
+thumbnail_size_prepared_cb (GdkPixbufLoader *loader,
+			    gint width,
+			    gint height,
+			    gpointer user_data)
+{
+	gdouble scale;
+
+	if (width <= THUMBNAIL_SIZE && height <= THUMBNAIL_SIZE)
+		return;
+
+	/* Let the loader downscale, which can be cheaper than decoding the whole image */
+	scale = MIN ((gdouble) THUMBNAIL_SIZE / width, (gdouble) THUMBNAIL_SIZE / height);
+
+	gdk_pixbuf_loader_set_size (loader, MAX (1, width * scale), MAX (1, height * scale));
+}
+
+static GdkPixbuf *
+thumbnail_decode_image (GBytes *bytes)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *pixbuf = NULL;
+	gboolean success;
+
+	loader = gdk_pixbuf_loader_new ();
+
+	g_signal_connect (loader, "size-prepared",
+		G_CALLBACK (thumbnail_size_prepared_cb), NULL);
+
+	success = gdk_pixbuf_loader_write_bytes (loader, bytes, NULL);
+
+	/* Close it always, to not have it complain in the dispose */
+	if (gdk_pixbuf_loader_close (loader, NULL) && success) {
+		pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+
+		/* Rotate by the EXIF orientation; it returns a new reference */
+		if (pixbuf)
+			pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+	}
+
+	g_object_unref (loader);
+
+	return pixbuf;
+}
+
+static GdkPixbuf *
+thumbnail_create_for_mime_part (CamelMimePart *mime_part)
+{
+	CamelDataWrapper *content;
+	GOutputStream *stream;
+	GBytes *bytes;
+	GdkPixbuf *pixbuf = NULL;
+	gchar *checksum;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (mime_part));
+	if (!content)
+		return NULL;
+
+	stream = g_memory_output_stream_new_resizable ();
+
+	if (camel_data_wrapper_decode_to_output_stream_sync (content, stream, NULL, NULL) < 0 ||
+	    !g_output_stream_close (stream, NULL, NULL)) {
+		g_object_unref (stream);
+		return NULL;
+	}
+
+	bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (stream));
+	g_object_unref (stream);
+
+	if (!g_bytes_get_size (bytes)) {
+		g_bytes_unref (bytes);
+		return NULL;
+	}
+
+	/* The same image can be attached to many messages */
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+
+	pixbuf = thumbnail_cache_ref (checksum);
+
+	if (!pixbuf) {
+		pixbuf = thumbnail_decode_image (bytes);
+
+		if (pixbuf)
+			thumbnail_cache_add (checksum, pixbuf);
+	}
 
-		file_info = e_attachment_ref_file_info (attachment);
-		attribute = G_FILE_ATTRIBUTE_THUMBNAIL_PATH;
+	g_bytes_unref (bytes);
+	g_free (checksum);
+
+	return pixbuf;
+}
+
+static gboolean
+thumbnail_job_done_cb (gpointer user_data)
+{
+	ThumbnailJob *job = user_data;
+	EAttachment *attachment;
+	GIcon *thumbnail = NULL;
+
+	attachment = g_weak_ref_get (job->attachment_weak_ref);
+	if (!attachment)
+		return FALSE;
 
-		if (file_info != NULL) {
+	if (job->thumbnail_path) {
+		GFile *file;
+
+		file = g_file_new_for_path (job->thumbnail_path);
+		thumbnail = g_file_icon_new (file);
+		g_object_unref (file);
+	} else if (job->pixbuf) {
+		thumbnail = G_ICON (g_object_ref (job->pixbuf));
+	}
+
+	g_mutex_lock (&attachment->priv->property_lock);
+
+	/* The file or the MIME part could change meanwhile */
+	if (job->stamp != attachment->priv->thumbnail_stamp)
+		g_clear_object (&thumbnail);
+
+	if (thumbnail) {
+		g_clear_object (&attachment->priv->thumbnail);
+		attachment->priv->thumbnail = g_object_ref (thumbnail);
+
+		if (job->thumbnail_path && attachment->priv->file_info) {
 			g_file_info_set_attribute_byte_string (
-				file_info, attribute, thumbnail);
-			g_object_unref (file_info);
+				attachment->priv->file_info,
+				G_FILE_ATTRIBUTE_THUMBNAIL_PATH,
+				job->thumbnail_path);
 		}
 	}
 
-	g_free (thumbnail);
+	g_mutex_unlock (&attachment->priv->property_lock);
 
-	success = TRUE;
+	if (thumbnail)
+		attachment_update_icon_column (attachment);
 
-exit:
-	g_clear_object (&file);
+	g_clear_object (&thumbnail);
+	g_object_unref (attachment);
+
+	return FALSE;
+}
+
+static void
+thumbnail_job_run (gpointer data,
+		   gpointer user_data)
+{
+	ThumbnailJob *job = data;
+	EAttachment *attachment;
+
+	/* Skip the attachments, which are gone already */
+	attachment = g_weak_ref_get (job->attachment_weak_ref);
+	if (!attachment) {
+		thumbnail_job_free (job);
+		return;
+	}
+
+	g_object_unref (attachment);
+
+	if (job->file_path)
+		job->thumbnail_path = e_icon_factory_create_thumbnail (job->file_path);
+	else if (job->mime_part)
+		job->pixbuf = thumbnail_create_for_mime_part (job->mime_part);
+
+	if (job->thumbnail_path || job->pixbuf)
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, thumbnail_job_done_cb, job, thumbnail_job_free);
+	else
+		thumbnail_job_free (job);
+}
+
+/* Called with the property_lock held */
+static void
+attachment_reset_thumbnail_locked (EAttachment *attachment)
+{
+	g_clear_object (&attachment->priv->thumbnail);
+	attachment->priv->thumbnail_requested = FALSE;
+	attachment->priv->thumbnail_stamp++;
+}
+
+/* Sets the @icon to the thumbnail of the @attachment and returns TRUE, when
+ * the thumbnail is ready. Otherwise schedules its creation, if possible,
+ * and returns FALSE. */
+static gboolean
+attachment_get_thumbnail (EAttachment *attachment,
+			  GIcon **icon)
+{
+	ThumbnailJob *job = NULL;
+	gboolean success = FALSE;
+
+	g_mutex_lock (&attachment->priv->property_lock);
+
+	if (attachment->priv->thumbnail) {
+		g_clear_object (icon);
+		*icon = g_object_ref (attachment->priv->thumbnail);
+		success = TRUE;
+	} else if (!attachment->priv->thumbnail_requested) {
+		gchar *file_path = NULL;
+
+		attachment->priv->thumbnail_requested = TRUE;
+
+		if (attachment->priv->file)
+			file_path = g_file_get_path (attachment->priv->file);
+
+		if (file_path) {
+			job = g_slice_new0 (ThumbnailJob);
+			job->file_path = file_path;
+		} else if (attachment->priv->mime_part &&
+			   camel_content_type_is (camel_mime_part_get_content_type (attachment->priv->mime_part), "image", "*")) {
+			job = g_slice_new0 (ThumbnailJob);
+			job->mime_part = g_object_ref (attachment->priv->mime_part);
+		}
+
+		if (job) {
+			job->attachment_weak_ref = e_weak_ref_new (attachment);
+			job->stamp = attachment->priv->thumbnail_stamp;
+		}
+	}
+
+	g_mutex_unlock (&attachment->priv->property_lock);
+
+	if (job) {
+		if (!thumbnail_pool)
+			thumbnail_pool = g_thread_pool_new (thumbnail_job_run, NULL, THUMBNAIL_MAX_THREADS, FALSE, NULL);
+
+		g_thread_pool_push (thumbnail_pool, job, NULL);
+	}
 
 	return success;
 }
@@ -444,7 +721,7 @@ attachment_update_icon_column_idle_cb (gpointer weak_ref)
 
 	if (file_info != NULL && g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_STANDARD_ICON)) {
 		icon = g_file_info_get_icon (file_info);
-		/* add the reference here, thus the create_system_thumbnail() can unref the *icon. */
+		/* add the reference here, thus the attachment_get_thumbnail() can unref the *icon. */
 		if (icon)
 			g_object_ref (icon);
 		if (g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH))
@@ -463,8 +740,8 @@ attachment_update_icon_column_idle_cb (gpointer weak_ref)
 		icon = g_file_icon_new (file);
 		g_object_unref (file);
 
-	/* Try the system thumbnailer. */
-	} else if (create_system_thumbnail (attachment, &icon)) {
+	/* Try the thumbnailer; it updates the icon once the thumbnail is ready. */
+	} else if (attachment_get_thumbnail (attachment, &icon)) {
 		/* Nothing to do, just use the icon. */
 
 	/* Else use the standard icon for the content type. */
@@ -923,6 +1200,7 @@ attachment_dispose (GObject *object)
 	g_clear_object (&self->priv->file_info);
 	g_clear_object (&self->priv->cancellable);
 	g_clear_object (&self->priv->mime_part);
+	g_clear_object (&self->priv->thumbnail);
 
 	if (self->priv->emblem_timeout_id > 0) {
 		g_source_remove (self->priv->emblem_timeout_id);
@@ -1473,6 +1751,7 @@ e_attachment_set_file (EAttachment *attachment,
 
 	g_clear_object (&attachment->priv->file);
 	attachment->priv->file = file;
+	attachment_reset_thumbnail_locked (attachment);
 
 	g_mutex_unlock (&attachment->priv->property_lock);
 
@@ -1512,6 +1791,10 @@ e_attachment_set_file_info (EAttachment *attachment,
 	g_clear_object (&attachment->priv->file_info);
 	attachment->priv->file_info = file_info;
 
+	/* The file could be modified */
+	if (attachment->priv->file)
+		attachment_reset_thumbnail_locked (attachment);
+
 	if (file_info && g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_STANDARD_ICON)) {
 		GIcon *icon;
 
@@ -1618,6 +1901,7 @@ e_attachment_set_mime_part (EAttachment *attachment,
 
 	g_clear_object (&attachment->priv->mime_part);
 	attachment->priv->mime_part = mime_part;
+	attachment_reset_thumbnail_locked (attachment);
 
 	g_mutex_unlock (&attachment->priv->property_lock);
 
@@ -87,6 +87,7 @@ static GdkAtom clipboard_atom = GDK_NONE;
 
 typedef struct _ECellTextPrivate {
 	PangoEllipsizeMode ellipsize_mode;
+	guint layout_stamp; /* changes when any property affecting the layouts changes */
 } ECellTextPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (ECellText, e_cell_text, E_TYPE_CELL)
@@ -95,6 +96,32 @@ G_DEFINE_TYPE_WITH_PRIVATE (ECellText, e_cell_text, E_TYPE_CELL)
 
 #define TEXT_PAD 4
 
+/* How many layouts each view, aka each column, can cache; a few screens of rows */
+#define LAYOUT_CACHE_SIZE 256
+
+/* Bits of the LayoutCacheEntry::attrs */
+#define LAYOUT_ATTR_BOLD	(1 << 0)
+#define LAYOUT_ATTR_STRIKEOUT	(1 << 1)
+#define LAYOUT_ATTR_UNDERLINE	(1 << 2)
+#define LAYOUT_ATTR_ITALIC	(1 << 3)
+
+typedef struct _LayoutCacheEntry {
+	/* the hash key */
+	gint row;
+	gint model_col;
+	gint width;
+
+	/* verified on lookup, the layout is rebuilt when any differs */
+	guint attrs;
+	guint strikeout_color;
+	guint context_serial;
+	guint cell_stamp;
+	gchar *text;
+
+	PangoLayout *layout;
+	GList *lru_link; /* in ECellTextView::layout_cache_lru */
+} LayoutCacheEntry;
+
 typedef struct {
 	gpointer lines;			/* Text split into lines (private field) */
 	gint num_lines;			/* Number of lines of text */
@@ -118,6 +145,10 @@ typedef struct {
 	gint xofs, yofs;                 /* This gets added to the x
                                            and y for the cell text. */
 	gdouble ellipsis_width[2];      /* The width of the ellipsis. */
+
+	/* Layouts of the drawn cells, to not shape the text on every draw */
+	GHashTable *layout_cache;	/* LayoutCacheEntry ~> itself */
+	GQueue layout_cache_lru;	/* LayoutCacheEntry *, the most recently used first */
 } ECellTextView;
 
 struct _CellEdit {
@@ -316,6 +347,44 @@ ect_cancel_edit (ECellTextView *text_view)
 /*
  * ECell::new_view method
  */
+static guint
+layout_cache_entry_hash (gconstpointer ptr)
+{
+	const LayoutCacheEntry *entry = ptr;
+
+	return (((guint) entry->row) * 31 + ((guint) entry->model_col)) * 31 + ((guint) entry->width);
+}
+
+static gboolean
+layout_cache_entry_equal (gconstpointer ptr1,
+			  gconstpointer ptr2)
+{
+	const LayoutCacheEntry *entry1 = ptr1, *entry2 = ptr2;
+
+	return entry1->row == entry2->row &&
+		entry1->model_col == entry2->model_col &&
+		entry1->width == entry2->width;
+}
+
+static void
+layout_cache_entry_free (gpointer ptr)
+{
+	LayoutCacheEntry *entry = ptr;
+
+	if (entry) {
+		g_clear_object (&entry->layout);
+		g_free (entry->text);
+		g_free (entry);
+	}
+}
+
+static void
+ect_clear_layout_cache (ECellTextView *text_view)
+{
+	g_queue_clear (&text_view->layout_cache_lru);
+	g_hash_table_remove_all (text_view->layout_cache);
+}
+
 static ECellView *
 ect_new_view (ECell *ecell,
               ETableModel *table_model,
@@ -335,6 +404,9 @@ ect_new_view (ECell *ecell,
 	text_view->xofs = 0.0;
 	text_view->yofs = 0.0;
 
+	text_view->layout_cache = g_hash_table_new_full (layout_cache_entry_hash, layout_cache_entry_equal, layout_cache_entry_free, NULL);
+	g_queue_init (&text_view->layout_cache_lru);
+
 	return (ECellView *) text_view;
 }
 
@@ -352,6 +424,9 @@ ect_kill_view (ECellView *ecv)
 	if (text_view->cell_view.kill_view_cb_data)
 	    g_list_free (text_view->cell_view.kill_view_cb_data);
 
+	ect_clear_layout_cache (text_view);
+	g_hash_table_destroy (text_view->layout_cache);
+
 	g_free (text_view);
 }
 
@@ -383,6 +458,8 @@ ect_unrealize (ECellView *ecv)
 
 	g_clear_object (&text_view->i_cursor);
 
+	ect_clear_layout_cache (text_view);
+
 	if (E_CELL_CLASS (e_cell_text_parent_class)->unrealize)
 		(* E_CELL_CLASS (e_cell_text_parent_class)->unrealize) (ecv);
 
@@ -685,6 +762,112 @@ generate_layout (ECellTextView *text_view,
 	return layout;
 }
 
+static guint
+get_layout_attrs (ECellTextView *text_view,
+		  gint row,
+		  guint *out_strikeout_color)
+{
+	ECellView *ecell_view = (ECellView *) text_view;
+	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	guint attrs = 0;
+
+	/* The same values as build_attr_list() uses */
+	if (ect->bold_column >= 0 && e_table_model_value_at (ecell_view->e_table_model, ect->bold_column, row))
+		attrs |= LAYOUT_ATTR_BOLD;
+	if (ect->strikeout_column >= 0 && e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_column, row))
+		attrs |= LAYOUT_ATTR_STRIKEOUT;
+	if (ect->underline_column >= 0 && e_table_model_value_at (ecell_view->e_table_model, ect->underline_column, row))
+		attrs |= LAYOUT_ATTR_UNDERLINE;
+	if (ect->italic_column >= 0 && e_table_model_value_at (ecell_view->e_table_model, ect->italic_column, row))
+		attrs |= LAYOUT_ATTR_ITALIC;
+
+	*out_strikeout_color = 0;
+
+	if ((attrs & LAYOUT_ATTR_STRIKEOUT) != 0 && ect->strikeout_color_column >= 0)
+		*out_strikeout_color = GPOINTER_TO_UINT (e_table_model_value_at (ecell_view->e_table_model, ect->strikeout_color_column, row));
+
+	return attrs;
+}
+
+/* Like generate_layout(), only reuses the layout from the previous call
+   for the same cell, when neither its text nor its style changed. The
+   text and the attributes are compared, not only hashed, thus the model
+   changes cannot return a stale layout; font changes bump the serial
+   of the canvas' PangoContext. */
+static PangoLayout *
+generate_layout_cached (ECellTextView *text_view,
+			gint model_col,
+			gint view_col,
+			gint row,
+			gint width)
+{
+	ECellView *ecell_view = (ECellView *) text_view;
+	ECellText *ect = E_CELL_TEXT (ecell_view->ecell);
+	ECellTextPrivate *priv = e_cell_text_get_instance_private (ect);
+	LayoutCacheEntry key, *entry;
+	PangoContext *pango_context;
+	guint attrs, strikeout_color = 0, context_serial;
+	gchar *text;
+
+	if (row < 0 || text_view->edit)
+		return generate_layout (text_view, model_col, view_col, row, width);
+
+	pango_context = gtk_widget_get_pango_context (GTK_WIDGET (text_view->canvas));
+	context_serial = pango_context_get_serial (pango_context);
+	attrs = get_layout_attrs (text_view, row, &strikeout_color);
+	text = e_cell_text_get_text (ect, ecell_view->e_table_model, model_col, row);
+
+	key.row = row;
+	key.model_col = model_col;
+	key.width = width;
+
+	entry = g_hash_table_lookup (text_view->layout_cache, &key);
+
+	if (entry) {
+		g_queue_unlink (&text_view->layout_cache_lru, entry->lru_link);
+		g_queue_push_head_link (&text_view->layout_cache_lru, entry->lru_link);
+
+		if (entry->attrs == attrs &&
+		    entry->strikeout_color == strikeout_color &&
+		    entry->context_serial == context_serial &&
+		    entry->cell_stamp == priv->layout_stamp &&
+		    g_strcmp0 (entry->text, text ? text : "") == 0) {
+			e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, text);
+			return g_object_ref (entry->layout);
+		}
+
+		g_clear_object (&entry->layout);
+		g_clear_pointer (&entry->text, g_free);
+	} else {
+		if (g_queue_get_length (&text_view->layout_cache_lru) >= LAYOUT_CACHE_SIZE) {
+			LayoutCacheEntry *oldest = g_queue_pop_tail (&text_view->layout_cache_lru);
+
+			g_hash_table_remove (text_view->layout_cache, oldest);
+		}
+
+		entry = g_new0 (LayoutCacheEntry, 1);
+		entry->row = row;
+		entry->model_col = model_col;
+		entry->width = width;
+
+		g_queue_push_head (&text_view->layout_cache_lru, entry);
+		entry->lru_link = g_queue_peek_head_link (&text_view->layout_cache_lru);
+
+		g_hash_table_add (text_view->layout_cache, entry);
+	}
+
+	entry->attrs = attrs;
+	entry->strikeout_color = strikeout_color;
+	entry->context_serial = context_serial;
+	entry->cell_stamp = priv->layout_stamp;
+	entry->text = g_strdup (text ? text : "");
+	entry->layout = build_layout (text_view, row, entry->text, width);
+
+	e_cell_text_free_text (ect, ecell_view->e_table_model, model_col, text);
+
+	return g_object_ref (entry->layout);
+}
+
 static void
 draw_cursor (cairo_t *cr,
              gint x1,
@@ -856,7 +1039,7 @@ ect_draw (ECellView *ecell_view,
 	cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
 	cairo_clip (cr);
 
-	layout = generate_layout (text_view, model_col, view_col, row, x2 - x1);
+	layout = generate_layout_cached (text_view, model_col, view_col, row, x2 - x1);
 
 	if (edit && edit->view_col == view_col && edit->row == row) {
 		layout = layout_with_preedit  (text_view, row, edit->text ? edit->text : "",  x2 - x1);
@@ -1207,7 +1390,7 @@ ect_height (ECellView *ecell_view,
 	gint height;
 	PangoLayout *layout;
 
-	layout = generate_layout (text_view, model_col, view_col, row, 0);
+	layout = generate_layout_cached (text_view, model_col, view_col, row, 0);
 	pango_layout_get_pixel_size (layout, NULL, &height);
 	g_object_unref (layout);
 	return height + (get_vertical_spacing (GTK_WIDGET (text_view->canvas)) * 2);
@@ -1624,8 +1807,10 @@ ect_set_property (GObject *object,
                   GParamSpec *pspec)
 {
 	ECellText *text;
+	ECellTextPrivate *priv;
 
 	text = E_CELL_TEXT (object);
+	priv = e_cell_text_get_instance_private (text);
 
 	switch (property_id) {
 	case PROP_STRIKEOUT_COLUMN:
@@ -1675,6 +1860,8 @@ ect_set_property (GObject *object,
 	default:
 		return;
 	}
+
+	priv->layout_stamp++;
 }
 
 /* Get_arg handler for the text item */
@@ -3021,5 +3208,8 @@ e_cell_text_set_ellipsize_mode (ECellText *self,
 
 	priv = e_cell_text_get_instance_private (self);
 
-	priv->ellipsize_mode = mode;
+	if (priv->ellipsize_mode != mode) {
+		priv->ellipsize_mode = mode;
+		priv->layout_stamp++;
+	}
 }
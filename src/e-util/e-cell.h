@@ -47,6 +47,13 @@ typedef struct _ECellView ECellView;
 typedef gboolean (*ETableSearchFunc) (gconstpointer haystack,
 				      const gchar *needle);
 
+/* Sort keys are precomputed once per value and compared without calling
+ * the column compare function. Collate keys are compared with strcmp(),
+ * a NULL key sorts after any other; they can be computed in a dedicated
+ * thread. Integer keys are computed in the main thread. */
+typedef gchar *	(*ETableCollateKeyFunc) (gconstpointer value);
+typedef gint64	(*ETableIntKeyFunc) (gconstpointer value);
+
 typedef enum {
 	E_CELL_SELECTED = 1 << 0,
 
@@ -26,6 +26,7 @@
 #include <libebackend/libebackend.h>
 
 #include "e-simple-async-result.h"
+#include "e-trace.h"
 #include "e-client-cache.h"
 
 typedef struct _ClientData ClientData;
@@ -53,6 +54,10 @@ struct _ClientData {
 	gulong backend_died_handler_id;
 	gulong backend_error_handler_id;
 	gulong notify_handler_id;
+
+	/* Set only when tracing. */
+	gint64 trace_begin;
+	gchar *trace_detail;
 };
 
 struct _SignalClosure {
@@ -127,6 +132,7 @@ client_data_unref (ClientData *client_data)
 
 		g_mutex_clear (&client_data->lock);
 		g_clear_object (&client_data->client);
+		g_free (client_data->trace_detail);
 		g_weak_ref_set (&client_data->client_cache, NULL);
 
 		/* There should be no connect() operations in progress. */
@@ -514,6 +520,11 @@ client_cache_process_results (ClientData *client_data,
 	/* Complete async operations outside the lock. */
 	e_queue_transfer (&client_data->connecting, &queue);
 
+	if (client_data->trace_begin) {
+		e_trace_end (client_data->trace_begin, "client-cache", "connect", client_data->trace_detail);
+		client_data->trace_begin = 0;
+	}
+
 	if (client != NULL) {
 		EClientCache *client_cache;
 
@@ -1112,6 +1123,7 @@ e_client_cache_get_client_sync (EClientCache *client_cache,
 {
 	ClientData *client_data;
 	EClient *client = NULL;
+	gint64 trace_begin;
 	GError *local_error = NULL;
 
 	g_return_val_if_fail (E_IS_CLIENT_CACHE (client_cache), NULL);
@@ -1142,6 +1154,8 @@ e_client_cache_get_client_sync (EClientCache *client_cache,
 		return client;
 	}
 
+	trace_begin = e_trace_begin ();
+
 	/* Create an appropriate EClient instance for the extension
 	 * name.  The client_ht_lookup() call above ensures us that
 	 * one of these options will match. */
@@ -1165,6 +1179,14 @@ e_client_cache_get_client_sync (EClientCache *client_cache,
 		g_warn_if_reached ();  /* Should never happen. */
 	}
 
+	if (trace_begin) {
+		gchar *detail;
+
+		detail = g_strconcat (e_source_get_uid (source), " ", extension_name, NULL);
+		e_trace_end (trace_begin, "client-cache", "connect-sync", detail);
+		g_free (detail);
+	}
+
 	if (client)
 		client_cache_process_results (client_data, client, local_error);
 
@@ -1286,6 +1308,14 @@ e_client_cache_get_client (EClientCache *client_cache,
 	if (connect_in_progress)
 		goto exit;
 
+	if (e_trace_is_enabled ()) {
+		g_mutex_lock (&client_data->lock);
+		client_data->trace_begin = e_trace_begin ();
+		g_free (client_data->trace_detail);
+		client_data->trace_detail = g_strconcat (e_source_get_uid (source), " ", extension_name, NULL);
+		g_mutex_unlock (&client_data->lock);
+	}
+
 	/* Create an appropriate EClient instance for the extension
 	 * name.  The client_ht_lookup() call above ensures us that
 	 * one of these options will match. */
@@ -161,17 +161,8 @@ e_icon_factory_pixbuf_scale (GdkPixbuf *pixbuf,
 	return gdk_pixbuf_scale_simple (pixbuf, width, height, GDK_INTERP_BILINEAR);
 }
 
-/**
- * e_icon_factory_create_thumbnail
- * @filename: the file name to create the thumbnail for
- *
- * Creates system thumbnail for @filename.
- *
- * Returns: Path to system thumbnail of the file; %NULL if couldn't
- *          create it. Free it with g_free().
- **/
-gchar *
-e_icon_factory_create_thumbnail (const gchar *filename)
+static gchar *
+icon_factory_create_thumbnail_locked (const gchar *filename)
 {
 #ifdef HAVE_GNOME_DESKTOP
 	static GnomeDesktopThumbnailFactory *thumbnail_factory = NULL;
@@ -242,3 +233,28 @@ e_icon_factory_create_thumbnail (const gchar *filename)
 	return NULL;
 #endif /* HAVE_GNOME_DESKTOP */
 }
+
+/**
+ * e_icon_factory_create_thumbnail
+ * @filename: the file name to create the thumbnail for
+ *
+ * Creates system thumbnail for @filename. The function can be called
+ * from any thread, but the thumbnails are created one at a time.
+ *
+ * Returns: Path to system thumbnail of the file; %NULL if couldn't
+ *          create it. Free it with g_free().
+ **/
+gchar *
+e_icon_factory_create_thumbnail (const gchar *filename)
+{
+	static GMutex mutex;
+	gchar *thumbnail;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	g_mutex_lock (&mutex);
+	thumbnail = icon_factory_create_thumbnail_locked (filename);
+	g_mutex_unlock (&mutex);
+
+	return thumbnail;
+}
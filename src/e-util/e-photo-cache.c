@@ -10,13 +10,15 @@
  * #EPhotoCache finds photos associated with an email address.
  *
  * A limited internal cache is employed to speed up frequently searched
- * email addresses.  The exact caching semantics are private and subject
- * to change.
+ * email addresses, optionally backed by an on-disk cache.  The exact
+ * caching semantics are private and subject to change.
  **/
 
 #include "evolution-config.h"
 
 #include <string.h>
+#include <errno.h>
+#include <glib/gstdio.h>
 #include <libebackend/libebackend.h>
 
 #include <e-util/e-data-capture.h>
@@ -28,11 +30,24 @@
  * priority photo source, after which we settle for what we have. */
 #define ASYNC_TIMEOUT_SECONDS 3.0
 
-/* How many email addresses we track at once, regardless of whether
- * the email address has a photo.  As new cache entries are added, we
- * discard the least recently accessed entries to keep the cache size
- * within the limit. */
-#define MAX_CACHE_SIZE 20
+/* How much memory the cached photos can use.  As new cache entries
+ * are added, we discard the least recently accessed entries to keep
+ * the cache size within the limit.  Each entry counts with at least
+ * CACHE_ENTRY_OVERHEAD bytes, which also limits the number of email
+ * addresses without a photo. */
+#define MAX_CACHE_BYTES (4 * 1024 * 1024)
+#define CACHE_ENTRY_OVERHEAD 256
+
+/* How long (in seconds) to remember that an email address has no photo,
+ * before asking the photo sources again. */
+#define NEGATIVE_ENTRY_TIMEOUT_SECONDS (60 * 60)
+
+/* Limits of the on-disk cache; the files are removed, when older than
+ * MAX_DISK_AGE_SECONDS, or when the whole cache is larger than
+ * MAX_DISK_BYTES, the least recently written first. */
+#define MAX_DISK_AGE_SECONDS (7 * 24 * 60 * 60)
+#define MAX_DISK_BYTES (32 * 1024 * 1024)
+#define DISK_WRITES_BETWEEN_PRUNES 64
 
 #define ERROR_IS_CANCELLED(error) \
 	(g_error_matches ((error), G_IO_ERROR, G_IO_ERROR_CANCELLED))
@@ -47,9 +62,17 @@ struct _EPhotoCachePrivate {
 	GMainContext *main_context;
 
 	GHashTable *photo_ht;
-	GQueue photo_ht_keys;
+	GQueue photo_ht_keys; /* most recently used first */
+	gsize photo_ht_bytes;
 	GMutex photo_ht_lock;
 
+	/* These are guarded by the photo_ht_lock */
+	gchar *disk_cache_dir; /* NULL when not using disk cache */
+	guint disk_writes;
+	guint64 n_hits;
+	guint64 n_disk_hits;
+	guint64 n_misses;
+
 	GHashTable *sources_ht;
 	GMutex sources_ht_lock;
 };
@@ -62,6 +85,10 @@ struct _AsyncContext {
 	GInputStream *stream;
 	GConverter *data_capture;
 
+	/* to remember email addresses without a photo */
+	GWeakRef photo_cache;
+	gchar *email_address;
+
 	GCancellable *cancellable;
 	gulong cancelled_handler_id;
 };
@@ -85,11 +112,33 @@ struct _PhotoData {
 	volatile gint ref_count;
 	GMutex lock;
 	GBytes *bytes;
+
+	/* These are guarded by the photo_ht_lock */
+	GList *lru_link; /* in photo_ht_keys */
+	gsize cost;
+	gint64 expires; /* monotonic time; 0 means never */
 };
 
+typedef struct _DiskLookupData {
+	gchar *filename;
+	gboolean found;
+	GBytes *bytes;
+	gint64 age; /* in seconds */
+
+	ESimpleAsyncResult *simple;
+	gchar *email_address;
+	GCancellable *cancellable;
+} DiskLookupData;
+
+typedef struct _DiskWriteData {
+	gchar *filename;
+	GBytes *bytes;
+} DiskWriteData;
+
 enum {
 	PROP_0,
 	PROP_CLIENT_CACHE,
+	PROP_USE_DISK_CACHE,
 	N_PROPS
 };
 
@@ -97,6 +146,8 @@ static GParamSpec *properties[N_PROPS] = { NULL, };
 
 /* Forward Declarations */
 static void	async_context_cancel_subtasks	(AsyncContext *async_context);
+static void	photo_cache_note_no_photo	(EPhotoCache *photo_cache,
+						 const gchar *email_address);
 
 G_DEFINE_TYPE_WITH_CODE (EPhotoCache, e_photo_cache, G_TYPE_OBJECT,
 	G_ADD_PRIVATE (EPhotoCache)
@@ -262,6 +313,17 @@ async_subtask_complete (AsyncSubtask *async_subtask)
 		}
 
 		async_subtask_unref (async_subtask);
+	} else {
+		EPhotoCache *photo_cache;
+
+		/* All the photo sources finished without a match,
+		 * remember it, to not ask them again for some time. */
+		photo_cache = g_weak_ref_get (&async_context->photo_cache);
+
+		if (photo_cache != NULL) {
+			photo_cache_note_no_photo (photo_cache, async_context->email_address);
+			g_object_unref (photo_cache);
+		}
 	}
 
 	e_simple_async_result_complete_idle (simple);
@@ -283,7 +345,9 @@ async_context_cancelled_cb (GCancellable *cancellable,
 }
 
 static AsyncContext *
-async_context_new (EDataCapture *data_capture,
+async_context_new (EPhotoCache *photo_cache,
+                   const gchar *email_address,
+                   EDataCapture *data_capture,
                    GCancellable *cancellable)
 {
 	AsyncContext *async_context;
@@ -291,6 +355,8 @@ async_context_new (EDataCapture *data_capture,
 	async_context = g_slice_new0 (AsyncContext);
 	g_mutex_init (&async_context->lock);
 	async_context->timer = g_timer_new ();
+	g_weak_ref_init (&async_context->photo_cache, photo_cache);
+	async_context->email_address = g_strdup (email_address);
 
 	async_context->subtasks = g_hash_table_new_full (
 		(GHashFunc) g_direct_hash,
@@ -335,6 +401,9 @@ async_context_free (AsyncContext *async_context)
 	g_clear_object (&async_context->data_capture);
 	g_clear_object (&async_context->cancellable);
 
+	g_weak_ref_clear (&async_context->photo_cache);
+	g_free (async_context->email_address);
+
 	g_slice_free (AsyncContext, async_context);
 }
 
@@ -480,10 +549,36 @@ photo_ht_normalize_key (const gchar *email_address)
 	return collation_key;
 }
 
+static gsize
+photo_data_calc_cost (GBytes *bytes)
+{
+	return CACHE_ENTRY_OVERHEAD + (bytes ? g_bytes_get_size (bytes) : 0);
+}
+
+/* Call with the photo_ht_lock held */
+static void
+photo_ht_remove_link_locked (EPhotoCache *photo_cache,
+                             GList *link)
+{
+	PhotoData *photo_data;
+	gchar *key = link->data;
+
+	photo_data = g_hash_table_lookup (photo_cache->priv->photo_ht, key);
+	if (photo_data != NULL) {
+		photo_cache->priv->photo_ht_bytes -= photo_data->cost;
+		photo_data->lru_link = NULL;
+		g_hash_table_remove (photo_cache->priv->photo_ht, key);
+	}
+
+	g_queue_delete_link (&photo_cache->priv->photo_ht_keys, link);
+	g_free (key);
+}
+
 static void
 photo_ht_insert (EPhotoCache *photo_cache,
                  const gchar *email_address,
-                 GBytes *bytes)
+                 GBytes *bytes,
+                 gint64 expires)
 {
 	GHashTable *photo_ht;
 	GQueue *photo_ht_keys;
@@ -502,23 +597,24 @@ photo_ht_insert (EPhotoCache *photo_cache,
 	photo_data = g_hash_table_lookup (photo_ht, key);
 
 	if (photo_data != NULL) {
-		GList *link;
-
 		/* Replace the old photo data if we have new photo
 		 * data, otherwise leave the old photo data alone. */
-		if (bytes != NULL)
+		if (bytes != NULL) {
 			photo_data_set_bytes (photo_data, bytes);
 
-		/* Move the key to the head of the MRU queue. */
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_queue_unlink (photo_ht_keys, link);
-			g_queue_push_head_link (photo_ht_keys, link);
+			photo_cache->priv->photo_ht_bytes -= photo_data->cost;
+			photo_data->cost = photo_data_calc_cost (bytes);
+			photo_cache->priv->photo_ht_bytes += photo_data->cost;
+			photo_data->expires = expires;
 		}
+
+		/* Move the key to the head of the MRU queue. */
+		g_queue_unlink (photo_ht_keys, photo_data->lru_link);
+		g_queue_push_head_link (photo_ht_keys, photo_data->lru_link);
 	} else {
 		photo_data = photo_data_new (bytes);
+		photo_data->cost = photo_data_calc_cost (bytes);
+		photo_data->expires = expires;
 
 		g_hash_table_insert (
 			photo_ht, g_strdup (key),
@@ -526,19 +622,19 @@ photo_ht_insert (EPhotoCache *photo_cache,
 
 		/* Push the key to the head of the MRU queue. */
 		g_queue_push_head (photo_ht_keys, g_strdup (key));
+		photo_data->lru_link = g_queue_peek_head_link (photo_ht_keys);
 
-		/* Trim the cache if necessary. */
-		while (g_queue_get_length (photo_ht_keys) > MAX_CACHE_SIZE) {
-			gchar *oldest_key;
-
-			oldest_key = g_queue_pop_tail (photo_ht_keys);
-			g_hash_table_remove (photo_ht, oldest_key);
-			g_free (oldest_key);
-		}
+		photo_cache->priv->photo_ht_bytes += photo_data->cost;
 
 		photo_data_unref (photo_data);
 	}
 
+	/* Trim the cache if necessary, but keep the just added entry. */
+	while (photo_cache->priv->photo_ht_bytes > MAX_CACHE_BYTES &&
+	       g_queue_get_length (photo_ht_keys) > 1) {
+		photo_ht_remove_link_locked (photo_cache, g_queue_peek_tail_link (photo_ht_keys));
+	}
+
 	/* Hash table and queue sizes should be equal at all times. */
 	g_warn_if_fail (
 		g_hash_table_size (photo_ht) ==
@@ -570,7 +666,14 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 
 	photo_data = g_hash_table_lookup (photo_ht, key);
 
+	if (photo_data != NULL && photo_data->expires > 0 &&
+	    photo_data->expires < g_get_monotonic_time ()) {
+		photo_ht_remove_link_locked (photo_cache, photo_data->lru_link);
+		photo_data = NULL;
+	}
+
 	if (photo_data != NULL) {
+		GQueue *photo_ht_keys = &photo_cache->priv->photo_ht_keys;
 		GBytes *bytes;
 
 		bytes = photo_data_ref_bytes (photo_data);
@@ -582,6 +685,12 @@ photo_ht_lookup (EPhotoCache *photo_cache,
 			*out_stream = NULL;
 		}
 		found = TRUE;
+
+		/* Move the key to the head of the MRU queue. */
+		g_queue_unlink (photo_ht_keys, photo_data->lru_link);
+		g_queue_push_head_link (photo_ht_keys, photo_data->lru_link);
+
+		photo_cache->priv->n_hits++;
 	}
 
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
@@ -597,6 +706,7 @@ photo_ht_remove (EPhotoCache *photo_cache,
 {
 	GHashTable *photo_ht;
 	GQueue *photo_ht_keys;
+	PhotoData *photo_data;
 	gchar *key;
 	gboolean removed = FALSE;
 
@@ -609,17 +719,11 @@ photo_ht_remove (EPhotoCache *photo_cache,
 
 	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
 
-	if (g_hash_table_remove (photo_ht, key)) {
-		GList *link;
+	photo_data = g_hash_table_lookup (photo_ht, key);
 
-		link = g_queue_find_custom (
-			photo_ht_keys, key,
-			(GCompareFunc) strcmp);
-		if (link != NULL) {
-			g_free (link->data);
-			g_queue_delete_link (photo_ht_keys, link);
-			removed = TRUE;
-		}
+	if (photo_data != NULL) {
+		photo_ht_remove_link_locked (photo_cache, photo_data->lru_link);
+		removed = TRUE;
 	}
 
 	/* Hash table and queue sizes should be equal at all times. */
@@ -650,7 +754,298 @@ photo_ht_remove_all (EPhotoCache *photo_cache)
 	while (!g_queue_is_empty (photo_ht_keys))
 		g_free (g_queue_pop_head (photo_ht_keys));
 
+	photo_cache->priv->photo_ht_bytes = 0;
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+}
+
+/* The on-disk cache stores one file per email address, named by
+ * a checksum of the normalized address.  An empty file means that
+ * the email address has no photo. */
+static gchar *
+photo_disk_dup_filename (EPhotoCache *photo_cache,
+                         const gchar *email_address)
+{
+	gchar *filename = NULL;
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	if (photo_cache->priv->disk_cache_dir != NULL) {
+		gchar *normalized, *checksum;
+
+		normalized = g_utf8_strdown (email_address, -1);
+		g_strstrip (normalized);
+
+		checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, normalized, -1);
+		filename = g_build_filename (photo_cache->priv->disk_cache_dir, checksum, NULL);
+
+		g_free (checksum);
+		g_free (normalized);
+	}
+
 	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	return filename;
+}
+
+typedef struct _DiskFileInfo {
+	gchar *filename;
+	gint64 mtime;
+	gint64 size;
+} DiskFileInfo;
+
+static gint
+photo_disk_file_info_compare_mtime (gconstpointer ptr1,
+                                    gconstpointer ptr2)
+{
+	const DiskFileInfo *info1 = *((const DiskFileInfo **) ptr1);
+	const DiskFileInfo *info2 = *((const DiskFileInfo **) ptr2);
+
+	if (info1->mtime == info2->mtime)
+		return 0;
+
+	return info1->mtime < info2->mtime ? -1 : 1;
+}
+
+static void
+photo_disk_file_info_free (gpointer ptr)
+{
+	DiskFileInfo *info = ptr;
+
+	if (info) {
+		g_free (info->filename);
+		g_slice_free (DiskFileInfo, info);
+	}
+}
+
+static void
+photo_disk_prune_thread (GTask *task,
+                         gpointer source_object,
+                         gpointer task_data,
+                         GCancellable *cancellable)
+{
+	const gchar *dirname = task_data;
+	GPtrArray *files;
+	GDir *dir;
+	const gchar *name;
+	gint64 now, total_size = 0;
+	guint ii;
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir) {
+		g_task_return_boolean (task, FALSE);
+		return;
+	}
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	files = g_ptr_array_new_with_free_func (photo_disk_file_info_free);
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		DiskFileInfo *info;
+		GStatBuf st;
+		gchar *filename;
+
+		filename = g_build_filename (dirname, name, NULL);
+
+		if (g_stat (filename, &st) != 0 || !S_ISREG (st.st_mode)) {
+			g_free (filename);
+			continue;
+		}
+
+		if (now - st.st_mtime > (st.st_size ? MAX_DISK_AGE_SECONDS : NEGATIVE_ENTRY_TIMEOUT_SECONDS)) {
+			g_unlink (filename);
+			g_free (filename);
+			continue;
+		}
+
+		info = g_slice_new (DiskFileInfo);
+		info->filename = filename;
+		info->mtime = st.st_mtime;
+		info->size = st.st_size;
+
+		total_size += info->size;
+
+		g_ptr_array_add (files, info);
+	}
+
+	g_dir_close (dir);
+
+	if (total_size > MAX_DISK_BYTES) {
+		g_ptr_array_sort (files, photo_disk_file_info_compare_mtime);
+
+		/* Leave some room, to not prune on each write */
+		for (ii = 0; ii < files->len && total_size > MAX_DISK_BYTES * 3 / 4; ii++) {
+			DiskFileInfo *info = g_ptr_array_index (files, ii);
+
+			if (g_unlink (info->filename) == 0)
+				total_size -= info->size;
+		}
+	}
+
+	g_ptr_array_unref (files);
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+photo_disk_schedule_prune (EPhotoCache *photo_cache,
+                           const gchar *dirname)
+{
+	GTask *task;
+
+	task = g_task_new (photo_cache, NULL, NULL, NULL);
+	g_task_set_source_tag (task, photo_disk_schedule_prune);
+	g_task_set_task_data (task, g_strdup (dirname), g_free);
+	g_task_run_in_thread (task, photo_disk_prune_thread);
+	g_object_unref (task);
+}
+
+static void
+disk_write_data_free (gpointer ptr)
+{
+	DiskWriteData *dwd = ptr;
+
+	if (dwd) {
+		g_free (dwd->filename);
+		g_clear_pointer (&dwd->bytes, g_bytes_unref);
+		g_slice_free (DiskWriteData, dwd);
+	}
+}
+
+static void
+photo_disk_write_thread (GTask *task,
+                         gpointer source_object,
+                         gpointer task_data,
+                         GCancellable *cancellable)
+{
+	DiskWriteData *dwd = task_data;
+	GError *local_error = NULL;
+	gconstpointer data = NULL;
+	gsize size = 0;
+
+	if (dwd->bytes)
+		data = g_bytes_get_data (dwd->bytes, &size);
+
+	if (!g_file_set_contents (dwd->filename, data ? data : "", size, &local_error)) {
+		g_debug ("%s: Failed to write '%s': %s", G_STRFUNC, dwd->filename,
+			local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+photo_disk_store (EPhotoCache *photo_cache,
+                  const gchar *email_address,
+                  GBytes *bytes)
+{
+	DiskWriteData *dwd;
+	GTask *task;
+	gchar *filename;
+	gchar *prune_dir = NULL;
+
+	filename = photo_disk_dup_filename (photo_cache, email_address);
+	if (!filename)
+		return;
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	photo_cache->priv->disk_writes++;
+	if (photo_cache->priv->disk_writes >= DISK_WRITES_BETWEEN_PRUNES && photo_cache->priv->disk_cache_dir) {
+		photo_cache->priv->disk_writes = 0;
+		prune_dir = g_strdup (photo_cache->priv->disk_cache_dir);
+	}
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	dwd = g_slice_new0 (DiskWriteData);
+	dwd->filename = filename;
+	dwd->bytes = bytes ? g_bytes_ref (bytes) : NULL;
+
+	task = g_task_new (photo_cache, NULL, NULL, NULL);
+	g_task_set_source_tag (task, photo_disk_store);
+	g_task_set_task_data (task, dwd, disk_write_data_free);
+	g_task_run_in_thread (task, photo_disk_write_thread);
+	g_object_unref (task);
+
+	if (prune_dir) {
+		photo_disk_schedule_prune (photo_cache, prune_dir);
+		g_free (prune_dir);
+	}
+}
+
+static void
+photo_disk_remove (EPhotoCache *photo_cache,
+                   const gchar *email_address)
+{
+	gchar *filename;
+
+	filename = photo_disk_dup_filename (photo_cache, email_address);
+	if (filename) {
+		if (g_unlink (filename) != 0 && errno != ENOENT)
+			g_debug ("%s: Failed to remove '%s': %s", G_STRFUNC, filename, g_strerror (errno));
+
+		g_free (filename);
+	}
+}
+
+static void
+disk_lookup_data_free (gpointer ptr)
+{
+	DiskLookupData *dld = ptr;
+
+	if (dld) {
+		g_free (dld->filename);
+		g_clear_pointer (&dld->bytes, g_bytes_unref);
+		g_clear_object (&dld->simple);
+		g_clear_object (&dld->cancellable);
+		g_free (dld->email_address);
+		g_slice_free (DiskLookupData, dld);
+	}
+}
+
+static void
+photo_disk_lookup_thread (GTask *task,
+                          gpointer source_object,
+                          gpointer task_data,
+                          GCancellable *cancellable)
+{
+	DiskLookupData *dld = task_data;
+	GStatBuf st;
+
+	if (g_stat (dld->filename, &st) == 0) {
+		dld->age = (g_get_real_time () / G_USEC_PER_SEC) - st.st_mtime;
+
+		if (dld->age > (st.st_size ? MAX_DISK_AGE_SECONDS : NEGATIVE_ENTRY_TIMEOUT_SECONDS)) {
+			g_unlink (dld->filename);
+		} else if (st.st_size == 0) {
+			dld->found = TRUE;
+		} else {
+			gchar *contents = NULL;
+			gsize length = 0;
+
+			if (g_file_get_contents (dld->filename, &contents, &length, NULL) && length > 0) {
+				dld->bytes = g_bytes_new_take (contents, length);
+				dld->found = TRUE;
+			} else {
+				g_free (contents);
+			}
+		}
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+photo_cache_note_no_photo (EPhotoCache *photo_cache,
+                           const gchar *email_address)
+{
+	photo_ht_insert (
+		photo_cache, email_address, NULL,
+		g_get_monotonic_time () + NEGATIVE_ENTRY_TIMEOUT_SECONDS * G_TIME_SPAN_SECOND);
+
+	photo_disk_store (photo_cache, email_address, NULL);
 }
 
 static void
@@ -709,6 +1104,12 @@ photo_cache_set_property (GObject *object,
 				E_PHOTO_CACHE (object),
 				g_value_get_object (value));
 			return;
+
+		case PROP_USE_DISK_CACHE:
+			e_photo_cache_set_use_disk_cache (
+				E_PHOTO_CACHE (object),
+				g_value_get_boolean (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -727,6 +1128,13 @@ photo_cache_get_property (GObject *object,
 				e_photo_cache_ref_client_cache (
 				E_PHOTO_CACHE (object)));
 			return;
+
+		case PROP_USE_DISK_CACHE:
+			g_value_set_boolean (
+				value,
+				e_photo_cache_get_use_disk_cache (
+				E_PHOTO_CACHE (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -758,6 +1166,8 @@ photo_cache_finalize (GObject *object)
 	g_mutex_clear (&self->priv->photo_ht_lock);
 	g_mutex_clear (&self->priv->sources_ht_lock);
 
+	g_free (self->priv->disk_cache_dir);
+
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (e_photo_cache_parent_class)->finalize (object);
 }
@@ -801,6 +1211,22 @@ e_photo_cache_class_init (EPhotoCacheClass *class)
 			G_PARAM_CONSTRUCT_ONLY |
 			G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * EPhotoCache:use-disk-cache:
+	 *
+	 * Whether to store found photos, and also email addresses
+	 * without a photo, on the disk, to be used after restart.
+	 *
+	 * Since: 3.62
+	 **/
+	properties[PROP_USE_DISK_CACHE] =
+		g_param_spec_boolean (
+			"use-disk-cache", NULL, NULL,
+			FALSE,
+			G_PARAM_READWRITE |
+			G_PARAM_EXPLICIT_NOTIFY |
+			G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -868,6 +1294,119 @@ e_photo_cache_ref_client_cache (EPhotoCache *photo_cache)
 	return g_object_ref (photo_cache->priv->client_cache);
 }
 
+/**
+ * e_photo_cache_get_use_disk_cache:
+ * @photo_cache: an #EPhotoCache
+ *
+ * Returns whether the @photo_cache stores the photos also on the disk.
+ *
+ * Returns: whether the on-disk cache is used
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_photo_cache_get_use_disk_cache (EPhotoCache *photo_cache)
+{
+	gboolean use_disk_cache;
+
+	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), FALSE);
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	use_disk_cache = photo_cache->priv->disk_cache_dir != NULL;
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	return use_disk_cache;
+}
+
+/**
+ * e_photo_cache_set_use_disk_cache:
+ * @photo_cache: an #EPhotoCache
+ * @use_disk_cache: whether to use the on-disk cache
+ *
+ * Sets whether the @photo_cache stores the found photos, and also email
+ * addresses without a photo, on the disk, thus they do not need to be
+ * searched for in the photo sources after restart. The on-disk cache is
+ * limited both by size and by the age of the entries.
+ *
+ * Since: 3.62
+ **/
+void
+e_photo_cache_set_use_disk_cache (EPhotoCache *photo_cache,
+                                  gboolean use_disk_cache)
+{
+	gchar *prune_dir = NULL;
+
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	if ((photo_cache->priv->disk_cache_dir != NULL) == (use_disk_cache != FALSE)) {
+		g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+		return;
+	}
+
+	if (use_disk_cache) {
+		gchar *dirname;
+
+		dirname = g_build_filename (e_get_user_cache_dir (), "photos", NULL);
+
+		if (g_mkdir_with_parents (dirname, 0700) == 0) {
+			photo_cache->priv->disk_cache_dir = dirname;
+			prune_dir = g_strdup (dirname);
+		} else {
+			g_warning ("%s: Failed to create '%s': %s", G_STRFUNC, dirname, g_strerror (errno));
+			g_free (dirname);
+		}
+	} else {
+		g_clear_pointer (&photo_cache->priv->disk_cache_dir, g_free);
+	}
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	/* Remove old entries from the previous run */
+	if (prune_dir) {
+		photo_disk_schedule_prune (photo_cache, prune_dir);
+		g_free (prune_dir);
+	}
+
+	g_object_notify_by_pspec (G_OBJECT (photo_cache), properties[PROP_USE_DISK_CACHE]);
+}
+
+/**
+ * e_photo_cache_get_stats:
+ * @photo_cache: an #EPhotoCache
+ * @out_hits: (out) (optional): return location for the number of lookups satisfied from the memory
+ * @out_disk_hits: (out) (optional): return location for the number of lookups satisfied from the disk
+ * @out_misses: (out) (optional): return location for the number of lookups, which asked the photo sources
+ * @out_n_bytes: (out) (optional): return location for the memory used by the cached photos
+ *
+ * Returns statistics of the @photo_cache, since its creation.
+ *
+ * Since: 3.62
+ **/
+void
+e_photo_cache_get_stats (EPhotoCache *photo_cache,
+                         guint64 *out_hits,
+                         guint64 *out_disk_hits,
+                         guint64 *out_misses,
+                         gsize *out_n_bytes)
+{
+	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+
+	if (out_hits)
+		*out_hits = photo_cache->priv->n_hits;
+	if (out_disk_hits)
+		*out_disk_hits = photo_cache->priv->n_disk_hits;
+	if (out_misses)
+		*out_misses = photo_cache->priv->n_misses;
+	if (out_n_bytes)
+		*out_n_bytes = photo_cache->priv->photo_ht_bytes;
+
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+}
+
 /**
  * e_photo_cache_add_photo_source:
  * @photo_cache: an #EPhotoCache
@@ -986,7 +1525,8 @@ e_photo_cache_add_photo (EPhotoCache *photo_cache,
 	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
 	g_return_if_fail (email_address != NULL);
 
-	photo_ht_insert (photo_cache, email_address, bytes);
+	photo_ht_insert (photo_cache, email_address, bytes, 0);
+	photo_disk_store (photo_cache, email_address, bytes);
 }
 
 /**
@@ -1005,6 +1545,8 @@ e_photo_cache_remove_photo (EPhotoCache *photo_cache,
 	g_return_val_if_fail (E_IS_PHOTO_CACHE (photo_cache), FALSE);
 	g_return_val_if_fail (email_address != NULL, FALSE);
 
+	photo_disk_remove (photo_cache, email_address);
+
 	return photo_ht_remove (photo_cache, email_address);
 }
 
@@ -1059,6 +1601,95 @@ e_photo_cache_get_photo_sync (EPhotoCache *photo_cache,
 	return success;
 }
 
+static void
+photo_cache_dispatch_sources (EPhotoCache *photo_cache,
+                              ESimpleAsyncResult *simple,
+                              const gchar *email_address,
+                              GCancellable *cancellable)
+{
+	AsyncContext *async_context;
+	GList *list, *link;
+
+	async_context = e_simple_async_result_get_op_pointer (simple);
+
+	g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+	photo_cache->priv->n_misses++;
+	g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+	list = e_photo_cache_list_photo_sources (photo_cache);
+
+	if (list == NULL) {
+		e_simple_async_result_complete_idle (simple);
+		return;
+	}
+
+	g_mutex_lock (&async_context->lock);
+
+	/* Dispatch a subtask for each photo source. */
+	for (link = list; link != NULL; link = g_list_next (link)) {
+		EPhotoSource *photo_source;
+		AsyncSubtask *async_subtask;
+
+		photo_source = E_PHOTO_SOURCE (link->data);
+		async_subtask = async_subtask_new (photo_source, simple);
+
+		g_hash_table_add (
+			async_context->subtasks,
+			async_subtask_ref (async_subtask));
+
+		e_photo_source_get_photo (
+			photo_source, email_address,
+			async_subtask->cancellable,
+			photo_cache_async_subtask_done_cb,
+			async_subtask_ref (async_subtask));
+
+		async_subtask_unref (async_subtask);
+	}
+
+	g_mutex_unlock (&async_context->lock);
+
+	g_list_free_full (list, (GDestroyNotify) g_object_unref);
+
+	/* Check if we were cancelled while dispatching subtasks. */
+	if (g_cancellable_is_cancelled (cancellable))
+		async_context_cancel_subtasks (async_context);
+}
+
+static void
+photo_cache_disk_lookup_done_cb (GObject *source_object,
+                                 GAsyncResult *result,
+                                 gpointer user_data)
+{
+	EPhotoCache *photo_cache = E_PHOTO_CACHE (source_object);
+	DiskLookupData *dld;
+	AsyncContext *async_context;
+
+	dld = g_task_get_task_data (G_TASK (result));
+	async_context = e_simple_async_result_get_op_pointer (dld->simple);
+
+	if (dld->found) {
+		gint64 expires = 0;
+
+		if (!dld->bytes) {
+			expires = g_get_monotonic_time () +
+				MAX (NEGATIVE_ENTRY_TIMEOUT_SECONDS - dld->age, 1) * G_TIME_SPAN_SECOND;
+		}
+
+		photo_ht_insert (photo_cache, dld->email_address, dld->bytes, expires);
+
+		g_mutex_lock (&photo_cache->priv->photo_ht_lock);
+		photo_cache->priv->n_disk_hits++;
+		g_mutex_unlock (&photo_cache->priv->photo_ht_lock);
+
+		if (dld->bytes)
+			async_context->stream = g_memory_input_stream_new_from_bytes (dld->bytes);
+
+		e_simple_async_result_complete_idle (dld->simple);
+	} else {
+		photo_cache_dispatch_sources (photo_cache, dld->simple, dld->email_address, dld->cancellable);
+	}
+}
+
 /**
  * e_photo_cache_get_photo:
  * @photo_cache: an #EPhotoCache
@@ -1084,7 +1715,7 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 	AsyncContext *async_context;
 	EDataCapture *data_capture;
 	GInputStream *stream = NULL;
-	GList *list, *link;
+	gchar *filename;
 
 	g_return_if_fail (E_IS_PHOTO_CACHE (photo_cache));
 	g_return_if_fail (email_address != NULL);
@@ -1099,7 +1730,7 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 		data_capture_closure_new (photo_cache, email_address),
 		(GClosureNotify) data_capture_closure_free, 0);
 
-	async_context = async_context_new (data_capture, cancellable);
+	async_context = async_context_new (photo_cache, email_address, data_capture, cancellable);
 
 	simple = e_simple_async_result_new (
 		G_OBJECT (photo_cache), callback,
@@ -1117,44 +1748,27 @@ e_photo_cache_get_photo (EPhotoCache *photo_cache,
 		goto exit;
 	}
 
-	list = e_photo_cache_list_photo_sources (photo_cache);
+	filename = photo_disk_dup_filename (photo_cache, email_address);
 
-	if (list == NULL) {
-		e_simple_async_result_complete_idle (simple);
-		goto exit;
-	}
-
-	g_mutex_lock (&async_context->lock);
-
-	/* Dispatch a subtask for each photo source. */
-	for (link = list; link != NULL; link = g_list_next (link)) {
-		EPhotoSource *photo_source;
-		AsyncSubtask *async_subtask;
+	if (filename != NULL) {
+		DiskLookupData *dld;
+		GTask *task;
 
-		photo_source = E_PHOTO_SOURCE (link->data);
-		async_subtask = async_subtask_new (photo_source, simple);
+		dld = g_slice_new0 (DiskLookupData);
+		dld->filename = filename;  /* takes ownership */
+		dld->simple = g_object_ref (simple);
+		dld->email_address = g_strdup (email_address);
+		dld->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
 
-		g_hash_table_add (
-			async_context->subtasks,
-			async_subtask_ref (async_subtask));
-
-		e_photo_source_get_photo (
-			photo_source, email_address,
-			async_subtask->cancellable,
-			photo_cache_async_subtask_done_cb,
-			async_subtask_ref (async_subtask));
-
-		async_subtask_unref (async_subtask);
+		task = g_task_new (photo_cache, cancellable, photo_cache_disk_lookup_done_cb, NULL);
+		g_task_set_source_tag (task, e_photo_cache_get_photo);
+		g_task_set_task_data (task, dld, disk_lookup_data_free);
+		g_task_run_in_thread (task, photo_disk_lookup_thread);
+		g_object_unref (task);
+	} else {
+		photo_cache_dispatch_sources (photo_cache, simple, email_address, cancellable);
 	}
 
-	g_mutex_unlock (&async_context->lock);
-
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
-
-	/* Check if we were cancelled while dispatching subtasks. */
-	if (g_cancellable_is_cancelled (cancellable))
-		async_context_cancel_subtasks (async_context);
-
 exit:
 	g_object_unref (simple);
 	g_object_unref (data_capture);
@@ -56,6 +56,16 @@ struct _EPhotoCacheClass {
 GType		e_photo_cache_get_type		(void) G_GNUC_CONST;
 EPhotoCache *	e_photo_cache_new		(EClientCache *client_cache);
 EClientCache *	e_photo_cache_ref_client_cache	(EPhotoCache *photo_cache);
+gboolean	e_photo_cache_get_use_disk_cache
+						(EPhotoCache *photo_cache);
+void		e_photo_cache_set_use_disk_cache
+						(EPhotoCache *photo_cache,
+						 gboolean use_disk_cache);
+void		e_photo_cache_get_stats		(EPhotoCache *photo_cache,
+						 guint64 *out_hits,
+						 guint64 *out_disk_hits,
+						 guint64 *out_misses,
+						 gsize *out_n_bytes);
 void		e_photo_cache_add_photo_source	(EPhotoCache *photo_cache,
 						 EPhotoSource *photo_source);
 GList *		e_photo_cache_list_photo_sources
@@ -60,9 +60,6 @@ static GSList *ep_disabled;
 static GHashTable *eph_types;
 
 struct _plugin_doc {
-	struct _plugin_doc *next;
-	struct _plugin_doc *prev;
-
 	gchar *filename;
 	xmlDocPtr doc;
 };
@@ -344,30 +341,52 @@ ep_load_plugin (xmlNodePtr root,
 	return ep;
 }
 
-static gint
-ep_load (const gchar *filename,
-         gint load_level)
+static void
+ep_plugin_doc_free (gpointer ptr)
+{
+	struct _plugin_doc *pdoc = ptr;
+
+	if (pdoc) {
+		xmlFreeDoc (pdoc->doc);
+		g_free (pdoc->filename);
+		g_free (pdoc);
+	}
+}
+
+static struct _plugin_doc *
+ep_parse (const gchar *filename)
 {
 	xmlDocPtr doc;
 	xmlNodePtr root;
-	EPlugin *ep = NULL;
 	struct _plugin_doc *pdoc;
 
 	doc = e_xml_parse_file (filename);
 	if (doc == NULL)
-		return -1;
+		return NULL;
 
 	root = xmlDocGetRootElement (doc);
 	if (strcmp ((gchar *) root->name, "e-plugin-list") != 0) {
 		g_warning ("No <e-plugin-list> root element: %s", filename);
 		xmlFreeDoc (doc);
-		return -1;
+		return NULL;
 	}
 
 	pdoc = g_malloc0 (sizeof (*pdoc));
 	pdoc->doc = doc;
 	pdoc->filename = g_strdup (filename);
 
+	return pdoc;
+}
+
+static void
+ep_load (struct _plugin_doc *pdoc,
+         gint load_level)
+{
+	xmlNodePtr root;
+	EPlugin *ep = NULL;
+
+	root = xmlDocGetRootElement (pdoc->doc);
+
 	for (root = root->children; root; root = root->next) {
 		if (strcmp ((gchar *) root->name, "e-plugin") == 0) {
 			gchar *plugin_load_level, *is_system_plugin;
@@ -403,12 +422,6 @@ ep_load (const gchar *filename,
 			}
 		}
 	}
-
-	xmlFreeDoc (pdoc->doc);
-	g_free (pdoc->filename);
-	g_free (pdoc);
-
-	return 0;
 }
 
 static void
@@ -460,7 +473,7 @@ plugin_hook_load_subclass (GType type,
 
 static void
 e_plugin_traverse_directory (const gchar *dirname,
-			     gint index)
+			     GPtrArray *pdocs)
 {
 	GDir *dir;
 	const gchar *d;
@@ -474,10 +487,13 @@ e_plugin_traverse_directory (const gchar *dirname,
 
 	while ((d = g_dir_read_name (dir))) {
 		if (g_str_has_suffix  (d, ".eplug")) {
+			struct _plugin_doc *pdoc;
 			gchar *name;
 
 			name = g_build_filename (dirname, d, NULL);
-			ep_load (name, index);
+			pdoc = ep_parse (name);
+			if (pdoc)
+				g_ptr_array_add (pdocs, pdoc);
 			g_free (name);
 		}
 	}
@@ -498,7 +514,9 @@ e_plugin_load_plugins (void)
 {
 	GSettings *settings;
 	GPtrArray *variants;
+	GPtrArray *pdocs;
 	gchar **strv;
+	guint jj;
 	gint i;
 
 	if (eph_types != NULL)
@@ -527,23 +545,28 @@ e_plugin_load_plugins (void)
 
 	variants = e_util_get_directory_variants (EVOLUTION_PLUGINDIR, EVOLUTION_PREFIX, TRUE);
 
-	for (i = 0; i < 3; i++) {
-		if (variants) {
-			guint jj;
+	/* Parse each plugin file only once, not once per load level. */
+	pdocs = g_ptr_array_new_with_free_func (ep_plugin_doc_free);
 
-			for (jj = 0; jj < variants->len; jj++) {
-				const gchar *dirname = g_ptr_array_index (variants, jj);
+	if (variants) {
+		for (jj = 0; jj < variants->len; jj++) {
+			const gchar *dirname = g_ptr_array_index (variants, jj);
 
-				if (dirname && *dirname)
-					e_plugin_traverse_directory (dirname, i);
-			}
-		} else {
-			e_plugin_traverse_directory (EVOLUTION_PLUGINDIR, i);
+			if (dirname && *dirname)
+				e_plugin_traverse_directory (dirname, pdocs);
 		}
-	}
 
-	if (variants)
 		g_ptr_array_unref (variants);
+	} else {
+		e_plugin_traverse_directory (EVOLUTION_PLUGINDIR, pdocs);
+	}
+
+	for (i = 0; i < 3; i++) {
+		for (jj = 0; jj < pdocs->len; jj++)
+			ep_load (g_ptr_array_index (pdocs, jj), i);
+	}
+
+	g_ptr_array_unref (pdocs);
 
 	return 0;
 }
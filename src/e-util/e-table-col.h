@@ -66,6 +66,8 @@ struct _ETableCol {
 	gshort x;
 	GCompareDataFunc compare;
 	ETableSearchFunc search;
+	ETableCollateKeyFunc collate_key;
+	ETableIntKeyFunc int_key;
 
 	gboolean selected;
 
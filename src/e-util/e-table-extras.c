@@ -27,6 +27,8 @@ struct _ETableExtrasPrivate {
 	GHashTable *compares;
 	GHashTable *icon_names;
 	GHashTable *searches;
+	GHashTable *collate_keys;
+	GHashTable *int_keys;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ETableExtras, e_table_extras, G_TYPE_OBJECT)
@@ -39,6 +41,8 @@ ete_finalize (GObject *object)
 	g_clear_pointer (&self->priv->cells, g_hash_table_destroy);
 	g_clear_pointer (&self->priv->compares, g_hash_table_destroy);
 	g_clear_pointer (&self->priv->searches, g_hash_table_destroy);
+	g_clear_pointer (&self->priv->collate_keys, g_hash_table_destroy);
+	g_clear_pointer (&self->priv->int_keys, g_hash_table_destroy);
 	g_clear_pointer (&self->priv->icon_names, g_hash_table_destroy);
 
 	G_OBJECT_CLASS (e_table_extras_parent_class)->finalize (object);
@@ -196,6 +200,51 @@ e_table_collate_compare (gconstpointer x,
 	return strcmp (cx, cy);
 }
 
+static gchar *
+e_table_str_case_collate_key (gconstpointer value)
+{
+	gchar *tmp, *key;
+
+	if (!value)
+		return NULL;
+
+	tmp = g_utf8_casefold (value, -1);
+	key = g_utf8_collate_key (tmp, -1);
+	g_free (tmp);
+
+	return key;
+}
+
+static gchar *
+e_table_collate_key (gconstpointer value)
+{
+	if (!value)
+		return NULL;
+
+	return g_utf8_collate_key (value, -1);
+}
+
+static gint64
+e_int_key (gconstpointer value)
+{
+	return GPOINTER_TO_INT (value);
+}
+
+static gint64
+e_strint_key (gconstpointer value)
+{
+	return atoi (value);
+}
+
+static gint64
+e_int64ptr_key (gconstpointer value)
+{
+	const gint64 *pvalue = value;
+
+	/* sort unset values before set */
+	return pvalue ? *pvalue : G_MININT64;
+}
+
 static void
 safe_unref (gpointer object)
 {
@@ -230,6 +279,16 @@ e_table_extras_init (ETableExtras *extras)
 		(GDestroyNotify) g_free,
 		(GDestroyNotify) NULL);
 
+	extras->priv->collate_keys = g_hash_table_new_full (
+		g_str_hash, g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) NULL);
+
+	extras->priv->int_keys = g_hash_table_new_full (
+		g_str_hash, g_str_equal,
+		(GDestroyNotify) g_free,
+		(GDestroyNotify) NULL);
+
 	e_table_extras_add_compare (
 		extras, "string",
 		(GCompareDataFunc) e_str_compare);
@@ -249,6 +308,12 @@ e_table_extras_init (ETableExtras *extras)
 		extras, "pointer-integer64",
 		(GCompareDataFunc) e_int64ptr_compare);
 
+	e_table_extras_add_collate_key (extras, "stringcase", e_table_str_case_collate_key);
+	e_table_extras_add_collate_key (extras, "collate", e_table_collate_key);
+	e_table_extras_add_int_key (extras, "integer", e_int_key);
+	e_table_extras_add_int_key (extras, "string-integer", e_strint_key);
+	e_table_extras_add_int_key (extras, "pointer-integer64", e_int64ptr_key);
+
 	e_table_extras_add_search (extras, "string", e_string_search);
 
 	cell = e_cell_checkbox_new ();
@@ -362,6 +427,52 @@ e_table_extras_get_search (ETableExtras *extras,
 	return g_hash_table_lookup (extras->priv->searches, id);
 }
 
+void
+e_table_extras_add_collate_key (ETableExtras *extras,
+                                const gchar *id,
+                                ETableCollateKeyFunc collate_key)
+{
+	g_return_if_fail (E_IS_TABLE_EXTRAS (extras));
+	g_return_if_fail (id != NULL);
+
+	g_hash_table_insert (
+		extras->priv->collate_keys,
+		g_strdup (id), (gpointer) collate_key);
+}
+
+ETableCollateKeyFunc
+e_table_extras_get_collate_key (ETableExtras *extras,
+                                const gchar *id)
+{
+	g_return_val_if_fail (E_IS_TABLE_EXTRAS (extras), NULL);
+	g_return_val_if_fail (id != NULL, NULL);
+
+	return g_hash_table_lookup (extras->priv->collate_keys, id);
+}
+
+void
+e_table_extras_add_int_key (ETableExtras *extras,
+                            const gchar *id,
+                            ETableIntKeyFunc int_key)
+{
+	g_return_if_fail (E_IS_TABLE_EXTRAS (extras));
+	g_return_if_fail (id != NULL);
+
+	g_hash_table_insert (
+		extras->priv->int_keys,
+		g_strdup (id), (gpointer) int_key);
+}
+
+ETableIntKeyFunc
+e_table_extras_get_int_key (ETableExtras *extras,
+                            const gchar *id)
+{
+	g_return_val_if_fail (E_IS_TABLE_EXTRAS (extras), NULL);
+	g_return_val_if_fail (id != NULL, NULL);
+
+	return g_hash_table_lookup (extras->priv->int_keys, id);
+}
+
 void
 e_table_extras_add_icon_name (ETableExtras *extras,
                               const gchar *id,
@@ -67,6 +67,18 @@ void		e_table_extras_add_search	(ETableExtras *extras,
 ETableSearchFunc
 		e_table_extras_get_search	(ETableExtras *extras,
 						 const gchar *id);
+void		e_table_extras_add_collate_key	(ETableExtras *extras,
+						 const gchar *id,
+						 ETableCollateKeyFunc collate_key);
+ETableCollateKeyFunc
+		e_table_extras_get_collate_key	(ETableExtras *extras,
+						 const gchar *id);
+void		e_table_extras_add_int_key	(ETableExtras *extras,
+						 const gchar *id,
+						 ETableIntKeyFunc int_key);
+ETableIntKeyFunc
+		e_table_extras_get_int_key	(ETableExtras *extras,
+						 const gchar *id);
 void		e_table_extras_add_icon_name	(ETableExtras *extras,
 						 const gchar *id,
 						 const gchar *icon_name);
@@ -33,16 +33,278 @@ G_DEFINE_TYPE_WITH_CODE (
 		E_TYPE_SORTER,
 		e_table_sorter_interface_init))
 
+/* Do not bother with threads for fewer rows than this */
+#define PARALLEL_KEYS_MIN_ROWS 4096
+
+typedef enum {
+	KEY_KIND_VALUE,		/* compared with the column compare function */
+	KEY_KIND_COLLATE,	/* collate keys compared with strcmp() */
+	KEY_KIND_INT		/* integer keys */
+} KeyKind;
+
+typedef struct _ColumnKeys {
+	ETableModel *model; /* not referenced */
+	gint model_col;
+	KeyKind kind;
+	GCompareDataFunc compare;
+	ETableCollateKeyFunc collate_key;
+	ETableIntKeyFunc int_key;
+	gint n_rows;
+	gpointer *values;	/* KEY_KIND_VALUE */
+	gchar **str_keys;	/* KEY_KIND_COLLATE */
+	gint64 *int_keys;	/* KEY_KIND_INT */
+} ColumnKeys;
+
+typedef struct _CollateJob {
+	GMutex lock;
+	GCond cond;
+	gint pending;
+	ETableCollateKeyFunc collate_key;
+	gpointer *values;
+	gchar **str_keys;
+} CollateJob;
+
+typedef struct _CollateChunk {
+	CollateJob *job;
+	gint from;
+	gint to;
+} CollateChunk;
+
 struct qsort_data {
-	ETableSorter *table_sorter;
-	gpointer *vals;
+	ColumnKeys **keys;
 	gint cols;
 	gint *ascending;
-	GCompareDataFunc *compare;
 	gpointer cmp_cache;
 };
 
-/* FIXME: Make it not cache the second and later columns (as if anyone cares.) */
+static void
+column_keys_free (gpointer ptr)
+{
+	ColumnKeys *keys = ptr;
+	gint ii;
+
+	if (!keys)
+		return;
+
+	if (keys->values) {
+		for (ii = 0; ii < keys->n_rows; ii++) {
+			e_table_model_free_value (keys->model, keys->model_col, keys->values[ii]);
+		}
+
+		g_free (keys->values);
+	}
+
+	if (keys->str_keys) {
+		for (ii = 0; ii < keys->n_rows; ii++) {
+			g_free (keys->str_keys[ii]);
+		}
+
+		g_free (keys->str_keys);
+	}
+
+	g_free (keys->int_keys);
+	g_slice_free (ColumnKeys, keys);
+}
+
+static void
+collate_keys_compute (ETableCollateKeyFunc collate_key,
+                      gpointer *values,
+                      gchar **str_keys,
+                      gint from,
+                      gint to)
+{
+	gint ii;
+
+	for (ii = from; ii < to; ii++) {
+		str_keys[ii] = values[ii] ? collate_key (values[ii]) : NULL;
+	}
+}
+
+static void
+collate_keys_thread (gpointer data,
+                     gpointer user_data)
+{
+	CollateChunk *chunk = data;
+	CollateJob *job = chunk->job;
+
+	collate_keys_compute (job->collate_key, job->values, job->str_keys, chunk->from, chunk->to);
+
+	g_mutex_lock (&job->lock);
+	job->pending--;
+	if (!job->pending)
+		g_cond_signal (&job->cond);
+	g_mutex_unlock (&job->lock);
+
+	g_slice_free (CollateChunk, chunk);
+}
+
+static GThreadPool *
+table_sorter_get_thread_pool (void)
+{
+	static GThreadPool *thread_pool = NULL;
+	static gsize initialized = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		guint n_processors = g_get_num_processors ();
+
+		if (n_processors > 1)
+			thread_pool = g_thread_pool_new (collate_keys_thread, NULL, n_processors - 1, FALSE, NULL);
+
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return thread_pool;
+}
+
+/* Computes collate keys for all the values, spreading the work over
+ * the thread pool for large models. The main thread takes part in it. */
+static void
+table_sorter_compute_collate_keys (ETableCollateKeyFunc collate_key,
+                                   gpointer *values,
+                                   gchar **str_keys,
+                                   gint n_rows)
+{
+	GThreadPool *thread_pool;
+	CollateJob job;
+	gint n_chunks, chunk_size, from, ii;
+
+	thread_pool = n_rows >= PARALLEL_KEYS_MIN_ROWS ? table_sorter_get_thread_pool () : NULL;
+
+	if (!thread_pool) {
+		collate_keys_compute (collate_key, values, str_keys, 0, n_rows);
+		return;
+	}
+
+	n_chunks = MIN (g_thread_pool_get_max_threads (thread_pool) + 1, n_rows / (PARALLEL_KEYS_MIN_ROWS / 2));
+	chunk_size = (n_rows + n_chunks - 1) / n_chunks;
+
+	g_mutex_init (&job.lock);
+	g_cond_init (&job.cond);
+	job.pending = 0;
+	job.collate_key = collate_key;
+	job.values = values;
+	job.str_keys = str_keys;
+
+	g_mutex_lock (&job.lock);
+
+	for (ii = 1, from = chunk_size; ii < n_chunks && from < n_rows; ii++, from += chunk_size) {
+		CollateChunk *chunk;
+
+		chunk = g_slice_new (CollateChunk);
+		chunk->job = &job;
+		chunk->from = from;
+		chunk->to = MIN (from + chunk_size, n_rows);
+
+		job.pending++;
+
+		g_thread_pool_push (thread_pool, chunk, NULL);
+	}
+
+	g_mutex_unlock (&job.lock);
+
+	collate_keys_compute (collate_key, values, str_keys, 0, MIN (chunk_size, n_rows));
+
+	g_mutex_lock (&job.lock);
+	while (job.pending > 0)
+		g_cond_wait (&job.cond, &job.lock);
+	g_mutex_unlock (&job.lock);
+
+	g_mutex_clear (&job.lock);
+	g_cond_clear (&job.cond);
+}
+
+static ColumnKeys *
+table_sorter_ref_column_keys (ETableSorter *table_sorter,
+                              ETableCol *col,
+                              gint rows)
+{
+	ColumnKeys *keys;
+	gint ii;
+
+	if (!table_sorter->column_keys)
+		table_sorter->column_keys = g_hash_table_new_full (NULL, NULL, NULL, column_keys_free);
+
+	keys = g_hash_table_lookup (table_sorter->column_keys, col);
+	if (keys && keys->n_rows == rows)
+		return keys;
+
+	keys = g_slice_new0 (ColumnKeys);
+	keys->model = table_sorter->source;
+	keys->model_col = col->spec->model_col;
+	keys->compare = col->compare;
+	keys->collate_key = col->collate_key;
+	keys->int_key = col->int_key;
+	keys->n_rows = rows;
+	keys->values = g_new (gpointer, rows);
+
+	for (ii = 0; ii < rows; ii++) {
+		keys->values[ii] = e_table_model_value_at (table_sorter->source, keys->model_col, ii);
+	}
+
+	if (keys->int_key) {
+		keys->kind = KEY_KIND_INT;
+		keys->int_keys = g_new (gint64, rows);
+
+		for (ii = 0; ii < rows; ii++) {
+			keys->int_keys[ii] = keys->int_key (keys->values[ii]);
+		}
+	} else if (keys->collate_key) {
+		keys->kind = KEY_KIND_COLLATE;
+		keys->str_keys = g_new (gchar *, rows);
+
+		table_sorter_compute_collate_keys (keys->collate_key, keys->values, keys->str_keys, rows);
+	} else {
+		keys->kind = KEY_KIND_VALUE;
+	}
+
+	/* The values are not needed, when the keys are known */
+	if (keys->kind != KEY_KIND_VALUE) {
+		for (ii = 0; ii < rows; ii++) {
+			e_table_model_free_value (table_sorter->source, keys->model_col, keys->values[ii]);
+		}
+
+		g_clear_pointer (&keys->values, g_free);
+	}
+
+	g_hash_table_insert (table_sorter->column_keys, col, keys);
+
+	return keys;
+}
+
+static void
+table_sorter_update_column_keys_row (ETableSorter *table_sorter,
+                                     ColumnKeys *keys,
+                                     gint row)
+{
+	gpointer value;
+
+	if (row < 0 || row >= keys->n_rows)
+		return;
+
+	value = e_table_model_value_at (table_sorter->source, keys->model_col, row);
+
+	switch (keys->kind) {
+	case KEY_KIND_VALUE:
+		e_table_model_free_value (table_sorter->source, keys->model_col, keys->values[row]);
+		keys->values[row] = value;
+		return;
+	case KEY_KIND_COLLATE:
+		g_free (keys->str_keys[row]);
+		keys->str_keys[row] = value ? keys->collate_key (value) : NULL;
+		break;
+	case KEY_KIND_INT:
+		keys->int_keys[row] = keys->int_key (value);
+		break;
+	}
+
+	e_table_model_free_value (table_sorter->source, keys->model_col, value);
+}
+
+static void
+table_sorter_drop_column_keys (ETableSorter *table_sorter)
+{
+	g_clear_pointer (&table_sorter->column_keys, g_hash_table_destroy);
+}
 
 static gint
 qsort_callback (gconstpointer data1,
@@ -53,18 +315,36 @@ qsort_callback (gconstpointer data1,
 	gint row1 = *(gint *) data1;
 	gint row2 = *(gint *) data2;
 	gint j;
-	gint sort_count;
 	gint comp_val = 0;
 	gint ascending = 1;
 
-	sort_count =
-		e_table_sort_info_sorting_get_count (
-			qd->table_sorter->sort_info) +
-		e_table_sort_info_grouping_get_count (
-			qd->table_sorter->sort_info);
+	for (j = 0; j < qd->cols; j++) {
+		ColumnKeys *keys = qd->keys[j];
+
+		switch (keys->kind) {
+		case KEY_KIND_INT:
+			if (keys->int_keys[row1] < keys->int_keys[row2])
+				comp_val = -1;
+			else if (keys->int_keys[row1] > keys->int_keys[row2])
+				comp_val = 1;
+			else
+				comp_val = 0;
+			break;
+		case KEY_KIND_COLLATE:
+			if (!keys->str_keys[row1] || !keys->str_keys[row2]) {
+				if (keys->str_keys[row1] == keys->str_keys[row2])
+					comp_val = 0;
+				else
+					comp_val = keys->str_keys[row1] ? -1 : 1;
+			} else {
+				comp_val = strcmp (keys->str_keys[row1], keys->str_keys[row2]);
+			}
+			break;
+		case KEY_KIND_VALUE:
+			comp_val = (*keys->compare) (keys->values[row1], keys->values[row2], qd->cmp_cache);
+			break;
+		}
 
-	for (j = 0; j < sort_count; j++) {
-		comp_val = (*(qd->compare[j]))(qd->vals[qd->cols * row1 + j], qd->vals[qd->cols * row2 + j], qd->cmp_cache);
 		ascending = qd->ascending[j];
 		if (comp_val != 0)
 			break;
@@ -96,6 +376,7 @@ table_sorter_clean (ETableSorter *table_sorter)
 static void
 table_sorter_sort (ETableSorter *table_sorter)
 {
+	GHashTable *used_columns;
 	gint rows;
 	gint i;
 	gint j;
@@ -115,13 +396,12 @@ table_sorter_sort (ETableSorter *table_sorter)
 		table_sorter->sorted[i] = i;
 
 	qd.cols = cols;
-	qd.table_sorter = table_sorter;
-
-	qd.vals = g_new (gpointer , rows * cols);
+	qd.keys = g_new (ColumnKeys *, cols);
 	qd.ascending = g_new (int, cols);
-	qd.compare = g_new (GCompareDataFunc, cols);
 	qd.cmp_cache = e_table_sorting_utils_create_cmp_cache ();
 
+	used_columns = g_hash_table_new (NULL, NULL);
+
 	for (j = 0; j < cols; j++) {
 		ETableColumnSpecification *spec;
 		ETableCol *col;
@@ -145,49 +425,31 @@ table_sorter_sort (ETableSorter *table_sorter)
 				table_sorter->full_header, last);
 		}
 
-		for (i = 0; i < rows; i++) {
-			qd.vals[i * cols + j] = e_table_model_value_at (
-				table_sorter->source,
-				col->spec->model_col, i);
-		}
-
-		qd.compare[j] = col->compare;
+		qd.keys[j] = table_sorter_ref_column_keys (table_sorter, col, rows);
 		qd.ascending[j] = (sort_type == GTK_SORT_ASCENDING);
+
+		g_hash_table_add (used_columns, col);
 	}
 
 	g_qsort_with_data (table_sorter->sorted, rows, sizeof (gint), qsort_callback, &qd);
 
-	for (j = 0; j < cols; j++) {
-		ETableColumnSpecification *spec;
-		ETableCol *col;
-		GtkSortType sort_type;
-
-		if (j < group_cols)
-			spec = e_table_sort_info_grouping_get_nth (
-				table_sorter->sort_info,
-				j, &sort_type);
-		else
-			spec = e_table_sort_info_sorting_get_nth (
-				table_sorter->sort_info,
-				j - group_cols, &sort_type);
-
-		col = e_table_header_get_column_by_spec (
-			table_sorter->full_header, spec);
-		if (col == NULL) {
-			gint last = e_table_header_count (
-				table_sorter->full_header) - 1;
-			col = e_table_header_get_column (
-				table_sorter->full_header, last);
-		}
-
-		for (i = 0; i < rows; i++) {
-			e_table_model_free_value (table_sorter->source, col->spec->model_col, qd.vals[i * cols + j]);
+	/* Keep only the keys of the currently sorted columns, thus flipping
+	 * the sort order or adding another sort column does not read all
+	 * the values from the model again. */
+	if (table_sorter->column_keys) {
+		GHashTableIter iter;
+		gpointer key;
+
+		g_hash_table_iter_init (&iter, table_sorter->column_keys);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (!g_hash_table_contains (used_columns, key))
+				g_hash_table_iter_remove (&iter);
 		}
 	}
 
-	g_free (qd.vals);
+	g_hash_table_destroy (used_columns);
+	g_free (qd.keys);
 	g_free (qd.ascending);
-	g_free (qd.compare);
 	e_table_sorting_utils_free_cmp_cache (qd.cmp_cache);
 }
 
@@ -213,6 +475,7 @@ static void
 table_sorter_model_changed_cb (ETableModel *table_model,
                                ETableSorter *table_sorter)
 {
+	table_sorter_drop_column_keys (table_sorter);
 	table_sorter_clean (table_sorter);
 }
 
@@ -221,6 +484,16 @@ table_sorter_model_row_changed_cb (ETableModel *table_model,
                                    gint row,
                                    ETableSorter *table_sorter)
 {
+	if (table_sorter->column_keys) {
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, table_sorter->column_keys);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			table_sorter_update_column_keys_row (table_sorter, value, row);
+		}
+	}
+
 	table_sorter_clean (table_sorter);
 }
 
@@ -230,6 +503,19 @@ table_sorter_model_cell_changed_cb (ETableModel *table_model,
                                     gint row,
                                     ETableSorter *table_sorter)
 {
+	if (table_sorter->column_keys) {
+		GHashTableIter iter;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, table_sorter->column_keys);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			ColumnKeys *keys = value;
+
+			if (keys->model_col == col)
+				table_sorter_update_column_keys_row (table_sorter, keys, row);
+		}
+	}
+
 	table_sorter_clean (table_sorter);
 }
 
@@ -239,6 +525,7 @@ table_sorter_model_rows_inserted_cb (ETableModel *table_model,
                                      gint count,
                                      ETableSorter *table_sorter)
 {
+	table_sorter_drop_column_keys (table_sorter);
 	table_sorter_clean (table_sorter);
 }
 
@@ -248,6 +535,7 @@ table_sorter_model_rows_deleted_cb (ETableModel *table_model,
                                     gint count,
                                     ETableSorter *table_sorter)
 {
+	table_sorter_drop_column_keys (table_sorter);
 	table_sorter_clean (table_sorter);
 }
 
@@ -366,6 +654,8 @@ table_sorter_dispose (GObject *object)
 		table_sorter->group_info_changed_id = 0;
 	}
 
+	table_sorter_drop_column_keys (table_sorter);
+
 	g_clear_object (&table_sorter->sort_info);
 	g_clear_object (&table_sorter->full_header);
 	g_clear_object (&table_sorter->source);
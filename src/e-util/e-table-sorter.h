@@ -53,6 +53,9 @@ struct _ETableSorter {
 	gint *sorted;
 	gint *backsorted;
 
+	/* ETableCol ~> sort keys of its model column, kept between sorts */
+	GHashTable *column_keys;
+
 	gulong table_model_changed_id;
 	gulong table_model_row_changed_id;
 	gulong table_model_cell_changed_id;
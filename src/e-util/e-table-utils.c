@@ -60,11 +60,16 @@ et_col_spec_to_col (ETableColumnSpecification *col_spec,
 	ECell *cell = NULL;
 	GCompareDataFunc compare = NULL;
 	ETableSearchFunc search = NULL;
+	ETableCollateKeyFunc collate_key = NULL;
+	ETableIntKeyFunc int_key = NULL;
 
 	if (col_spec->cell)
 		cell = e_table_extras_get_cell (ete, col_spec->cell);
-	if (col_spec->compare)
+	if (col_spec->compare) {
 		compare = e_table_extras_get_compare (ete, col_spec->compare);
+		collate_key = e_table_extras_get_collate_key (ete, col_spec->compare);
+		int_key = e_table_extras_get_int_key (ete, col_spec->compare);
+	}
 	if (col_spec->search)
 		search = e_table_extras_get_search (ete, col_spec->search);
 
@@ -93,8 +98,11 @@ et_col_spec_to_col (ETableColumnSpecification *col_spec,
 				cell, compare);
 		}
 
-		if (col != NULL)
+		if (col != NULL) {
 			col->search = search;
+			col->collate_key = collate_key;
+			col->int_key = int_key;
+		}
 
 		g_free (title);
 	}
@@ -0,0 +1,329 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+/**
+ * SECTION: e-trace
+ * @include: e-util/e-util.h
+ * @short_description: Timeline of named spans
+ *
+ * A lightweight tracing facility, which records named spans with their
+ * monotonic time stamps and thread IDs and writes them as a JSON file
+ * in the Chrome trace event format, which can be opened in the Chrome's
+ * about:tracing page or in Perfetto.
+ *
+ * Tracing is off unless e_trace_init() is called, which Evolution does
+ * when the EVOLUTION_TRACE_FILE environment variable or the --trace-file
+ * command-line option is set. All functions are cheap no-ops when
+ * the tracing is off. A span is recorded like this:
+ *
+ * |[<!-- language="C" -->
+ * gint64 begin_time = e_trace_begin ();
+ *
+ * do_something ();
+ *
+ * e_trace_end (begin_time, "shell", "do-something", NULL);
+ * ]|
+ **/
+
+#include "evolution-config.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "e-trace.h"
+
+/* Do not let a forgotten tracing eat all the memory. */
+#define MAX_EVENTS 1000000
+
+typedef struct _TraceEvent {
+	gint64 ts;	/* microseconds since e_trace_init() */
+	gint64 dur;	/* -1 for instant events */
+	gint tid;
+	const gchar *category;	/* interned */
+	gchar *name;
+	gchar *detail;
+} TraceEvent;
+
+static GMutex trace_lock;
+static gchar *trace_filename;
+static gint64 trace_start_time;
+static GArray *trace_events;
+static gint trace_enabled;
+static gint trace_next_tid;
+static GPrivate trace_tid_key;
+
+static gint
+trace_get_tid (void)
+{
+	gint tid;
+
+	tid = GPOINTER_TO_INT (g_private_get (&trace_tid_key));
+
+	if (!tid) {
+		tid = g_atomic_int_add (&trace_next_tid, 1) + 1;
+		g_private_set (&trace_tid_key, GINT_TO_POINTER (tid));
+	}
+
+	return tid;
+}
+
+static void
+trace_event_clear (gpointer ptr)
+{
+	TraceEvent *event = ptr;
+
+	g_free (event->name);
+	g_free (event->detail);
+}
+
+static void
+trace_add_event (gint64 begin_time,
+                 gint64 end_time,
+                 const gchar *category,
+                 const gchar *name,
+                 const gchar *detail)
+{
+	TraceEvent event;
+
+	event.ts = begin_time - trace_start_time;
+	event.dur = end_time < 0 ? -1 : end_time - begin_time;
+	event.tid = trace_get_tid ();
+	event.category = g_intern_string (category ? category : "evolution");
+	event.name = g_strdup (name);
+	event.detail = g_strdup (detail);
+
+	g_mutex_lock (&trace_lock);
+
+	if (trace_events && trace_events->len < MAX_EVENTS)
+		g_array_append_val (trace_events, event);
+	else
+		trace_event_clear (&event);
+
+	g_mutex_unlock (&trace_lock);
+}
+
+static void
+trace_append_json_string (GString *json,
+                          const gchar *str)
+{
+	const guchar *ptr;
+
+	g_string_append_c (json, '"');
+
+	for (ptr = (const guchar *) str; ptr && *ptr; ptr++) {
+		switch (*ptr) {
+			case '"':
+				g_string_append (json, "\\\"");
+				break;
+			case '\\':
+				g_string_append (json, "\\\\");
+				break;
+			default:
+				if (*ptr < 0x20)
+					g_string_append_printf (json, "\\u%04x", *ptr);
+				else
+					g_string_append_c (json, *ptr);
+				break;
+		}
+	}
+
+	g_string_append_c (json, '"');
+}
+
+/**
+ * e_trace_init:
+ * @filename: a file to write the trace to
+ *
+ * Turns on the tracing. The recorded events are written into @filename
+ * by e_trace_write(). The thread calling this function is reported
+ * as the main thread. Calling it when the tracing is on already does
+ * nothing.
+ *
+ * Returns: whether the tracing had been turned on by this call
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_trace_init (const gchar *filename)
+{
+	gboolean success = FALSE;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	g_mutex_lock (&trace_lock);
+
+	if (!trace_events) {
+		trace_filename = g_strdup (filename);
+		trace_start_time = g_get_monotonic_time ();
+		trace_events = g_array_sized_new (FALSE, FALSE, sizeof (TraceEvent), 1024);
+		g_array_set_clear_func (trace_events, trace_event_clear);
+		success = TRUE;
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	if (success) {
+		/* The caller is the main thread. */
+		trace_get_tid ();
+		g_atomic_int_set (&trace_enabled, 1);
+	}
+
+	return success;
+}
+
+/**
+ * e_trace_is_enabled:
+ *
+ * Returns: whether the tracing is on
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_trace_is_enabled (void)
+{
+	return g_atomic_int_get (&trace_enabled) != 0;
+}
+
+/**
+ * e_trace_begin:
+ *
+ * Returns the time stamp to pass to e_trace_end() when the traced
+ * operation finishes. The operation can finish in a different thread.
+ *
+ * Returns: the begin time of a span, or 0 when the tracing is off
+ *
+ * Since: 3.62
+ **/
+gint64
+e_trace_begin (void)
+{
+	if (!e_trace_is_enabled ())
+		return 0;
+
+	return g_get_monotonic_time ();
+}
+
+/**
+ * e_trace_end:
+ * @begin_time: a value returned by e_trace_begin()
+ * @category: (nullable): a category of the span, like "mail"
+ * @name: a name of the span
+ * @detail: (nullable): additional information about the span
+ *
+ * Records a span, which began at @begin_time and ends now. Nothing
+ * is recorded when the @begin_time is 0, thus when the tracing
+ * had been off when the span began.
+ *
+ * Since: 3.62
+ **/
+void
+e_trace_end (gint64 begin_time,
+             const gchar *category,
+             const gchar *name,
+             const gchar *detail)
+{
+	g_return_if_fail (name != NULL);
+
+	if (!begin_time || !e_trace_is_enabled ())
+		return;
+
+	trace_add_event (begin_time, g_get_monotonic_time (), category, name, detail);
+}
+
+/**
+ * e_trace_instant:
+ * @category: (nullable): a category of the event, like "mail"
+ * @name: a name of the event
+ * @detail: (nullable): additional information about the event
+ *
+ * Records an event, which has no duration, like a window being shown.
+ *
+ * Since: 3.62
+ **/
+void
+e_trace_instant (const gchar *category,
+                 const gchar *name,
+                 const gchar *detail)
+{
+	g_return_if_fail (name != NULL);
+
+	if (!e_trace_is_enabled ())
+		return;
+
+	trace_add_event (g_get_monotonic_time (), -1, category, name, detail);
+}
+
+/**
+ * e_trace_write:
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes all events recorded so far into the file given
+ * to e_trace_init(), in the Chrome trace event format.
+ * Does nothing when the tracing is off.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_trace_write (GError **error)
+{
+	GString *json;
+	gboolean success;
+	gint pid;
+	guint ii;
+
+	if (!e_trace_is_enabled ())
+		return TRUE;
+
+	pid = (gint) getpid ();
+	json = g_string_sized_new (1024 * 1024);
+
+	g_string_append (json, "{\"traceEvents\":[\n");
+	g_string_append_printf (json,
+		"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":1,"
+		"\"args\":{\"name\":\"main\"}}", pid);
+
+	g_mutex_lock (&trace_lock);
+
+	for (ii = 0; ii < trace_events->len; ii++) {
+		const TraceEvent *event = &g_array_index (trace_events, TraceEvent, ii);
+
+		g_string_append (json, ",\n{\"name\":");
+		trace_append_json_string (json, event->name);
+		g_string_append (json, ",\"cat\":");
+		trace_append_json_string (json, event->category);
+
+		if (event->dur < 0) {
+			g_string_append (json, ",\"ph\":\"i\",\"s\":\"t\"");
+		} else {
+			g_string_append_printf (json, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT, event->dur);
+		}
+
+		g_string_append_printf (json,
+			",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d",
+			event->ts, pid, event->tid);
+
+		if (event->detail) {
+			g_string_append (json, ",\"args\":{\"detail\":");
+			trace_append_json_string (json, event->detail);
+			g_string_append_c (json, '}');
+		}
+
+		g_string_append_c (json, '}');
+	}
+
+	g_mutex_unlock (&trace_lock);
+
+	g_string_append (json, "\n]}\n");
+
+	success = g_file_set_contents (trace_filename, json->str, json->len, error);
+
+	g_string_free (json, TRUE);
+
+	return success;
+}
@@ -0,0 +1,31 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#if !defined (__E_UTIL_H_INSIDE__) && !defined (LIBEUTIL_COMPILATION)
+#error "Only <e-util/e-util.h> should be included directly."
+#endif
+
+#ifndef E_TRACE_H
+#define E_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean	e_trace_init			(const gchar *filename);
+gboolean	e_trace_is_enabled		(void);
+gint64		e_trace_begin			(void);
+void		e_trace_end			(gint64 begin_time,
+						 const gchar *category,
+						 const gchar *name,
+						 const gchar *detail);
+void		e_trace_instant			(const gchar *category,
+						 const gchar *name,
+						 const gchar *detail);
+gboolean	e_trace_write			(GError **error);
+
+G_END_DECLS
+
+#endif /* E_TRACE_H */
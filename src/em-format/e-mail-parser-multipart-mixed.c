@@ -28,6 +28,184 @@ static const gchar *parser_mime_types[] = {
 	NULL
 };
 
+typedef struct _MixedData {
+	CamelMultipart *multipart;
+	CamelMimePart *pgp_encrypted;
+	CamelMimePart *pgp_octet_stream;
+} MixedData;
+
+static void
+empe_mp_mixed_parse_subpart (EMailParser *parser,
+			     guint index,
+			     GString *part_id,
+			     GCancellable *cancellable,
+			     GQueue *out_mail_parts,
+			     gpointer user_data)
+{
+	MixedData *mmd = user_data;
+	gsize len = part_id->len;
+	GQueue work_queue = G_QUEUE_INIT;
+	EMailPart *mail_part;
+	CamelMimePart *subpart;
+	CamelContentType *ct;
+	gboolean handled;
+
+	subpart = camel_multipart_get_part (mmd->multipart, index);
+
+	if (subpart == mmd->pgp_encrypted ||
+	    subpart == mmd->pgp_octet_stream) {
+		/* Garbled PGP enctryped message by an Exchange server; show it
+		   at the position, where the pgp-encrypted part is. */
+		if (subpart == mmd->pgp_encrypted &&
+		    mmd->pgp_encrypted && mmd->pgp_octet_stream) {
+			CamelMultipart *encrypted;
+			CamelMimePart *tmp_part;
+
+			encrypted = CAMEL_MULTIPART (camel_multipart_encrypted_new ());
+			camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (encrypted), "multipart/encrypted; protocol=\"application/pgp-encrypted\"");
+			camel_multipart_add_part (encrypted, mmd->pgp_encrypted);
+			camel_multipart_add_part (encrypted, mmd->pgp_octet_stream);
+
+			tmp_part = camel_mime_part_new ();
+			camel_mime_part_set_content_type (tmp_part, "multipart/encrypted; protocol=\"application/pgp-encrypted\"");
+			camel_medium_set_content (CAMEL_MEDIUM (tmp_part), CAMEL_DATA_WRAPPER (encrypted));
+
+			g_string_append (part_id, ".mixed-as-pgp-encrypted");
+
+			e_mail_parser_parse_part_as (parser, tmp_part, part_id,
+				"multipart/encrypted", cancellable, out_mail_parts);
+
+			g_string_truncate (part_id, len);
+
+			g_object_unref (tmp_part);
+			g_object_unref (encrypted);
+		}
+		return;
+	}
+
+	if (index == 0 && (g_str_has_suffix (part_id->str, ".encrypted-pgp") || g_str_has_suffix (part_id->str, ".encrypted-pgp.signed.0"))) {
+		ct = camel_mime_part_get_content_type (subpart);
+		if (ct && camel_content_type_is (ct, "text", "rfc822-headers") &&
+		    camel_content_type_param (ct, "protected-headers")) {
+			/* Skip the text/rfc822-headers part, it's not needed to be shown */
+			return;
+		}
+	}
+
+	g_string_append_printf (part_id, ".mixed.%d", index);
+
+	handled = FALSE;
+	ct = camel_mime_part_get_content_type (subpart);
+	if (ct)
+		ct = camel_content_type_ref (ct);
+
+	if (!e_mail_parser_get_parsers_for_part (parser, subpart)) {
+		gchar *guessed_mime_type;
+		CamelContentType *guessed_ct = NULL;
+
+		guessed_mime_type = e_mail_part_guess_mime_type (subpart);
+		if (guessed_mime_type)
+			guessed_ct = camel_content_type_decode (guessed_mime_type);
+
+		if (guessed_ct && guessed_ct->type && guessed_ct->subtype && (
+		    !ct || g_ascii_strcasecmp (guessed_ct->type, ct->type) != 0 ||
+		    g_ascii_strcasecmp (guessed_ct->subtype, ct->subtype) != 0)) {
+			CamelStream *mem_stream;
+
+			mem_stream = camel_stream_mem_new ();
+			if (camel_data_wrapper_decode_to_stream_sync (
+				camel_medium_get_content (CAMEL_MEDIUM (subpart)),
+				mem_stream, cancellable, NULL)) {
+				CamelMimePart *opart;
+				CamelDataWrapper *dw;
+
+				g_seekable_seek (G_SEEKABLE (mem_stream), 0, G_SEEK_SET, cancellable, NULL);
+
+				opart = camel_mime_part_new ();
+
+				dw = camel_data_wrapper_new ();
+				camel_data_wrapper_set_mime_type (dw, guessed_mime_type);
+				if (camel_data_wrapper_construct_from_stream_sync (dw, mem_stream, cancellable, NULL)) {
+					const gchar *disposition;
+
+					camel_medium_set_content (CAMEL_MEDIUM (opart), dw);
+
+					/* Copy Content-Disposition header, if available */
+					disposition = camel_medium_get_header (CAMEL_MEDIUM (subpart), "Content-Disposition");
+					if (disposition)
+						camel_medium_set_header (CAMEL_MEDIUM (opart), "Content-Disposition", disposition);
+
+					/* Copy also any existing parameters of the Content-Type, like 'name' or 'charset'. */
+					if (ct && ct->params) {
+						CamelHeaderParam *param;
+						for (param = ct->params; param; param = param->next) {
+							camel_content_type_set_param (guessed_ct, param->name, param->value);
+						}
+					}
+
+					camel_content_type_set_param (guessed_ct, E_MAIL_PART_X_EVOLUTION_GUESSED, "1");
+					camel_data_wrapper_set_mime_type_field (CAMEL_DATA_WRAPPER (opart), guessed_ct);
+
+					handled = e_mail_parser_parse_part (parser, opart, part_id, cancellable, &work_queue);
+					if (handled) {
+						camel_content_type_unref (ct);
+						ct = camel_content_type_ref (guessed_ct);
+					}
+				}
+
+				g_object_unref (opart);
+				g_object_unref (dw);
+			}
+
+			g_object_unref (mem_stream);
+		}
+
+		if (guessed_ct)
+			camel_content_type_unref (guessed_ct);
+		g_free (guessed_mime_type);
+	}
+
+	if (!handled) {
+		handled = e_mail_parser_parse_part (
+			parser, subpart, part_id, cancellable, &work_queue);
+	}
+
+	mail_part = g_queue_peek_head (&work_queue);
+
+	/* Display parts with CID as attachments
+	 * (unless they already are attachments).
+	 * Show also hidden attachments with CID,
+	 * because this is multipart/mixed,
+	 * not multipart/related. */
+	if (mail_part != NULL &&
+	    e_mail_part_get_cid (mail_part) != NULL &&
+	    (!e_mail_part_get_is_attachment (mail_part) ||
+	     mail_part->is_hidden)) {
+
+		e_mail_parser_wrap_as_attachment (parser, subpart, part_id, E_MAIL_PARSER_WRAP_ATTACHMENT_FLAG_NONE, &work_queue);
+
+	/* Force messages to be expandable */
+	} else if ((mail_part == NULL && !handled) ||
+	    (camel_content_type_is (ct, "message", "*") &&
+	     mail_part != NULL &&
+	     !e_mail_part_get_is_attachment (mail_part))) {
+
+		e_mail_parser_wrap_as_attachment (parser, subpart, part_id, E_MAIL_PARSER_WRAP_ATTACHMENT_FLAG_NONE, &work_queue);
+
+		mail_part = g_queue_peek_head (&work_queue);
+
+		if (mail_part != NULL)
+			mail_part->force_inline = TRUE;
+	}
+
+	e_queue_transfer (&work_queue, out_mail_parts);
+
+	g_string_truncate (part_id, len);
+
+	if (ct)
+		camel_content_type_unref (ct);
+}
+
 static gboolean
 empe_mp_mixed_parse (EMailParserExtension *extension,
                      EMailParser *parser,
@@ -38,7 +216,8 @@ empe_mp_mixed_parse (EMailParserExtension *extension,
 {
 	CamelMultipart *mp;
 	CamelMimePart *pgp_encrypted = NULL, *pgp_octet_stream = NULL;
-	gint i, nparts, len;
+	MixedData mmd;
+	gint i, nparts;
 
 	mp = (CamelMultipart *) camel_medium_get_content ((CamelMedium *) part);
 
@@ -48,7 +227,6 @@ empe_mp_mixed_parse (EMailParserExtension *extension,
 			"application/vnd.evolution.source",
 			cancellable, out_mail_parts);
 
-	len = part_id->len;
 	nparts = camel_multipart_get_number (mp);
 
 	if ((nparts == 2 || nparts == 3) &&
@@ -85,168 +263,16 @@ empe_mp_mixed_parse (EMailParserExtension *extension,
 		}
 	}
 
-	for (i = 0; i < nparts; i++) {
-		GQueue work_queue = G_QUEUE_INIT;
-		EMailPart *mail_part;
-		CamelMimePart *subpart;
-		CamelContentType *ct;
-		gboolean handled;
-
-		subpart = camel_multipart_get_part (mp, i);
-
-		if (subpart == pgp_encrypted ||
-		    subpart == pgp_octet_stream) {
-			/* Garbled PGP enctryped message by an Exchange server; show it
-			   at the position, where the pgp-encrypted part is. */
-			if (subpart == pgp_encrypted &&
-			    pgp_encrypted && pgp_octet_stream) {
-				CamelMultipart *encrypted;
-				CamelMimePart *tmp_part;
-
-				encrypted = CAMEL_MULTIPART (camel_multipart_encrypted_new ());
-				camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (encrypted), "multipart/encrypted; protocol=\"application/pgp-encrypted\"");
-				camel_multipart_add_part (encrypted, pgp_encrypted);
-				camel_multipart_add_part (encrypted, pgp_octet_stream);
+	mmd.multipart = mp;
+	mmd.pgp_encrypted = pgp_encrypted;
+	mmd.pgp_octet_stream = pgp_octet_stream;
 
-				tmp_part = camel_mime_part_new ();
-				camel_mime_part_set_content_type (tmp_part, "multipart/encrypted; protocol=\"application/pgp-encrypted\"");
-				camel_medium_set_content (CAMEL_MEDIUM (tmp_part), CAMEL_DATA_WRAPPER (encrypted));
-
-				g_string_append (part_id, ".mixed-as-pgp-encrypted");
-
-				e_mail_parser_parse_part_as (parser, tmp_part, part_id,
-					"multipart/encrypted", cancellable, out_mail_parts);
-
-				g_string_truncate (part_id, len);
-
-				g_object_unref (tmp_part);
-				g_object_unref (encrypted);
-			}
-			continue;
-		}
-
-		if (i == 0 && (g_str_has_suffix (part_id->str, ".encrypted-pgp") || g_str_has_suffix (part_id->str, ".encrypted-pgp.signed.0"))) {
-			ct = camel_mime_part_get_content_type (subpart);
-			if (ct && camel_content_type_is (ct, "text", "rfc822-headers") &&
-			    camel_content_type_param (ct, "protected-headers")) {
-				/* Skip the text/rfc822-headers part, it's not needed to be shown */
-				continue;
-			}
-		}
-
-		g_string_append_printf (part_id, ".mixed.%d", i);
-
-		handled = FALSE;
-		ct = camel_mime_part_get_content_type (subpart);
-		if (ct)
-			ct = camel_content_type_ref (ct);
-
-		if (!e_mail_parser_get_parsers_for_part (parser, subpart)) {
-			gchar *guessed_mime_type;
-			CamelContentType *guessed_ct = NULL;
-
-			guessed_mime_type = e_mail_part_guess_mime_type (subpart);
-			if (guessed_mime_type)
-				guessed_ct = camel_content_type_decode (guessed_mime_type);
-
-			if (guessed_ct && guessed_ct->type && guessed_ct->subtype && (
-			    !ct || g_ascii_strcasecmp (guessed_ct->type, ct->type) != 0 ||
-			    g_ascii_strcasecmp (guessed_ct->subtype, ct->subtype) != 0)) {
-				CamelStream *mem_stream;
-
-				mem_stream = camel_stream_mem_new ();
-				if (camel_data_wrapper_decode_to_stream_sync (
-					camel_medium_get_content (CAMEL_MEDIUM (subpart)),
-					mem_stream, cancellable, NULL)) {
-					CamelMimePart *opart;
-					CamelDataWrapper *dw;
-
-					g_seekable_seek (G_SEEKABLE (mem_stream), 0, G_SEEK_SET, cancellable, NULL);
-
-					opart = camel_mime_part_new ();
-
-					dw = camel_data_wrapper_new ();
-					camel_data_wrapper_set_mime_type (dw, guessed_mime_type);
-					if (camel_data_wrapper_construct_from_stream_sync (dw, mem_stream, cancellable, NULL)) {
-						const gchar *disposition;
-
-						camel_medium_set_content (CAMEL_MEDIUM (opart), dw);
-
-						/* Copy Content-Disposition header, if available */
-						disposition = camel_medium_get_header (CAMEL_MEDIUM (subpart), "Content-Disposition");
-						if (disposition)
-							camel_medium_set_header (CAMEL_MEDIUM (opart), "Content-Disposition", disposition);
-
-						/* Copy also any existing parameters of the Content-Type, like 'name' or 'charset'. */
-						if (ct && ct->params) {
-							CamelHeaderParam *param;
-							for (param = ct->params; param; param = param->next) {
-								camel_content_type_set_param (guessed_ct, param->name, param->value);
-							}
-						}
-
-						camel_content_type_set_param (guessed_ct, E_MAIL_PART_X_EVOLUTION_GUESSED, "1");
-						camel_data_wrapper_set_mime_type_field (CAMEL_DATA_WRAPPER (opart), guessed_ct);
-
-						handled = e_mail_parser_parse_part (parser, opart, part_id, cancellable, &work_queue);
-						if (handled) {
-							camel_content_type_unref (ct);
-							ct = camel_content_type_ref (guessed_ct);
-						}
-					}
-
-					g_object_unref (opart);
-					g_object_unref (dw);
-				}
-
-				g_object_unref (mem_stream);
-			}
-
-			if (guessed_ct)
-				camel_content_type_unref (guessed_ct);
-			g_free (guessed_mime_type);
-		}
-
-		if (!handled) {
-			handled = e_mail_parser_parse_part (
-				parser, subpart, part_id, cancellable, &work_queue);
-		}
-
-		mail_part = g_queue_peek_head (&work_queue);
-
-		/* Display parts with CID as attachments
-		 * (unless they already are attachments).
-		 * Show also hidden attachments with CID,
-		 * because this is multipart/mixed,
-		 * not multipart/related. */
-		if (mail_part != NULL &&
-		    e_mail_part_get_cid (mail_part) != NULL &&
-		    (!e_mail_part_get_is_attachment (mail_part) ||
-		     mail_part->is_hidden)) {
-
-			e_mail_parser_wrap_as_attachment (parser, subpart, part_id, E_MAIL_PARSER_WRAP_ATTACHMENT_FLAG_NONE, &work_queue);
-
-		/* Force messages to be expandable */
-		} else if ((mail_part == NULL && !handled) ||
-		    (camel_content_type_is (ct, "message", "*") &&
-		     mail_part != NULL &&
-		     !e_mail_part_get_is_attachment (mail_part))) {
-
-			e_mail_parser_wrap_as_attachment (parser, subpart, part_id, E_MAIL_PARSER_WRAP_ATTACHMENT_FLAG_NONE, &work_queue);
-
-			mail_part = g_queue_peek_head (&work_queue);
-
-			if (mail_part != NULL)
-				mail_part->force_inline = TRUE;
-		}
-
-		e_queue_transfer (&work_queue, out_mail_parts);
-
-		g_string_truncate (part_id, len);
-
-		if (ct)
-			camel_content_type_unref (ct);
-	}
+	/* The subparts do not depend on each other, thus decode and parse
+	 * them concurrently; the parts are still added in the original order. */
+	e_mail_parser_parse_parallel (
+		parser, nparts, part_id,
+		empe_mp_mixed_parse_subpart, &mmd,
+		cancellable, out_mail_parts);
 
 	return TRUE;
 }
@@ -20,6 +20,9 @@
 
 #define d(x)
 
+/* Upper bound of the worker threads parsing subparts in parallel. */
+#define MAX_PARSER_THREADS 8
+
 struct _EMailParserPrivate {
 	GMutex mutex;
 
@@ -768,6 +771,198 @@ e_mail_parser_parse_part_as (EMailParser *parser,
 	return mime_part_handled;
 }
 
+typedef struct _ParallelParseData {
+	volatile gint ref_count;
+
+	EMailParser *parser;
+	EMailParserParseFunc func;
+	gpointer user_data;
+	GCancellable *cancellable;
+	gchar *part_id;
+
+	guint n_items;
+	gint next_item;		/* atomic */
+	GQueue *queues;		/* one for each item */
+
+	GMutex lock;
+	GCond cond;
+	guint n_finished;
+} ParallelParseData;
+
+static ParallelParseData *
+parallel_parse_data_ref (ParallelParseData *ppd)
+{
+	g_atomic_int_inc (&ppd->ref_count);
+
+	return ppd;
+}
+
+static void
+parallel_parse_data_unref (ParallelParseData *ppd)
+{
+	if (g_atomic_int_dec_and_test (&ppd->ref_count)) {
+		guint ii;
+
+		for (ii = 0; ii < ppd->n_items; ii++) {
+			g_queue_clear_full (&ppd->queues[ii], g_object_unref);
+		}
+
+		g_clear_object (&ppd->parser);
+		g_clear_object (&ppd->cancellable);
+		g_free (ppd->queues);
+		g_free (ppd->part_id);
+		g_mutex_clear (&ppd->lock);
+		g_cond_clear (&ppd->cond);
+		g_slice_free (ParallelParseData, ppd);
+	}
+}
+
+/* Claims the next item not started yet and parses it; returns FALSE
+   when all items are claimed already. */
+static gboolean
+mail_parser_parallel_run_one (ParallelParseData *ppd)
+{
+	guint index;
+
+	index = (guint) g_atomic_int_add (&ppd->next_item, 1);
+	if (index >= ppd->n_items)
+		return FALSE;
+
+	if (!g_cancellable_is_cancelled (ppd->cancellable)) {
+		GString *part_id;
+
+		part_id = g_string_new (ppd->part_id);
+
+		ppd->func (ppd->parser, index, part_id, ppd->cancellable,
+			&ppd->queues[index], ppd->user_data);
+
+		g_string_free (part_id, TRUE);
+	}
+
+	g_mutex_lock (&ppd->lock);
+	ppd->n_finished++;
+	if (ppd->n_finished == ppd->n_items)
+		g_cond_signal (&ppd->cond);
+	g_mutex_unlock (&ppd->lock);
+
+	return TRUE;
+}
+
+static void
+mail_parser_parallel_thread (gpointer data,
+			     gpointer user_data)
+{
+	ParallelParseData *ppd = data;
+
+	mail_parser_parallel_run_one (ppd);
+	parallel_parse_data_unref (ppd);
+}
+
+static GThreadPool *
+mail_parser_get_thread_pool (void)
+{
+	static GThreadPool *thread_pool = NULL;
+
+	if (g_once_init_enter (&thread_pool)) {
+		GThreadPool *pool;
+
+		pool = g_thread_pool_new (mail_parser_parallel_thread, NULL,
+			CLAMP (g_get_num_processors (), 2, MAX_PARSER_THREADS), FALSE, NULL);
+
+		g_once_init_leave (&thread_pool, pool);
+	}
+
+	return thread_pool;
+}
+
+/**
+ * e_mail_parser_parse_parallel:
+ * @parser: an #EMailParser
+ * @n_items: how many items to parse
+ * @part_id: part ID prefix of the items
+ * @func: (scope call): an #EMailParserParseFunc to parse one item
+ * @user_data: user data passed to the @func
+ * @cancellable: (nullable): a #GCancellable
+ * @out_mail_parts: a #GQueue to add the parsed parts to
+ *
+ * Calls @func for each of the @n_items items, each with its own copy
+ * of the @part_id and its own output queue, concurrently on a shared pool
+ * of worker threads.  The calling thread parses items as well, thus it is
+ * safe to call this function from within the @func.  Items not started
+ * before the @cancellable is cancelled are skipped.
+ *
+ * Once all items are finished, their parts are added to @out_mail_parts
+ * in the order of the items, regardless of the order they finished in.
+ *
+ * The @func should not touch any state shared with the other items
+ * without a lock.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_parser_parse_parallel (EMailParser *parser,
+			      guint n_items,
+			      GString *part_id,
+			      EMailParserParseFunc func,
+			      gpointer user_data,
+			      GCancellable *cancellable,
+			      GQueue *out_mail_parts)
+{
+	ParallelParseData *ppd;
+	guint ii;
+
+	g_return_if_fail (E_IS_MAIL_PARSER (parser));
+	g_return_if_fail (part_id != NULL);
+	g_return_if_fail (func != NULL);
+	g_return_if_fail (out_mail_parts != NULL);
+
+	if (n_items <= 1) {
+		gsize len = part_id->len;
+
+		for (ii = 0; ii < n_items && !g_cancellable_is_cancelled (cancellable); ii++) {
+			func (parser, ii, part_id, cancellable, out_mail_parts, user_data);
+			g_string_truncate (part_id, len);
+		}
+
+		return;
+	}
+
+	ppd = g_slice_new0 (ParallelParseData);
+	ppd->ref_count = 1;
+	ppd->parser = g_object_ref (parser);
+	ppd->func = func;
+	ppd->user_data = user_data;
+	ppd->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	ppd->part_id = g_strdup (part_id->str);
+	ppd->n_items = n_items;
+	ppd->queues = g_new0 (GQueue, n_items);
+	g_mutex_init (&ppd->lock);
+	g_cond_init (&ppd->cond);
+
+	/* The workers help the calling thread, which parses items too;
+	   waiting only for items other threads are already working on
+	   avoids a deadlock when the pool is saturated by nested calls. */
+	for (ii = 1; ii < n_items; ii++) {
+		g_thread_pool_push (mail_parser_get_thread_pool (), parallel_parse_data_ref (ppd), NULL);
+	}
+
+	while (mail_parser_parallel_run_one (ppd)) {
+		/* Parse what was not claimed by the workers yet */
+	}
+
+	g_mutex_lock (&ppd->lock);
+	while (ppd->n_finished < ppd->n_items) {
+		g_cond_wait (&ppd->cond, &ppd->lock);
+	}
+	g_mutex_unlock (&ppd->lock);
+
+	for (ii = 0; ii < n_items; ii++) {
+		e_queue_transfer (&ppd->queues[ii], out_mail_parts);
+	}
+
+	parallel_parse_data_unref (ppd);
+}
+
 void
 e_mail_parser_error (EMailParser *parser,
                      GQueue *out_mail_parts,
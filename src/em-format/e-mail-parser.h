@@ -33,6 +33,26 @@ typedef struct _EMailParser EMailParser;
 typedef struct _EMailParserClass EMailParserClass;
 typedef struct _EMailParserPrivate EMailParserPrivate;
 
+/**
+ * EMailParserParseFunc:
+ * @parser: an #EMailParser
+ * @index: index of the item to parse
+ * @part_id: part ID prefix; the function can modify it
+ * @cancellable: (nullable): a #GCancellable
+ * @out_mail_parts: a #GQueue to add the parsed parts to
+ * @user_data: user data passed to e_mail_parser_parse_parallel()
+ *
+ * Parses one item for e_mail_parser_parse_parallel().
+ *
+ * Since: 3.62
+ **/
+typedef void	(*EMailParserParseFunc)		(EMailParser *parser,
+						 guint index,
+						 GString *part_id,
+						 GCancellable *cancellable,
+						 GQueue *out_mail_parts,
+						 gpointer user_data);
+
 struct _EMailParser {
 	GObject parent;
 	EMailParserPrivate *priv;
@@ -84,6 +104,14 @@ gboolean	e_mail_parser_parse_part_as	(EMailParser *parser,
 						 GCancellable *cancellable,
 						 GQueue *out_mail_parts);
 
+void		e_mail_parser_parse_parallel	(EMailParser *parser,
+						 guint n_items,
+						 GString *part_id,
+						 EMailParserParseFunc func,
+						 gpointer user_data,
+						 GCancellable *cancellable,
+						 GQueue *out_mail_parts);
+
 void		e_mail_parser_error		(EMailParser *parser,
 						 GQueue *out_mail_parts,
 						 const gchar *format,
@@ -36,10 +36,16 @@
 #define w(x)
 #define d(x)
 
+/* How long to gather "changed" emissions of a folder before
+ * processing them as a single batch. */
+#define FOLDER_CHANGES_BATCH_INTERVAL_MS 250
+
 typedef struct _StoreInfo StoreInfo;
 typedef struct _FolderInfo FolderInfo;
 typedef struct _AsyncContext AsyncContext;
 typedef struct _UpdateClosure UpdateClosure;
+typedef struct _FolderChangesBatch FolderChangesBatch;
+typedef struct _ProcessChangesData ProcessChangesData;
 
 struct _MailFolderCachePrivate {
 	GMainContext *main_context;
@@ -55,6 +61,16 @@ struct _MailFolderCachePrivate {
 
 	GHashTable *local_folder_uris;
 	GHashTable *remote_folder_uris;
+
+	/* CamelFolder ~> FolderChangesBatch */
+	GHashTable *folder_changes_ht;
+	GMutex folder_changes_lock;
+	GSource *folder_changes_source;
+
+	/* Scheduled unread count updates, which can still absorb
+	 * later updates of the same folder: UpdateClosure ~> itself */
+	GHashTable *pending_updates_ht;
+	GMutex pending_updates_lock;
 };
 
 enum {
@@ -139,7 +155,7 @@ struct _UpdateClosure {
 	 * AVAILABLE, DELETED, RENAMED, UNAVAILABLE */
 	guint signal_id;
 
-	gboolean new_messages;
+	gint new_messages;
 
 	gchar *full_name;
 	gchar *oldfull;
@@ -152,6 +168,19 @@ struct _UpdateClosure {
 	gchar *msg_subject;
 };
 
+/* Changes of one folder, gathered between two processing runs. */
+struct _FolderChangesBatch {
+	CamelFolder *folder;
+	CamelFolderChangeInfo *changes;
+	gboolean has_changes;
+	gboolean in_flight;	/* the previous batch is still being processed */
+};
+
+struct _ProcessChangesData {
+	MailFolderCache *cache;
+	CamelFolder *folder;
+};
+
 /* Forward Declarations */
 static void	store_folder_created_cb		(CamelStore *store,
 						 CamelFolderInfo *info,
@@ -487,6 +516,85 @@ update_closure_free (UpdateClosure *closure)
 	g_slice_free (UpdateClosure, closure);
 }
 
+static guint
+update_closure_hash (gconstpointer ptr)
+{
+	const UpdateClosure *closure = ptr;
+
+	return g_direct_hash (closure->store) ^ g_str_hash (closure->full_name);
+}
+
+static gboolean
+update_closure_equal (gconstpointer ptr1,
+                      gconstpointer ptr2)
+{
+	const UpdateClosure *closure1 = ptr1;
+	const UpdateClosure *closure2 = ptr2;
+
+	return closure1->store == closure2->store &&
+		g_strcmp0 (closure1->full_name, closure2->full_name) == 0;
+}
+
+/* Folds a later unread count update into one not delivered yet. */
+static void
+update_closure_merge (UpdateClosure *closure,
+                      UpdateClosure *later)
+{
+	closure->unread = later->unread;
+
+	if (later->new_messages <= 0)
+		return;
+
+	if (closure->new_messages > 0) {
+		/* The details are shown only for a single new message. */
+		g_clear_pointer (&closure->msg_uid, g_free);
+		g_clear_pointer (&closure->msg_sender, g_free);
+		g_clear_pointer (&closure->msg_subject, g_free);
+	} else {
+		closure->msg_uid = g_steal_pointer (&later->msg_uid);
+		closure->msg_sender = g_steal_pointer (&later->msg_sender);
+		closure->msg_subject = g_steal_pointer (&later->msg_subject);
+	}
+
+	closure->new_messages += later->new_messages;
+}
+
+static FolderChangesBatch *
+folder_changes_batch_new (CamelFolder *folder)
+{
+	FolderChangesBatch *batch;
+
+	batch = g_slice_new0 (FolderChangesBatch);
+	batch->folder = g_object_ref (folder);
+	batch->changes = camel_folder_change_info_new ();
+
+	return batch;
+}
+
+static void
+folder_changes_batch_free (gpointer ptr)
+{
+	FolderChangesBatch *batch = ptr;
+
+	if (batch) {
+		g_clear_object (&batch->folder);
+		camel_folder_change_info_free (batch->changes);
+		g_slice_free (FolderChangesBatch, batch);
+	}
+}
+
+static void
+process_changes_data_free (gpointer ptr)
+{
+	ProcessChangesData *pcd = ptr;
+
+	if (pcd) {
+		g_clear_object (&pcd->cache);
+		g_clear_object (&pcd->folder);
+		g_slice_free (ProcessChangesData, pcd);
+	}
+}
+
 static void
 mail_folder_cache_check_connection_status_cb (CamelStore *store,
 					      GParamSpec *param,
@@ -696,6 +804,14 @@ mail_folder_cache_update_idle_cb (gpointer user_data)
 	cache = camel_weak_ref_group_get (closure->cache_weak_ref_group);
 
 	if (cache != NULL) {
+		if (!closure->signal_id) {
+			/* From now on later updates need their own closure. */
+			g_mutex_lock (&cache->priv->pending_updates_lock);
+			if (g_hash_table_lookup (cache->priv->pending_updates_ht, closure) == closure)
+				g_hash_table_remove (cache->priv->pending_updates_ht, closure);
+			g_mutex_unlock (&cache->priv->pending_updates_lock);
+		}
+
 		if (closure->signal_id == signals[FOLDER_DELETED]) {
 			g_signal_emit (
 				cache,
@@ -794,6 +910,32 @@ mail_folder_cache_submit_update (UpdateClosure *closure)
 	cache = camel_weak_ref_group_get (closure->cache_weak_ref_group);
 	g_return_if_fail (cache != NULL);
 
+	g_mutex_lock (&cache->priv->pending_updates_lock);
+
+	if (!closure->signal_id) {
+		UpdateClosure *pending;
+
+		/* Only the last unread count matters, thus merge it into
+		 * an update of the same folder, which did not run yet. */
+		pending = g_hash_table_lookup (cache->priv->pending_updates_ht, closure);
+		if (pending != NULL) {
+			update_closure_merge (pending, closure);
+			g_mutex_unlock (&cache->priv->pending_updates_lock);
+
+			update_closure_free (closure);
+			g_object_unref (cache);
+
+			return;
+		}
+
+		g_hash_table_add (cache->priv->pending_updates_ht, closure);
+	} else {
+		/* Keep the order; later count updates follow this one. */
+		g_hash_table_remove (cache->priv->pending_updates_ht, closure);
+	}
+
+	g_mutex_unlock (&cache->priv->pending_updates_lock);
+
 	main_context = mail_folder_cache_ref_main_context (cache);
 
 	idle_source = g_idle_source_new ();
@@ -1049,7 +1191,8 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 {
 	static GHashTable *last_newmail_per_folder = NULL;
 	static GMutex last_newmail_per_folder_mutex;
-	MailFolderCache *cache = user_data;
+	ProcessChangesData *pcd = user_data;
+	MailFolderCache *cache = pcd->cache;
 	time_t latest_received, new_latest_received;
 	CamelFolder *local_drafts;
 	CamelFolder *local_outbox;
@@ -1188,17 +1331,146 @@ folder_cache_process_folder_changes_thread (CamelFolder *folder,
 #undef IGNORE_THREAD_VALUE_IN_PROGRESS
 #undef IGNORE_THREAD_VALUE_DONE
 
+static gboolean mail_folder_cache_flush_folder_changes_cb (gpointer user_data);
+
+/* Call with folder_changes_lock held. */
+static void
+mail_folder_cache_schedule_folder_changes_locked (MailFolderCache *cache)
+{
+	GMainContext *main_context;
+	GSource *timeout_source;
+
+	if (cache->priv->folder_changes_source)
+		return;
+
+	main_context = mail_folder_cache_ref_main_context (cache);
+
+	timeout_source = g_timeout_source_new (FOLDER_CHANGES_BATCH_INTERVAL_MS);
+	g_source_set_name (timeout_source, "mail_folder_cache_flush_folder_changes_cb");
+	g_source_set_callback (
+		timeout_source,
+		mail_folder_cache_flush_folder_changes_cb,
+		camel_weak_ref_group_ref (cache->priv->weak_ref_group),
+		(GDestroyNotify) camel_weak_ref_group_unref);
+	g_source_attach (timeout_source, main_context);
+
+	/* Takes the reference */
+	cache->priv->folder_changes_source = timeout_source;
+
+	g_main_context_unref (main_context);
+}
+
+static void
+folder_cache_process_folder_changes_done (gpointer user_data)
+{
+	ProcessChangesData *pcd = user_data;
+	MailFolderCache *cache = pcd->cache;
+	FolderChangesBatch *batch;
+
+	g_mutex_lock (&cache->priv->folder_changes_lock);
+
+	batch = g_hash_table_lookup (cache->priv->folder_changes_ht, pcd->folder);
+	if (batch != NULL) {
+		batch->in_flight = FALSE;
+
+		/* More changes arrived while processing the previous batch. */
+		if (batch->has_changes)
+			mail_folder_cache_schedule_folder_changes_locked (cache);
+		else
+			g_hash_table_remove (cache->priv->folder_changes_ht, pcd->folder);
+	}
+
+	g_mutex_unlock (&cache->priv->folder_changes_lock);
+
+	process_changes_data_free (pcd);
+}
+
+static gboolean
+mail_folder_cache_flush_folder_changes_cb (gpointer user_data)
+{
+	CamelWeakRefGroup *weak_ref_group = user_data;
+	MailFolderCache *cache;
+	GHashTableIter iter;
+	GSList *batches = NULL, *link;
+	gpointer value;
+
+	cache = camel_weak_ref_group_get (weak_ref_group);
+	if (!cache)
+		return FALSE;
+
+	g_mutex_lock (&cache->priv->folder_changes_lock);
+
+	if (cache->priv->folder_changes_source == g_main_current_source ())
+		g_clear_pointer (&cache->priv->folder_changes_source, g_source_unref);
+
+	g_hash_table_iter_init (&iter, cache->priv->folder_changes_ht);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FolderChangesBatch *batch = value, *ready;
+
+		/* One batch per folder at a time; the rest waits for it. */
+		if (batch->in_flight || !batch->has_changes)
+			continue;
+
+		ready = g_slice_new0 (FolderChangesBatch);
+		ready->folder = g_object_ref (batch->folder);
+		ready->changes = batch->changes;
+
+		batch->changes = camel_folder_change_info_new ();
+		batch->has_changes = FALSE;
+		batch->in_flight = TRUE;
+
+		batches = g_slist_prepend (batches, ready);
+	}
+
+	g_mutex_unlock (&cache->priv->folder_changes_lock);
+
+	for (link = batches; link; link = g_slist_next (link)) {
+		FolderChangesBatch *batch = link->data;
+		ProcessChangesData *pcd;
+
+		pcd = g_slice_new0 (ProcessChangesData);
+		pcd->cache = g_object_ref (cache);
+		pcd->folder = g_object_ref (batch->folder);
+
+		mail_process_folder_changes (batch->folder, batch->changes,
+			folder_cache_process_folder_changes_thread,
+			folder_cache_process_folder_changes_done, pcd);
+	}
+
+	g_slist_free_full (batches, folder_changes_batch_free);
+	g_object_unref (cache);
+
+	return FALSE;
+}
+
 static void
 folder_changed_cb (CamelFolder *folder,
                    CamelFolderChangeInfo *changes,
                    MailFolderCache *cache)
 {
+	FolderChangesBatch *batch;
+
 	if (!changes)
 		return;
 
-	mail_process_folder_changes (folder, changes,
-		folder_cache_process_folder_changes_thread,
-		g_object_unref, g_object_ref (cache));
+	/* A large sync emits "changed" many times in a row; gather the bursts
+	 * per folder and process them together, thus the counts are computed
+	 * and the signals are emitted once per batch, not once per emission. */
+	g_mutex_lock (&cache->priv->folder_changes_lock);
+
+	batch = g_hash_table_lookup (cache->priv->folder_changes_ht, folder);
+	if (!batch) {
+		batch = folder_changes_batch_new (folder);
+		g_hash_table_insert (cache->priv->folder_changes_ht, folder, batch);
+	}
+
+	camel_folder_change_info_cat (batch->changes, changes);
+	batch->has_changes = TRUE;
+
+	if (!batch->in_flight)
+		mail_folder_cache_schedule_folder_changes_locked (cache);
+
+	g_mutex_unlock (&cache->priv->folder_changes_lock);
 }
 
 static void
@@ -1509,6 +1781,14 @@ mail_folder_cache_dispose (GObject *object)
 
 	g_hash_table_remove_all (self->priv->store_info_ht);
 
+	g_mutex_lock (&self->priv->folder_changes_lock);
+	if (self->priv->folder_changes_source) {
+		g_source_destroy (self->priv->folder_changes_source);
+		g_clear_pointer (&self->priv->folder_changes_source, g_source_unref);
+	}
+	g_hash_table_remove_all (self->priv->folder_changes_ht);
+	g_mutex_unlock (&self->priv->folder_changes_lock);
+
 	/* Chain up to parent's dispose() method. */
 	G_OBJECT_CLASS (mail_folder_cache_parent_class)->dispose (object);
 }
@@ -1525,6 +1805,10 @@ mail_folder_cache_finalize (GObject *object)
 	g_hash_table_destroy (self->priv->local_folder_uris);
 	g_hash_table_destroy (self->priv->remote_folder_uris);
 	g_mutex_clear (&self->priv->store_info_ht_lock);
+	g_hash_table_destroy (self->priv->folder_changes_ht);
+	g_mutex_clear (&self->priv->folder_changes_lock);
+	g_hash_table_destroy (self->priv->pending_updates_ht);
+	g_mutex_clear (&self->priv->pending_updates_lock);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (mail_folder_cache_parent_class)->finalize (object);
@@ -1830,6 +2114,12 @@ mail_folder_cache_init (MailFolderCache *cache)
 	cache->priv->store_info_ht = store_info_ht;
 	g_mutex_init (&cache->priv->store_info_ht_lock);
 
+	cache->priv->folder_changes_ht = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, folder_changes_batch_free);
+	g_mutex_init (&cache->priv->folder_changes_lock);
+
+	cache->priv->pending_updates_ht = g_hash_table_new (update_closure_hash, update_closure_equal);
+	g_mutex_init (&cache->priv->pending_updates_lock);
+
 	cache->priv->count_sent = getenv ("EVOLUTION_COUNT_SENT") != NULL;
 	cache->priv->count_trash = getenv ("EVOLUTION_COUNT_TRASH") != NULL;
 
@@ -2083,8 +2373,11 @@ mail_folder_cache_note_store_thread (ESimpleAsyncResult *simple,
 	GQueue result_queue = G_QUEUE_INIT;
 	AsyncContext *async_context;
 	gboolean success = FALSE;
+	gint64 trace_begin, trace_step;
 	GError *local_error = NULL;
 
+	trace_begin = e_trace_begin ();
+
 	cache = MAIL_FOLDER_CACHE (source_object);
 	async_context = e_simple_async_result_get_op_pointer (simple);
 	store_info = async_context->store_info;
@@ -2132,12 +2425,14 @@ mail_folder_cache_note_store_thread (ESimpleAsyncResult *simple,
 	 *     "out" parameter so it's easier to distinguish errors
 	 *     from empty results.
 	 */
+	trace_step = e_trace_begin ();
 	async_context->info = camel_store_get_folder_info_sync (
 		store_info->store, NULL,
 		CAMEL_STORE_FOLDER_INFO_FAST |
 		CAMEL_STORE_FOLDER_INFO_RECURSIVE |
 		CAMEL_STORE_FOLDER_INFO_SUBSCRIBED,
 		cancellable, &local_error);
+	e_trace_end (trace_step, "mail-folder-cache", "get-folder-info", camel_service_get_display_name (service));
 
 	if (local_error != NULL) {
 		g_warn_if_fail (async_context->info == NULL);
@@ -2151,7 +2446,9 @@ mail_folder_cache_note_store_thread (ESimpleAsyncResult *simple,
 	g_mutex_lock (&store_info->lock);
 	if (store_info->first_update != E_FIRST_UPDATE_DONE) {
 		g_mutex_unlock (&store_info->lock);
+		trace_step = e_trace_begin ();
 		mail_folder_cache_first_update (cache, store_info);
+		e_trace_end (trace_step, "mail-folder-cache", "first-update", camel_service_get_display_name (service));
 	} else {
 		g_mutex_unlock (&store_info->lock);
 	}
@@ -2182,6 +2479,8 @@ exit:
 			g_clear_object (&queued_result);
 	}
 
+	e_trace_end (trace_begin, "mail-folder-cache", "note-store", camel_service_get_display_name (service));
+
 	g_object_unref (session);
 }
 
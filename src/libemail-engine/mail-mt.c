@@ -396,6 +396,325 @@ mail_msg_init (void)
 	main_thread = g_thread_self ();
 }
 
+/* The messages are run by a single pool of worker threads, which
+ * pick the work from any of the queues.  The unordered queue runs
+ * its messages in parallel, each ordered queue runs one message at
+ * a time, in the order (and priority) it was pushed in.  Ordered
+ * queues are created on demand and freed once they are empty. */
+
+#define UNORDERED_QUEUE_NAME	"unordered"
+#define FAST_QUEUE_NAME		"fast-ordered"
+#define SLOW_QUEUE_NAME		"slow-ordered"
+
+/* Idle worker threads exit after this many seconds */
+#define WORKER_IDLE_TIMEOUT	60
+
+/* Kept after the queue is freed, thus the statistics cover
+ * the whole run time, not only the time the queue was busy. */
+typedef struct _QueueStats {
+	guint64 n_processed;
+	gint64 wait_time_total;
+	gint64 wait_time_max;
+} QueueStats;
+
+typedef struct _MsgQueue {
+	gchar *name;
+	GQueue items;		/* QueueItem *, sorted by priority */
+	guint running;
+	guint max_running;
+	QueueStats *stats;	/* owned by scheduler_stats */
+} MsgQueue;
+
+typedef struct _QueueItem {
+	MailMsg *msg;
+	gint64 queued_at;
+} QueueItem;
+
+static GMutex scheduler_lock;
+static GCond scheduler_cond;
+static GHashTable *scheduler_queues; /* gchar *name ~> MsgQueue * */
+static GPtrArray *scheduler_queues_array; /* MsgQueue *, for round-robin */
+static GHashTable *scheduler_stats; /* gchar *name ~> QueueStats * */
+static guint scheduler_next_queue;
+static guint scheduler_n_workers;
+static guint scheduler_n_idle; /* waiting workers, which were not signalled yet */
+static guint scheduler_n_wakeups; /* signalled or new workers, which did not pick any item yet */
+static guint scheduler_max_workers;
+
+static void
+msg_queue_free (gpointer ptr)
+{
+	MsgQueue *queue = ptr;
+
+	if (queue) {
+		g_warn_if_fail (g_queue_is_empty (&queue->items));
+		g_free (queue->name);
+		g_slice_free (MsgQueue, queue);
+	}
+}
+
+/* Call with the scheduler_lock held */
+static MsgQueue *
+scheduler_ref_queue_locked (const gchar *name)
+{
+	MsgQueue *queue;
+
+	if (!scheduler_queues) {
+		guint n_processors = g_get_num_processors ();
+
+		/* Most of the messages wait for the network, not for the CPU */
+		scheduler_max_workers = CLAMP (n_processors * 2, 8, 32);
+		scheduler_queues = g_hash_table_new (g_str_hash, g_str_equal);
+		scheduler_queues_array = g_ptr_array_new_with_free_func (msg_queue_free);
+		scheduler_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	}
+
+	queue = g_hash_table_lookup (scheduler_queues, name);
+	if (!queue) {
+		queue = g_slice_new0 (MsgQueue);
+		queue->name = g_strdup (name);
+		g_queue_init (&queue->items);
+
+		if (g_strcmp0 (name, UNORDERED_QUEUE_NAME) == 0) {
+			/* Leave some workers for the ordered queues */
+			queue->max_running = MAX (scheduler_max_workers * 3 / 4, 1);
+		} else {
+			queue->max_running = 1;
+		}
+
+		queue->stats = g_hash_table_lookup (scheduler_stats, name);
+		if (!queue->stats) {
+			queue->stats = g_new0 (QueueStats, 1);
+			g_hash_table_insert (scheduler_stats, g_strdup (name), queue->stats);
+		}
+
+		g_hash_table_insert (scheduler_queues, queue->name, queue);
+		g_ptr_array_add (scheduler_queues_array, queue);
+	}
+
+	return queue;
+}
+
+/* Call with the scheduler_lock held */
+static void
+scheduler_free_queue_if_empty_locked (MsgQueue *queue)
+{
+	if (queue->running || !g_queue_is_empty (&queue->items))
+		return;
+
+	g_hash_table_remove (scheduler_queues, queue->name);
+
+	/* This frees the 'queue' */
+	g_ptr_array_remove_fast (scheduler_queues_array, queue);
+}
+
+/* Call with the scheduler_lock held; returns how many of the queued
+ * items can be run right now, considering the limits of the queues. */
+static guint
+scheduler_count_runnable_locked (void)
+{
+	guint ii, n_runnable = 0;
+
+	for (ii = 0; scheduler_queues_array && ii < scheduler_queues_array->len; ii++) {
+		MsgQueue *queue = g_ptr_array_index (scheduler_queues_array, ii);
+
+		if (queue->running < queue->max_running)
+			n_runnable += MIN (g_queue_get_length (&queue->items), queue->max_running - queue->running);
+	}
+
+	return n_runnable;
+}
+
+/* Call with the scheduler_lock held; picks the queue with the highest
+ * priority message, which can run now, equal priorities round-robin. */
+static QueueItem *
+scheduler_pop_locked (MsgQueue **out_queue)
+{
+	MsgQueue *best = NULL;
+	guint ii, n_queues, best_index = 0;
+
+	if (!scheduler_queues_array)
+		return NULL;
+
+	n_queues = scheduler_queues_array->len;
+
+	for (ii = 0; ii < n_queues; ii++) {
+		guint index = (scheduler_next_queue + ii) % n_queues;
+		MsgQueue *queue = g_ptr_array_index (scheduler_queues_array, index);
+		QueueItem *head;
+
+		if (queue->running >= queue->max_running)
+			continue;
+
+		head = g_queue_peek_head (&queue->items);
+		if (!head)
+			continue;
+
+		if (!best || head->msg->priority > ((QueueItem *) g_queue_peek_head (&best->items))->msg->priority) {
+			best = queue;
+			best_index = index;
+		}
+	}
+
+	if (!best)
+		return NULL;
+
+	scheduler_next_queue = best_index + 1;
+	best->running++;
+
+	*out_queue = best;
+
+	return g_queue_pop_head (&best->items);
+}
+
+/* Call with the scheduler_lock held; the worker is not idle anymore */
+static void
+scheduler_worker_woken_locked (void)
+{
+	/* The signalling thread already did not count it as idle */
+	if (scheduler_n_wakeups > 0)
+		scheduler_n_wakeups--;
+	else if (scheduler_n_idle > 0)
+		scheduler_n_idle--;
+}
+
+/* Prints the queue statistics, when run with CAMEL_DEBUG=mail:queues */
+static void
+scheduler_dump_stats (void)
+{
+	GSList *stats, *link;
+
+	stats = mail_msg_dup_queue_stats ();
+
+	printf ("Mail message queues:\n");
+
+	for (link = stats; link; link = g_slist_next (link)) {
+		MailMsgQueueStats *stat = link->data;
+
+		printf ("   %s: queued:%u running:%u processed:%" G_GUINT64_FORMAT " wait avg:%.1f ms max:%.1f ms\n",
+			stat->name, stat->n_queued, stat->n_running, stat->n_processed,
+			stat->wait_time_avg / 1000.0, stat->wait_time_max / 1000.0);
+	}
+
+	g_slist_free_full (stats, (GDestroyNotify) mail_msg_queue_stats_free);
+}
+
+static gpointer
+scheduler_worker_thread (gpointer user_data)
+{
+	g_mutex_lock (&scheduler_lock);
+
+	/* Counted as a wakeup by the scheduler_push() */
+	if (scheduler_n_wakeups > 0)
+		scheduler_n_wakeups--;
+
+	while (TRUE) {
+		MsgQueue *queue = NULL;
+		QueueItem *item;
+		gint64 waited;
+
+		item = scheduler_pop_locked (&queue);
+
+		if (!item) {
+			gint64 end_time;
+			gboolean timed_out;
+
+			end_time = g_get_monotonic_time () + WORKER_IDLE_TIMEOUT * G_TIME_SPAN_SECOND;
+
+			scheduler_n_idle++;
+			timed_out = !g_cond_wait_until (&scheduler_cond, &scheduler_lock, end_time);
+			scheduler_worker_woken_locked ();
+
+			if (timed_out) {
+				item = scheduler_pop_locked (&queue);
+				if (!item)
+					break;
+			} else {
+				continue;
+			}
+		}
+
+		waited = g_get_monotonic_time () - item->queued_at;
+		queue->stats->wait_time_total += waited;
+		queue->stats->wait_time_max = MAX (queue->stats->wait_time_max, waited);
+
+		g_mutex_unlock (&scheduler_lock);
+
+		mail_msg_proxy (item->msg);
+		g_slice_free (QueueItem, item);
+
+		if (camel_debug ("mail:queues"))
+			scheduler_dump_stats ();
+
+		g_mutex_lock (&scheduler_lock);
+
+		queue->running--;
+		queue->stats->n_processed++;
+		scheduler_free_queue_if_empty_locked (queue);
+	}
+
+	scheduler_n_workers--;
+
+	g_mutex_unlock (&scheduler_lock);
+
+	return NULL;
+}
+
+static void
+scheduler_push (const gchar *queue_name,
+                MailMsg *msg)
+{
+	MsgQueue *queue;
+	QueueItem *item;
+	GList *link;
+
+	item = g_slice_new (QueueItem);
+	item->msg = msg;
+	item->queued_at = g_get_monotonic_time ();
+
+	g_mutex_lock (&scheduler_lock);
+
+	queue = scheduler_ref_queue_locked (queue_name);
+
+	/* Higher priority first, keep the push order for the same priority */
+	for (link = g_queue_peek_tail_link (&queue->items); link; link = g_list_previous (link)) {
+		QueueItem *other = link->data;
+
+		if (other->msg->priority >= msg->priority)
+			break;
+	}
+
+	/* NULL 'link' inserts at the head */
+	g_queue_insert_after (&queue->items, link, item);
+
+	/* The workers, which were woken up or started and did not pick
+	 * an item yet, will pick the runnable items; add one more worker
+	 * when there are more runnable items than such workers. */
+	if (scheduler_count_runnable_locked () <= scheduler_n_wakeups) {
+		/* Nothing to do */
+	} else if (scheduler_n_idle > 0) {
+		scheduler_n_idle--;
+		scheduler_n_wakeups++;
+		g_cond_signal (&scheduler_cond);
+	} else if (scheduler_n_workers < scheduler_max_workers) {
+		GThread *thread;
+		GError *local_error = NULL;
+
+		thread = g_thread_try_new ("mail-msg-worker", scheduler_worker_thread, NULL, &local_error);
+		if (thread) {
+			scheduler_n_workers++;
+			scheduler_n_wakeups++;
+			g_thread_unref (thread);
+		} else {
+			g_warning ("%s: Failed to create worker thread: %s", G_STRFUNC,
+				local_error ? local_error->message : "Unknown error");
+			g_clear_error (&local_error);
+		}
+	}
+
+	g_mutex_unlock (&scheduler_lock);
+}
+
 static gint
 mail_msg_compare (const MailMsg *msg1,
                   const MailMsg *msg2)
@@ -409,21 +728,6 @@ mail_msg_compare (const MailMsg *msg1,
 	return (priority1 < priority2) ? 1 : -1;
 }
 
-static gpointer
-create_thread_pool (gpointer data)
-{
-	GThreadPool *thread_pool;
-	gint max_threads = GPOINTER_TO_INT (data);
-
-	/* once created, run forever */
-	thread_pool = g_thread_pool_new (
-		(GFunc) mail_msg_proxy, NULL, max_threads, FALSE, NULL);
-	g_thread_pool_set_sort_function (
-		thread_pool, (GCompareDataFunc) mail_msg_compare, NULL);
-
-	return thread_pool;
-}
-
 void
 mail_msg_main_loop_push (gpointer msg)
 {
@@ -443,31 +747,96 @@ mail_msg_main_loop_push (gpointer msg)
 void
 mail_msg_unordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
-
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (10));
-
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	scheduler_push (UNORDERED_QUEUE_NAME, msg);
 }
 
 void
 mail_msg_fast_ordered_push (gpointer msg)
 {
-	static GOnce once = G_ONCE_INIT;
+	scheduler_push (FAST_QUEUE_NAME, msg);
+}
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
+void
+mail_msg_slow_ordered_push (gpointer msg)
+{
+	scheduler_push (SLOW_QUEUE_NAME, msg);
+}
+
+/* Runs the messages pushed with the same queue_name one after another,
+ * in parallel with the other queues, thus also with the slow-ordered
+ * queue.  Use it only for operations, which do not need to be ordered
+ * with anything else; NULL means the slow-ordered queue. */
+void
+mail_msg_ordered_push (gpointer msg,
+                       const gchar *queue_name)
+{
+	if (!queue_name || !*queue_name ||
+	    g_strcmp0 (queue_name, UNORDERED_QUEUE_NAME) == 0)
+		queue_name = SLOW_QUEUE_NAME;
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+	scheduler_push (queue_name, msg);
 }
 
+/* Orders the message within the queue of the 'store'; the message
+ * should not touch any other store, nor need to be ordered with the
+ * slow-ordered queue. */
 void
-mail_msg_slow_ordered_push (gpointer msg)
+mail_msg_store_ordered_push (gpointer msg,
+                             CamelStore *store)
+{
+	mail_msg_ordered_push (msg, store ? camel_service_get_uid (CAMEL_SERVICE (store)) : NULL);
+}
+
+/* Free the returned GSList with g_slist_free_full (stats, mail_msg_queue_stats_free); */
+GSList *
+mail_msg_dup_queue_stats (void)
 {
-	static GOnce once = G_ONCE_INIT;
+	GSList *stats = NULL;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_mutex_lock (&scheduler_lock);
+
+	if (!scheduler_stats) {
+		g_mutex_unlock (&scheduler_lock);
+		return NULL;
+	}
+
+	g_hash_table_iter_init (&iter, scheduler_stats);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *name = key;
+		QueueStats *queue_stats = value;
+		MsgQueue *queue;
+		MailMsgQueueStats *stat;
+
+		queue = g_hash_table_lookup (scheduler_queues, name);
+
+		stat = g_slice_new0 (MailMsgQueueStats);
+		stat->name = g_strdup (name);
+		stat->n_queued = queue ? g_queue_get_length (&queue->items) : 0;
+		stat->n_running = queue ? queue->running : 0;
+		stat->n_processed = queue_stats->n_processed;
+		stat->wait_time_max = queue_stats->wait_time_max;
 
-	g_once (&once, (GThreadFunc) create_thread_pool, GINT_TO_POINTER (1));
+		if (queue_stats->n_processed + stat->n_running > 0)
+			stat->wait_time_avg = queue_stats->wait_time_total / (gint64) (queue_stats->n_processed + stat->n_running);
 
-	g_thread_pool_push ((GThreadPool *) once.retval, msg, NULL);
+		stats = g_slist_prepend (stats, stat);
+	}
+
+	g_mutex_unlock (&scheduler_lock);
+
+	return stats;
+}
+
+void
+mail_msg_queue_stats_free (MailMsgQueueStats *stats)
+{
+	if (stats) {
+		g_free (stats->name);
+		g_slice_free (MailMsgQueueStats, stats);
+	}
 }
 
 gboolean
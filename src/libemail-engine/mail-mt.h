@@ -46,6 +46,16 @@ struct _MailMsg {
 	GError *error;			/* up to the caller to use this */
 };
 
+/* Statistics of a single message queue, see mail_msg_dup_queue_stats() */
+typedef struct _MailMsgQueueStats {
+	gchar *name;
+	guint n_queued;			/* waiting to be run */
+	guint n_running;
+	guint64 n_processed;
+	gint64 wait_time_avg;		/* in microseconds */
+	gint64 wait_time_max;		/* in microseconds */
+} MailMsgQueueStats;
+
 struct _MailMsgInfo {
 	gsize size;
 	MailMsgDescFunc desc;
@@ -84,6 +94,14 @@ void mail_msg_main_loop_push (gpointer msg);
 void mail_msg_unordered_push (gpointer msg);
 void mail_msg_fast_ordered_push (gpointer msg);
 void mail_msg_slow_ordered_push (gpointer msg);
+void mail_msg_ordered_push (gpointer msg,
+			    const gchar *queue_name);
+void mail_msg_store_ordered_push (gpointer msg,
+				  CamelStore *store);
+
+/* queue statistics */
+GSList *mail_msg_dup_queue_stats (void);
+void mail_msg_queue_stats_free (MailMsgQueueStats *stats);
 
 /* Call a function in the GUI thread, wait for it to return, type is
  * the marshaller to use.  FIXME This thing is horrible, please put
@@ -16,6 +16,7 @@
 
 #include "e-mail-folder-tweaks.h"
 #include "e-mail-migrate.h"
+#include "e-mail-part-list-cache.h"
 #include "e-mail-ui-session.h"
 #include "em-event.h"
 #include "em-folder-tree-model.h"
@@ -35,6 +36,8 @@ struct _EMailBackendPrivate {
 	EMailSendAccountOverride *send_account_override;
 	EMailRemoteContent *remote_content;
 	EMailProperties *mail_properties;
+	GSettings *mail_settings;
+	GSettings *prefer_plain_settings;
 };
 
 enum {
@@ -694,6 +697,15 @@ mail_backend_rename_folder_state (EShell *shell,
 	mail_backend_rename_folder_cache_file ("et-header-", old_uri, new_uri);
 }
 
+static void
+mail_backend_parser_settings_changed_cb (GSettings *settings,
+                                         const gchar *key,
+                                         EMailBackend *backend)
+{
+	/* The cached messages had been parsed with the old settings. */
+	e_mail_part_list_cache_clear (e_mail_part_list_cache_get_default ());
+}
+
 static void
 mail_backend_folder_deleted_cb (MailFolderCache *folder_cache,
                                 CamelStore *store,
@@ -713,6 +725,9 @@ mail_backend_folder_deleted_cb (MailFolderCache *folder_cache,
 	const gchar *local_sent_folder_uri;
 	gchar *uri;
 
+	/* Do not keep parsed messages of the deleted folder. */
+	e_mail_part_list_cache_clear (e_mail_part_list_cache_get_default ());
+
 	/* Check whether the deleted folder was a designated Drafts or
 	 * Sent folder for any mail account, and if so revert the setting
 	 * to the equivalent local folder, which is always present. */
@@ -1221,6 +1236,7 @@ mail_backend_dispose (GObject *object)
 
 	if (self->priv->session != NULL) {
 		em_folder_tree_model_free_default ();
+		e_mail_part_list_cache_free_default ();
 
 		g_signal_handlers_disconnect_matched (
 			self->priv->session, G_SIGNAL_MATCH_DATA,
@@ -1230,6 +1246,16 @@ mail_backend_dispose (GObject *object)
 		g_clear_object (&self->priv->session);
 	}
 
+	if (self->priv->mail_settings) {
+		g_signal_handlers_disconnect_by_data (self->priv->mail_settings, object);
+		g_clear_object (&self->priv->mail_settings);
+	}
+
+	if (self->priv->prefer_plain_settings) {
+		g_signal_handlers_disconnect_by_data (self->priv->prefer_plain_settings, object);
+		g_clear_object (&self->priv->prefer_plain_settings);
+	}
+
 	/* There should be no unfinished jobs left. */
 	g_warn_if_fail (g_hash_table_size (self->priv->jobs) == 0);
 
@@ -1274,6 +1300,9 @@ mail_backend_remove_store (EMailSession *session,
 
 	model = em_folder_tree_model_get_default ();
 	em_folder_tree_model_remove_store (model, store);
+
+	/* Do not keep parsed messages of the removed account. */
+	e_mail_part_list_cache_clear (e_mail_part_list_cache_get_default ());
 }
 
 #define SET_ACTIVITY(cancellable, activity) \
@@ -1501,6 +1530,27 @@ mail_backend_constructed (GObject *object)
 		G_CALLBACK (mail_backend_folder_unread_updated_cb),
 		shell_backend);
 
+	/* Settings influencing how the messages are parsed. */
+	self->priv->mail_settings = e_util_ref_settings ("org.gnome.evolution.mail");
+
+	g_signal_connect (
+		self->priv->mail_settings, "changed::display-content-disposition-inline",
+		G_CALLBACK (mail_backend_parser_settings_changed_cb), shell_backend);
+
+	g_signal_connect (
+		self->priv->mail_settings, "changed::display-delivery-notification-inline",
+		G_CALLBACK (mail_backend_parser_settings_changed_cb), shell_backend);
+
+	g_signal_connect (
+		self->priv->mail_settings, "changed::html-link-to-text",
+		G_CALLBACK (mail_backend_parser_settings_changed_cb), shell_backend);
+
+	self->priv->prefer_plain_settings = e_util_ref_settings ("org.gnome.evolution.plugin.prefer-plain");
+
+	g_signal_connect (
+		self->priv->prefer_plain_settings, "changed",
+		G_CALLBACK (mail_backend_parser_settings_changed_cb), shell_backend);
+
 	mail_config_init (self->priv->session);
 
 	mail_msg_register_activities (
@@ -0,0 +1,379 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "evolution-config.h"
+
+#include "e-mail-part-list-cache.h"
+
+/* At most this many parsed messages are kept... */
+#define PART_LIST_CACHE_MAX_ITEMS 50
+
+/* ...and at most this many bytes of them, as estimated by the callers */
+#define PART_LIST_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+/* Parse jobs run in few threads only, they should not slow down the UI */
+#define PART_LIST_CACHE_MAX_PARSE_THREADS 2
+
+typedef struct _CacheItem {
+	gchar *mail_uri;
+	EMailPartList *part_list;
+	gsize size;
+	GList *lru_link; /* in EMailPartListCache::lru */
+} CacheItem;
+
+typedef struct _ParseJob {
+	EMailPartListCacheParseFunc func;
+	gpointer user_data;
+} ParseJob;
+
+struct _EMailPartListCache {
+	GMutex lock;
+	GHashTable *items;	/* gchar *mail_uri ~> CacheItem * */
+	GQueue lru;		/* CacheItem *; most recently used first */
+	gsize size;
+
+	guint64 n_hits;
+	guint64 n_misses;
+
+	GThreadPool *parse_pool;
+};
+
+G_LOCK_DEFINE_STATIC (default_cache);
+static EMailPartListCache *default_cache = NULL;
+
+static void
+cache_item_free (gpointer ptr)
+{
+	CacheItem *item = ptr;
+
+	if (item) {
+		g_free (item->mail_uri);
+		g_clear_object (&item->part_list);
+		g_slice_free (CacheItem, item);
+	}
+}
+
+static void
+part_list_cache_remove_locked (EMailPartListCache *cache,
+			       CacheItem *item)
+{
+	g_queue_delete_link (&cache->lru, item->lru_link);
+	cache->size -= item->size;
+
+	/* This frees the item */
+	g_hash_table_remove (cache->items, item->mail_uri);
+}
+
+static void
+part_list_cache_prune_locked (EMailPartListCache *cache)
+{
+	while (g_queue_get_length (&cache->lru) > PART_LIST_CACHE_MAX_ITEMS ||
+	       (cache->size > PART_LIST_CACHE_MAX_SIZE && g_queue_get_length (&cache->lru) > 1)) {
+		part_list_cache_remove_locked (cache, g_queue_peek_tail (&cache->lru));
+	}
+}
+
+/* The part list can be removed from the registry, to be parsed again */
+static gboolean
+part_list_cache_item_is_valid (CacheItem *item)
+{
+	EMailPartList *registered;
+	gboolean valid;
+
+	registered = camel_object_bag_peek (e_mail_part_list_get_registry (), item->mail_uri);
+	valid = registered == item->part_list;
+	g_clear_object (&registered);
+
+	return valid;
+}
+
+static void
+part_list_cache_parse_thread (gpointer data,
+			      gpointer user_data)
+{
+	ParseJob *job = data;
+	EMailPartListCache *cache = user_data;
+
+	job->func (cache, job->user_data);
+
+	g_slice_free (ParseJob, job);
+}
+
+/**
+ * e_mail_part_list_cache_get_default:
+ *
+ * Returns the process-wide #EMailPartListCache. It's freed
+ * with e_mail_part_list_cache_free_default().
+ *
+ * Returns: (transfer none): the default #EMailPartListCache
+ *
+ * Since: 3.62
+ **/
+EMailPartListCache *
+e_mail_part_list_cache_get_default (void)
+{
+	EMailPartListCache *cache;
+
+	G_LOCK (default_cache);
+
+	if (!default_cache) {
+		cache = g_new0 (EMailPartListCache, 1);
+		g_mutex_init (&cache->lock);
+		cache->items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, cache_item_free);
+		g_queue_init (&cache->lru);
+		cache->parse_pool = g_thread_pool_new (part_list_cache_parse_thread, cache,
+			PART_LIST_CACHE_MAX_PARSE_THREADS, FALSE, NULL);
+
+		default_cache = cache;
+	}
+
+	cache = default_cache;
+
+	G_UNLOCK (default_cache);
+
+	return cache;
+}
+
+/**
+ * e_mail_part_list_cache_free_default:
+ *
+ * Frees the process-wide #EMailPartListCache, if it exists, after
+ * the parse jobs queued with e_mail_part_list_cache_push_parse_job()
+ * have finished.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_part_list_cache_free_default (void)
+{
+	EMailPartListCache *cache;
+
+	G_LOCK (default_cache);
+	cache = default_cache;
+	default_cache = NULL;
+	G_UNLOCK (default_cache);
+
+	if (!cache)
+		return;
+
+	/* The jobs use the cache they are given, not the default one */
+	g_thread_pool_free (cache->parse_pool, FALSE, TRUE);
+
+	g_queue_clear (&cache->lru);
+	g_hash_table_destroy (cache->items);
+	g_mutex_clear (&cache->lock);
+	g_free (cache);
+}
+
+/**
+ * e_mail_part_list_cache_push_parse_job:
+ * @cache: an #EMailPartListCache
+ * @func: (scope async): a function to call in a dedicated thread
+ * @user_data: user data for the @func
+ *
+ * Queues the @func to be called in one of the few threads of the @cache,
+ * meant for parsing messages in advance. The @func is responsible to free
+ * the @user_data. It's called even when the @cache is being freed, thus
+ * it should return early when the work is no longer needed.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_part_list_cache_push_parse_job (EMailPartListCache *cache,
+				       EMailPartListCacheParseFunc func,
+				       gpointer user_data)
+{
+	ParseJob *job;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (func != NULL);
+
+	job = g_slice_new (ParseJob);
+	job->func = func;
+	job->user_data = user_data;
+
+	g_thread_pool_push (cache->parse_pool, job, NULL);
+}
+
+/**
+ * e_mail_part_list_cache_add:
+ * @cache: an #EMailPartListCache
+ * @mail_uri: a mail URI, as built by e_mail_part_build_uri()
+ * @part_list: an #EMailPartList to remember
+ * @size: estimated size of the @part_list, in bytes
+ *
+ * Remembers the @part_list as the most recently used one, dropping
+ * the least recently used part lists when the cache is over its limits.
+ * The @part_list should be stored in the part list registry under
+ * the @mail_uri.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_part_list_cache_add (EMailPartListCache *cache,
+			    const gchar *mail_uri,
+			    EMailPartList *part_list,
+			    gsize size)
+{
+	CacheItem *item;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (mail_uri != NULL);
+	g_return_if_fail (E_IS_MAIL_PART_LIST (part_list));
+
+	g_mutex_lock (&cache->lock);
+
+	item = g_hash_table_lookup (cache->items, mail_uri);
+	if (item)
+		part_list_cache_remove_locked (cache, item);
+
+	item = g_slice_new0 (CacheItem);
+	item->mail_uri = g_strdup (mail_uri);
+	item->part_list = g_object_ref (part_list);
+	item->size = size;
+
+	g_queue_push_head (&cache->lru, item);
+	item->lru_link = g_queue_peek_head_link (&cache->lru);
+
+	g_hash_table_insert (cache->items, item->mail_uri, item);
+	cache->size += size;
+
+	part_list_cache_prune_locked (cache);
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * e_mail_part_list_cache_ref:
+ * @cache: an #EMailPartListCache
+ * @mail_uri: a mail URI, as built by e_mail_part_build_uri()
+ *
+ * Looks up the part list for the @mail_uri and marks it as the most
+ * recently used. The lookup is counted into the cache statistics.
+ *
+ * Returns: (transfer full) (nullable): an #EMailPartList for the @mail_uri,
+ *    or %NULL, when not cached. Free it with g_object_unref(), when
+ *    no longer needed.
+ *
+ * Since: 3.62
+ **/
+EMailPartList *
+e_mail_part_list_cache_ref (EMailPartListCache *cache,
+			    const gchar *mail_uri)
+{
+	EMailPartList *part_list = NULL;
+	CacheItem *item;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (mail_uri != NULL, NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	item = g_hash_table_lookup (cache->items, mail_uri);
+	if (item && !part_list_cache_item_is_valid (item)) {
+		part_list_cache_remove_locked (cache, item);
+		item = NULL;
+	}
+
+	if (item) {
+		g_queue_unlink (&cache->lru, item->lru_link);
+		g_queue_push_head_link (&cache->lru, item->lru_link);
+
+		part_list = g_object_ref (item->part_list);
+		cache->n_hits++;
+	} else {
+		cache->n_misses++;
+	}
+
+	g_mutex_unlock (&cache->lock);
+
+	return part_list;
+}
+
+/**
+ * e_mail_part_list_cache_contains:
+ * @cache: an #EMailPartListCache
+ * @mail_uri: a mail URI, as built by e_mail_part_build_uri()
+ *
+ * Checks whether the part list for the @mail_uri is cached, without
+ * influencing the order of the items or the statistics.
+ *
+ * Returns: whether the @mail_uri is cached
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_part_list_cache_contains (EMailPartListCache *cache,
+				 const gchar *mail_uri)
+{
+	gboolean contains;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+	g_return_val_if_fail (mail_uri != NULL, FALSE);
+
+	g_mutex_lock (&cache->lock);
+	contains = g_hash_table_contains (cache->items, mail_uri);
+	g_mutex_unlock (&cache->lock);
+
+	return contains;
+}
+
+/**
+ * e_mail_part_list_cache_clear:
+ * @cache: an #EMailPartListCache
+ *
+ * Drops all the cached part lists. The statistics are preserved.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_part_list_cache_clear (EMailPartListCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	g_queue_clear (&cache->lru);
+	g_hash_table_remove_all (cache->items);
+	cache->size = 0;
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * e_mail_part_list_cache_get_stats:
+ * @cache: an #EMailPartListCache
+ * @out_hits: (out) (optional): return location for the number of hits, or %NULL
+ * @out_misses: (out) (optional): return location for the number of misses, or %NULL
+ * @out_n_items: (out) (optional): return location for the number of cached part lists, or %NULL
+ * @out_size: (out) (optional): return location for the estimated cached size, or %NULL
+ *
+ * Returns the statistics of the e_mail_part_list_cache_ref() calls and
+ * the current usage of the @cache.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_part_list_cache_get_stats (EMailPartListCache *cache,
+				  guint64 *out_hits,
+				  guint64 *out_misses,
+				  guint *out_n_items,
+				  gsize *out_size)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	if (out_hits)
+		*out_hits = cache->n_hits;
+	if (out_misses)
+		*out_misses = cache->n_misses;
+	if (out_n_items)
+		*out_n_items = g_queue_get_length (&cache->lru);
+	if (out_size)
+		*out_size = cache->size;
+
+	g_mutex_unlock (&cache->lock);
+}
@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#ifndef E_MAIL_PART_LIST_CACHE_H
+#define E_MAIL_PART_LIST_CACHE_H
+
+#include <em-format/e-mail-part-list.h>
+
+G_BEGIN_DECLS
+
+/**
+ * EMailPartListCache:
+ *
+ * A bounded, most-recently-used cache of parsed messages, which keeps
+ * the #EMailPartList-s alive, thus also in the part list registry,
+ * after no #EMailDisplay shows them. All functions are thread-safe.
+ *
+ * Since: 3.62
+ **/
+typedef struct _EMailPartListCache EMailPartListCache;
+
+/**
+ * EMailPartListCacheParseFunc:
+ * @cache: an #EMailPartListCache
+ * @user_data: user data passed to e_mail_part_list_cache_push_parse_job()
+ *
+ * A function called in a dedicated thread of the @cache.
+ *
+ * Since: 3.62
+ **/
+typedef void	(*EMailPartListCacheParseFunc)	(EMailPartListCache *cache,
+						 gpointer user_data);
+
+EMailPartListCache *
+		e_mail_part_list_cache_get_default
+						(void);
+void		e_mail_part_list_cache_free_default
+						(void);
+void		e_mail_part_list_cache_push_parse_job
+						(EMailPartListCache *cache,
+						 EMailPartListCacheParseFunc func,
+						 gpointer user_data);
+void		e_mail_part_list_cache_add	(EMailPartListCache *cache,
+						 const gchar *mail_uri,
+						 EMailPartList *part_list,
+						 gsize size);
+EMailPartList *	e_mail_part_list_cache_ref	(EMailPartListCache *cache,
+						 const gchar *mail_uri);
+gboolean	e_mail_part_list_cache_contains	(EMailPartListCache *cache,
+						 const gchar *mail_uri);
+void		e_mail_part_list_cache_clear	(EMailPartListCache *cache);
+void		e_mail_part_list_cache_get_stats
+						(EMailPartListCache *cache,
+						 guint64 *out_hits,
+						 guint64 *out_misses,
+						 guint *out_n_items,
+						 gsize *out_size);
+
+G_END_DECLS
+
+#endif /* E_MAIL_PART_LIST_CACHE_H */
@@ -24,6 +24,7 @@
 #include "e-mail-label-dialog.h"
 #include "e-mail-label-list-store.h"
 #include "e-mail-notes.h"
+#include "e-mail-part-list-cache.h"
 #include "e-mail-reader-utils.h"
 #include "e-mail-remote-content-popover.h"
 #include "e-mail-ui-session.h"
@@ -87,6 +88,10 @@ struct _EMailReaderPrivate {
 
 	GSList *ongoing_operations; /* GCancellable * */
 
+	/* Prefetch of the messages around the shown message */
+	guint prefetch_timeout_id;
+	GCancellable *prefetching;
+
 	GMenuModel *reply_group_menu;
 	GMenuModel *forward_as_menu;
 	GMenu *labels_menu;
@@ -139,6 +144,14 @@ mail_reader_private_free (EMailReaderPrivate *priv)
 		priv->retrieving_message = NULL;
 	}
 
+	if (priv->prefetch_timeout_id > 0)
+		g_source_remove (priv->prefetch_timeout_id);
+
+	if (priv->prefetching) {
+		g_cancellable_cancel (priv->prefetching);
+		g_clear_object (&priv->prefetching);
+	}
+
 	g_clear_object (&priv->reply_group_menu);
 	g_clear_object (&priv->forward_as_menu);
 	g_clear_object (&priv->labels_menu);
@@ -4175,6 +4188,324 @@ mail_reader_reload (EMailReader *reader)
 	e_mail_display_reload (mail_display);
 }
 
+/* How many messages around the shown message can be prefetched at most */
+#define PREFETCH_MAX_MESSAGES 10
+
+/* How long to wait after the message is shown before prefetching */
+#define PREFETCH_DELAY_MS 250
+
+/* Mail URI-s being prefetched, to not prefetch them twice */
+static GHashTable *prefetching_uris = NULL;
+G_LOCK_DEFINE_STATIC (prefetching_uris);
+
+typedef struct _PrefetchData {
+	EMailSession *session;
+	CamelFolder *folder;
+	gchar *message_uid;
+	gchar *mail_uri;
+	CamelMimeMessage *message;
+	GCancellable *cancellable;
+} PrefetchData;
+
+static void
+prefetch_data_free (PrefetchData *pd)
+{
+	if (pd) {
+		G_LOCK (prefetching_uris);
+		g_hash_table_remove (prefetching_uris, pd->mail_uri);
+		G_UNLOCK (prefetching_uris);
+
+		g_clear_object (&pd->session);
+		g_clear_object (&pd->folder);
+		g_clear_object (&pd->message);
+		g_clear_object (&pd->cancellable);
+		g_free (pd->message_uid);
+		g_free (pd->mail_uri);
+		g_slice_free (PrefetchData, pd);
+	}
+}
+
+/* The parsed message holds the message itself and its decoded parts */
+static gsize
+mail_reader_estimate_part_list_size (CamelFolder *folder,
+				     const gchar *message_uid)
+{
+	CamelMessageInfo *mi;
+	gsize size = 0;
+
+	mi = folder ? camel_folder_get_message_info (folder, message_uid) : NULL;
+	if (mi) {
+		size = 2 * camel_message_info_get_size (mi);
+		g_object_unref (mi);
+	}
+
+	return size > 0 ? size : 64 * 1024;
+}
+
+/* Adds the part list into the EMailPartListCache, when it's also in the registry */
+static void
+mail_reader_remember_part_list (EMailPartList *part_list)
+{
+	EMailPartList *registered;
+	CamelFolder *folder;
+	const gchar *message_uid;
+	gchar *mail_uri;
+
+	folder = e_mail_part_list_get_folder (part_list);
+	message_uid = e_mail_part_list_get_message_uid (part_list);
+
+	if (!folder || !message_uid)
+		return;
+
+	mail_uri = e_mail_part_build_uri (folder, message_uid, NULL, NULL);
+	registered = camel_object_bag_peek (e_mail_part_list_get_registry (), mail_uri);
+
+	if (registered == part_list) {
+		e_mail_part_list_cache_add (e_mail_part_list_cache_get_default (), mail_uri, part_list,
+			mail_reader_estimate_part_list_size (folder, message_uid));
+	}
+
+	g_clear_object (&registered);
+	g_free (mail_uri);
+}
+
+static EMailPartList *
+mail_reader_ref_cached_part_list (CamelFolder *folder,
+				  const gchar *message_uid)
+{
+	EMailPartListCache *cache;
+	EMailPartList *part_list;
+	gchar *mail_uri;
+
+	if (!folder || !message_uid)
+		return NULL;
+
+	cache = e_mail_part_list_cache_get_default ();
+
+	mail_uri = e_mail_part_build_uri (folder, message_uid, NULL, NULL);
+	part_list = e_mail_part_list_cache_ref (cache, mail_uri);
+	g_free (mail_uri);
+
+	if (camel_debug ("mail:prefetch")) {
+		guint64 hits = 0, misses = 0;
+		guint n_items = 0;
+		gsize size = 0;
+
+		e_mail_part_list_cache_get_stats (cache, &hits, &misses, &n_items, &size);
+
+		printf ("%s: %s message '%s'; hits:%" G_GUINT64_FORMAT " misses:%" G_GUINT64_FORMAT " hit rate:%.1f%% items:%u size:%" G_GSIZE_FORMAT "\n",
+			G_STRFUNC, part_list ? "cached" : "not cached", message_uid, hits, misses,
+			hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0, n_items, size);
+	}
+
+	return part_list;
+}
+
+static gboolean
+mail_reader_has_cached_part_list (EMailReader *reader,
+				  const gchar *message_uid)
+{
+	CamelFolder *folder;
+	gboolean has;
+
+	if (!message_uid)
+		return FALSE;
+
+	folder = e_mail_reader_ref_folder (reader);
+
+	if (folder) {
+		gchar *mail_uri;
+
+		mail_uri = e_mail_part_build_uri (folder, message_uid, NULL, NULL);
+		has = e_mail_part_list_cache_contains (e_mail_part_list_cache_get_default (), mail_uri);
+		g_free (mail_uri);
+	} else {
+		has = FALSE;
+	}
+
+	g_clear_object (&folder);
+
+	return has;
+}
+
+static void
+mail_reader_prefetch_parse_thread (EMailPartListCache *cache,
+				   gpointer user_data)
+{
+	PrefetchData *pd = user_data;
+	CamelObjectBag *registry;
+	EMailPartList *part_list;
+
+	if (g_cancellable_is_cancelled (pd->cancellable)) {
+		prefetch_data_free (pd);
+		return;
+	}
+
+	registry = e_mail_part_list_get_registry ();
+
+	/* Returns an existing part list, when the message had been parsed meanwhile */
+	part_list = camel_object_bag_reserve (registry, pd->mail_uri);
+
+	if (!part_list) {
+		EMailParser *parser;
+
+		parser = e_mail_parser_new (CAMEL_SESSION (pd->session));
+		part_list = e_mail_parser_parse_sync (parser, pd->folder, pd->message_uid, pd->message, pd->cancellable);
+		g_object_unref (parser);
+
+		/* Do not store partially parsed messages */
+		if (part_list && !g_cancellable_is_cancelled (pd->cancellable)) {
+			camel_object_bag_add (registry, pd->mail_uri, part_list);
+		} else {
+			camel_object_bag_abort (registry, pd->mail_uri);
+			g_clear_object (&part_list);
+		}
+	}
+
+	if (part_list) {
+		e_mail_part_list_cache_add (cache, pd->mail_uri, part_list,
+			mail_reader_estimate_part_list_size (pd->folder, pd->message_uid));
+		g_object_unref (part_list);
+	}
+
+	prefetch_data_free (pd);
+}
+
+static void
+mail_reader_prefetch_message_got_cb (GObject *source_object,
+				     GAsyncResult *result,
+				     gpointer user_data)
+{
+	PrefetchData *pd = user_data;
+
+	pd->message = camel_folder_get_message_finish (CAMEL_FOLDER (source_object), result, NULL);
+
+	if (!pd->message || g_cancellable_is_cancelled (pd->cancellable)) {
+		prefetch_data_free (pd);
+		return;
+	}
+
+	e_mail_part_list_cache_push_parse_job (e_mail_part_list_cache_get_default (),
+		mail_reader_prefetch_parse_thread, pd);
+}
+
+static gboolean
+mail_reader_prefetch_timeout_cb (gpointer user_data)
+{
+	EMailReader *reader = user_data;
+	EMailReaderPrivate *priv;
+	EMailPartListCache *cache;
+	EMailSession *session;
+	EMailDisplay *display;
+	GtkWidget *message_list;
+	CamelFolder *folder;
+	GSettings *settings;
+	GPtrArray *uids;
+	gint n_around;
+	guint ii;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+	priv->prefetch_timeout_id = 0;
+
+	settings = e_util_ref_settings ("org.gnome.evolution.mail");
+	n_around = g_settings_get_int (settings, "prefetch-message-count");
+	g_object_unref (settings);
+
+	display = e_mail_reader_get_mail_display (reader);
+	message_list = e_mail_reader_get_message_list (reader);
+
+	/* The source mode does not store the part lists */
+	if (n_around <= 0 || !display || !message_list ||
+	    e_mail_display_get_mode (display) == E_MAIL_FORMATTER_MODE_SOURCE)
+		return FALSE;
+
+	folder = e_mail_reader_ref_folder (reader);
+	if (!folder)
+		return FALSE;
+
+	if (!priv->prefetching)
+		priv->prefetching = g_cancellable_new ();
+
+	cache = e_mail_part_list_cache_get_default ();
+	session = e_mail_backend_get_session (e_mail_reader_get_backend (reader));
+	uids = message_list_dup_neighbour_uids (MESSAGE_LIST (message_list), MIN (n_around, PREFETCH_MAX_MESSAGES));
+
+	G_LOCK (prefetching_uris);
+
+	if (!prefetching_uris)
+		prefetching_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		const gchar *uid = g_ptr_array_index (uids, ii);
+		PrefetchData *pd;
+		gchar *mail_uri;
+
+		mail_uri = e_mail_part_build_uri (folder, uid, NULL, NULL);
+
+		if (g_hash_table_contains (prefetching_uris, mail_uri) ||
+		    e_mail_part_list_cache_contains (cache, mail_uri)) {
+			g_free (mail_uri);
+			continue;
+		}
+
+		g_hash_table_add (prefetching_uris, g_strdup (mail_uri));
+
+		pd = g_slice_new0 (PrefetchData);
+		pd->session = g_object_ref (session);
+		pd->folder = g_object_ref (folder);
+		pd->message_uid = g_strdup (uid);
+		pd->mail_uri = mail_uri;
+		pd->cancellable = g_object_ref (priv->prefetching);
+
+		camel_folder_get_message (folder, uid, G_PRIORITY_LOW, pd->cancellable,
+			mail_reader_prefetch_message_got_cb, pd);
+	}
+
+	G_UNLOCK (prefetching_uris);
+
+	g_ptr_array_unref (uids);
+	g_object_unref (folder);
+
+	return FALSE;
+}
+
+static void
+mail_reader_schedule_prefetch (EMailReader *reader)
+{
+	EMailReaderPrivate *priv;
+
+	priv = E_MAIL_READER_GET_PRIVATE (reader);
+
+	if (priv->prefetch_timeout_id > 0)
+		g_source_remove (priv->prefetch_timeout_id);
+
+	priv->prefetch_timeout_id = e_named_timeout_add (
+		PREFETCH_DELAY_MS, mail_reader_prefetch_timeout_cb, reader);
+}
+
+static void
+mail_reader_message_ready (EMailReader *reader,
+			   CamelFolder *folder,
+			   const gchar *message_uid,
+			   CamelMimeMessage *message)
+{
+	CamelMessageInfo *mi;
+
+	mail_reader_manage_followup_flag (reader, folder, message_uid);
+
+	mi = camel_folder_get_message_info (folder, message_uid);
+	if (mi) {
+		if (camel_util_fill_message_info_user_headers (mi, camel_medium_get_headers (CAMEL_MEDIUM (message))))
+			gtk_widget_queue_draw (e_mail_reader_get_message_list (reader));
+
+		g_object_unref (mi);
+	}
+
+	g_signal_emit (
+		reader, signals[MESSAGE_LOADED], 0,
+		message_uid, message);
+}
+
 static void
 mail_reader_message_loaded_cb (CamelFolder *folder,
                                GAsyncResult *result,
@@ -4218,23 +4549,8 @@ mail_reader_message_loaded_cb (CamelFolder *folder,
 		goto exit;
 	}
 
-	if (message != NULL) {
-		CamelMessageInfo *mi;
-
-		mail_reader_manage_followup_flag (reader, folder, message_uid);
-
-		mi = camel_folder_get_message_info (folder, message_uid);
-		if (mi) {
-			if (camel_util_fill_message_info_user_headers (mi, camel_medium_get_headers (CAMEL_MEDIUM (message))))
-				gtk_widget_queue_draw (message_list);
-
-			g_object_unref (mi);
-		}
-
-		g_signal_emit (
-			reader, signals[MESSAGE_LOADED], 0,
-			message_uid, message);
-	}
+	if (message != NULL)
+		mail_reader_message_ready (reader, folder, message_uid, message);
 
 exit:
 	if (error != NULL) {
@@ -4302,11 +4618,30 @@ mail_reader_message_selected_timeout_cb (gpointer user_data)
 
 		if (display_visible && selected_uid_changed) {
 			EMailReaderClosure *closure;
+			EMailPartList *cached_parts;
 			GCancellable *cancellable;
 			CamelFolder *folder;
 			EActivity *activity;
 			gchar *string;
 
+			folder = e_mail_reader_ref_folder (reader);
+
+			/* Prefetched or recently shown, no need to retrieve it */
+			cached_parts = mail_reader_ref_cached_part_list (folder, cursor_uid);
+			if (cached_parts && e_mail_part_list_get_message (cached_parts)) {
+				mail_reader_message_ready (reader, folder, cursor_uid,
+					e_mail_part_list_get_message (cached_parts));
+
+				g_object_unref (cached_parts);
+				g_clear_object (&folder);
+
+				priv->message_selected_timeout_id = 0;
+
+				return FALSE;
+			}
+
+			g_clear_object (&cached_parts);
+
 			string = g_strdup_printf (
 				_("Retrieving message “%s”"), cursor_uid);
 			e_mail_display_set_part_list (display, NULL);
@@ -4322,8 +4657,6 @@ mail_reader_message_selected_timeout_cb (gpointer user_data)
 			closure->reader = g_object_ref (reader);
 			closure->message_uid = g_strdup (cursor_uid);
 
-			folder = e_mail_reader_ref_folder (reader);
-
 			camel_folder_get_message (
 				folder, cursor_uid, G_PRIORITY_DEFAULT,
 				cancellable, (GAsyncReadyCallback)
@@ -4409,6 +4742,10 @@ mail_reader_message_selected_cb (EMailReader *reader,
 		 * rapidly through the message list. */
 		mail_reader_message_selected_timeout_cb (reader);
 
+	} else if (mail_reader_has_cached_part_list (reader, message_list->cursor_uid)) {
+		/* No retrieval is needed, thus no need to wait */
+		mail_reader_message_selected_timeout_cb (reader);
+
 	} else {
 		priv->message_selected_timeout_id = e_named_timeout_add (
 			100, mail_reader_message_selected_timeout_cb, reader);
@@ -4553,6 +4890,11 @@ mail_reader_set_folder (EMailReader *reader,
 	if (folder != previous_folder) {
 		e_web_view_clear (E_WEB_VIEW (display));
 
+		if (priv->prefetching) {
+			g_cancellable_cancel (priv->prefetching);
+			g_clear_object (&priv->prefetching);
+		}
+
 		priv->folder_was_just_selected = (folder != NULL) && !priv->mark_seen_always;
 		priv->did_try_to_open_message = FALSE;
 
@@ -4622,11 +4964,15 @@ set_mail_display_part_list (GObject *object,
 	e_mail_display_set_part_list (display, part_list);
 	e_mail_display_load (display, NULL);
 
+	mail_reader_remember_part_list (part_list);
+
 	/* Remove the reference added when parts list was
-	 * created, so that only owners are EMailDisplays. */
+	 * created, so that only owners are EMailDisplays
+	 * and the EMailPartListCache. */
 	g_object_unref (part_list);
 
 	mail_reader_emit_udpate_actions (reader);
+	mail_reader_schedule_prefetch (reader);
 }
 
 static void
@@ -4661,6 +5007,7 @@ mail_reader_set_display_formatter_for_message (EMailReader *reader,
 		g_object_unref (parts);
 
 		mail_reader_emit_udpate_actions (reader);
+		mail_reader_schedule_prefetch (reader);
 	}
 }
 
@@ -6004,6 +6351,16 @@ e_mail_reader_dispose (EMailReader *reader)
 	if (priv->retrieving_message)
 		g_cancellable_cancel (priv->retrieving_message);
 
+	if (priv->prefetch_timeout_id > 0) {
+		g_source_remove (priv->prefetch_timeout_id);
+		priv->prefetch_timeout_id = 0;
+	}
+
+	if (priv->prefetching) {
+		g_cancellable_cancel (priv->prefetching);
+		g_clear_object (&priv->prefetching);
+	}
+
 	ongoing_operations = g_slist_copy_deep (priv->ongoing_operations, (GCopyFunc) g_object_ref, NULL);
 	g_slist_free (priv->ongoing_operations);
 	priv->ongoing_operations = NULL;
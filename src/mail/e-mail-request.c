@@ -80,6 +80,301 @@ save_gicon_to_stream (GIcon *icon,
 	g_object_unref (icon_info);
 }
 
+/* The formatted output of the mail: requests is remembered, thus showing
+   the same message again (reloads, zoom changes, switching back to it)
+   does not run the EMailFormatter again. It is used only in the main
+   thread, where the requests are processed. The output is not stored
+   on disk, because it can contain decrypted content. */
+
+#define FORMATTED_CACHE_MAX_ITEMS 500
+#define FORMATTED_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+/* In seconds; the formatters can show things depending on the time, like dates */
+#define FORMATTED_CACHE_MAX_AGE (15 * 60)
+
+typedef struct _FormattedData {
+	gchar *key;
+	GWeakRef part_list;
+	GBytes *bytes;
+	gchar *mime_type;
+	GPtrArray *attachments; /* EAttachment *, claimed by the formatter */
+	gint64 created; /* g_get_monotonic_time() */
+	GList *lru_link; /* in FormattedCache::lru */
+} FormattedData;
+
+typedef struct _FormattedCache {
+	GHashTable *items; /* gchar *key ~> FormattedData * */
+	GQueue lru; /* FormattedData *; most recently used first */
+	gsize size;
+	GSettings *settings;
+} FormattedCache;
+
+static void
+formatted_data_free (gpointer ptr)
+{
+	FormattedData *fd = ptr;
+
+	if (fd) {
+		g_free (fd->key);
+		g_weak_ref_clear (&fd->part_list);
+		g_bytes_unref (fd->bytes);
+		g_free (fd->mime_type);
+		g_ptr_array_unref (fd->attachments);
+		g_slice_free (FormattedData, fd);
+	}
+}
+
+static void
+formatted_cache_remove (FormattedCache *cache,
+			FormattedData *fd)
+{
+	g_queue_delete_link (&cache->lru, fd->lru_link);
+	cache->size -= g_bytes_get_size (fd->bytes);
+
+	/* This frees the 'fd' */
+	g_hash_table_remove (cache->items, fd->key);
+}
+
+static void
+formatted_cache_clear (FormattedCache *cache)
+{
+	g_queue_clear (&cache->lru);
+	g_hash_table_remove_all (cache->items);
+	cache->size = 0;
+}
+
+static void
+formatted_cache_settings_changed_cb (GSettings *settings,
+				     const gchar *key,
+				     gpointer user_data)
+{
+	FormattedCache *cache = user_data;
+
+	/* Not every setting is reflected in the formatter properties */
+	formatted_cache_clear (cache);
+}
+
+static FormattedCache *
+formatted_cache_get (void)
+{
+	static FormattedCache *cache = NULL;
+
+	if (!cache) {
+		cache = g_new0 (FormattedCache, 1);
+		cache->items = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, formatted_data_free);
+		g_queue_init (&cache->lru);
+		cache->settings = e_util_ref_settings ("org.gnome.evolution.mail");
+
+		g_signal_connect (cache->settings, "changed",
+			G_CALLBACK (formatted_cache_settings_changed_cb), cache);
+	}
+
+	return cache;
+}
+
+static FormattedData *
+formatted_cache_lookup (FormattedCache *cache,
+			const gchar *key,
+			EMailPartList *part_list)
+{
+	FormattedData *fd;
+	EMailPartList *cached_part_list;
+
+	fd = g_hash_table_lookup (cache->items, key);
+	if (!fd)
+		return NULL;
+
+	/* The message can be parsed again, with a different result */
+	cached_part_list = g_weak_ref_get (&fd->part_list);
+
+	if (cached_part_list != part_list ||
+	    g_get_monotonic_time () - fd->created > FORMATTED_CACHE_MAX_AGE * G_USEC_PER_SEC) {
+		formatted_cache_remove (cache, fd);
+		fd = NULL;
+	} else {
+		g_queue_unlink (&cache->lru, fd->lru_link);
+		g_queue_push_head_link (&cache->lru, fd->lru_link);
+	}
+
+	g_clear_object (&cached_part_list);
+
+	return fd;
+}
+
+static void
+formatted_cache_add (FormattedCache *cache,
+		     const gchar *key,
+		     EMailPartList *part_list,
+		     GBytes *bytes,
+		     const gchar *mime_type,
+		     GPtrArray *attachments)
+{
+	FormattedData *fd;
+
+	if (g_bytes_get_size (bytes) > FORMATTED_CACHE_MAX_SIZE / 4)
+		return;
+
+	fd = g_hash_table_lookup (cache->items, key);
+	if (fd)
+		formatted_cache_remove (cache, fd);
+
+	fd = g_slice_new0 (FormattedData);
+	fd->key = g_strdup (key);
+	g_weak_ref_init (&fd->part_list, part_list);
+	fd->bytes = g_bytes_ref (bytes);
+	fd->mime_type = g_strdup (mime_type);
+	fd->attachments = g_ptr_array_ref (attachments);
+	fd->created = g_get_monotonic_time ();
+
+	g_queue_push_head (&cache->lru, fd);
+	fd->lru_link = g_queue_peek_head_link (&cache->lru);
+
+	g_hash_table_insert (cache->items, fd->key, fd);
+	cache->size += g_bytes_get_size (bytes);
+
+	while (g_queue_get_length (&cache->lru) > FORMATTED_CACHE_MAX_ITEMS ||
+	       cache->size > FORMATTED_CACHE_MAX_SIZE) {
+		formatted_cache_remove (cache, g_queue_peek_tail (&cache->lru));
+	}
+}
+
+/* The calendar formatter changes its part while formatting, thus
+   it cannot be skipped; similar for the messages containing it. */
+static gboolean
+mail_request_can_cache_part_list (EMailPartList *part_list)
+{
+	GQueue queue = G_QUEUE_INIT;
+	gboolean can_cache = TRUE;
+
+	e_mail_part_list_queue_parts (part_list, NULL, &queue);
+
+	while (!g_queue_is_empty (&queue)) {
+		EMailPart *part = g_queue_pop_head (&queue);
+		const gchar *mime_type = e_mail_part_get_mime_type (part);
+
+		if (can_cache && (e_mail_part_id_has_substr (part, ".itip") ||
+		    (mime_type && (
+		    g_ascii_strcasecmp (mime_type, "text/calendar") == 0 ||
+		    g_ascii_strcasecmp (mime_type, "application/ics") == 0))))
+			can_cache = FALSE;
+
+		g_object_unref (part);
+	}
+
+	return can_cache;
+}
+
+/* The key consists of the request URI, which contains the folder URI,
+   the message UID, the part ID, the mode and the charsets, then of all
+   the formatter properties, like colors and image loading policy, and
+   of the message flags. */
+static gchar *
+mail_request_build_cache_key (const gchar *uri,
+			      EMailPartList *part_list,
+			      EMailFormatter *formatter)
+{
+	GParamSpec **pspecs;
+	GString *key;
+	CamelFolder *folder;
+	const gchar *message_uid;
+	guint ii, n_pspecs = 0;
+
+	key = g_string_new (uri);
+
+	pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (formatter), &n_pspecs);
+
+	for (ii = 0; ii < n_pspecs; ii++) {
+		GParamSpec *pspec = pspecs[ii];
+		GValue value = G_VALUE_INIT;
+		gchar *str = NULL;
+
+		if (!(pspec->flags & G_PARAM_READABLE))
+			continue;
+
+		g_value_init (&value, pspec->value_type);
+		g_object_get_property (G_OBJECT (formatter), pspec->name, &value);
+
+		if (G_VALUE_HOLDS (&value, GDK_TYPE_RGBA)) {
+			const GdkRGBA *rgba = g_value_get_boxed (&value);
+
+			if (rgba)
+				str = gdk_rgba_to_string (rgba);
+		} else if (g_value_type_transformable (pspec->value_type, G_TYPE_STRING)) {
+			GValue str_value = G_VALUE_INIT;
+
+			g_value_init (&str_value, G_TYPE_STRING);
+
+			if (g_value_transform (&value, &str_value))
+				str = g_value_dup_string (&str_value);
+
+			g_value_unset (&str_value);
+		}
+
+		g_string_append_printf (key, "\n%s=%s", pspec->name, str ? str : "");
+
+		g_value_unset (&value);
+		g_free (str);
+	}
+
+	g_free (pspecs);
+
+	g_string_append_printf (key, "\ntext-format-flags=%u", e_mail_formatter_get_text_format_flags (formatter));
+
+	folder = e_mail_part_list_get_folder (part_list);
+	message_uid = e_mail_part_list_get_message_uid (part_list);
+
+	if (folder && message_uid) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, message_uid);
+		if (info) {
+			const CamelNamedFlags *user_flags;
+			const CamelNameValueArray *user_tags;
+			guint len;
+
+			camel_message_info_property_lock (info);
+
+			/* The seen flag changes right after the message is shown, and
+			   the folder-flagged only marks the info as changed */
+			g_string_append_printf (key, "\nflags=%u", camel_message_info_get_flags (info) &
+				~(CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FOLDER_FLAGGED));
+
+			user_flags = camel_message_info_get_user_flags (info);
+			len = user_flags ? camel_named_flags_get_length (user_flags) : 0;
+
+			for (ii = 0; ii < len; ii++) {
+				g_string_append_printf (key, "\nflag:%s", camel_named_flags_get (user_flags, ii));
+			}
+
+			user_tags = camel_message_info_get_user_tags (info);
+			len = user_tags ? camel_name_value_array_get_length (user_tags) : 0;
+
+			for (ii = 0; ii < len; ii++) {
+				const gchar *name = NULL, *value = NULL;
+
+				if (camel_name_value_array_get (user_tags, ii, &name, &value))
+					g_string_append_printf (key, "\ntag:%s=%s", name, value);
+			}
+
+			camel_message_info_property_unlock (info);
+
+			g_object_unref (info);
+		}
+	}
+
+	return g_string_free (key, FALSE);
+}
+
+static void
+mail_request_claim_attachment_cb (EMailFormatter *formatter,
+				  EAttachment *attachment,
+				  gpointer user_data)
+{
+	GPtrArray *attachments = user_data;
+
+	g_ptr_array_add (attachments, g_object_ref (attachment));
+}
+
 static gboolean
 mail_request_process_mail_sync (EContentRequest *request,
 				GUri *guri,
@@ -94,12 +389,14 @@ mail_request_process_mail_sync (EContentRequest *request,
 	EMailFormatter *formatter;
 	EMailPartList *part_list;
 	CamelObjectBag *registry;
-	GOutputStream *output_stream;
+	GOutputStream *output_stream = NULL;
 	GBytes *bytes;
-	gchar *tmp, *use_mime_type = NULL;
+	GPtrArray *claimed_attachments = NULL;
+	gchar *tmp, *use_mime_type = NULL, *cache_key = NULL;
 	const gchar *val;
 	const gchar *default_charset, *charset;
 	gboolean part_converted_to_utf8 = FALSE;
+	gulong claim_attachment_handler_id = 0;
 
 	EMailFormatterContext context = { 0 };
 
@@ -161,6 +458,46 @@ mail_request_process_mail_sync (EContentRequest *request,
 	if (charset != NULL && *charset != '\0')
 		e_mail_formatter_set_charset (formatter, charset);
 
+	if (E_IS_MAIL_DISPLAY (requester) &&
+	    context.mode != E_MAIL_FORMATTER_MODE_PRINTING &&
+	    !(uri_query && g_hash_table_contains (uri_query, "attachment_icon"))) {
+		FormattedCache *cache = formatted_cache_get ();
+
+		if (g_settings_get_boolean (cache->settings, "cache-formatted-messages") &&
+		    mail_request_can_cache_part_list (part_list)) {
+			FormattedData *fd;
+
+			cache_key = mail_request_build_cache_key (context.uri, part_list, formatter);
+			fd = formatted_cache_lookup (cache, cache_key, part_list);
+
+			if (fd) {
+				guint ii;
+
+				if (camel_debug_start ("emformat:requests")) {
+					printf ("%s: using cached output for '%s'\n", G_STRFUNC, context.uri);
+					camel_debug_end ();
+				}
+
+				/* The attachment bar is populated by the formatter */
+				for (ii = 0; ii < fd->attachments->len; ii++) {
+					e_mail_formatter_claim_attachment (formatter, g_ptr_array_index (fd->attachments, ii));
+				}
+
+				bytes = g_bytes_ref (fd->bytes);
+				use_mime_type = g_strdup (fd->mime_type);
+
+				g_clear_pointer (&cache_key, g_free);
+				g_clear_object (&context.part_list);
+
+				goto have_bytes;
+			}
+
+			claimed_attachments = g_ptr_array_new_with_free_func (g_object_unref);
+			claim_attachment_handler_id = g_signal_connect (formatter, "claim-attachment",
+				G_CALLBACK (mail_request_claim_attachment_cb), claimed_attachments);
+		}
+	}
+
 	output_stream = g_memory_output_stream_new_resizable ();
 
 	val = uri_query ? g_hash_table_lookup (uri_query, "attachment_icon") : NULL;
@@ -238,6 +575,7 @@ mail_request_process_mail_sync (EContentRequest *request,
 			}
 
 			g_free (part_id);
+			g_clear_pointer (&cache_key, g_free);
 			goto no_part;
 		}
 		g_free (part_id);
@@ -268,6 +606,9 @@ mail_request_process_mail_sync (EContentRequest *request,
  no_part:
 	g_clear_object (&context.part_list);
 
+	if (claim_attachment_handler_id)
+		g_signal_handler_disconnect (formatter, claim_attachment_handler_id);
+
 	g_output_stream_close (output_stream, NULL, NULL);
 
 	bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (output_stream));
@@ -294,14 +635,23 @@ mail_request_process_mail_sync (EContentRequest *request,
 		use_mime_type = tmp;
 	}
 
+	/* A partial output is not stored */
+	if (cache_key && !g_cancellable_is_cancelled (cancellable)) {
+		formatted_cache_add (formatted_cache_get (), cache_key, part_list,
+			bytes, use_mime_type, claimed_attachments);
+	}
+
+ have_bytes:
 	*out_stream = g_memory_input_stream_new_from_bytes (bytes);
 	*out_stream_length = g_bytes_get_size (bytes);
 	*out_mime_type = use_mime_type;
 
-	g_object_unref (output_stream);
+	g_clear_object (&output_stream);
+	g_clear_pointer (&claimed_attachments, g_ptr_array_unref);
 	g_object_unref (part_list);
 	g_object_unref (formatter);
 	g_bytes_unref (bytes);
+	g_free (cache_key);
 	g_free (context.uri);
 
 	return TRUE;
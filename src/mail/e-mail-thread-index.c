@@ -0,0 +1,937 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "evolution-config.h"
+
+#include <string.h>
+
+#include "e-mail-thread-index.h"
+
+#define THREAD_INDEX_HEADER "EvolutionThreadIndex 1\n"
+
+/* Do not rewrite the file more often than this, in seconds */
+#define THREAD_INDEX_SAVE_INTERVAL 60
+
+typedef struct _ThreadEntry ThreadEntry;
+
+struct _ThreadEntry {
+	const gchar *uid;		/* in the Camel string pool */
+	guint64 message_id;
+	guint64 wanted_parent_id;	/* referenced message, not in the folder (yet) */
+	ThreadEntry *parent;
+	guint n_children;
+	gboolean phantom;		/* removed message, kept for its children */
+};
+
+struct _EMailThreadIndex {
+	volatile gint ref_count;
+	GMutex lock;
+	gchar *filename;
+
+	GHashTable *entries;		/* const gchar *uid ~> ThreadEntry * */
+	GHashTable *by_message_id;	/* guint64 * ~> ThreadEntry * */
+	GHashTable *orphans;		/* guint64 *wanted_parent_id ~> GPtrArray { ThreadEntry * } */
+	GHashTable *pending_added;	/* const gchar *uid ~> NULL */
+	GHashTable *pending_removed;	/* const gchar *uid ~> NULL */
+
+	gboolean reconciled;
+	gboolean dirty;
+	gint64 last_save;
+};
+
+static ThreadEntry *
+thread_entry_new (const gchar *uid)
+{
+	ThreadEntry *entry;
+
+	entry = g_slice_new0 (ThreadEntry);
+	entry->uid = camel_pstring_strdup (uid);
+
+	return entry;
+}
+
+static void
+thread_entry_free (gpointer ptr)
+{
+	ThreadEntry *entry = ptr;
+
+	if (entry) {
+		camel_pstring_free (entry->uid);
+		g_slice_free (ThreadEntry, entry);
+	}
+}
+
+/* Whether the 'entry' is the 'ancestor' or one of its descendants */
+static gboolean
+thread_entry_descends_from (ThreadEntry *entry,
+			    ThreadEntry *ancestor)
+{
+	while (entry) {
+		if (entry == ancestor)
+			return TRUE;
+
+		entry = entry->parent;
+	}
+
+	return FALSE;
+}
+
+static void
+thread_index_clear_locked (EMailThreadIndex *index)
+{
+	g_hash_table_remove_all (index->orphans);
+	g_hash_table_remove_all (index->by_message_id);
+	g_hash_table_remove_all (index->pending_added);
+	g_hash_table_remove_all (index->pending_removed);
+	g_hash_table_remove_all (index->entries);
+
+	index->reconciled = FALSE;
+}
+
+/* Frees phantoms which do not hold any children anymore */
+static void
+thread_index_release_phantoms_locked (EMailThreadIndex *index,
+				      ThreadEntry *entry)
+{
+	while (entry && entry->phantom && !entry->n_children) {
+		ThreadEntry *parent = entry->parent;
+
+		if (parent)
+			parent->n_children--;
+
+		entry->parent = NULL;
+
+		g_hash_table_remove (index->entries, entry->uid);
+
+		entry = parent;
+	}
+}
+
+static void
+thread_index_set_parent_locked (EMailThreadIndex *index,
+				ThreadEntry *entry,
+				ThreadEntry *parent)
+{
+	ThreadEntry *old_parent = entry->parent;
+
+	if (old_parent == parent)
+		return;
+
+	if (parent)
+		parent->n_children++;
+
+	entry->parent = parent;
+
+	if (old_parent) {
+		old_parent->n_children--;
+		thread_index_release_phantoms_locked (index, old_parent);
+	}
+}
+
+static void
+thread_index_add_orphan_locked (EMailThreadIndex *index,
+				ThreadEntry *entry,
+				guint64 wanted_parent_id)
+{
+	GPtrArray *waiting;
+
+	if (!wanted_parent_id)
+		return;
+
+	entry->wanted_parent_id = wanted_parent_id;
+
+	waiting = g_hash_table_lookup (index->orphans, &wanted_parent_id);
+	if (!waiting) {
+		waiting = g_ptr_array_new ();
+		g_hash_table_insert (index->orphans, g_memdup2 (&wanted_parent_id, sizeof (guint64)), waiting);
+	}
+
+	g_ptr_array_add (waiting, entry);
+}
+
+static void
+thread_index_remove_orphan_locked (EMailThreadIndex *index,
+				   ThreadEntry *entry)
+{
+	GPtrArray *waiting;
+
+	if (!entry->wanted_parent_id)
+		return;
+
+	waiting = g_hash_table_lookup (index->orphans, &entry->wanted_parent_id);
+	if (waiting) {
+		g_ptr_array_remove_fast (waiting, entry);
+
+		if (!waiting->len)
+			g_hash_table_remove (index->orphans, &entry->wanted_parent_id);
+	}
+
+	entry->wanted_parent_id = 0;
+}
+
+static void
+thread_index_register_message_id_locked (EMailThreadIndex *index,
+					 ThreadEntry *entry)
+{
+	if (entry->message_id && !g_hash_table_contains (index->by_message_id, &entry->message_id))
+		g_hash_table_insert (index->by_message_id, &entry->message_id, entry);
+}
+
+/* Threads a message the same way as CamelFolderThread does without the
+ * subject threading: the parent is the closest referenced message known
+ * to the index.  Messages which reference an unknown message wait for it
+ * and are adopted once it is added. */
+static void
+thread_index_add_info_locked (EMailThreadIndex *index,
+			      CamelMessageInfo *info)
+{
+	ThreadEntry *entry;
+	GPtrArray *waiting;
+	GArray *references;
+	const gchar *uid;
+
+	uid = camel_message_info_get_uid (info);
+	if (!uid)
+		return;
+
+	entry = g_hash_table_lookup (index->entries, uid);
+	if (entry && !entry->phantom)
+		return;
+
+	if (entry) {
+		entry->phantom = FALSE;
+	} else {
+		entry = thread_entry_new (uid);
+		g_hash_table_insert (index->entries, (gpointer) entry->uid, entry);
+	}
+
+	entry->message_id = camel_message_info_get_message_id (info);
+	thread_index_register_message_id_locked (index, entry);
+
+	references = camel_message_info_dup_references (info);
+
+	if (!entry->parent && references && references->len) {
+		guint ii;
+
+		for (ii = references->len; ii > 0; ii--) {
+			guint64 ref_id = g_array_index (references, guint64, ii - 1);
+			ThreadEntry *parent;
+
+			if (!ref_id || ref_id == entry->message_id)
+				continue;
+
+			parent = g_hash_table_lookup (index->by_message_id, &ref_id);
+			if (parent && !thread_entry_descends_from (parent, entry)) {
+				thread_index_set_parent_locked (index, entry, parent);
+				break;
+			}
+		}
+
+		if (!entry->parent) {
+			thread_index_add_orphan_locked (index, entry,
+				g_array_index (references, guint64, references->len - 1));
+		}
+	}
+
+	if (references)
+		g_array_unref (references);
+
+	waiting = entry->message_id ? g_hash_table_lookup (index->orphans, &entry->message_id) : NULL;
+	if (waiting) {
+		guint ii;
+
+		g_ptr_array_ref (waiting);
+		g_hash_table_remove (index->orphans, &entry->message_id);
+
+		for (ii = 0; ii < waiting->len; ii++) {
+			ThreadEntry *child = g_ptr_array_index (waiting, ii);
+
+			child->wanted_parent_id = 0;
+
+			if (!thread_entry_descends_from (entry, child))
+				thread_index_set_parent_locked (index, child, entry);
+		}
+
+		g_ptr_array_unref (waiting);
+	}
+
+	index->dirty = TRUE;
+}
+
+static void
+thread_index_remove_uid_locked (EMailThreadIndex *index,
+				const gchar *uid)
+{
+	ThreadEntry *entry;
+
+	entry = g_hash_table_lookup (index->entries, uid);
+	if (!entry || entry->phantom)
+		return;
+
+	thread_index_remove_orphan_locked (index, entry);
+
+	if (entry->message_id && g_hash_table_lookup (index->by_message_id, &entry->message_id) == entry)
+		g_hash_table_remove (index->by_message_id, &entry->message_id);
+
+	/* Keep it, thus the children stay in the same thread */
+	entry->phantom = TRUE;
+
+	if (!entry->n_children)
+		thread_index_release_phantoms_locked (index, entry);
+
+	index->dirty = TRUE;
+}
+
+/**
+ * e_mail_thread_index_new:
+ * @filename: a file name to store the index into
+ *
+ * Creates a new, empty #EMailThreadIndex, which is stored in @filename.
+ * Free it with e_mail_thread_index_unref(), when no longer needed.
+ *
+ * Returns: (transfer full): a new #EMailThreadIndex
+ *
+ * Since: 3.62
+ **/
+EMailThreadIndex *
+e_mail_thread_index_new (const gchar *filename)
+{
+	EMailThreadIndex *index;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	index = g_slice_new0 (EMailThreadIndex);
+	index->ref_count = 1;
+	index->filename = g_strdup (filename);
+	index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, thread_entry_free);
+	index->by_message_id = g_hash_table_new (g_int64_hash, g_int64_equal);
+	index->orphans = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+	index->pending_added = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+	index->pending_removed = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+	g_mutex_init (&index->lock);
+
+	return index;
+}
+
+/**
+ * e_mail_thread_index_ref:
+ * @index: an #EMailThreadIndex
+ *
+ * Adds a reference to the @index.
+ *
+ * Returns: (transfer full): the @index
+ *
+ * Since: 3.62
+ **/
+EMailThreadIndex *
+e_mail_thread_index_ref (EMailThreadIndex *index)
+{
+	g_return_val_if_fail (index != NULL, NULL);
+
+	g_atomic_int_inc (&index->ref_count);
+
+	return index;
+}
+
+/**
+ * e_mail_thread_index_unref:
+ * @index: (transfer full): an #EMailThreadIndex
+ *
+ * Removes a reference from the @index. It's freed,
+ * when the last reference is removed.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_unref (EMailThreadIndex *index)
+{
+	g_return_if_fail (index != NULL);
+
+	if (g_atomic_int_dec_and_test (&index->ref_count)) {
+		thread_index_clear_locked (index);
+
+		g_hash_table_destroy (index->orphans);
+		g_hash_table_destroy (index->by_message_id);
+		g_hash_table_destroy (index->pending_added);
+		g_hash_table_destroy (index->pending_removed);
+		g_hash_table_destroy (index->entries);
+		g_mutex_clear (&index->lock);
+		g_free (index->filename);
+
+		g_slice_free (EMailThreadIndex, index);
+	}
+}
+
+/**
+ * e_mail_thread_index_load:
+ * @index: an #EMailThreadIndex
+ *
+ * Replaces the content of the @index with what is stored on the disk.
+ * The loaded content should be reconciled with the folder content with
+ * e_mail_thread_index_reconcile(), because the folder could change while
+ * it was not shown.
+ *
+ * Returns: whether the stored index had been loaded
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_thread_index_load (EMailThreadIndex *index)
+{
+	GPtrArray *links; /* ThreadEntry *, const gchar *parent_uid pairs */
+	gchar *contents = NULL, *line;
+	gboolean success = TRUE;
+	guint ii;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+
+	if (!g_file_get_contents (index->filename, &contents, NULL, NULL))
+		return FALSE;
+
+	if (!g_str_has_prefix (contents, THREAD_INDEX_HEADER)) {
+		g_free (contents);
+		return FALSE;
+	}
+
+	links = g_ptr_array_new ();
+
+	g_mutex_lock (&index->lock);
+
+	thread_index_clear_locked (index);
+
+	/* Each line is: "message_id\twanted_parent_id\tflag\tuid\tparent_uid\n" */
+	line = contents + strlen (THREAD_INDEX_HEADER);
+	while (success && *line) {
+		ThreadEntry *entry;
+		gchar *eol, *fields[5];
+		guint n_fields = 0;
+
+		eol = strchr (line, '\n');
+		if (!eol) {
+			success = FALSE;
+			break;
+		}
+
+		*eol = '\0';
+
+		fields[n_fields++] = line;
+		while (n_fields < G_N_ELEMENTS (fields) && (line = strchr (line, '\t')) != NULL) {
+			*line = '\0';
+			line++;
+			fields[n_fields++] = line;
+		}
+
+		if (n_fields != G_N_ELEMENTS (fields) || !*fields[3] ||
+		    g_hash_table_contains (index->entries, fields[3])) {
+			success = FALSE;
+			break;
+		}
+
+		entry = thread_entry_new (fields[3]);
+		entry->message_id = g_ascii_strtoull (fields[0], NULL, 16);
+		entry->phantom = fields[2][0] == 'P';
+		g_hash_table_insert (index->entries, (gpointer) entry->uid, entry);
+
+		if (!entry->phantom)
+			thread_index_register_message_id_locked (index, entry);
+
+		thread_index_add_orphan_locked (index, entry, g_ascii_strtoull (fields[1], NULL, 16));
+
+		if (*fields[4]) {
+			g_ptr_array_add (links, entry);
+			g_ptr_array_add (links, fields[4]);
+		}
+
+		line = eol + 1;
+	}
+
+	for (ii = 0; success && ii + 1 < links->len; ii += 2) {
+		ThreadEntry *entry = g_ptr_array_index (links, ii);
+		ThreadEntry *parent;
+
+		parent = g_hash_table_lookup (index->entries, g_ptr_array_index (links, ii + 1));
+		if (parent && !thread_entry_descends_from (parent, entry))
+			thread_index_set_parent_locked (index, entry, parent);
+		else
+			success = FALSE;
+	}
+
+	if (!success)
+		thread_index_clear_locked (index);
+
+	index->dirty = FALSE;
+	index->last_save = g_get_monotonic_time ();
+
+	g_mutex_unlock (&index->lock);
+
+	g_ptr_array_unref (links);
+	g_free (contents);
+
+	return success;
+}
+
+/**
+ * e_mail_thread_index_save:
+ * @index: an #EMailThreadIndex
+ * @error: return location for a #GError, or %NULL
+ *
+ * Stores the @index content into its file. It does nothing,
+ * when the @index did not change since it was loaded or saved.
+ *
+ * Returns: whether succeeded
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_thread_index_save (EMailThreadIndex *index,
+			  GError **error)
+{
+	GHashTableIter iter;
+	GString *contents;
+	gpointer value;
+	gboolean success;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+
+	g_mutex_lock (&index->lock);
+
+	if (!index->dirty || !index->reconciled) {
+		g_mutex_unlock (&index->lock);
+		return TRUE;
+	}
+
+	contents = g_string_sized_new (64 * (g_hash_table_size (index->entries) + 1));
+	g_string_append (contents, THREAD_INDEX_HEADER);
+
+	g_hash_table_iter_init (&iter, index->entries);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ThreadEntry *entry = value;
+
+		g_string_append_printf (contents, "%" G_GINT64_MODIFIER "x\t%" G_GINT64_MODIFIER "x\t%c\t%s\t%s\n",
+			entry->message_id,
+			entry->wanted_parent_id,
+			entry->phantom ? 'P' : '-',
+			entry->uid,
+			entry->parent ? entry->parent->uid : "");
+	}
+
+	index->dirty = FALSE;
+	index->last_save = g_get_monotonic_time ();
+
+	g_mutex_unlock (&index->lock);
+
+	success = g_file_set_contents (index->filename, contents->str, contents->len, error);
+
+	if (!success) {
+		g_mutex_lock (&index->lock);
+		index->dirty = TRUE;
+		g_mutex_unlock (&index->lock);
+	}
+
+	g_string_free (contents, TRUE);
+
+	return success;
+}
+
+/**
+ * e_mail_thread_index_save_throttled:
+ * @index: an #EMailThreadIndex
+ *
+ * Saves the @index with e_mail_thread_index_save(), unless it was
+ * saved only a short time ago. This can be used after each update,
+ * to avoid rewriting the file with every folder change. Errors
+ * are silently ignored.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_save_throttled (EMailThreadIndex *index)
+{
+	gboolean can_save;
+
+	g_return_if_fail (index != NULL);
+
+	g_mutex_lock (&index->lock);
+	can_save = index->dirty && (!index->last_save ||
+		g_get_monotonic_time () - index->last_save >= THREAD_INDEX_SAVE_INTERVAL * G_USEC_PER_SEC);
+	g_mutex_unlock (&index->lock);
+
+	if (can_save)
+		e_mail_thread_index_save (index, NULL);
+}
+
+/**
+ * e_mail_thread_index_get_is_empty:
+ * @index: an #EMailThreadIndex
+ *
+ * Returns: whether the @index has no content
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_thread_index_get_is_empty (EMailThreadIndex *index)
+{
+	gboolean is_empty;
+
+	g_return_val_if_fail (index != NULL, TRUE);
+
+	g_mutex_lock (&index->lock);
+	is_empty = !g_hash_table_size (index->entries);
+	g_mutex_unlock (&index->lock);
+
+	return is_empty;
+}
+
+/**
+ * e_mail_thread_index_get_needs_reconcile:
+ * @index: an #EMailThreadIndex
+ *
+ * Returns: whether the @index was not filled with
+ *    e_mail_thread_index_fill_from_thread() nor reconciled
+ *    with e_mail_thread_index_reconcile() yet
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_thread_index_get_needs_reconcile (EMailThreadIndex *index)
+{
+	gboolean needs_reconcile;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+
+	g_mutex_lock (&index->lock);
+	needs_reconcile = !index->reconciled;
+	g_mutex_unlock (&index->lock);
+
+	return needs_reconcile;
+}
+
+/**
+ * e_mail_thread_index_get_dirty:
+ * @index: an #EMailThreadIndex
+ *
+ * Returns: whether the @index changed since it was loaded or saved
+ *
+ * Since: 3.62
+ **/
+gboolean
+e_mail_thread_index_get_dirty (EMailThreadIndex *index)
+{
+	gboolean dirty;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+
+	g_mutex_lock (&index->lock);
+	dirty = index->dirty;
+	g_mutex_unlock (&index->lock);
+
+	return dirty;
+}
+
+static void
+thread_index_fill_locked (EMailThreadIndex *index,
+			  CamelFolderThreadNode *node,
+			  ThreadEntry *parent)
+{
+	while (node) {
+		CamelMessageInfo *info = camel_folder_thread_node_get_item (node);
+		ThreadEntry *entry = NULL;
+
+		if (info && camel_message_info_get_uid (info) &&
+		    !g_hash_table_contains (index->entries, camel_message_info_get_uid (info))) {
+			entry = thread_entry_new (camel_message_info_get_uid (info));
+			entry->message_id = camel_message_info_get_message_id (info);
+			g_hash_table_insert (index->entries, (gpointer) entry->uid, entry);
+
+			thread_index_register_message_id_locked (index, entry);
+
+			if (parent) {
+				thread_index_set_parent_locked (index, entry, parent);
+			} else {
+				GArray *references;
+
+				references = camel_message_info_dup_references (info);
+				if (references && references->len) {
+					thread_index_add_orphan_locked (index, entry,
+						g_array_index (references, guint64, references->len - 1));
+				}
+
+				if (references)
+					g_array_unref (references);
+			}
+		}
+
+		if (camel_folder_thread_node_get_child (node))
+			thread_index_fill_locked (index, camel_folder_thread_node_get_child (node), entry ? entry : parent);
+
+		node = camel_folder_thread_node_get_next (node);
+	}
+}
+
+/**
+ * e_mail_thread_index_fill_from_thread:
+ * @index: an #EMailThreadIndex
+ * @thread: a #CamelFolderThread of all the folder messages
+ *
+ * Replaces the content of the @index with the threads from the @thread,
+ * which is supposed to be built without the subject threading.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_fill_from_thread (EMailThreadIndex *index,
+				      CamelFolderThread *thread)
+{
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (CAMEL_IS_FOLDER_THREAD (thread));
+
+	g_mutex_lock (&index->lock);
+
+	thread_index_clear_locked (index);
+	thread_index_fill_locked (index, camel_folder_thread_get_tree (thread), NULL);
+
+	index->reconciled = TRUE;
+	index->dirty = TRUE;
+	index->last_save = 0;
+
+	g_mutex_unlock (&index->lock);
+}
+
+/**
+ * e_mail_thread_index_reconcile:
+ * @index: an #EMailThreadIndex
+ * @folder: a #CamelFolder the @index is for
+ * @folder_uids: (element-type utf8): all message UIDs of the @folder
+ * @cancellable: (nullable): optional #GCancellable object, or %NULL
+ *
+ * Adds messages missing in the @index and removes those which are not
+ * part of the @folder_uids. Only message infos of the added messages
+ * are read from the @folder. The @index is left unreconciled, when
+ * the operation is cancelled.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_reconcile (EMailThreadIndex *index,
+			       CamelFolder *folder,
+			       GPtrArray *folder_uids,
+			       GCancellable *cancellable)
+{
+	GHashTableIter iter;
+	GHashTable *known_uids;
+	GPtrArray *removed_uids;
+	gpointer key, value;
+	gboolean cancelled = FALSE;
+	guint ii;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (CAMEL_IS_FOLDER (folder));
+	g_return_if_fail (folder_uids != NULL);
+
+	known_uids = g_hash_table_new (g_str_hash, g_str_equal);
+	for (ii = 0; ii < folder_uids->len; ii++)
+		g_hash_table_add (known_uids, g_ptr_array_index (folder_uids, ii));
+
+	removed_uids = g_ptr_array_new ();
+
+	g_mutex_lock (&index->lock);
+
+	g_hash_table_remove_all (index->pending_added);
+	g_hash_table_remove_all (index->pending_removed);
+
+	g_hash_table_iter_init (&iter, index->entries);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		ThreadEntry *entry = value;
+
+		if (!entry->phantom && !g_hash_table_contains (known_uids, key))
+			g_ptr_array_add (removed_uids, (gpointer) camel_pstring_strdup (key));
+	}
+
+	for (ii = 0; ii < removed_uids->len; ii++)
+		thread_index_remove_uid_locked (index, g_ptr_array_index (removed_uids, ii));
+
+	for (ii = 0; ii < folder_uids->len && !cancelled; ii++) {
+		const gchar *uid = g_ptr_array_index (folder_uids, ii);
+		ThreadEntry *entry;
+
+		entry = g_hash_table_lookup (index->entries, uid);
+		if (!entry || entry->phantom) {
+			CamelMessageInfo *info;
+
+			cancelled = g_cancellable_is_cancelled (cancellable);
+
+			info = cancelled ? NULL : camel_folder_get_message_info (folder, uid);
+			if (info) {
+				thread_index_add_info_locked (index, info);
+				g_object_unref (info);
+			}
+		}
+	}
+
+	index->reconciled = !cancelled;
+
+	g_mutex_unlock (&index->lock);
+
+	g_ptr_array_foreach (removed_uids, (GFunc) camel_pstring_free, NULL);
+	g_ptr_array_unref (removed_uids);
+	g_hash_table_destroy (known_uids);
+}
+
+/**
+ * e_mail_thread_index_note_changes:
+ * @index: an #EMailThreadIndex
+ * @changes: a #CamelFolderChangeInfo
+ *
+ * Remembers added and removed messages from the @changes, to be applied
+ * on the @index with e_mail_thread_index_apply_changes().  This does not
+ * read any message info, thus it can be called from the main thread.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_note_changes (EMailThreadIndex *index,
+				  CamelFolderChangeInfo *changes)
+{
+	guint ii;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (changes != NULL);
+
+	g_mutex_lock (&index->lock);
+
+	for (ii = 0; changes->uid_removed && ii < changes->uid_removed->len; ii++) {
+		const gchar *uid = g_ptr_array_index (changes->uid_removed, ii);
+
+		g_hash_table_remove (index->pending_added, uid);
+		g_hash_table_add (index->pending_removed, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	for (ii = 0; changes->uid_added && ii < changes->uid_added->len; ii++) {
+		const gchar *uid = g_ptr_array_index (changes->uid_added, ii);
+
+		g_hash_table_remove (index->pending_removed, uid);
+		g_hash_table_add (index->pending_added, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	g_mutex_unlock (&index->lock);
+}
+
+/**
+ * e_mail_thread_index_apply_changes:
+ * @index: an #EMailThreadIndex
+ * @folder: a #CamelFolder the @index is for
+ *
+ * Applies changes remembered by e_mail_thread_index_note_changes()
+ * on the @index. This reads message infos of the added messages,
+ * thus it should not be called from the main thread.
+ *
+ * Since: 3.62
+ **/
+void
+e_mail_thread_index_apply_changes (EMailThreadIndex *index,
+				   CamelFolder *folder)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (CAMEL_IS_FOLDER (folder));
+
+	g_mutex_lock (&index->lock);
+
+	g_hash_table_iter_init (&iter, index->pending_removed);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		thread_index_remove_uid_locked (index, key);
+	}
+
+	g_hash_table_iter_init (&iter, index->pending_added);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		CamelMessageInfo *info;
+
+		info = camel_folder_get_message_info (folder, key);
+		if (info) {
+			thread_index_add_info_locked (index, info);
+			g_object_unref (info);
+		}
+	}
+
+	g_hash_table_remove_all (index->pending_added);
+	g_hash_table_remove_all (index->pending_removed);
+
+	g_mutex_unlock (&index->lock);
+}
+
+/**
+ * e_mail_thread_index_dup_parents:
+ * @index: an #EMailThreadIndex
+ * @uids: (element-type utf8): message UIDs to get the parents for
+ *
+ * Finds the thread parent for each of the @uids, which is the closest
+ * ancestor being part of the @uids. Messages without such ancestor
+ * are thread roots and are not part of the returned hash table.
+ *
+ * Both keys and values of the returned hash table point to the strings
+ * of the @uids array, thus they are valid only as long as the @uids is.
+ *
+ * Returns: (transfer container): a #GHashTable with message UID
+ *    as the key and its parent message UID as the value.
+ *    Free it with g_hash_table_destroy(), when no longer needed.
+ *
+ * Since: 3.62
+ **/
+GHashTable *
+e_mail_thread_index_dup_parents (EMailThreadIndex *index,
+				 GPtrArray *uids)
+{
+	GHashTable *wanted_uids;
+	GHashTable *parents;
+	guint ii, max_depth;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (uids != NULL, NULL);
+
+	wanted_uids = g_hash_table_new (g_str_hash, g_str_equal);
+	parents = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		gpointer uid = g_ptr_array_index (uids, ii);
+
+		g_hash_table_insert (wanted_uids, uid, uid);
+	}
+
+	g_mutex_lock (&index->lock);
+
+	max_depth = g_hash_table_size (index->entries);
+
+	for (ii = 0; ii < uids->len; ii++) {
+		gpointer uid = g_ptr_array_index (uids, ii);
+		ThreadEntry *entry;
+		guint depth = 0;
+
+		entry = g_hash_table_lookup (index->entries, uid);
+		if (!entry)
+			continue;
+
+		for (entry = entry->parent; entry && depth < max_depth; entry = entry->parent, depth++) {
+			gpointer parent_uid;
+
+			if (entry->phantom)
+				continue;
+
+			parent_uid = g_hash_table_lookup (wanted_uids, entry->uid);
+			if (parent_uid) {
+				g_hash_table_insert (parents, uid, parent_uid);
+				break;
+			}
+		}
+	}
+
+	g_mutex_unlock (&index->lock);
+
+	g_hash_table_destroy (wanted_uids);
+
+	return parents;
+}
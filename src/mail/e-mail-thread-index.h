@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2026 Red Hat (www.redhat.com)
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#ifndef E_MAIL_THREAD_INDEX_H
+#define E_MAIL_THREAD_INDEX_H
+
+#include <camel/camel.h>
+
+G_BEGIN_DECLS
+
+/**
+ * EMailThreadIndex:
+ *
+ * A persistent, per-folder child-to-parent message map used by
+ * the #MessageList to show threads without threading all messages
+ * on every folder open.  All functions are thread-safe.
+ *
+ * Since: 3.62
+ **/
+typedef struct _EMailThreadIndex EMailThreadIndex;
+
+EMailThreadIndex *
+		e_mail_thread_index_new		(const gchar *filename);
+EMailThreadIndex *
+		e_mail_thread_index_ref		(EMailThreadIndex *index);
+void		e_mail_thread_index_unref	(EMailThreadIndex *index);
+gboolean	e_mail_thread_index_load	(EMailThreadIndex *index);
+gboolean	e_mail_thread_index_save	(EMailThreadIndex *index,
+						 GError **error);
+void		e_mail_thread_index_save_throttled
+						(EMailThreadIndex *index);
+gboolean	e_mail_thread_index_get_is_empty
+						(EMailThreadIndex *index);
+gboolean	e_mail_thread_index_get_needs_reconcile
+						(EMailThreadIndex *index);
+gboolean	e_mail_thread_index_get_dirty	(EMailThreadIndex *index);
+void		e_mail_thread_index_fill_from_thread
+						(EMailThreadIndex *index,
+						 CamelFolderThread *thread);
+void		e_mail_thread_index_reconcile	(EMailThreadIndex *index,
+						 CamelFolder *folder,
+						 GPtrArray *folder_uids,
+						 GCancellable *cancellable);
+void		e_mail_thread_index_note_changes
+						(EMailThreadIndex *index,
+						 CamelFolderChangeInfo *changes);
+void		e_mail_thread_index_apply_changes
+						(EMailThreadIndex *index,
+						 CamelFolder *folder);
+GHashTable *	e_mail_thread_index_dup_parents	(EMailThreadIndex *index,
+						 GPtrArray *uids);
+
+G_END_DECLS
+
+#endif /* E_MAIL_THREAD_INDEX_H */
@@ -472,6 +472,7 @@ mail_ui_session_constructed (GObject *object)
 
 	client_cache = e_shell_get_client_cache (shell);
 	self->priv->photo_cache = e_photo_cache_new (client_cache);
+	e_photo_cache_set_use_disk_cache (self->priv->photo_cache, TRUE);
 
 	/* XXX Make sure the folder tree model is created before we
 	 *     add built-in CamelStores so it gets signals from the
@@ -32,6 +32,7 @@
 #define SPINNER_PULSE_INTERVAL (750 / 12)
 
 typedef struct _StoreInfo StoreInfo;
+typedef struct _SortKey SortKey;
 
 struct _EMFolderTreeModelPrivate {
 	/* This is set by EMailShellSidebar.  It allows new EMFolderTree
@@ -89,6 +90,21 @@ struct _StoreInfo {
 	guint spinner_pulse_timeout_id;
 };
 
+/* Precomputed in COL_BOXED_SORT_KEY, thus the sort function
+ * does not need to copy and collate the display names. */
+struct _SortKey {
+	volatile gint ref_count;
+
+	guint rank;		/* SORT_RANK_... */
+	gchar *store_uid;	/* for the COMPARE_FOLDERS signal */
+	gchar *collate_key;	/* from g_utf8_collate_key() of the display name */
+};
+
+enum {
+	SORT_RANK_INBOX = 0,	/* Inbox is always first */
+	SORT_RANK_DEFAULT
+};
+
 enum {
 	PROP_0,
 	PROP_SELECTION,
@@ -391,6 +407,82 @@ folder_tree_model_store_index_remove (EMFolderTreeModel *model,
 	return removed;
 }
 
+static SortKey *
+sort_key_new (const gchar *display_name,
+              guint32 flags,
+              CamelStore *store)
+{
+	SortKey *sort_key;
+
+	sort_key = g_slice_new0 (SortKey);
+	sort_key->ref_count = 1;
+	sort_key->rank = (flags & CAMEL_FOLDER_TYPE_MASK) == CAMEL_FOLDER_TYPE_INBOX ?
+		SORT_RANK_INBOX : SORT_RANK_DEFAULT;
+	sort_key->store_uid = store ? g_strdup (camel_service_get_uid (CAMEL_SERVICE (store))) : NULL;
+	sort_key->collate_key = display_name ? g_utf8_collate_key (display_name, -1) : NULL;
+
+	return sort_key;
+}
+
+static SortKey *
+sort_key_ref (SortKey *sort_key)
+{
+	g_return_val_if_fail (sort_key != NULL, NULL);
+	g_return_val_if_fail (sort_key->ref_count > 0, NULL);
+
+	g_atomic_int_inc (&sort_key->ref_count);
+
+	return sort_key;
+}
+
+static void
+sort_key_unref (SortKey *sort_key)
+{
+	g_return_if_fail (sort_key != NULL);
+	g_return_if_fail (sort_key->ref_count > 0);
+
+	if (g_atomic_int_dec_and_test (&sort_key->ref_count)) {
+		g_free (sort_key->store_uid);
+		g_free (sort_key->collate_key);
+		g_slice_free (SortKey, sort_key);
+	}
+}
+
+static GType
+sort_key_get_type (void)
+{
+	static gsize type_id = 0;
+
+	if (g_once_init_enter (&type_id)) {
+		GType tmp_type;
+
+		tmp_type = g_boxed_type_register_static (
+			g_intern_static_string ("EMFolderTreeModelSortKey"),
+			(GBoxedCopyFunc) sort_key_ref,
+			(GBoxedFreeFunc) sort_key_unref);
+
+		g_once_init_leave (&type_id, tmp_type);
+	}
+
+	return type_id;
+}
+
+/* Returns the sort key of the row without copying it; the key is kept
+ * alive by the row, which cannot change while the model is being sorted. */
+static const SortKey *
+folder_tree_model_peek_sort_key (GtkTreeModel *model,
+                                 GtkTreeIter *iter)
+{
+	GValue value = G_VALUE_INIT;
+	const SortKey *sort_key;
+
+	gtk_tree_model_get_value (model, iter, COL_BOXED_SORT_KEY, &value);
+	sort_key = g_value_get_boxed (&value);
+	g_value_unset (&value);
+
+	return sort_key;
+}
+
 static gint
 folder_tree_model_sort (GtkTreeModel *model,
                         GtkTreeIter *a,
@@ -398,38 +490,30 @@ folder_tree_model_sort (GtkTreeModel *model,
                         gpointer unused)
 {
 	EMFolderTreeModel *folder_tree_model;
-	gchar *aname, *bname;
-	CamelService *service_a;
-	CamelService *service_b;
+	const SortKey *key_a, *key_b;
+	const gchar *collate_a, *collate_b;
 	gboolean a_is_store;
 	gboolean b_is_store;
-	const gchar *store_uid = NULL;
-	guint32 flags_a, flags_b;
 	guint sort_order_a = 0, sort_order_b = 0;
 	gint rv = -2;
 
 	folder_tree_model = EM_FOLDER_TREE_MODEL (model);
 
+	/* Only plain values, which are not copied */
 	gtk_tree_model_get (
 		model, a,
 		COL_BOOL_IS_STORE, &a_is_store,
-		COL_OBJECT_CAMEL_STORE, &service_a,
-		COL_STRING_DISPLAY_NAME, &aname,
-		COL_UINT_FLAGS, &flags_a,
 		COL_UINT_SORT_ORDER, &sort_order_a,
 		-1);
 
 	gtk_tree_model_get (
 		model, b,
 		COL_BOOL_IS_STORE, &b_is_store,
-		COL_OBJECT_CAMEL_STORE, &service_b,
-		COL_STRING_DISPLAY_NAME, &bname,
-		COL_UINT_FLAGS, &flags_b,
 		COL_UINT_SORT_ORDER, &sort_order_b,
 		-1);
 
-	if (CAMEL_IS_SERVICE (service_a))
-		store_uid = camel_service_get_uid (service_a);
+	key_a = folder_tree_model_peek_sort_key (model, a);
+	key_b = folder_tree_model_peek_sort_key (model, b);
 
 	if (!a_is_store && !b_is_store && (sort_order_a || sort_order_b)) {
 		if (sort_order_a && sort_order_b)
@@ -439,38 +523,40 @@ folder_tree_model_sort (GtkTreeModel *model,
 		else
 			rv = 1;
 	} else if (a_is_store && b_is_store) {
+		CamelService *service_a = NULL;
+		CamelService *service_b = NULL;
+
+		gtk_tree_model_get (model, a, COL_OBJECT_CAMEL_STORE, &service_a, -1);
+		gtk_tree_model_get (model, b, COL_OBJECT_CAMEL_STORE, &service_b, -1);
+
 		rv = e_mail_account_store_compare_services (
 			folder_tree_model->priv->account_store,
 			service_a, service_b);
 
-	} else {
-		/* Inbox is always first. */
-		if ((flags_a & CAMEL_FOLDER_TYPE_MASK) == CAMEL_FOLDER_TYPE_INBOX)
-			rv = -1;
-		else if ((flags_b & CAMEL_FOLDER_TYPE_MASK) == CAMEL_FOLDER_TYPE_INBOX)
-			rv = 1;
+		g_clear_object (&service_a);
+		g_clear_object (&service_b);
+	} else if (key_a && key_b && key_a->rank != key_b->rank) {
+		rv = key_a->rank < key_b->rank ? -1 : 1;
 	}
 
-	if (rv == -2 && !a_is_store && !b_is_store)
-		g_signal_emit (model, signals[COMPARE_FOLDERS], 0, store_uid, a, b, &rv);
+	if (rv == -2 && !a_is_store && !b_is_store &&
+	    g_signal_has_handler_pending (model, signals[COMPARE_FOLDERS], 0, FALSE))
+		g_signal_emit (model, signals[COMPARE_FOLDERS], 0, key_a ? key_a->store_uid : NULL, a, b, &rv);
 
 	if (rv == -2) {
-		if (aname != NULL && bname != NULL)
-			rv = g_utf8_collate (aname, bname);
-		else if (aname == bname)
+		collate_a = key_a ? key_a->collate_key : NULL;
+		collate_b = key_b ? key_b->collate_key : NULL;
+
+		if (collate_a != NULL && collate_b != NULL)
+			rv = strcmp (collate_a, collate_b);
+		else if (collate_a == collate_b)
 			rv = 0;
-		else if (aname == NULL)
+		else if (collate_a == NULL)
 			rv = -1;
 		else
 			rv = 1;
 	}
 
-	g_free (aname);
-	g_free (bname);
-
-	g_clear_object (&service_a);
-	g_clear_object (&service_b);
-
 	return rv;
 }
 
@@ -985,7 +1071,8 @@ folder_tree_model_constructed (GObject *object)
 		GDK_TYPE_RGBA,    /* COL_RGBA_FOREGROUND_RGBA */
 		G_TYPE_UINT,      /* COL_UINT_SORT_ORDER */
 		G_TYPE_UINT,      /* COL_UINT_STATUS_CODE */
-		G_TYPE_BOOLEAN    /* COL_BOOL_SUBDIRS_UNREAD */
+		G_TYPE_BOOLEAN,   /* COL_BOOL_SUBDIRS_UNREAD */
+		sort_key_get_type () /* COL_BOXED_SORT_KEY */
 	};
 
 	g_warn_if_fail (G_N_ELEMENTS (col_types) == NUM_COLUMNS);
@@ -1449,6 +1536,9 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 	gboolean folder_is_sent = FALSE;
 	gchar *valid_display_name = NULL;
 	gchar *uri;
+	SortKey *sort_key;
+	GPtrArray *children;
+	guint ii;
 
 	g_return_val_if_fail (EM_IS_FOLDER_TREE_MODEL (model), FALSE);
 	g_return_val_if_fail (iter != NULL, FALSE);
@@ -1589,6 +1679,8 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 		display_name = valid_display_name;
 	}
 
+	sort_key = sort_key_new (display_name, flags, store);
+
 	gtk_tree_store_set (
 		tree_store, iter,
 		COL_STRING_DISPLAY_NAME, display_name,
@@ -1602,8 +1694,11 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 		COL_UINT_UNREAD_LAST_SEL, 0,
 		COL_BOOL_IS_DRAFT, folder_is_drafts,
 		COL_STRING_FOLDER_URI, uri,
+		COL_BOXED_SORT_KEY, sort_key,
 		-1);
 
+	sort_key_unref (sort_key);
+
 	em_folder_tree_model_update_row_tweaks (model, iter);
 
 	g_clear_pointer (&valid_display_name, g_free);
@@ -1637,6 +1732,8 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 	}
 
 	if (load) {
+		sort_key = sort_key_new (_("Loading…"), 0, store);
+
 		/* create a placeholder node for our subfolders... */
 		gtk_tree_store_append (tree_store, &sub, iter);
 		gtk_tree_store_set (
@@ -1651,8 +1748,11 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 			COL_UINT_UNREAD, 0,
 			COL_UINT_UNREAD_LAST_SEL, 0,
 			COL_BOOL_IS_DRAFT, FALSE,
+			COL_BOXED_SORT_KEY, sort_key,
 			-1);
 
+		sort_key_unref (sort_key);
+
 		path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), iter);
 		g_signal_emit (model, signals[LOADED_ROW], 0, path, iter);
 		g_signal_emit (model, signals[LOADING_ROW], 0, path, iter);
@@ -1660,29 +1760,30 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 		return TRUE;
 	}
 
-	if (fi->child) {
-		fi = fi->child;
+	/* Appended in the order of the model, thus the rows do not move */
+	children = fi->child ? em_folder_tree_model_sort_folder_infos (model, store, fi->child) : NULL;
 
-		do {
-			gtk_tree_store_append (tree_store, &sub, iter);
-
-			if (!emitted) {
-				path = gtk_tree_model_get_path (
-					GTK_TREE_MODEL (model), iter);
-				g_signal_emit (
-					model, signals[LOADED_ROW],
-					0, path, iter);
-				gtk_tree_path_free (path);
-				emitted = TRUE;
-			}
+	for (ii = 0; children && ii < children->len; ii++) {
+		fi = g_ptr_array_index (children, ii);
+
+		gtk_tree_store_append (tree_store, &sub, iter);
 
-			if (!em_folder_tree_model_set_folder_info (model, &sub, store, fi, fully_loaded))
-				gtk_tree_store_remove (tree_store, &sub);
+		if (!emitted) {
+			path = gtk_tree_model_get_path (
+				GTK_TREE_MODEL (model), iter);
+			g_signal_emit (
+				model, signals[LOADED_ROW],
+				0, path, iter);
+			gtk_tree_path_free (path);
+			emitted = TRUE;
+		}
 
-			fi = fi->next;
-		} while (fi);
+		if (!em_folder_tree_model_set_folder_info (model, &sub, store, fi, fully_loaded))
+			gtk_tree_store_remove (tree_store, &sub);
 	}
 
+	g_clear_pointer (&children, g_ptr_array_unref);
+
 	if (!emitted) {
 		path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), iter);
 		g_signal_emit (model, signals[LOADED_ROW], 0, path, iter);
@@ -1692,6 +1793,100 @@ em_folder_tree_model_set_folder_info (EMFolderTreeModel *model,
 	return TRUE;
 }
 
+typedef struct _FolderInfoSortData {
+	CamelFolderInfo *fi;
+	guint sort_order;	/* from the EMailFolderTweaks */
+	guint rank;		/* SORT_RANK_... */
+	gchar *collate_key;
+} FolderInfoSortData;
+
+/* The same order as folder_tree_model_sort() uses for folder rows,
+ * except of the "compare-folders" signal handlers. */
+static gint
+folder_info_sort_data_compare (gconstpointer ptr_a,
+                               gconstpointer ptr_b)
+{
+	const FolderInfoSortData *a = ptr_a, *b = ptr_b;
+
+	if (a->sort_order || b->sort_order) {
+		if (a->sort_order && b->sort_order)
+			return a->sort_order < b->sort_order ? -1 : (a->sort_order > b->sort_order ? 1 : 0);
+
+		return a->sort_order ? -1 : 1;
+	}
+
+	if (a->rank != b->rank)
+		return a->rank < b->rank ? -1 : 1;
+
+	return g_strcmp0 (a->collate_key, b->collate_key);
+}
+
+/**
+ * em_folder_tree_model_sort_folder_infos:
+ * @model: an #EMFolderTreeModel
+ * @store: a #CamelStore the folders belong to
+ * @first_sibling: the first #CamelFolderInfo of a list of siblings
+ *
+ * Sorts the @first_sibling and its next siblings the way the @model
+ * sorts its rows, thus adding them in this order does not need to move
+ * the added rows, neither to sort the whole @model.
+ *
+ * Returns: (transfer container) (element-type CamelFolderInfo): the sorted
+ *    siblings; free the array with g_ptr_array_unref(), when no longer needed
+ *
+ * Since: 3.62
+ **/
+GPtrArray *
+em_folder_tree_model_sort_folder_infos (EMFolderTreeModel *model,
+                                        CamelStore *store,
+                                        CamelFolderInfo *first_sibling)
+{
+	GArray *sort_data;
+	GPtrArray *sorted;
+	CamelFolderInfo *fi;
+	gboolean store_is_local;
+	guint ii;
+
+	g_return_val_if_fail (EM_IS_FOLDER_TREE_MODEL (model), NULL);
+	g_return_val_if_fail (CAMEL_IS_STORE (store), NULL);
+
+	store_is_local = g_strcmp0 (camel_service_get_uid (CAMEL_SERVICE (store)), E_MAIL_SESSION_LOCAL_UID) == 0;
+	sort_data = g_array_new (FALSE, TRUE, sizeof (FolderInfoSortData));
+
+	for (fi = first_sibling; fi; fi = fi->next) {
+		FolderInfoSortData data = { 0, };
+		gchar *uri;
+
+		uri = e_mail_folder_uri_build (store, fi->full_name);
+
+		data.fi = fi;
+		data.sort_order = e_mail_folder_tweaks_get_sort_order (model->priv->folder_tweaks, uri);
+		data.rank = (fi->flags & CAMEL_FOLDER_TYPE_MASK) == CAMEL_FOLDER_TYPE_INBOX ||
+			(store_is_local && g_strcmp0 (fi->full_name, "Inbox") == 0) ?
+			SORT_RANK_INBOX : SORT_RANK_DEFAULT;
+		data.collate_key = fi->display_name ? g_utf8_collate_key (fi->display_name, -1) : NULL;
+
+		g_array_append_val (sort_data, data);
+
+		g_free (uri);
+	}
+
+	g_array_sort (sort_data, folder_info_sort_data_compare);
+
+	sorted = g_ptr_array_sized_new (sort_data->len);
+
+	for (ii = 0; ii < sort_data->len; ii++) {
+		FolderInfoSortData *data = &g_array_index (sort_data, FolderInfoSortData, ii);
+
+		g_ptr_array_add (sorted, data->fi);
+		g_free (data->collate_key);
+	}
+
+	g_array_free (sort_data, TRUE);
+
+	return sorted;
+}
+
 static void
 folder_tree_model_folder_created_cb (CamelStore *store,
                                      CamelFolderInfo *fi,
@@ -1976,6 +2171,7 @@ em_folder_tree_model_add_store (EMFolderTreeModel *model,
 	CamelService *service;
 	CamelProvider *provider;
 	StoreInfo *si;
+	SortKey *sort_key;
 	const gchar *display_name;
 	gchar *valid_display_name = NULL;
 
@@ -2010,6 +2206,8 @@ em_folder_tree_model_add_store (EMFolderTreeModel *model,
 		display_name = valid_display_name;
 	}
 
+	sort_key = sort_key_new (display_name, 0, store);
+
 	/* Add the store to the tree. */
 	gtk_tree_store_append (tree_store, &iter, NULL);
 	gtk_tree_store_set (
@@ -2019,8 +2217,10 @@ em_folder_tree_model_add_store (EMFolderTreeModel *model,
 		COL_STRING_FULL_NAME, NULL,
 		COL_BOOL_LOAD_SUBDIRS, TRUE,
 		COL_BOOL_IS_STORE, TRUE,
+		COL_BOXED_SORT_KEY, sort_key,
 		-1);
 
+	sort_key_unref (sort_key);
 	g_clear_pointer (&valid_display_name, g_free);
 
 	path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
@@ -2034,6 +2234,7 @@ em_folder_tree_model_add_store (EMFolderTreeModel *model,
 	/* Each store has folders, but we don't load them until
 	 * the user demands them. */
 	root = iter;
+	sort_key = sort_key_new (_("Loading…"), 0, store);
 	gtk_tree_store_append (tree_store, &iter, &root);
 	gtk_tree_store_set (
 		tree_store, &iter,
@@ -2046,8 +2247,11 @@ em_folder_tree_model_add_store (EMFolderTreeModel *model,
 		COL_UINT_UNREAD, 0,
 		COL_UINT_UNREAD_LAST_SEL, 0,
 		COL_BOOL_IS_DRAFT, FALSE,
+		COL_BOXED_SORT_KEY, sort_key,
 		-1);
 
+	sort_key_unref (sort_key);
+
 	if (CAMEL_IS_NETWORK_SERVICE (store))
 		folder_tree_model_update_status_icon (si);
 
@@ -77,6 +77,7 @@ enum {
 
 	COL_UINT_STATUS_CODE,		/* Status code for the store - one of EMFT_STATUS_CODE_ constancts */
 	COL_BOOL_SUBDIRS_UNREAD,	/* TRUE if any descendant folder has unread > 0 */
+	COL_BOXED_SORT_KEY,		/* Private to the model, used for sorting */
 
 	NUM_COLUMNS
 };
@@ -133,6 +134,10 @@ gboolean	em_folder_tree_model_set_folder_info
 					 CamelStore *store,
 					 CamelFolderInfo *fi,
 					 gint fully_loaded);
+GPtrArray *	em_folder_tree_model_sort_folder_infos
+					(EMFolderTreeModel *model,
+					 CamelStore *store,
+					 CamelFolderInfo *first_sibling);
 void		em_folder_tree_model_add_store
 					(EMFolderTreeModel *model,
 					 CamelStore *store);
@@ -339,9 +339,18 @@ folder_tree_get_folder_info_cb (CamelStore *store,
 		}
 
 	} else {
-		while (child_info != NULL) {
+		GPtrArray *children;
+		guint ii;
+
+		/* Appended in the order of the model, thus the rows do not move */
+		children = em_folder_tree_model_sort_folder_infos (
+			EM_FOLDER_TREE_MODEL (model), store, child_info);
+
+		for (ii = 0; ii < children->len; ii++) {
 			GtkTreeRowReference *reference;
 
+			child_info = g_ptr_array_index (children, ii);
+
 			/* Check if we already have this row cached. */
 			reference = em_folder_tree_model_get_row_reference (
 				EM_FOLDER_TREE_MODEL (model),
@@ -360,10 +369,10 @@ folder_tree_get_folder_info_cb (CamelStore *store,
 				if (!em_folder_tree_model_set_folder_info (EM_FOLDER_TREE_MODEL (model), &iter, store, child_info, TRUE))
 					gtk_tree_store_remove (GTK_TREE_STORE (model), &iter);
 			}
-
-			child_info = child_info->next;
 		}
 
+		g_ptr_array_unref (children);
+
 		/* Remove the "Loading..." placeholder row. */
 		if (iter_is_placeholder)
 			gtk_tree_store_remove (GTK_TREE_STORE (model), &iter);
@@ -1426,17 +1426,136 @@ refresh_folders_desc (struct _refresh_folders_msg *m)
 		camel_service_get_display_name (CAMEL_SERVICE (m->store)));
 }
 
+typedef struct _RefreshFoldersData {
+	struct _refresh_folders_msg *m;
+	EMailBackend *mail_backend;
+	gboolean expunge;
+	GCancellable *cancellable;
+
+	GMutex lock;
+	GHashTable *known_errors;
+	gboolean stop;
+	gint n_done;
+} RefreshFoldersData;
+
+/* Returns FALSE when the refresh of the rest of the folders should be skipped */
+static gboolean
+refresh_folders_refresh_one (RefreshFoldersData *rfd,
+                             const gchar *folder_uri)
+{
+	struct _refresh_folders_msg *m = rfd->m;
+	CamelFolder *folder;
+	gboolean can_continue = TRUE;
+	GError *local_error = NULL;
+
+	folder = e_mail_session_uri_to_folder_sync (
+		E_MAIL_SESSION (m->info->session),
+		folder_uri, 0,
+		rfd->cancellable, &local_error);
+	if (folder && camel_folder_synchronize_sync (folder, rfd->expunge, rfd->cancellable, &local_error))
+		camel_folder_refresh_info_sync (folder, rfd->cancellable, &local_error);
+
+	if (folder && !local_error && rfd->mail_backend) {
+		em_utils_process_autoarchive_sync (rfd->mail_backend, folder, folder_uri, rfd->cancellable, &local_error);
+	}
+
+	if (local_error != NULL) {
+		const gchar *error_message = local_error->message ? local_error->message : _("Unknown error");
+
+		g_mutex_lock (&rfd->lock);
+
+		if (g_hash_table_contains (rfd->known_errors, error_message)) {
+			/* Received the same error message multiple times; there can be some
+			   connection issue probably, thus skip the rest folder updates for now */
+			can_continue = FALSE;
+		} else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			CamelStore *store;
+			const gchar *full_name;
+
+			if (folder) {
+				store = camel_folder_get_parent_store (folder);
+				full_name = camel_folder_get_full_display_name (folder);
+			} else {
+				store = m->store;
+				full_name = folder_uri;
+			}
+
+			report_error_to_ui (CAMEL_SERVICE (store), full_name, local_error, NULL);
+
+			/* To not report one error for multiple folders multiple times */
+			g_hash_table_insert (rfd->known_errors, g_strdup (error_message), GINT_TO_POINTER (1));
+		}
+
+		g_mutex_unlock (&rfd->lock);
+
+		g_clear_error (&local_error);
+	}
+
+	g_clear_object (&folder);
+
+	if (g_cancellable_is_cancelled (m->info->cancellable) ||
+	    g_cancellable_is_cancelled (rfd->cancellable))
+		can_continue = FALSE;
+
+	return can_continue;
+}
+
+static void
+refresh_folders_thread (gpointer data,
+                        gpointer user_data)
+{
+	RefreshFoldersData *rfd = user_data;
+	const gchar *folder_uri = data;
+	gboolean stop;
+	gint n_done;
+
+	g_mutex_lock (&rfd->lock);
+	stop = rfd->stop;
+	g_mutex_unlock (&rfd->lock);
+
+	if (stop)
+		return;
+
+	if (!refresh_folders_refresh_one (rfd, folder_uri)) {
+		g_mutex_lock (&rfd->lock);
+		rfd->stop = TRUE;
+		g_mutex_unlock (&rfd->lock);
+	}
+
+	n_done = g_atomic_int_add (&rfd->n_done, 1) + 1;
+
+	if (rfd->m->info->state != SEND_CANCELLED)
+		camel_operation_progress (
+			rfd->m->info->cancellable, 100 * n_done / rfd->m->folders->len);
+}
+
+/* Stores, which can refresh more folders at once, advertise it
+   with a "max-parallel-refreshes" property; the others are refreshed
+   one folder after another. */
+static guint
+refresh_folders_get_max_parallel (CamelStore *store)
+{
+	GParamSpec *param_spec;
+	guint max_parallel = 1;
+
+	param_spec = g_object_class_find_property (G_OBJECT_GET_CLASS (store), "max-parallel-refreshes");
+
+	if (param_spec && param_spec->value_type == G_TYPE_UINT)
+		g_object_get (store, "max-parallel-refreshes", &max_parallel, NULL);
+
+	return MAX (max_parallel, 1);
+}
+
 static void
 refresh_folders_exec (struct _refresh_folders_msg *m,
                       GCancellable *cancellable,
                       GError **error)
 {
-	CamelFolder *folder;
+	RefreshFoldersData rfd;
+	guint max_parallel;
 	gint i;
 	gboolean success;
 	gboolean delete_junk = FALSE, expunge = FALSE;
-	GHashTable *known_errors;
-	EMailBackend *mail_backend;
 	GError *local_error = NULL;
 	gulong handler_id = 0;
 
@@ -1465,66 +1584,42 @@ refresh_folders_exec (struct _refresh_folders_msg *m,
 		goto exit;
 	}
 
-	mail_backend = E_MAIL_BACKEND (e_shell_get_backend_by_name (e_shell_get_default (), "mail"));
+	memset (&rfd, 0, sizeof (RefreshFoldersData));
+	rfd.m = m;
+	rfd.mail_backend = E_MAIL_BACKEND (e_shell_get_backend_by_name (e_shell_get_default (), "mail"));
+	rfd.expunge = expunge;
+	rfd.cancellable = cancellable;
+	rfd.known_errors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_mutex_init (&rfd.lock);
 
-	known_errors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	max_parallel = refresh_folders_get_max_parallel (m->store);
 
-	for (i = 0; i < m->folders->len; i++) {
-		folder = e_mail_session_uri_to_folder_sync (
-			E_MAIL_SESSION (m->info->session),
-			m->folders->pdata[i], 0,
-			cancellable, &local_error);
-		if (folder && camel_folder_synchronize_sync (folder, expunge, cancellable, &local_error))
-			camel_folder_refresh_info_sync (folder, cancellable, &local_error);
+	if (max_parallel > 1 && m->folders->len > 1) {
+		GThreadPool *thread_pool;
 
-		if (folder && !local_error && mail_backend) {
-			em_utils_process_autoarchive_sync (mail_backend, folder, m->folders->pdata[i], cancellable, &local_error);
-		}
+		thread_pool = g_thread_pool_new (refresh_folders_thread, &rfd,
+			MIN (m->folders->len, max_parallel), FALSE, NULL);
 
-		if (local_error != NULL) {
-			const gchar *error_message = local_error->message ? local_error->message : _("Unknown error");
+		for (i = 0; i < m->folders->len; i++) {
+			g_thread_pool_push (thread_pool, m->folders->pdata[i], NULL);
+		}
 
-			if (g_hash_table_contains (known_errors, error_message)) {
-				/* Received the same error message multiple times; there can be some
-				   connection issue probably, thus skip the rest folder updates for now */
-				g_clear_object (&folder);
-				g_clear_error (&local_error);
+		/* Waits for all the pushed folders to be processed */
+		g_thread_pool_free (thread_pool, FALSE, TRUE);
+	} else {
+		for (i = 0; i < m->folders->len; i++) {
+			if (!refresh_folders_refresh_one (&rfd, m->folders->pdata[i]))
 				break;
-			} else if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
-				CamelStore *store;
-				const gchar *full_name;
-
-				if (folder) {
-					store = camel_folder_get_parent_store (folder);
-					full_name = camel_folder_get_full_display_name (folder);
-				} else {
-					store = m->store;
-					full_name = (const gchar *) m->folders->pdata[i];
-				}
-
-				report_error_to_ui (CAMEL_SERVICE (store), full_name, local_error, NULL);
 
-				/* To not report one error for multiple folders multiple times */
-				g_hash_table_insert (known_errors, g_strdup (error_message), GINT_TO_POINTER (1));
-			}
-
-			g_clear_error (&local_error);
+			if (m->info->state != SEND_CANCELLED)
+				camel_operation_progress (
+					m->info->cancellable, 100 * i / m->folders->len);
 		}
-
-		if (folder)
-			g_object_unref (folder);
-
-		if (g_cancellable_is_cancelled (m->info->cancellable) ||
-		    g_cancellable_is_cancelled (cancellable))
-			break;
-
-		if (m->info->state != SEND_CANCELLED)
-			camel_operation_progress (
-				m->info->cancellable, 100 * i / m->folders->len);
 	}
 
 	camel_operation_pop_message (m->info->cancellable);
-	g_hash_table_destroy (known_errors);
+	g_hash_table_destroy (rfd.known_errors);
+	g_mutex_clear (&rfd.lock);
 
 exit:
 	if (handler_id > 0)
@@ -19,6 +19,7 @@
 
 #include "e-mail-label-list-store.h"
 #include "e-mail-notes.h"
+#include "e-mail-thread-index.h"
 #include "e-mail-ui-session.h"
 #include "em-utils.h"
 
@@ -71,6 +72,8 @@ struct _MessageListPrivate {
 	CamelFolder *folder;
 	gulong folder_changed_handler_id;
 
+	EMailThreadIndex *thread_index;
+
 	/* For message list regeneration. */
 	GMutex regen_lock;
 	GTask *regen_task;
@@ -91,6 +94,7 @@ struct _MessageListPrivate {
 	gboolean thread_flat;
 	gboolean any_row_changed; /* save state before regen list when this is set to true */
 	gboolean regen_selects_unread;
+	gboolean flat_tree_built; /* the tree model content comes from build_flat () */
 
 	GtkTargetList *copy_target_list;
 	GtkTargetList *paste_target_list;
@@ -148,6 +152,14 @@ struct _RegenData {
 
 	CamelFolderThread *thread_tree;
 
+	/* Used instead of the 'thread_tree' when the threads come
+	 * from the 'thread_index'; the 'thread_parents' point into
+	 * strings of the 'thread_uids' and the 'summary' holds
+	 * the message infos. */
+	EMailThreadIndex *thread_index;
+	GHashTable *thread_parents; /* gchar *uid ~> gchar *parent_uid */
+	GPtrArray *thread_uids;
+
 	/* This indicates we're regenerating the message list because
 	 * we received a "folder-changed" signal from our CamelFolder. */
 	gboolean folder_changed;
@@ -156,6 +168,12 @@ struct _RegenData {
 	CamelFolder *folder;
 	GPtrArray *summary;
 
+	/* Set for incremental regen of a flat list: a snapshot of the UIDs
+	 * shown when the regen started, and the sorted search result.  The
+	 * 'summary' then holds only infos of UIDs not shown yet. */
+	GHashTable *shown_uids; /* gchar *~>NULL */
+	GPtrArray *sorted_uids;
+
 	gint last_row; /* last selected (cursor) row */
 
 	xmlDoc *expand_state; /* expanded state to be restored */
@@ -167,6 +185,8 @@ struct _RegenData {
 	gchar *select_uid;
 	gboolean select_all;
 	gboolean select_use_fallback;
+
+	gint64 trace_begin; /* e_trace_begin() at the regen request */
 };
 
 enum {
@@ -473,6 +493,7 @@ regen_data_new (MessageList *message_list,
 	regen_data->activity = g_object_ref (activity);
 	regen_data->folder = message_list_ref_folder (message_list);
 	regen_data->last_row = -1;
+	regen_data->trace_begin = e_trace_begin ();
 
 	if (adapter) {
 		regen_data->sort_info = e_tree_table_adapter_get_sort_info (adapter);
@@ -487,6 +508,9 @@ regen_data_new (MessageList *message_list,
 	if (message_list->just_set_folder)
 		regen_data->select_uid = g_strdup (message_list->cursor_uid);
 
+	if (message_list->priv->thread_index)
+		regen_data->thread_index = e_mail_thread_index_ref (message_list->priv->thread_index);
+
 	g_mutex_init (&regen_data->select_lock);
 
 	session = message_list_get_session (message_list);
@@ -508,6 +532,9 @@ regen_data_free (RegenData *regen_data)
 
 	g_clear_pointer (&regen_data->search, g_free);
 	g_clear_object (&regen_data->thread_tree);
+	g_clear_pointer (&regen_data->thread_parents, g_hash_table_destroy);
+	g_clear_pointer (&regen_data->thread_uids, g_ptr_array_unref);
+	g_clear_pointer (&regen_data->thread_index, e_mail_thread_index_unref);
 
 	if (regen_data->summary != NULL) {
 		guint ii, length;
@@ -521,6 +548,8 @@ regen_data_free (RegenData *regen_data)
 	}
 
 	g_clear_pointer (&regen_data->removed_uids, g_hash_table_unref);
+	g_clear_pointer (&regen_data->shown_uids, g_hash_table_unref);
+	g_clear_pointer (&regen_data->sorted_uids, g_ptr_array_unref);
 	g_clear_object (&regen_data->folder);
 	g_clear_pointer (&regen_data->expand_state, xmlFreeDoc);
 	g_mutex_clear (&regen_data->select_lock);
@@ -3425,6 +3454,37 @@ message_list_get_property (GObject *object,
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
 }
 
+static void
+message_list_save_thread_index_thread (GTask *task,
+				       gpointer source_object,
+				       gpointer task_data,
+				       GCancellable *cancellable)
+{
+	GError *local_error = NULL;
+
+	if (!e_mail_thread_index_save (task_data, &local_error))
+		g_warning ("%s: Failed to save thread index: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+
+	g_clear_error (&local_error);
+}
+
+/* Saves pending thread index changes in a dedicated thread,
+ * to not block the UI with a possibly large write. */
+static void
+message_list_save_thread_index (EMailThreadIndex *thread_index)
+{
+	GTask *task;
+
+	if (!e_mail_thread_index_get_dirty (thread_index))
+		return;
+
+	task = g_task_new (NULL, NULL, NULL, NULL);
+	g_task_set_source_tag (task, message_list_save_thread_index);
+	g_task_set_task_data (task, e_mail_thread_index_ref (thread_index), (GDestroyNotify) e_mail_thread_index_unref);
+	g_task_run_in_thread (task, message_list_save_thread_index_thread);
+	g_object_unref (task);
+}
+
 static void
 message_list_dispose (GObject *object)
 {
@@ -3476,6 +3536,11 @@ message_list_dispose (GObject *object)
 			G_CALLBACK (message_list_user_headers_changed_cb), message_list);
 	}
 
+	if (priv->thread_index) {
+		message_list_save_thread_index (priv->thread_index);
+		g_clear_pointer (&priv->thread_index, e_mail_thread_index_unref);
+	}
+
 	g_clear_object (&priv->session);
 	g_clear_object (&priv->folder);
 	g_clear_object (&priv->invisible);
@@ -4556,6 +4621,7 @@ clear_tree (MessageList *message_list,
 	message_list->priv->newest_read_uid = NULL;
 	message_list->priv->oldest_unread_date = 0;
 	message_list->priv->oldest_unread_uid = NULL;
+	message_list->priv->flat_tree_built = FALSE;
 
 	if (message_list->priv->tree_model_root != NULL) {
 		/* we should be frozen already */
@@ -4836,23 +4902,15 @@ find_next_selectable (MessageList *message_list,
 	return NULL;
 }
 
-static GNode *
-ml_uid_nodemap_insert (MessageList *message_list,
-                       CamelMessageInfo *info,
-                       GNode *parent,
-                       gint row)
+static void
+ml_uid_nodemap_track (MessageList *message_list,
+                      CamelMessageInfo *info,
+                      GNode *node)
 {
-	GNode *node;
 	const gchar *uid;
 	time_t date;
 	guint flags;
 
-	if (parent == NULL)
-		parent = message_list->priv->tree_model_root;
-
-	node = message_list_tree_model_insert (
-		message_list, parent, row, info);
-
 	uid = camel_message_info_get_uid (info);
 	flags = camel_message_info_get_flags (info);
 	date = camel_message_info_get_date_received (info);
@@ -4876,10 +4934,74 @@ ml_uid_nodemap_insert (MessageList *message_list,
 			message_list->priv->oldest_unread_uid = uid;
 		}
 	}
+}
+
+static GNode *
+ml_uid_nodemap_insert (MessageList *message_list,
+                       CamelMessageInfo *info,
+                       GNode *parent,
+                       gint row)
+{
+	GNode *node;
+
+	if (parent == NULL)
+		parent = message_list->priv->tree_model_root;
+
+	node = message_list_tree_model_insert (
+		message_list, parent, row, info);
+
+	ml_uid_nodemap_track (message_list, info, node);
 
 	return node;
 }
 
+/* Inserts a top-level node before the 'sibling' (or appends it when
+ * 'sibling' is NULL) without walking the children.  The tree model
+ * is expected to be frozen, thus no change signals are emitted. */
+static GNode *
+ml_uid_nodemap_insert_before (MessageList *message_list,
+                              CamelMessageInfo *info,
+                              GNode *sibling)
+{
+	GNode *node;
+
+	g_warn_if_fail (message_list->priv->tree_model_frozen > 0);
+
+	node = extended_g_node_new (info);
+	extended_g_node_insert_before (message_list->priv->tree_model_root, sibling, node);
+
+	ml_uid_nodemap_track (message_list, info, node);
+
+	return node;
+}
+
+static void
+ml_uid_nodemap_remove (MessageList *message_list,
+                       GNode *node)
+{
+	const gchar *uid;
+
+	g_warn_if_fail (message_list->priv->tree_model_frozen > 0);
+
+	uid = get_message_uid (message_list, node);
+
+	/* These point into the info, which is about to be freed. */
+	if (uid == message_list->priv->newest_read_uid) {
+		message_list->priv->newest_read_date = 0;
+		message_list->priv->newest_read_uid = NULL;
+	}
+
+	if (uid == message_list->priv->oldest_unread_uid) {
+		message_list->priv->oldest_unread_date = 0;
+		message_list->priv->oldest_unread_uid = NULL;
+	}
+
+	g_hash_table_remove (message_list->uid_nodemap, uid);
+	g_clear_object (&node->data);
+
+	message_list_tree_model_remove (message_list, node);
+}
+
 /* only call if we have a tree model */
 /* builds the tree structure */
 
@@ -4890,9 +5012,18 @@ static void	build_subtree			(MessageList *message_list,
 						 gboolean thread_latest,
 						 gint *row);
 
+static void
+build_tree_from_parents (MessageList *message_list,
+			 GPtrArray *summary,
+			 GHashTable *thread_parents,
+			 gboolean thread_flat,
+			 gboolean thread_latest);
+
 static void
 build_tree (MessageList *message_list,
             CamelFolderThread *thread,
+	    GPtrArray *summary,
+	    GHashTable *thread_parents,
 	    gboolean thread_flat,
 	    gboolean thread_latest,
             gboolean folder_changed)
@@ -4926,13 +5057,22 @@ build_tree (MessageList *message_list,
 
 	clear_tree (message_list, FALSE);
 
-	build_subtree (
-		message_list,
-		message_list->priv->tree_model_root,
-		thread ? camel_folder_thread_get_tree (thread) : NULL,
-		thread_flat,
-		thread_latest,
-		&row);
+	if (thread_parents) {
+		build_tree_from_parents (
+			message_list,
+			summary,
+			thread_parents,
+			thread_flat,
+			thread_latest);
+	} else {
+		build_subtree (
+			message_list,
+			message_list->priv->tree_model_root,
+			thread ? camel_folder_thread_get_tree (thread) : NULL,
+			thread_flat,
+			thread_latest,
+			&row);
+	}
 
 	message_list_tree_model_thaw (message_list);
 
@@ -4994,6 +5134,93 @@ build_subtree (MessageList *message_list,
 	}
 }
 
+static void
+build_tree_from_parents (MessageList *message_list,
+			 GPtrArray *summary,
+			 GHashTable *thread_parents,
+			 gboolean thread_flat,
+			 gboolean thread_latest)
+{
+	GHashTable *infos; /* gchar *uid ~> CamelMessageInfo * */
+	GPtrArray *chain;
+	guint ii;
+
+	if (!summary)
+		return;
+
+	infos = g_hash_table_new (g_str_hash, g_str_equal);
+	chain = g_ptr_array_new ();
+
+	for (ii = 0; ii < summary->len; ii++) {
+		CamelMessageInfo *info = summary->pdata[ii];
+
+		g_hash_table_insert (infos, (gpointer) camel_message_info_get_uid (info), info);
+	}
+
+	for (ii = 0; ii < summary->len; ii++) {
+		CamelMessageInfo *info = summary->pdata[ii];
+		GNode *parent = message_list->priv->tree_model_root;
+		const gchar *uid;
+		guint jj;
+
+		uid = camel_message_info_get_uid (info);
+
+		/* Ancestors are inserted before their descendants, thus
+		 * collect the not yet shown part of the thread first. */
+		g_ptr_array_set_size (chain, 0);
+
+		while (uid && chain->len <= summary->len) {
+			GNode *node;
+
+			node = g_hash_table_lookup (message_list->uid_nodemap, uid);
+			if (node) {
+				parent = node;
+				break;
+			}
+
+			info = g_hash_table_lookup (infos, uid);
+			if (!info)
+				break;
+
+			g_ptr_array_add (chain, info);
+			uid = g_hash_table_lookup (thread_parents, uid);
+		}
+
+		for (jj = chain->len; jj > 0; jj--) {
+			GNode *node;
+
+			info = g_ptr_array_index (chain, jj - 1);
+
+			/* Flat threads have all messages right below the thread root */
+			if (thread_flat && parent != message_list->priv->tree_model_root) {
+				while (parent->parent != message_list->priv->tree_model_root)
+					parent = parent->parent;
+			}
+
+			node = ml_uid_nodemap_insert (message_list, info, parent, -1);
+
+			if (thread_latest && thread_flat && parent != message_list->priv->tree_model_root &&
+			    parent->data && node->data) {
+				CamelMessageInfo *parent_nfo, *node_nfo;
+
+				parent_nfo = parent->data;
+				node_nfo = node->data;
+
+				if (camel_message_info_get_date_received (parent_nfo) < camel_message_info_get_date_received (node_nfo)) {
+					/* Swap the root node's message info with the added one, because the added is the latest */
+					parent->data = node_nfo;
+					node->data = parent_nfo;
+				}
+			}
+
+			parent = node;
+		}
+	}
+
+	g_ptr_array_unref (chain);
+	g_hash_table_destroy (infos);
+}
+
 static void
 build_flat (MessageList *message_list,
             GPtrArray *summary,
@@ -5026,6 +5253,8 @@ build_flat (MessageList *message_list,
 		ml_uid_nodemap_insert (message_list, info, NULL, -1);
 	}
 
+	message_list->priv->flat_tree_built = TRUE;
+
 	message_list_tree_model_thaw (message_list);
 
 	message_list_set_selected (message_list, selected);
@@ -5058,6 +5287,116 @@ build_flat (MessageList *message_list,
 
 }
 
+/* Updates a flat list in place: removes nodes whose UID is not part
+ * of the 'sorted_uids' and inserts nodes for the 'new_infos', keeping
+ * the 'sorted_uids' order.  Existing nodes and their infos are reused. */
+static void
+build_flat_incremental (MessageList *message_list,
+                        GPtrArray *sorted_uids,
+                        GPtrArray *new_infos,
+                        gboolean folder_changed,
+                        GHashTable *removed_uids)
+{
+	GHashTable *wanted_uids;
+	GHashTable *new_infos_by_uid;
+	GPtrArray *selected;
+	GNode *child;
+	gchar *saveuid = NULL;
+	guint ii;
+#ifdef TIMEIT
+	struct timeval start, end;
+	gulong diff;
+
+	printf ("Updating flat\n");
+	gettimeofday (&start, NULL);
+#endif
+
+	if (message_list->cursor_uid != NULL)
+		saveuid = find_next_selectable (message_list, removed_uids);
+
+	selected = message_list_get_selected (message_list);
+
+	wanted_uids = g_hash_table_new (g_str_hash, g_str_equal);
+	for (ii = 0; ii < sorted_uids->len; ii++)
+		g_hash_table_add (wanted_uids, sorted_uids->pdata[ii]);
+
+	new_infos_by_uid = g_hash_table_new (g_str_hash, g_str_equal);
+	for (ii = 0; new_infos && ii < new_infos->len; ii++) {
+		CamelMessageInfo *info = new_infos->pdata[ii];
+
+		g_hash_table_insert (new_infos_by_uid, (gpointer) camel_message_info_get_uid (info), info);
+	}
+
+	message_list_tree_model_freeze (message_list);
+
+	child = message_list->priv->tree_model_root->children;
+	while (child != NULL) {
+		GNode *next = child->next;
+
+		if (!g_hash_table_contains (wanted_uids, get_message_uid (message_list, child)))
+			ml_uid_nodemap_remove (message_list, child);
+
+		child = next;
+	}
+
+	/* Both lists are sorted the same way, thus merge them. */
+	child = message_list->priv->tree_model_root->children;
+	for (ii = 0; ii < sorted_uids->len; ii++) {
+		const gchar *uid = sorted_uids->pdata[ii];
+		CamelMessageInfo *info;
+
+		info = g_hash_table_lookup (new_infos_by_uid, uid);
+
+		if (!info) {
+			if (child && g_strcmp0 (get_message_uid (message_list, child), uid) == 0)
+				child = child->next;
+			continue;
+		}
+
+		if (!g_hash_table_contains (message_list->uid_nodemap, uid))
+			ml_uid_nodemap_insert_before (message_list, info, child);
+	}
+
+	message_list_tree_model_thaw (message_list);
+
+	g_hash_table_destroy (new_infos_by_uid);
+	g_hash_table_destroy (wanted_uids);
+
+	message_list_set_selected (message_list, selected);
+
+	g_ptr_array_unref (selected);
+
+	if (saveuid) {
+		GNode *node;
+
+		node = g_hash_table_lookup (
+			message_list->uid_nodemap, saveuid);
+		if (node == NULL) {
+			g_free (message_list->cursor_uid);
+			message_list->cursor_uid = NULL;
+			g_signal_emit (
+				message_list,
+				signals[MESSAGE_SELECTED], 0, NULL);
+		} else if (!folder_changed || !e_tree_get_item (E_TREE (message_list))) {
+			e_tree_set_cursor (E_TREE (message_list), node);
+		}
+		g_free (saveuid);
+	} else if (message_list->cursor_uid && !g_hash_table_contains (message_list->uid_nodemap, message_list->cursor_uid)) {
+		g_free (message_list->cursor_uid);
+		message_list->cursor_uid = NULL;
+		g_signal_emit (
+			message_list,
+			signals[MESSAGE_SELECTED], 0, NULL);
+	}
+
+#ifdef TIMEIT
+	gettimeofday (&end, NULL);
+	diff = end.tv_sec * 1000 + end.tv_usec / 1000;
+	diff -= start.tv_sec * 1000 + start.tv_usec / 1000;
+	printf ("Updating flat took %ld.%03ld seconds\n", diff / 1000, diff % 1000);
+#endif
+}
+
 static void
 message_list_change_first_visible_parent (MessageList *message_list,
                                           GNode *node)
@@ -5148,6 +5487,9 @@ message_list_folder_changed (CamelFolder *folder,
 	if (message_list->priv->destroyed)
 		return;
 
+	if (message_list->priv->thread_index)
+		e_mail_thread_index_note_changes (message_list->priv->thread_index, changes);
+
 	g_mutex_lock (&message_list->priv->regen_lock);
 	has_regen_task = message_list->priv->regen_task != NULL;
 	g_mutex_unlock (&message_list->priv->regen_lock);
@@ -5371,6 +5713,11 @@ message_list_set_folder (MessageList *message_list,
 		g_clear_object (&message_list->priv->folder);
 	}
 
+	if (message_list->priv->thread_index) {
+		message_list_save_thread_index (message_list->priv->thread_index);
+		g_clear_pointer (&message_list->priv->thread_index, e_mail_thread_index_unref);
+	}
+
 	g_free (message_list->cursor_uid);
 	message_list->cursor_uid = NULL;
 
@@ -5385,10 +5732,15 @@ message_list_set_folder (MessageList *message_list,
 		gint strikeout_col, strikeout_color_col;
 		ECell *cell;
 		gulong handler_id;
+		gchar *filename;
 
 		message_list->priv->folder = folder;
 		message_list->just_set_folder = TRUE;
 
+		filename = mail_config_folder_to_cachename (folder, "et-threads-");
+		message_list->priv->thread_index = e_mail_thread_index_new (filename);
+		g_free (filename);
+
 		non_trash_folder = !(camel_folder_get_flags (folder) & CAMEL_FOLDER_IS_TRASH);
 		non_junk_folder = !(camel_folder_get_flags (folder) & CAMEL_FOLDER_IS_JUNK);
 
@@ -6233,6 +6585,50 @@ message_list_regen_tweak_search_results (MessageList *message_list,
 	g_clear_object (&info);
 }
 
+/* Makes sure the thread index matches the folder content. It is read
+ * from the disk on the first use and updated from the noted folder
+ * changes afterwards; the whole folder is threaded only when there
+ * is no usable index stored yet. */
+static gboolean
+message_list_regen_prepare_thread_index (EMailThreadIndex *thread_index,
+					 CamelFolder *folder,
+					 GCancellable *cancellable)
+{
+	if (e_mail_thread_index_get_needs_reconcile (thread_index)) {
+		GPtrArray *folder_uids;
+
+		if (e_mail_thread_index_get_is_empty (thread_index))
+			e_mail_thread_index_load (thread_index);
+
+		folder_uids = camel_folder_dup_uids (folder);
+		if (!folder_uids)
+			return FALSE;
+
+		if (e_mail_thread_index_get_is_empty (thread_index)) {
+			CamelFolderThread *thread;
+
+			camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
+
+			thread = camel_folder_thread_new (folder, folder_uids, CAMEL_FOLDER_THREAD_FLAG_NONE);
+			e_mail_thread_index_fill_from_thread (thread_index, thread);
+			g_object_unref (thread);
+		} else {
+			e_mail_thread_index_reconcile (thread_index, folder, folder_uids, cancellable);
+		}
+
+		g_ptr_array_unref (folder_uids);
+
+		if (e_mail_thread_index_get_needs_reconcile (thread_index))
+			return FALSE;
+	} else {
+		e_mail_thread_index_apply_changes (thread_index, folder);
+	}
+
+	e_mail_thread_index_save_throttled (thread_index);
+
+	return TRUE;
+}
+
 static void
 message_list_regen_thread (GTask *task,
                            gpointer source_object,
@@ -6249,6 +6645,7 @@ message_list_regen_thread (GTask *task,
 	GString *expr;
 	gboolean hide_deleted;
 	gboolean hide_junk;
+	gint64 trace_begin;
 	GError *local_error = NULL;
 
 	message_list = MESSAGE_LIST (source_object);
@@ -6257,6 +6654,8 @@ message_list_regen_thread (GTask *task,
 	if (g_task_return_error_if_cancelled (task))
 		return;
 
+	trace_begin = e_trace_begin ();
+
 	/* Just for convenience. */
 	folder = g_object_ref (regen_data->folder);
 
@@ -6380,7 +6779,24 @@ message_list_regen_thread (GTask *task,
 	camel_folder_sort_uids (folder, uids);
 
 	/* update/build a new tree */
-	if (regen_data->group_by_threads) {
+	if (regen_data->group_by_threads && !regen_data->thread_subject &&
+	    regen_data->thread_index &&
+	    message_list_regen_prepare_thread_index (regen_data->thread_index, folder, cancellable)) {
+		guint ii;
+
+		regen_data->thread_uids = g_ptr_array_ref (uids);
+		regen_data->thread_parents = e_mail_thread_index_dup_parents (regen_data->thread_index, uids);
+		regen_data->summary = g_ptr_array_sized_new (uids->len);
+
+		camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
+
+		for (ii = 0; ii < uids->len; ii++) {
+			info = camel_folder_get_message_info (folder, g_ptr_array_index (uids, ii));
+			if (info != NULL)
+				g_ptr_array_add (regen_data->summary, info);
+		}
+
+	} else if (regen_data->group_by_threads) {
 		CamelFolderThread *thread_tree;
 
 		/* Always build a new thread_tree, to avoid race condition
@@ -6397,16 +6813,46 @@ message_list_regen_thread (GTask *task,
 		regen_data->thread_tree = thread_tree;
 
 	} else {
+		GHashTable *shown_uids = regen_data->shown_uids;
 		guint ii;
 
-		regen_data->summary = g_ptr_array_sized_new (uids->len);
+		if (shown_uids) {
+			guint n_shown, n_new = 0, n_removed;
 
-		camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
+			for (ii = 0; ii < uids->len; ii++) {
+				if (!g_hash_table_contains (shown_uids, uids->pdata[ii]))
+					n_new++;
+			}
+
+			n_shown = g_hash_table_size (shown_uids);
+			n_removed = n_shown - MIN (n_shown, uids->len - n_new);
+
+			/* Rebuild from scratch when the content mostly changed. */
+			if (n_new + n_removed > MAX (n_shown, uids->len) / 2) {
+				g_clear_pointer (&regen_data->shown_uids, g_hash_table_unref);
+				shown_uids = NULL;
+			} else {
+				regen_data->sorted_uids = g_ptr_array_ref (uids);
+			}
+
+			dd (g_print ("   %s: %s regen of folder %p, shown:%u new:%u removed:%u\n", G_STRFUNC,
+				shown_uids ? "incremental" : "full", folder, n_shown, n_new, n_removed));
+		}
+
+		regen_data->summary = g_ptr_array_sized_new (shown_uids ? 16 : uids->len);
+
+		if (!shown_uids)
+			camel_folder_summary_prepare_fetch_all (camel_folder_get_folder_summary (folder), NULL);
 
 		for (ii = 0; ii < uids->len; ii++) {
 			const gchar *uid;
 
 			uid = g_ptr_array_index (uids, ii);
+
+			/* Already in the list, only new UIDs are needed. */
+			if (shown_uids && g_hash_table_contains (shown_uids, uid))
+				continue;
+
 			info = camel_folder_get_message_info (folder, uid);
 			if (info != NULL)
 				g_ptr_array_add (regen_data->summary, info);
@@ -6421,6 +6867,8 @@ exit:
 	else if (uids != NULL)
 		g_ptr_array_unref (uids);
 
+	e_trace_end (trace_begin, "mail", "regen-list-thread", camel_folder_get_full_name (folder));
+
 	g_object_unref (folder);
 	g_clear_error (&local_error);
 }
@@ -6596,6 +7044,9 @@ message_list_regen_done_cb (GObject *source_object,
 	regen_data = g_task_get_task_data (G_TASK (result));
 	g_task_propagate_boolean (G_TASK (result), &local_error);
 
+	e_trace_end (regen_data->trace_begin, "mail", "regen-list",
+		regen_data->folder ? camel_folder_get_full_name (regen_data->folder) : NULL);
+
 	/* Withdraw our RegenData from the private struct, if it hasn't
 	 * already been replaced.  We have exclusive access to it now. */
 	g_mutex_lock (&message_list->priv->regen_lock);
@@ -6714,6 +7165,8 @@ message_list_regen_done_cb (GObject *source_object,
 		build_tree (
 			message_list,
 			regen_data->thread_tree,
+			regen_data->summary,
+			regen_data->thread_parents,
 			regen_data->thread_flat,
 			regen_data->thread_latest,
 			regen_data->folder_changed);
@@ -6806,6 +7259,13 @@ message_list_regen_done_cb (GObject *source_object,
 				message_list,
 				signals[MESSAGE_SELECTED], 0, NULL);
 		}
+	} else if (regen_data->sorted_uids) {
+		build_flat_incremental (
+			message_list,
+			regen_data->sorted_uids,
+			regen_data->summary,
+			regen_data->folder_changed,
+			regen_data->removed_uids);
 	} else {
 		build_flat (
 			message_list,
@@ -6993,6 +7453,26 @@ message_list_regen_idle_cb (gpointer user_data)
 	if (regen_data->select_unread)
 		message_list_set_regen_selects_unread (message_list, FALSE);
 
+	/* A changed search or flag filter of an already shown flat list
+	 * only adds and removes rows; remember what is shown, thus the list
+	 * can be updated in place, instead of being rebuilt from scratch. */
+	if (!regen_data->group_by_threads &&
+	    !regen_data->folder_changed &&
+	    !message_list->just_set_folder &&
+	    message_list->priv->flat_tree_built &&
+	    regen_data->folder == message_list->priv->folder &&
+	    g_hash_table_size (message_list->uid_nodemap) > 0) {
+		GHashTableIter iter;
+		gpointer key;
+
+		regen_data->shown_uids = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+		g_hash_table_iter_init (&iter, message_list->uid_nodemap);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			g_hash_table_add (regen_data->shown_uids, (gpointer) camel_pstring_strdup (key));
+		}
+	}
+
 	searching = message_list_is_searching (message_list);
 
 	adapter = e_tree_get_table_adapter (E_TREE (message_list));
@@ -7194,6 +7674,53 @@ exit:
 	g_free (tmp_search_copy);
 }
 
+/* Returns UIDs of up to 'n_around' messages shown after and before
+   the cursor, the nearest first, alternating the next and the previous. */
+GPtrArray *
+message_list_dup_neighbour_uids (MessageList *message_list,
+				 guint n_around)
+{
+	ETreeTableAdapter *adapter;
+	GPtrArray *uids;
+	GNode *node;
+	gint row, row_count;
+	gint ii;
+
+	g_return_val_if_fail (IS_MESSAGE_LIST (message_list), NULL);
+
+	uids = g_ptr_array_new_with_free_func (g_free);
+
+	if (!message_list->cursor_uid || !n_around)
+		return uids;
+
+	node = g_hash_table_lookup (message_list->uid_nodemap, message_list->cursor_uid);
+	if (!node)
+		return uids;
+
+	adapter = e_tree_get_table_adapter (E_TREE (message_list));
+	row_count = e_table_model_row_count (E_TABLE_MODEL (adapter));
+
+	row = e_tree_table_adapter_row_of_node (adapter, node);
+	if (row == -1)
+		return uids;
+
+	for (ii = 1; ii <= (gint) n_around; ii++) {
+		if (row + ii < row_count) {
+			node = e_tree_table_adapter_node_at_row (adapter, row + ii);
+			if (node && node->data)
+				g_ptr_array_add (uids, g_strdup (get_message_uid (message_list, node)));
+		}
+
+		if (row - ii >= 0) {
+			node = e_tree_table_adapter_node_at_row (adapter, row - ii);
+			if (node && node->data)
+				g_ptr_array_add (uids, g_strdup (get_message_uid (message_list, node)));
+		}
+	}
+
+	return uids;
+}
+
 gboolean
 message_list_contains_uid (MessageList *message_list,
 			   const gchar *uid)
@@ -227,6 +227,8 @@ void		message_list_sort_uids		(MessageList *message_list,
 						 GPtrArray *uids);
 gboolean	message_list_contains_uid	(MessageList *message_list,
 						 const gchar *uid);
+GPtrArray *	message_list_dup_neighbour_uids	(MessageList *message_list,
+						 guint n_around);
 void		message_list_inc_setting_up_search_folder
 						(MessageList *message_list);
 void		message_list_dec_setting_up_search_folder
@@ -6,7 +6,9 @@
 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <string.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 
 #include <camel/camel.h>
 
@@ -24,6 +26,15 @@
 #define BOGOFILTER_EXIT_STATUS_UNSURE		2
 #define BOGOFILTER_EXIT_STATUS_ERROR		3
 
+/* Messages are classified by one long-lived Bogofilter process
+ * running in bulk mode, which reads names of message files from
+ * its stdin and answers each of them with a line of output.  It
+ * is stopped after being idle for a while, before learning (so it
+ * does not hold the wordlist open) and whenever it misbehaves. */
+#define BOGOFILTER_BULK_REPLY_TIMEOUT_SECONDS	30
+#define BOGOFILTER_BULK_IDLE_SECONDS		10
+#define BOGOFILTER_BULK_MAX_FAILURES		3
+
 typedef struct _EBogofilter EBogofilter;
 typedef struct _EBogofilterClass EBogofilterClass;
 
@@ -31,6 +42,16 @@ struct _EBogofilter {
 	EMailJunkFilter parent;
 	gboolean convert_to_unicode;
 	gchar *command;
+
+	GMutex bulk_lock;
+	GSubprocess *bulk_process;
+	GOutputStream *bulk_stdin;
+	GDataInputStream *bulk_stdout;
+	gchar *bulk_command;	/* command line the process runs */
+	gchar *bulk_filename;	/* file the messages are passed in */
+	gint64 bulk_last_used;
+	guint bulk_idle_id;
+	guint bulk_n_failures;
 };
 
 struct _EBogofilterClass {
@@ -218,6 +239,353 @@ bogofilter_command (const gchar **argv,
 	return source_data.exit_code;
 }
 
+static void
+bogofilter_bulk_stop_locked (EBogofilter *extension,
+                             gboolean force)
+{
+	if (extension->bulk_process) {
+		/* Closing the stdin lets the process finish on its own. */
+		if (force)
+			g_subprocess_force_exit (extension->bulk_process);
+		else
+			g_output_stream_close (extension->bulk_stdin, NULL, NULL);
+	}
+
+	g_clear_object (&extension->bulk_stdin);
+	g_clear_object (&extension->bulk_stdout);
+	g_clear_object (&extension->bulk_process);
+	g_clear_pointer (&extension->bulk_command, g_free);
+
+	if (extension->bulk_filename) {
+		g_unlink (extension->bulk_filename);
+		g_clear_pointer (&extension->bulk_filename, g_free);
+	}
+}
+
+static void
+bogofilter_bulk_stop (EBogofilter *extension)
+{
+	g_mutex_lock (&extension->bulk_lock);
+	bogofilter_bulk_stop_locked (extension, FALSE);
+	g_mutex_unlock (&extension->bulk_lock);
+}
+
+static gboolean
+bogofilter_bulk_idle_cb (gpointer user_data)
+{
+	EBogofilter *extension = user_data;
+	gboolean keep_running = FALSE;
+
+	g_mutex_lock (&extension->bulk_lock);
+
+	if (extension->bulk_process && g_get_monotonic_time () - extension->bulk_last_used <
+	    (gint64) BOGOFILTER_BULK_IDLE_SECONDS * G_USEC_PER_SEC) {
+		keep_running = TRUE;
+	} else {
+		bogofilter_bulk_stop_locked (extension, FALSE);
+		extension->bulk_idle_id = 0;
+	}
+
+	g_mutex_unlock (&extension->bulk_lock);
+
+	return keep_running ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+static gboolean
+bogofilter_bulk_start_locked (EBogofilter *extension,
+                              const gchar **argv,
+                              GError **error)
+{
+	GInputStream *stdout_pipe;
+	const gchar *bulk_argv[5];
+	gchar *command_line;
+	gint ii, jj = 0;
+	gint fd;
+
+	command_line = g_strjoinv (" ", (gchar **) argv);
+
+	if (extension->bulk_process && g_strcmp0 (command_line, extension->bulk_command) == 0) {
+		g_free (command_line);
+		return TRUE;
+	}
+
+	bogofilter_bulk_stop_locked (extension, FALSE);
+
+	fd = g_file_open_tmp ("evolution-bogofilter-XXXXXX", &extension->bulk_filename, error);
+	if (fd == -1) {
+		g_free (command_line);
+		return FALSE;
+	}
+
+	g_close (fd, NULL);
+
+	bulk_argv[jj++] = argv[0];
+	bulk_argv[jj++] = "-b";  /* read names of message files from stdin */
+	bulk_argv[jj++] = "-t";  /* terse output */
+	for (ii = 1; argv[ii] && jj < G_N_ELEMENTS (bulk_argv) - 1; ii++)
+		bulk_argv[jj++] = argv[ii];
+	bulk_argv[jj] = NULL;
+
+	extension->bulk_process = g_subprocess_newv (
+		bulk_argv,
+		G_SUBPROCESS_FLAGS_STDIN_PIPE |
+		G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+		G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+		error);
+
+	if (!extension->bulk_process) {
+		g_prefix_error (
+			error, _("Failed to spawn Bogofilter (%s): "),
+			command_line);
+		g_free (command_line);
+		bogofilter_bulk_stop_locked (extension, TRUE);
+		return FALSE;
+	}
+
+	/* The reply is waited for with a timeout, thus the output
+	 * has to be pollable, which it is not on all platforms. */
+	stdout_pipe = g_subprocess_get_stdout_pipe (extension->bulk_process);
+	if (!G_IS_POLLABLE_INPUT_STREAM (stdout_pipe) ||
+	    !g_pollable_input_stream_can_poll (G_POLLABLE_INPUT_STREAM (stdout_pipe))) {
+		g_set_error_literal (
+			error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			"Cannot poll output of the Bogofilter process");
+		g_free (command_line);
+		bogofilter_bulk_stop_locked (extension, TRUE);
+		return FALSE;
+	}
+
+	extension->bulk_stdin = g_object_ref (g_subprocess_get_stdin_pipe (extension->bulk_process));
+	extension->bulk_stdout = g_data_input_stream_new (stdout_pipe);
+	extension->bulk_command = command_line;
+
+	return TRUE;
+}
+
+static gboolean
+bogofilter_bulk_readable_cb (GObject *pollable_stream,
+                             gpointer user_data)
+{
+	gint *state = user_data;
+
+	if (*state == 0)
+		*state = 1;
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+bogofilter_bulk_timeout_cb (gpointer user_data)
+{
+	gint *state = user_data;
+
+	if (*state == 0)
+		*state = 2;
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+bogofilter_bulk_wait_reply (EBogofilter *extension,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	GPollableInputStream *pollable;
+	GMainContext *context;
+	GSource *readable_source;
+	GSource *timeout_source;
+	gint state = 0;  /* 0 = waiting, 1 = readable, 2 = timed out */
+
+	if (g_buffered_input_stream_get_available (G_BUFFERED_INPUT_STREAM (extension->bulk_stdout)) > 0)
+		return TRUE;
+
+	pollable = G_POLLABLE_INPUT_STREAM (g_filter_input_stream_get_base_stream (
+		G_FILTER_INPUT_STREAM (extension->bulk_stdout)));
+
+	if (g_pollable_input_stream_is_readable (pollable))
+		return TRUE;
+
+	context = g_main_context_new ();
+
+	/* The pollable source is also dispatched on cancel. */
+	readable_source = g_pollable_input_stream_create_source (pollable, cancellable);
+	g_source_set_callback (
+		readable_source, (GSourceFunc)
+		bogofilter_bulk_readable_cb,
+		&state, NULL);
+	g_source_attach (readable_source, context);
+
+	timeout_source = g_timeout_source_new_seconds (BOGOFILTER_BULK_REPLY_TIMEOUT_SECONDS);
+	g_source_set_callback (
+		timeout_source,
+		bogofilter_bulk_timeout_cb,
+		&state, NULL);
+	g_source_attach (timeout_source, context);
+
+	while (state == 0)
+		g_main_context_iteration (context, TRUE);
+
+	g_source_destroy (readable_source);
+	g_source_unref (readable_source);
+	g_source_destroy (timeout_source);
+	g_source_unref (timeout_source);
+	g_main_context_unref (context);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return FALSE;
+
+	if (state == 2) {
+		g_set_error_literal (
+			error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+			"Bogofilter did not reply in time");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns FALSE when the bulk process cannot be used, in which case
+ * the message should be classified by a Bogofilter process of its own.
+ * When TRUE is returned, the @out_exit_code and the @error are set. */
+static gboolean
+bogofilter_bulk_classify (EBogofilter *extension,
+                          const gchar **argv,
+                          CamelMimeMessage *message,
+                          gint *out_exit_code,
+                          GCancellable *cancellable,
+                          GError **error)
+{
+	CamelStream *stream;
+	gchar *reply = NULL;
+	gboolean success;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&extension->bulk_lock);
+
+	if (extension->bulk_n_failures >= BOGOFILTER_BULK_MAX_FAILURES) {
+		g_mutex_unlock (&extension->bulk_lock);
+		return FALSE;
+	}
+
+	success = bogofilter_bulk_start_locked (extension, argv, &local_error);
+
+	if (success) {
+		stream = camel_stream_fs_new_with_name (
+			extension->bulk_filename,
+			O_WRONLY | O_CREAT | O_TRUNC, 0600,
+			&local_error);
+
+		success = stream &&
+			camel_data_wrapper_write_to_stream_sync (
+				CAMEL_DATA_WRAPPER (message), stream,
+				cancellable, &local_error) >= 0 &&
+			camel_stream_close (stream, cancellable, &local_error) == 0;
+
+		g_clear_object (&stream);
+	}
+
+	if (success) {
+		gchar *request;
+
+		request = g_strconcat (extension->bulk_filename, "\n", NULL);
+
+		success = g_output_stream_write_all (
+				extension->bulk_stdin, request, strlen (request),
+				NULL, cancellable, &local_error) &&
+			g_output_stream_flush (
+				extension->bulk_stdin, cancellable, &local_error);
+
+		g_free (request);
+	}
+
+	if (success)
+		success = bogofilter_bulk_wait_reply (extension, cancellable, &local_error);
+
+	if (success) {
+		reply = g_data_input_stream_read_line (
+			extension->bulk_stdout, NULL, cancellable, &local_error);
+
+		if (!reply && !local_error)
+			g_set_error_literal (
+				&local_error, G_IO_ERROR, G_IO_ERROR_CLOSED,
+				"Bogofilter exited unexpectedly");
+
+		success = reply != NULL;
+	}
+
+	if (success) {
+		gsize filename_len = strlen (extension->bulk_filename);
+
+		/* The reply is the file name followed by the terse
+		 * result, like "/tmp/evolution-bogofilter-XXXXXX S 0.999". */
+		success = strncmp (reply, extension->bulk_filename, filename_len) == 0;
+
+		if (success) {
+			const gchar *result = reply + filename_len;
+
+			while (g_ascii_isspace (*result))
+				result++;
+
+			switch (*result) {
+				case 'S':
+					*out_exit_code = BOGOFILTER_EXIT_STATUS_SPAM;
+					break;
+				case 'H':
+					*out_exit_code = BOGOFILTER_EXIT_STATUS_HAM;
+					break;
+				case 'U':
+					*out_exit_code = BOGOFILTER_EXIT_STATUS_UNSURE;
+					break;
+				default:
+					success = FALSE;
+					break;
+			}
+		}
+
+		if (!success)
+			g_set_error (
+				&local_error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				"Unexpected reply from Bogofilter: %s", reply);
+	}
+
+	g_free (reply);
+
+	if (success) {
+		extension->bulk_n_failures = 0;
+		extension->bulk_last_used = g_get_monotonic_time ();
+
+		if (!extension->bulk_idle_id) {
+			extension->bulk_idle_id = e_named_timeout_add_seconds_full (
+				G_PRIORITY_LOW, BOGOFILTER_BULK_IDLE_SECONDS,
+				bogofilter_bulk_idle_cb,
+				g_object_ref (extension),
+				g_object_unref);
+		}
+	} else if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		/* The process may be in the middle of a message. */
+		bogofilter_bulk_stop_locked (extension, TRUE);
+
+		*out_exit_code = BOGOFILTER_EXIT_STATUS_ERROR;
+		g_propagate_error (error, local_error);
+		local_error = NULL;
+		success = TRUE;
+	} else {
+		extension->bulk_n_failures++;
+
+		g_debug (
+			"Bogofilter: Bulk mode failed (%s), "
+			"using a process per message",
+			local_error ? local_error->message : "Unknown error");
+
+		bogofilter_bulk_stop_locked (extension, TRUE);
+		g_clear_error (&local_error);
+	}
+
+	g_mutex_unlock (&extension->bulk_lock);
+
+	return success;
+}
+
 static void
 bogofilter_init_wordlist (EBogofilter *extension)
 {
@@ -334,6 +702,9 @@ bogofilter_finalize (GObject *object)
 {
 	EBogofilter *extension = E_BOGOFILTER (object);
 
+	bogofilter_bulk_stop_locked (extension, FALSE);
+	g_mutex_clear (&extension->bulk_lock);
+
 	g_free (extension->command);
 	extension->command = NULL;
 
@@ -401,7 +772,8 @@ bogofilter_classify (CamelJunkFilter *junk_filter,
 		argv[1] = "--unicode=yes";
 
 retry:
-	exit_code = bogofilter_command (argv, message, cancellable, error);
+	if (!bogofilter_bulk_classify (extension, argv, message, &exit_code, cancellable, error))
+		exit_code = bogofilter_command (argv, message, cancellable, error);
 
 	switch (exit_code) {
 		case BOGOFILTER_EXIT_STATUS_SPAM:
@@ -418,7 +790,8 @@ retry:
 
 		case BOGOFILTER_EXIT_STATUS_ERROR:
 			status = CAMEL_JUNK_STATUS_ERROR;
-			if (!wordlist_initialized) {
+			if (!wordlist_initialized &&
+			    !g_cancellable_is_cancelled (cancellable)) {
 				wordlist_initialized = TRUE;
 				bogofilter_init_wordlist (extension);
 				goto retry;
@@ -460,6 +833,9 @@ bogofilter_learn_junk (CamelJunkFilter *junk_filter,
 	if (bogofilter_get_convert_to_unicode (extension))
 		argv[2] = "--unicode=yes";
 
+	/* Do not keep the wordlist open while it is being updated. */
+	bogofilter_bulk_stop (extension);
+
 	exit_code = bogofilter_command (argv, message, cancellable, error);
 
 	if (exit_code != 0)
@@ -495,6 +871,9 @@ bogofilter_learn_not_junk (CamelJunkFilter *junk_filter,
 	if (bogofilter_get_convert_to_unicode (extension))
 		argv[2] = "--unicode=yes";
 
+	/* Do not keep the wordlist open while it is being updated. */
+	bogofilter_bulk_stop (extension);
+
 	exit_code = bogofilter_command (argv, message, cancellable, error);
 
 	if (exit_code != 0)
@@ -571,6 +950,8 @@ e_bogofilter_init (EBogofilter *extension)
 {
 	GSettings *settings;
 
+	g_mutex_init (&extension->bulk_lock);
+
 	settings = e_util_ref_settings ("org.gnome.evolution.bogofilter");
 	g_settings_bind (
 		settings, "utf8-for-spam-filter",
@@ -162,6 +162,36 @@ rss_folder_get_message_sync (CamelFolder *folder,
 	return message;
 }
 
+/* Stop reading the feed after this many items in a row, which are not newer
+   than the last update; the feeds are usually sorted from the newest. */
+#define MAX_KNOWN_ITEMS_IN_A_ROW 20
+
+typedef struct _CollectFeedsData {
+	gint64 last_updated;
+	guint n_known_in_a_row;
+	GSList *feeds; /* ERssFeed * */
+} CollectFeedsData;
+
+static gboolean
+rss_folder_collect_new_feed_cb (ERssFeed *feed,
+				gpointer user_data)
+{
+	CollectFeedsData *cfd = user_data;
+
+	if (feed->last_modified > cfd->last_updated) {
+		cfd->feeds = g_slist_prepend (cfd->feeds, feed);
+		cfd->n_known_in_a_row = 0;
+	} else {
+		e_rss_feed_free (feed);
+		cfd->n_known_in_a_row++;
+
+		if (cfd->last_updated > 0 && cfd->n_known_in_a_row >= MAX_KNOWN_ITEMS_IN_A_ROW)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 rss_folder_refresh_info_sync (CamelFolder *folder,
 			      GCancellable *cancellable,
@@ -206,7 +236,7 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 		SoupSession *soup_session;
 		SoupMessageHeaders *request_headers;
 		SoupMessage *message;
-		GBytes *bytes;
+		GInputStream *stream;
 		GError *local_error = NULL;
 
 		message = soup_message_new (SOUP_METHOD_GET, href);
@@ -217,35 +247,23 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 			return FALSE;
 		}
 
-		soup_session = soup_session_new_with_options (
-			"timeout", 30,
-			"user-agent", "Evolution/" VERSION,
-			NULL);
-
-		if (camel_debug ("rss")) {
-			SoupLogger *logger;
-
-			logger = soup_logger_new (SOUP_LOGGER_LOG_BODY);
-			soup_session_add_feature (soup_session, SOUP_SESSION_FEATURE (logger));
-			g_object_unref (logger);
-		}
+		soup_session = camel_rss_store_ref_soup_session (rss_store);
 
 		request_headers = soup_message_get_request_headers (message);
 
-		soup_message_headers_append (request_headers, "Connection", "close");
-
 		if (last_etag && *last_etag)
 			soup_message_headers_append (request_headers, "If-None-Match", last_etag);
 		else if (last_modified && *last_modified)
 			soup_message_headers_append (request_headers, "If-Modified-Since", last_modified);
 
-		bytes = soup_session_send_and_read (soup_session, message, cancellable, &local_error);
+		stream = soup_session_send (soup_session, message, cancellable, &local_error);
 
 		if (soup_message_get_status (message) == SOUP_STATUS_NOT_MODIFIED) {
 			g_clear_error (&local_error);
-		} else if (bytes) {
+		} else if (stream) {
 			GSList *feeds = NULL;
 			gboolean save_summary = FALSE;
+			gboolean parsed = FALSE;
 
 			success = SOUP_STATUS_IS_SUCCESSFUL (soup_message_get_status (message));
 
@@ -257,7 +275,30 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 					soup_status_get_phrase (soup_message_get_status (message)));
 			}
 
-			if (success && e_rss_parser_parse ((const gchar *) g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes), NULL, NULL, NULL, NULL, &feeds)) {
+			if (success) {
+				CollectFeedsData cfd = { 0, };
+
+				cfd.last_updated = last_updated;
+
+				/* Only the new items are kept in memory */
+				parsed = e_rss_parser_parse_stream (stream, NULL, NULL, NULL, NULL,
+					rss_folder_collect_new_feed_cb, &cfd, cancellable, &local_error);
+
+				feeds = g_slist_reverse (cfd.feeds);
+
+				g_input_stream_close (stream, NULL, NULL);
+
+				/* A parse error or a network error in the middle of the body;
+				   do not remember the ETag and the Last-Modified of the response,
+				   thus the feed is downloaded again on the next refresh */
+				if (!parsed) {
+					success = FALSE;
+					g_propagate_error (error, local_error);
+					local_error = NULL;
+				}
+			}
+
+			if (parsed) {
 				CamelSettings *settings;
 				CamelRssSettings *rss_settings;
 				gboolean download_complete_article;
@@ -307,15 +348,16 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 							max_last_modified = feed->last_modified;
 
 						if (download_complete_article && feed->link) {
-							g_clear_object (&message);
-							g_clear_pointer (&bytes, g_bytes_unref);
+							SoupMessage *article_message;
 
-							message = soup_message_new (SOUP_METHOD_GET, feed->link);
-							if (message) {
-								complete_article = soup_session_send_and_read (soup_session, message, cancellable, NULL);
+							article_message = soup_message_new (SOUP_METHOD_GET, feed->link);
+							if (article_message) {
+								complete_article = soup_session_send_and_read (soup_session, article_message, cancellable, NULL);
 
-								if (!SOUP_STATUS_IS_SUCCESSFUL (soup_message_get_status (message)))
+								if (!SOUP_STATUS_IS_SUCCESSFUL (soup_message_get_status (article_message)))
 									g_clear_pointer (&complete_article, g_bytes_unref);
+
+								g_object_unref (article_message);
 							}
 						}
 
@@ -328,15 +370,16 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 								if (limit_feed_enclosure_size && enclosure->size > max_feed_enclosure_size)
 									continue;
 
-								g_clear_object (&message);
-								g_clear_pointer (&bytes, g_bytes_unref);
+								SoupMessage *enclosure_message;
 
-								message = soup_message_new (SOUP_METHOD_GET, enclosure->href);
-								if (message) {
-									enclosure->data = soup_session_send_and_read (soup_session, message, cancellable, NULL);
+								enclosure_message = soup_message_new (SOUP_METHOD_GET, enclosure->href);
+								if (enclosure_message) {
+									enclosure->data = soup_session_send_and_read (soup_session, enclosure_message, cancellable, NULL);
 
-									if (!SOUP_STATUS_IS_SUCCESSFUL (soup_message_get_status (message)))
+									if (!SOUP_STATUS_IS_SUCCESSFUL (soup_message_get_status (enclosure_message)))
 										g_clear_pointer (&enclosure->data, g_bytes_unref);
+
+									g_object_unref (enclosure_message);
 								}
 							}
 						}
@@ -397,9 +440,10 @@ rss_folder_refresh_info_sync (CamelFolder *folder,
 				g_propagate_error (error, local_error);
 		}
 
-		g_clear_pointer (&bytes, g_bytes_unref);
-		g_clear_object (&soup_session);
+		g_clear_object (&stream);
 		g_clear_object (&message);
+
+		camel_rss_store_release_soup_session (rss_store, soup_session);
 	} else {
 		g_set_error (error, CAMEL_FOLDER_ERROR, CAMEL_FOLDER_ERROR_INVALID, _("Invalid Feed URL."));
 		success = FALSE;
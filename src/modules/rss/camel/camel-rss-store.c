@@ -15,20 +15,32 @@
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 #include <libedataserver/libedataserver.h>
+#include <libsoup/soup.h>
 
 #include "camel-rss-folder.h"
 #include "camel-rss-settings.h"
 #include "camel-rss-store-summary.h"
 #include "camel-rss-store.h"
 
+/* How many unused sessions to keep around for reuse */
+#define MAX_IDLE_SOUP_SESSIONS 8
+
+/* Feeds are independent downloads, not limited by a single connection
+   to the server, thus several of them can be refreshed at once. */
+#define MAX_PARALLEL_REFRESHES 8
+
 struct _CamelRssStorePrivate {
 	CamelDataCache *cache;
 	CamelRssStoreSummary *summary;
+
+	GMutex soup_sessions_lock;
+	GSList *idle_soup_sessions; /* SoupSession * */
 };
 
 enum {
 	PROP_0,
 	PROP_SUMMARY,
+	PROP_MAX_PARALLEL_REFRESHES,
 	N_PROPS
 };
 
@@ -254,6 +266,10 @@ rss_store_get_property (GObject *object,
 				camel_rss_store_get_summary (
 				CAMEL_RSS_STORE (object)));
 			return;
+
+		case PROP_MAX_PARALLEL_REFRESHES:
+			g_value_set_uint (value, MAX_PARALLEL_REFRESHES);
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -276,10 +292,26 @@ rss_store_dispose (GObject *object)
 	g_clear_object (&self->priv->cache);
 	g_clear_object (&self->priv->summary);
 
+	g_mutex_lock (&self->priv->soup_sessions_lock);
+	g_slist_free_full (self->priv->idle_soup_sessions, g_object_unref);
+	self->priv->idle_soup_sessions = NULL;
+	g_mutex_unlock (&self->priv->soup_sessions_lock);
+
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (camel_rss_store_parent_class)->dispose (object);
 }
 
+static void
+rss_store_finalize (GObject *object)
+{
+	CamelRssStore *self = CAMEL_RSS_STORE (object);
+
+	g_mutex_clear (&self->priv->soup_sessions_lock);
+
+	/* Chain up to parent's method. */
+	G_OBJECT_CLASS (camel_rss_store_parent_class)->finalize (object);
+}
+
 static void
 camel_rss_store_class_init (CamelRssStoreClass *klass)
 {
@@ -290,6 +322,7 @@ camel_rss_store_class_init (CamelRssStoreClass *klass)
 	object_class = G_OBJECT_CLASS (klass);
 	object_class->get_property = rss_store_get_property;
 	object_class->dispose = rss_store_dispose;
+	object_class->finalize = rss_store_finalize;
 
 	service_class = CAMEL_SERVICE_CLASS (klass);
 	service_class->settings_type = CAMEL_TYPE_RSS_SETTINGS;
@@ -310,6 +343,15 @@ camel_rss_store_class_init (CamelRssStoreClass *klass)
 			G_PARAM_READABLE |
 			G_PARAM_STATIC_STRINGS);
 
+	/* Read by the send/receive code, which refreshes up to this many
+	   folders of the store at once, instead of one after another. */
+	properties[PROP_MAX_PARALLEL_REFRESHES] =
+		g_param_spec_uint (
+			"max-parallel-refreshes", NULL, NULL,
+			1, G_MAXUINT, MAX_PARALLEL_REFRESHES,
+			G_PARAM_READABLE |
+			G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -378,6 +420,8 @@ camel_rss_store_init (CamelRssStore *self)
 {
 	self->priv = camel_rss_store_get_instance_private (self);
 
+	g_mutex_init (&self->priv->soup_sessions_lock);
+
 	camel_store_set_flags (CAMEL_STORE (self), 0);
 }
 
@@ -396,3 +440,60 @@ camel_rss_store_get_summary (CamelRssStore *self)
 
 	return self->priv->summary;
 }
+
+/* Returns a session to download the feeds with. It can be used by one
+   thread at a time; give it back with camel_rss_store_release_soup_session(),
+   thus its open connections are reused by the next feed refresh. */
+SoupSession *
+camel_rss_store_ref_soup_session (CamelRssStore *self)
+{
+	SoupSession *session = NULL;
+
+	g_return_val_if_fail (CAMEL_IS_RSS_STORE (self), NULL);
+
+	g_mutex_lock (&self->priv->soup_sessions_lock);
+
+	if (self->priv->idle_soup_sessions) {
+		session = self->priv->idle_soup_sessions->data;
+		self->priv->idle_soup_sessions = g_slist_remove (self->priv->idle_soup_sessions, session);
+	}
+
+	g_mutex_unlock (&self->priv->soup_sessions_lock);
+
+	if (!session) {
+		/* HTTP/2 is negotiated by the libsoup itself, when the server supports it */
+		session = soup_session_new_with_options (
+			"timeout", 30,
+			"user-agent", "Evolution/" VERSION,
+			NULL);
+
+		if (camel_debug ("rss")) {
+			SoupLogger *logger;
+
+			logger = soup_logger_new (SOUP_LOGGER_LOG_BODY);
+			soup_session_add_feature (session, SOUP_SESSION_FEATURE (logger));
+			g_object_unref (logger);
+		}
+	}
+
+	return session;
+}
+
+void
+camel_rss_store_release_soup_session (CamelRssStore *self,
+				      SoupSession *session)
+{
+	g_return_if_fail (CAMEL_IS_RSS_STORE (self));
+	g_return_if_fail (SOUP_IS_SESSION (session));
+
+	g_mutex_lock (&self->priv->soup_sessions_lock);
+
+	if (g_slist_length (self->priv->idle_soup_sessions) < MAX_IDLE_SOUP_SESSIONS) {
+		self->priv->idle_soup_sessions = g_slist_prepend (self->priv->idle_soup_sessions, session);
+		session = NULL;
+	}
+
+	g_mutex_unlock (&self->priv->soup_sessions_lock);
+
+	g_clear_object (&session);
+}
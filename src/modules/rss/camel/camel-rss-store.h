@@ -7,6 +7,7 @@
 #define CAMEL_RSS_STORE_H
 
 #include <camel/camel.h>
+#include <libsoup/soup.h>
 
 #include "camel-rss-store-summary.h"
 
@@ -48,6 +49,11 @@ GType		camel_rss_store_get_type	(void);
 CamelDataCache *camel_rss_store_get_cache	(CamelRssStore *self);
 CamelRssStoreSummary *
 		camel_rss_store_get_summary	(CamelRssStore *self);
+SoupSession *	camel_rss_store_ref_soup_session
+						(CamelRssStore *self);
+void		camel_rss_store_release_soup_session
+						(CamelRssStore *self,
+						 SoupSession *session);
 
 G_END_DECLS
 
@@ -11,6 +11,8 @@
 #include <camel/camel.h>
 #include <libedataserver/libedataserver.h>
 
+#include <libxml/xmlreader.h>
+
 #include "e-rss-parser.h"
 
 ERssEnclosure *
@@ -383,16 +385,6 @@ e_rss_read_defaults_rdf (xmlNodePtr root,
 	}
 }
 
-static void
-e_rss_read_rdf (xmlNodePtr node,
-		const FeedDefaults *defaults,
-		GSList **out_feeds)
-{
-	if (g_strcmp0 ((const gchar *) node->name, "item") == 0) {
-		e_rss_read_item (node, defaults, out_feeds);
-	}
-}
-
 static void
 e_rss_read_defaults_rss (xmlNodePtr root,
 			 FeedDefaults *defaults)
@@ -483,22 +475,6 @@ e_rss_read_defaults_rss (xmlNodePtr root,
 	}
 }
 
-static void
-e_rss_read_rss (xmlNodePtr node,
-		const FeedDefaults *defaults,
-		GSList **out_feeds)
-{
-	if (g_strcmp0 ((const gchar *) node->name, "channel") == 0) {
-		xmlNodePtr subnode;
-
-		for (subnode = node->children; subnode; subnode = subnode->next) {
-			if (g_strcmp0 ((const gchar *) subnode->name, "item") == 0) {
-				e_rss_read_item (subnode, defaults, out_feeds);
-			}
-		}
-	}
-}
-
 static void
 e_rss_read_defaults_feed (xmlNodePtr root,
 			  FeedDefaults *defaults)
@@ -597,15 +573,211 @@ e_rss_read_defaults_feed (xmlNodePtr root,
 }
 
 static void
-e_rss_read_feed (xmlNodePtr node,
-		 const FeedDefaults *defaults,
-		 GSList **out_feeds)
+e_rss_feed_defaults_clear (FeedDefaults *defaults)
+{
+	g_clear_pointer (&defaults->base_uri, g_uri_unref);
+	g_clear_pointer (&defaults->base, xmlFree);
+	g_clear_pointer (&defaults->author_name, xmlFree);
+	g_clear_pointer (&defaults->author_email, xmlFree);
+	g_clear_pointer (&defaults->link, xmlFree);
+	g_clear_pointer (&defaults->alt_link, xmlFree);
+	g_clear_pointer (&defaults->title, xmlFree);
+	g_clear_pointer (&defaults->icon, xmlFree);
+	defaults->publish_date = 0;
+}
+
+static void
+e_rss_read_defaults (xmlNodePtr root,
+		     FeedDefaults *defaults)
 {
-	if (g_strcmp0 ((const gchar *) node->name, "entry") == 0) {
-		e_rss_read_item (node, defaults, out_feeds);
+	e_rss_feed_defaults_clear (defaults);
+
+	if (g_strcmp0 ((const gchar *) root->name, "RDF") == 0) {
+		/* RSS 1.0 - https://web.resource.org/rss/1.0/ */
+		e_rss_read_defaults_rdf (root, defaults);
+	} else if (g_strcmp0 ((const gchar *) root->name, "rss") == 0) {
+		/* RSS 2.0 - https://www.rssboard.org/rss-specification */
+		e_rss_read_defaults_rss (root, defaults);
+	} else if (g_strcmp0 ((const gchar *) root->name, "feed") == 0) {
+		/* Atom - https://validator.w3.org/feed/docs/atom.html */
+		e_rss_read_defaults_feed (root, defaults);
+	}
+
+	if (!defaults->publish_date)
+		defaults->publish_date = g_get_real_time () / G_USEC_PER_SEC;
+
+	if (defaults->base || defaults->link || defaults->alt_link) {
+		const gchar *base;
+
+		base = (const gchar *) defaults->base;
+		if (!base || *base == '/')
+			base = (const gchar *) defaults->link;
+		if (!base || *base == '/')
+			base = (const gchar *) defaults->alt_link;
+
+		if (base && *base != '/') {
+			defaults->base_uri = g_uri_parse (base,
+				G_URI_FLAGS_PARSE_RELAXED |
+				G_URI_FLAGS_HAS_PASSWORD |
+				G_URI_FLAGS_ENCODED_PATH |
+				G_URI_FLAGS_ENCODED_QUERY |
+				G_URI_FLAGS_ENCODED_FRAGMENT |
+				G_URI_FLAGS_SCHEME_NORMALIZE, NULL);
+		}
 	}
 }
 
+/* The document is read with an xmlTextReader, thus only the currently read
+   item is held in memory. The channel information, which is used as defaults
+   for the items, is copied into a small 'header' tree, which mimics
+   the document structure without the items. */
+static gboolean
+e_rss_parser_parse_reader (xmlTextReaderPtr reader,
+			   gchar **out_link,
+			   gchar **out_alt_link,
+			   gchar **out_title,
+			   gchar **out_icon,
+			   ERssParserFeedFunc feed_func,
+			   gpointer user_data)
+{
+	FeedDefaults defaults = { 0, };
+	xmlDocPtr header_doc = NULL;
+	xmlNodePtr header_root = NULL, header_channel = NULL;
+	const gchar *item_name = NULL;
+	gboolean defaults_read = FALSE;
+	gboolean stopped = FALSE;
+	gint ret;
+
+	ret = xmlTextReaderRead (reader);
+
+	while (ret == 1 && !stopped) {
+		xmlNodePtr node;
+		gint depth;
+
+		if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT) {
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		node = xmlTextReaderCurrentNode (reader);
+		depth = xmlTextReaderDepth (reader);
+
+		if (!header_root) {
+			header_doc = xmlNewDoc ((const xmlChar *) "1.0");
+			header_root = xmlDocCopyNode (node, header_doc, 2);
+			xmlDocSetRootElement (header_doc, header_root);
+
+			if (g_strcmp0 ((const gchar *) node->name, "RDF") == 0 ||
+			    g_strcmp0 ((const gchar *) node->name, "rss") == 0)
+				item_name = "item";
+			else if (g_strcmp0 ((const gchar *) node->name, "feed") == 0)
+				item_name = "entry";
+
+			/* Unknown document type, nothing to read */
+			if (!item_name)
+				break;
+
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		/* RSS 2.0 has the items inside the <channel>, others in the root */
+		if (depth == 1 && !header_channel &&
+		    g_strcmp0 ((const gchar *) header_root->name, "rss") == 0 &&
+		    g_strcmp0 ((const gchar *) node->name, "channel") == 0) {
+			header_channel = xmlDocCopyNode (node, header_doc, 2);
+			xmlAddChild (header_root, header_channel);
+
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		if ((depth == 1 || (depth == 2 && header_channel)) &&
+		    g_strcmp0 ((const gchar *) node->name, item_name) == 0) {
+			if (feed_func) {
+				xmlNodePtr item;
+
+				if (!defaults_read) {
+					e_rss_read_defaults (header_root, &defaults);
+					defaults_read = TRUE;
+				}
+
+				item = xmlTextReaderExpand (reader);
+
+				if (item) {
+					GSList *feeds = NULL;
+
+					e_rss_read_item (item, &defaults, &feeds);
+
+					if (feeds && !feed_func (feeds->data, user_data))
+						stopped = TRUE;
+
+					g_slist_free (feeds);
+				}
+			}
+		} else if (depth == 1 || (depth == 2 && header_channel)) {
+			xmlNodePtr expanded;
+
+			expanded = xmlTextReaderExpand (reader);
+
+			if (expanded)
+				xmlAddChild (depth == 1 ? header_root : header_channel, xmlDocCopyNode (expanded, header_doc, 1));
+		}
+
+		/* Skip the subtree, its content had been read above */
+		ret = depth > 0 ? xmlTextReaderNext (reader) : xmlTextReaderRead (reader);
+	}
+
+	if (!header_root || (ret == -1 && !stopped)) {
+		e_rss_feed_defaults_clear (&defaults);
+
+		if (header_doc)
+			xmlFreeDoc (header_doc);
+
+		return FALSE;
+	}
+
+	/* Read again, to include also the information after the items */
+	if (out_link || out_alt_link || out_title || out_icon)
+		e_rss_read_defaults (header_root, &defaults);
+
+	if (out_link) {
+		*out_link = g_strdup ((const gchar *) defaults.link);
+		e_rss_ensure_uri_absolute (defaults.base_uri, out_link);
+	}
+
+	if (out_alt_link) {
+		*out_alt_link = g_strdup ((const gchar *) defaults.alt_link);
+		e_rss_ensure_uri_absolute (defaults.base_uri, out_alt_link);
+	}
+
+	if (out_title)
+		*out_title = g_strdup ((const gchar *) defaults.title);
+
+	if (out_icon) {
+		*out_icon = g_strdup ((const gchar *) defaults.icon);
+		e_rss_ensure_uri_absolute (defaults.base_uri, out_icon);
+	}
+
+	e_rss_feed_defaults_clear (&defaults);
+	xmlFreeDoc (header_doc);
+
+	return TRUE;
+}
+
+#define READER_OPTIONS (XML_PARSE_NOWARNING | XML_PARSE_NOERROR | XML_PARSE_NONET | XML_PARSE_HUGE)
+
+static gboolean
+e_rss_parser_collect_feed_cb (ERssFeed *feed,
+			      gpointer user_data)
+{
+	GSList **out_feeds = user_data;
+
+	*out_feeds = g_slist_prepend (*out_feeds, feed);
+
+	return TRUE;
+}
+
 gboolean
 e_rss_parser_parse (const gchar *xml,
 		    gsize xml_len,
@@ -615,8 +787,9 @@ e_rss_parser_parse (const gchar *xml,
 		    gchar **out_icon,
 		    GSList **out_feeds) /* ERssFeed * */
 {
-	xmlDoc *doc;
-	xmlNodePtr root;
+	xmlTextReaderPtr reader;
+	GSList *feeds = NULL;
+	gboolean success;
 
 	if (out_feeds)
 		*out_feeds = NULL;
@@ -624,95 +797,89 @@ e_rss_parser_parse (const gchar *xml,
 	if (!xml || !xml_len)
 		return FALSE;
 
-	doc = e_xml_parse_data (xml, xml_len);
-
-	if (!doc)
+	reader = xmlReaderForMemory (xml, xml_len, "feed.xml", NULL, READER_OPTIONS);
+	if (!reader)
 		return FALSE;
 
-	root = xmlDocGetRootElement (doc);
-	if (root) {
-		FeedDefaults defaults = { 0, };
-		void (*read_func) (xmlNodePtr node,
-				   const FeedDefaults *defaults,
-				   GSList **out_feeds) = NULL;
-
-		if (g_strcmp0 ((const gchar *) root->name, "RDF") == 0) {
-			/* RSS 1.0 - https://web.resource.org/rss/1.0/ */
-			e_rss_read_defaults_rdf (root, &defaults);
-			read_func = e_rss_read_rdf;
-		} else if (g_strcmp0 ((const gchar *) root->name, "rss") == 0) {
-			/* RSS 2.0 - https://www.rssboard.org/rss-specification */
-			e_rss_read_defaults_rss (root, &defaults);
-			read_func = e_rss_read_rss;
-		} else if (g_strcmp0 ((const gchar *) root->name, "feed") == 0) {
-			/* Atom - https://validator.w3.org/feed/docs/atom.html */
-			e_rss_read_defaults_feed (root, &defaults);
-			read_func = e_rss_read_feed;
-		}
+	success = e_rss_parser_parse_reader (reader, out_link, out_alt_link, out_title, out_icon,
+		out_feeds ? e_rss_parser_collect_feed_cb : NULL, &feeds);
 
-		if (!defaults.publish_date)
-			defaults.publish_date = g_get_real_time () / G_USEC_PER_SEC;
-
-		if (defaults.base || defaults.link || defaults.alt_link) {
-			const gchar *base;
-
-			base = (const gchar *) defaults.base;
-			if (!base || *base == '/')
-				base = (const gchar *) defaults.link;
-			if (!base || *base == '/')
-				base = (const gchar *) defaults.alt_link;
-
-			if (base && *base != '/') {
-				defaults.base_uri = g_uri_parse (base,
-					G_URI_FLAGS_PARSE_RELAXED |
-					G_URI_FLAGS_HAS_PASSWORD |
-					G_URI_FLAGS_ENCODED_PATH |
-					G_URI_FLAGS_ENCODED_QUERY |
-					G_URI_FLAGS_ENCODED_FRAGMENT |
-					G_URI_FLAGS_SCHEME_NORMALIZE, NULL);
-			}
-		}
+	xmlFreeTextReader (reader);
 
-		if (read_func && out_feeds) {
-			xmlNodePtr node;
+	if (out_feeds)
+		*out_feeds = g_slist_reverse (feeds);
+	else
+		g_slist_free_full (feeds, e_rss_feed_free);
 
-			for (node = root->children; node; node = node->next) {
-				read_func (node, &defaults, out_feeds);
-			}
-		}
+	return success;
+}
 
-		if (out_link) {
-			*out_link = g_strdup ((const gchar *) defaults.link);
-			e_rss_ensure_uri_absolute (defaults.base_uri, out_link);
-		}
+typedef struct _StreamData {
+	GInputStream *stream;
+	GCancellable *cancellable;
+	GError *error;
+} StreamData;
 
-		if (out_alt_link) {
-			*out_alt_link = g_strdup ((const gchar *) defaults.alt_link);
-			e_rss_ensure_uri_absolute (defaults.base_uri, out_alt_link);
-		}
+static gint
+e_rss_parser_stream_read_cb (gpointer context,
+			     gchar *buffer,
+			     gint len)
+{
+	StreamData *sd = context;
+	gssize nread;
 
-		if (out_title)
-			*out_title = g_strdup ((const gchar *) defaults.title);
+	nread = g_input_stream_read (sd->stream, buffer, len, sd->cancellable, sd->error ? NULL : &sd->error);
 
-		if (out_icon) {
-			*out_icon = g_strdup ((const gchar *) defaults.icon);
-			e_rss_ensure_uri_absolute (defaults.base_uri, out_icon);
-		}
+	return (gint) nread;
+}
 
-		g_clear_pointer (&defaults.base_uri, g_uri_unref);
-		g_clear_pointer (&defaults.base, xmlFree);
-		g_clear_pointer (&defaults.author_name, xmlFree);
-		g_clear_pointer (&defaults.author_email, xmlFree);
-		g_clear_pointer (&defaults.link, xmlFree);
-		g_clear_pointer (&defaults.alt_link, xmlFree);
-		g_clear_pointer (&defaults.title, xmlFree);
-		g_clear_pointer (&defaults.icon, xmlFree);
-
-		if (out_feeds)
-			*out_feeds = g_slist_reverse (*out_feeds);
+static gint
+e_rss_parser_stream_close_cb (gpointer context)
+{
+	/* The stream is closed by the caller */
+	return 0;
+}
+
+/* Parses the feed from the 'stream', calling 'feed_func' for each item
+   as soon as it is read. Parsing stops when the 'feed_func' returns FALSE,
+   which is not considered an error. */
+gboolean
+e_rss_parser_parse_stream (GInputStream *stream,
+			   gchar **out_link,
+			   gchar **out_alt_link,
+			   gchar **out_title,
+			   gchar **out_icon,
+			   ERssParserFeedFunc feed_func,
+			   gpointer user_data,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	xmlTextReaderPtr reader;
+	StreamData sd;
+	gboolean success;
+
+	g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
+
+	sd.stream = stream;
+	sd.cancellable = cancellable;
+	sd.error = NULL;
+
+	reader = xmlReaderForIO (e_rss_parser_stream_read_cb, e_rss_parser_stream_close_cb, &sd, "feed.xml", NULL, READER_OPTIONS);
+	if (!reader) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED, _("Failed to read the feed"));
+		return FALSE;
 	}
 
-	xmlFreeDoc (doc);
+	success = e_rss_parser_parse_reader (reader, out_link, out_alt_link, out_title, out_icon, feed_func, user_data);
 
-	return TRUE;
+	xmlFreeTextReader (reader);
+
+	if (sd.error) {
+		g_propagate_error (error, sd.error);
+		success = FALSE;
+	} else if (!success) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, _("Failed to parse the feed"));
+	}
+
+	return success;
 }
@@ -6,7 +6,7 @@
 #ifndef E_RSS_PARSER_H
 #define E_RSS_PARSER_H
 
-#include <glib.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -28,6 +28,10 @@ typedef struct _ERssFeed {
 	GSList *enclosures; /* ERssEnclosure * */
 } ERssFeed;
 
+/* Takes ownership of the 'feed'; return FALSE to stop parsing */
+typedef gboolean (* ERssParserFeedFunc)	(ERssFeed *feed,
+					 gpointer user_data);
+
 ERssEnclosure *	e_rss_enclosure_new	(void);
 void		e_rss_enclosure_free	(gpointer ptr);
 
@@ -41,6 +45,16 @@ gboolean	e_rss_parser_parse	(const gchar *xml,
 					 gchar **out_title,
 					 gchar **out_icon,
 					 GSList **out_feeds); /* ERssFeed * */
+gboolean	e_rss_parser_parse_stream
+					(GInputStream *stream,
+					 gchar **out_link,
+					 gchar **out_alt_link,
+					 gchar **out_title,
+					 gchar **out_icon,
+					 ERssParserFeedFunc feed_func,
+					 gpointer user_data,
+					 GCancellable *cancellable,
+					 GError **error);
 
 G_END_DECLS
 
@@ -5,6 +5,8 @@
 #include "evolution-config.h"
 
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <glib/gstdio.h>
@@ -25,6 +27,14 @@
 #define SPAM_ASSASSIN_EXIT_STATUS_SUCCESS	0
 #define SPAM_ASSASSIN_EXIT_STATUS_ERROR		-1
 
+/* When enabled by the user, messages are classified by a running spamd,
+ * which saves starting the whole SpamAssassin for each of them. The spamd
+ * cannot be told to run only the local tests, thus the spamassassin
+ * command is used when only local tests are requested, as well as when
+ * the spamd is not reachable. */
+#define SPAMD_TIMEOUT_SECONDS	60
+#define SPAMD_RETRY_SECONDS	300
+
 typedef struct _ESpamAssassin ESpamAssassin;
 typedef struct _ESpamAssassinClass ESpamAssassinClass;
 
@@ -34,9 +44,15 @@ struct _ESpamAssassin {
 	gboolean local_only;
 	gchar *command;
 	gchar *learn_command;
+	gboolean use_spamd;
+	gchar *spamd_host; /* Guarded by spamd_lock */
+	gint spamd_port;
 
 	gboolean version_set;
 	gint version;
+
+	GMutex spamd_lock;
+	gint64 spamd_retry_after;
 };
 
 struct _ESpamAssassinClass {
@@ -48,6 +64,9 @@ enum {
 	PROP_LOCAL_ONLY,
 	PROP_COMMAND,
 	PROP_LEARN_COMMAND,
+	PROP_USE_SPAMD,
+	PROP_SPAMD_HOST,
+	PROP_SPAMD_PORT,
 	N_PROPS
 };
 
@@ -317,6 +336,152 @@ spam_assassin_command (const gchar **argv,
 		argv, message, input_data, NULL, TRUE, cancellable, error);
 }
 
+/* Returns FALSE when spamd could not be asked, in which case the
+ * message should be classified by running the spamassassin command.
+ * When TRUE is returned, the @out_is_spam and the @error are set. */
+static gboolean
+spam_assassin_spamd_classify (ESpamAssassin *extension,
+                              CamelMimeMessage *message,
+                              gboolean *out_is_spam,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	GSocketClient *client;
+	GSocketConnection *connection = NULL;
+	GDataInputStream *input_stream = NULL;
+	GOutputStream *output_stream;
+	CamelStream *stream;
+	GByteArray *byte_array;
+	gchar *spamd_host;
+	gchar *request = NULL;
+	gchar *line = NULL;
+	gint spamd_code = -1;
+	gboolean have_result = FALSE;
+	gboolean success;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&extension->spamd_lock);
+	success = g_get_monotonic_time () >= extension->spamd_retry_after;
+	spamd_host = g_strdup (extension->spamd_host);
+	g_mutex_unlock (&extension->spamd_lock);
+
+	if (!success || !spamd_host || !*spamd_host || extension->spamd_port <= 0) {
+		g_free (spamd_host);
+		return FALSE;
+	}
+
+	/* Serialize the message first, the Content-length is sent
+	 * in the request header. */
+	stream = camel_stream_mem_new ();
+	success = camel_data_wrapper_write_to_stream_sync (
+		CAMEL_DATA_WRAPPER (message), stream,
+		cancellable, &local_error) >= 0;
+	byte_array = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (stream));
+
+	if (success) {
+		client = g_socket_client_new ();
+		g_socket_client_set_timeout (client, SPAMD_TIMEOUT_SECONDS);
+
+		connection = g_socket_client_connect_to_host (
+			client, spamd_host, extension->spamd_port,
+			cancellable, &local_error);
+
+		g_object_unref (client);
+
+		success = connection != NULL;
+	}
+
+	if (success) {
+		request = g_strdup_printf (
+			"CHECK SPAMC/1.5\r\n"
+			"Content-length: %u\r\n"
+			"User: %s\r\n"
+			"\r\n",
+			byte_array->len, g_get_user_name ());
+
+		output_stream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+		success = g_output_stream_write_all (
+				output_stream, request, strlen (request),
+				NULL, cancellable, &local_error) &&
+			g_output_stream_write_all (
+				output_stream, byte_array->data, byte_array->len,
+				NULL, cancellable, &local_error) &&
+			g_output_stream_flush (output_stream, cancellable, &local_error);
+	}
+
+	if (success) {
+		input_stream = g_data_input_stream_new (
+			g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+		g_data_input_stream_set_newline_type (
+			input_stream, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+
+		/* The status line, like "SPAMD/1.1 0 EX_OK". */
+		line = g_data_input_stream_read_line (
+			input_stream, NULL, cancellable, &local_error);
+
+		success = line && g_str_has_prefix (line, "SPAMD/") &&
+			sscanf (line, "SPAMD/%*s %d", &spamd_code) == 1 &&
+			spamd_code == 0;
+
+		g_clear_pointer (&line, g_free);
+	}
+
+	/* The headers, up to an empty line, among them
+	 * the result, like "Spam: True ; 15.0 / 5.0". */
+	while (success && !have_result) {
+		line = g_data_input_stream_read_line (
+			input_stream, NULL, cancellable, &local_error);
+
+		if (!line || !*line) {
+			success = FALSE;
+		} else if (g_ascii_strncasecmp (line, "Spam:", 5) == 0) {
+			const gchar *value = line + 5;
+
+			while (g_ascii_isspace (*value))
+				value++;
+
+			*out_is_spam =
+				g_ascii_strncasecmp (value, "True", 4) == 0 ||
+				g_ascii_strncasecmp (value, "Yes", 3) == 0;
+			have_result = TRUE;
+		}
+
+		g_clear_pointer (&line, g_free);
+	}
+
+	g_clear_object (&input_stream);
+	g_clear_object (&connection);
+	g_object_unref (stream);
+	g_free (request);
+	g_free (spamd_host);
+
+	if (have_result)
+		return TRUE;
+
+	if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_propagate_error (error, local_error);
+		return TRUE;
+	}
+
+	/* Do not try to connect for every message when spamd is not
+	 * running; give it a chance again after a while. */
+	g_mutex_lock (&extension->spamd_lock);
+	extension->spamd_retry_after = g_get_monotonic_time () +
+		(gint64) SPAMD_RETRY_SECONDS * G_USEC_PER_SEC;
+	g_mutex_unlock (&extension->spamd_lock);
+
+	g_debug (
+		"SpamAssassin: Cannot use spamd (%s), "
+		"running the spamassassin command instead",
+		local_error ? local_error->message :
+		spamd_code > 0 ? "Request failed" : "Unexpected reply");
+
+	g_clear_error (&local_error);
+
+	return FALSE;
+}
+
 static gboolean
 spam_assassin_get_local_only (ESpamAssassin *extension)
 {
@@ -373,6 +538,80 @@ spam_assassin_set_learn_command (ESpamAssassin *extension,
 	g_object_notify_by_pspec (G_OBJECT (extension), properties[PROP_LEARN_COMMAND]);
 }
 
+static gboolean
+spam_assassin_get_use_spamd (ESpamAssassin *extension)
+{
+	return extension->use_spamd;
+}
+
+static void
+spam_assassin_set_use_spamd (ESpamAssassin *extension,
+                             gboolean use_spamd)
+{
+	if (extension->use_spamd == use_spamd)
+		return;
+
+	extension->use_spamd = use_spamd;
+
+	g_object_notify_by_pspec (G_OBJECT (extension), properties[PROP_USE_SPAMD]);
+}
+
+static gchar *
+spam_assassin_dup_spamd_host (ESpamAssassin *extension)
+{
+	gchar *spamd_host;
+
+	g_mutex_lock (&extension->spamd_lock);
+	spamd_host = g_strdup (extension->spamd_host);
+	g_mutex_unlock (&extension->spamd_lock);
+
+	return spamd_host;
+}
+
+static void
+spam_assassin_set_spamd_host (ESpamAssassin *extension,
+                              const gchar *spamd_host)
+{
+	g_mutex_lock (&extension->spamd_lock);
+
+	if (g_strcmp0 (extension->spamd_host, spamd_host) == 0) {
+		g_mutex_unlock (&extension->spamd_lock);
+		return;
+	}
+
+	g_free (extension->spamd_host);
+	extension->spamd_host = g_strdup (spamd_host);
+
+	/* Try the new address right away. */
+	extension->spamd_retry_after = 0;
+
+	g_mutex_unlock (&extension->spamd_lock);
+
+	g_object_notify_by_pspec (G_OBJECT (extension), properties[PROP_SPAMD_HOST]);
+}
+
+static gint
+spam_assassin_get_spamd_port (ESpamAssassin *extension)
+{
+	return extension->spamd_port;
+}
+
+static void
+spam_assassin_set_spamd_port (ESpamAssassin *extension,
+                              gint spamd_port)
+{
+	if (extension->spamd_port == spamd_port)
+		return;
+
+	extension->spamd_port = spamd_port;
+
+	g_mutex_lock (&extension->spamd_lock);
+	extension->spamd_retry_after = 0;
+	g_mutex_unlock (&extension->spamd_lock);
+
+	g_object_notify_by_pspec (G_OBJECT (extension), properties[PROP_SPAMD_PORT]);
+}
+
 static void
 spam_assassin_set_property (GObject *object,
                             guint property_id,
@@ -397,6 +636,24 @@ spam_assassin_set_property (GObject *object,
 				E_SPAM_ASSASSIN (object),
 				g_value_get_string (value));
 			return;
+
+		case PROP_USE_SPAMD:
+			spam_assassin_set_use_spamd (
+				E_SPAM_ASSASSIN (object),
+				g_value_get_boolean (value));
+			return;
+
+		case PROP_SPAMD_HOST:
+			spam_assassin_set_spamd_host (
+				E_SPAM_ASSASSIN (object),
+				g_value_get_string (value));
+			return;
+
+		case PROP_SPAMD_PORT:
+			spam_assassin_set_spamd_port (
+				E_SPAM_ASSASSIN (object),
+				g_value_get_int (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -426,6 +683,24 @@ spam_assassin_get_property (GObject *object,
 				value, spam_assassin_get_learn_command (
 				E_SPAM_ASSASSIN (object)));
 			return;
+
+		case PROP_USE_SPAMD:
+			g_value_set_boolean (
+				value, spam_assassin_get_use_spamd (
+				E_SPAM_ASSASSIN (object)));
+			return;
+
+		case PROP_SPAMD_HOST:
+			g_value_take_string (
+				value, spam_assassin_dup_spamd_host (
+				E_SPAM_ASSASSIN (object)));
+			return;
+
+		case PROP_SPAMD_PORT:
+			g_value_set_int (
+				value, spam_assassin_get_spamd_port (
+				E_SPAM_ASSASSIN (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -442,6 +717,11 @@ spam_assassin_finalize (GObject *object)
 	g_free (extension->learn_command);
 	extension->learn_command = NULL;
 
+	g_free (extension->spamd_host);
+	extension->spamd_host = NULL;
+
+	g_mutex_clear (&extension->spamd_lock);
+
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (e_spam_assassin_parent_class)->finalize (object);
 }
@@ -561,6 +841,35 @@ spam_assassin_new_config_widget (EMailJunkFilter *junk_filter)
 	gtk_widget_show (widget);
 	g_free (markup);
 
+	widget = gtk_check_button_new_with_mnemonic (
+		_("Use a running SpamAssassin _daemon (spamd)"));
+	gtk_widget_set_margin_start (widget, 12);
+	gtk_box_pack_start (GTK_BOX (container), widget, FALSE, FALSE, 0);
+	gtk_widget_show (widget);
+
+	e_binding_bind_property (
+		junk_filter, "use-spamd",
+		widget, "active",
+		G_BINDING_BIDIRECTIONAL |
+		G_BINDING_SYNC_CREATE);
+
+	e_binding_bind_property (
+		junk_filter, "local-only",
+		widget, "sensitive",
+		G_BINDING_SYNC_CREATE |
+		G_BINDING_INVERT_BOOLEAN);
+
+	markup = g_markup_printf_escaped (
+		"<small>%s</small>",
+		_("This is faster; it is used only when remote tests are included."));
+	widget = gtk_label_new (markup);
+	gtk_widget_set_margin_start (widget, 36);
+	gtk_label_set_xalign (GTK_LABEL (widget), 0);
+	gtk_label_set_use_markup (GTK_LABEL (widget), TRUE);
+	gtk_box_pack_start (GTK_BOX (container), widget, FALSE, FALSE, 0);
+	gtk_widget_show (widget);
+	g_free (markup);
+
 	return box;
 }
 
@@ -573,12 +882,26 @@ spam_assassin_classify (CamelJunkFilter *junk_filter,
 	ESpamAssassin *extension = E_SPAM_ASSASSIN (junk_filter);
 	CamelJunkStatus status;
 	const gchar *argv[7];
+	gboolean is_spam = FALSE;
 	gint exit_code;
 	gint ii = 0;
+	GError *local_error = NULL;
 
 	if (g_cancellable_set_error_if_cancelled (cancellable, error))
 		return CAMEL_JUNK_STATUS_ERROR;
 
+	if (extension->use_spamd && !extension->local_only &&
+	    spam_assassin_spamd_classify (extension, message, &is_spam, cancellable, &local_error)) {
+		if (local_error) {
+			g_propagate_error (error, local_error);
+			return CAMEL_JUNK_STATUS_ERROR;
+		}
+
+		return is_spam ?
+			CAMEL_JUNK_STATUS_MESSAGE_IS_JUNK :
+			CAMEL_JUNK_STATUS_MESSAGE_IS_NOT_JUNK;
+	}
+
 	argv[ii++] = spam_assassin_get_command_path (extension);
 	argv[ii++] = "--exit-code";
 	if (extension->local_only)
@@ -764,6 +1087,39 @@ e_spam_assassin_class_init (ESpamAssassinClass *class)
 			"",
 			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * ESpamAssassin:use-spamd
+	 *
+	 * Classify messages by a running spamd
+	 **/
+	properties[PROP_USE_SPAMD] =
+		g_param_spec_boolean (
+			"use-spamd", NULL, NULL,
+			FALSE,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * ESpamAssassin:spamd-host
+	 *
+	 * Host name the spamd listens on
+	 **/
+	properties[PROP_SPAMD_HOST] =
+		g_param_spec_string (
+			"spamd-host", NULL, NULL,
+			"localhost",
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+	/**
+	 * ESpamAssassin:spamd-port
+	 *
+	 * Port the spamd listens on
+	 **/
+	properties[PROP_SPAMD_PORT] =
+		g_param_spec_int (
+			"spamd-port", NULL, NULL,
+			1, G_MAXUINT16, 783,
+			G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -786,6 +1142,8 @@ e_spam_assassin_init (ESpamAssassin *extension)
 {
 	GSettings *settings;
 
+	g_mutex_init (&extension->spamd_lock);
+
 	settings = e_util_ref_settings ("org.gnome.evolution.spamassassin");
 
 	g_settings_bind (
@@ -800,6 +1158,18 @@ e_spam_assassin_init (ESpamAssassin *extension)
 		settings, "learn-command",
 		G_OBJECT (extension), "learn-command",
 		G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (
+		settings, "use-spamd",
+		extension, "use-spamd",
+		G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (
+		settings, "spamd-host",
+		extension, "spamd-host",
+		G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind (
+		settings, "spamd-port",
+		extension, "spamd-port",
+		G_SETTINGS_BIND_DEFAULT);
 
 	g_object_unref (settings);
 }
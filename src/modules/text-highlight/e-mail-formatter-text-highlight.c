@@ -29,11 +29,24 @@ typedef struct _TextHighlightClosure TextHighlightClosure;
 struct _TextHighlightClosure {
 	gboolean wrote_anything;
 	CamelStream *read_stream;
-	GOutputStream *output_stream;
+	GByteArray *output;
 	GCancellable *cancellable;
 	GError *error;
 };
 
+/* The highlighted output is cached by the checksum of the part content
+ * and of the options, thus re-opening a message or the same patch being
+ * in more messages of a thread does not need to highlight it again. */
+#define OUTPUT_CACHE_MAX_ITEMS 64
+#define OUTPUT_CACHE_MAX_BYTES (8 * 1024 * 1024)
+
+static GHashTable *output_cache = NULL; /* gchar *key ~> GBytes *output */
+static GQueue output_cache_lru = G_QUEUE_INIT; /* gchar *key, owned by output_cache; the most recent at the tail */
+static gsize output_cache_bytes = 0;
+G_LOCK_DEFINE_STATIC (output_cache);
+
+#define OUTPUT_HEADER "<style>body{margin:0; padding:8px;}</style>"
+
 GType e_mail_formatter_text_highlight_get_type (void);
 
 G_DEFINE_DYNAMIC_TYPE (
@@ -117,41 +130,166 @@ get_syntax (EMailPart *part,
 	return syntax;
 }
 
+static gchar *
+text_highlight_build_cache_key (GBytes *content,
+				const gchar *syntax,
+				const gchar *theme,
+				const gchar *font_family,
+				gint font_size)
+{
+	GChecksum *checksum;
+	gchar *key;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_checksum_update (checksum, g_bytes_get_data (content, NULL), g_bytes_get_size (content));
+
+	/* The options are separated by NUL-s, which cannot be part of them */
+	g_checksum_update (checksum, (const guchar *) "", 1);
+	g_checksum_update (checksum, (const guchar *) syntax, strlen (syntax) + 1);
+	g_checksum_update (checksum, (const guchar *) theme, strlen (theme) + 1);
+	g_checksum_update (checksum, (const guchar *) font_family, strlen (font_family) + 1);
+	g_checksum_update (checksum, (const guchar *) &font_size, sizeof (font_size));
+
+	key = g_strdup (g_checksum_get_string (checksum));
+
+	g_checksum_free (checksum);
+
+	return key;
+}
+
+static GBytes *
+text_highlight_cache_lookup (const gchar *key)
+{
+	GBytes *output;
+
+	G_LOCK (output_cache);
+
+	output = output_cache ? g_hash_table_lookup (output_cache, key) : NULL;
+	if (output) {
+		GList *link;
+
+		link = g_queue_find_custom (&output_cache_lru, key, (GCompareFunc) g_strcmp0);
+		if (link) {
+			g_queue_unlink (&output_cache_lru, link);
+			g_queue_push_tail_link (&output_cache_lru, link);
+		}
+
+		g_bytes_ref (output);
+	}
+
+	G_UNLOCK (output_cache);
+
+	return output;
+}
+
+static void
+text_highlight_cache_add (const gchar *key,
+			  GBytes *output)
+{
+	gchar *key_copy;
+
+	if (g_bytes_get_size (output) > OUTPUT_CACHE_MAX_BYTES / 4)
+		return;
+
+	G_LOCK (output_cache);
+
+	if (!output_cache)
+		output_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_bytes_unref);
+
+	if (!g_hash_table_contains (output_cache, key)) {
+		key_copy = g_strdup (key);
+
+		g_hash_table_insert (output_cache, key_copy, g_bytes_ref (output));
+		g_queue_push_tail (&output_cache_lru, key_copy);
+		output_cache_bytes += g_bytes_get_size (output);
+
+		while (output_cache_lru.length > OUTPUT_CACHE_MAX_ITEMS ||
+		       output_cache_bytes > OUTPUT_CACHE_MAX_BYTES) {
+			GBytes *oldest;
+
+			key_copy = g_queue_pop_head (&output_cache_lru);
+			oldest = g_hash_table_lookup (output_cache, key_copy);
+			output_cache_bytes -= g_bytes_get_size (oldest);
+
+			/* This frees also the key_copy */
+			g_hash_table_remove (output_cache, key_copy);
+		}
+	}
+
+	G_UNLOCK (output_cache);
+}
+
+/* Decodes the part content, in UTF-8 */
+static GBytes *
+text_highlight_read_content (CamelDataWrapper *data_wrapper,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	CamelContentType *content_type;
+	CamelStream *mem_stream, *stream;
+	GByteArray *byte_array;
+	GBytes *content = NULL;
+
+	mem_stream = camel_stream_mem_new ();
+	stream = g_object_ref (mem_stream);
+
+	content_type = camel_data_wrapper_get_mime_type_field (data_wrapper);
+	if (content_type) {
+		const gchar *charset = camel_content_type_param (content_type, "charset");
+
+		/* Convert to UTF-8 charset, if needed, which the highlighters expect;
+		   they can cope with non-UTF-8 letters, thus no need for a content UTF-8-validation */
+		if (charset && g_ascii_strcasecmp (charset, "utf-8") != 0) {
+			CamelMimeFilter *filter;
+
+			filter = camel_mime_filter_charset_new (charset, "UTF-8");
+			if (filter != NULL) {
+				CamelStream *filtered = camel_stream_filter_new (stream);
+
+				if (filtered) {
+					camel_stream_filter_add (CAMEL_STREAM_FILTER (filtered), filter);
+					g_object_unref (stream);
+					stream = filtered;
+				}
+
+				g_object_unref (filter);
+			}
+		}
+	}
+
+	if (camel_data_wrapper_decode_to_stream_sync (data_wrapper, stream, cancellable, error) >= 0 &&
+	    camel_stream_flush (stream, cancellable, error) == 0) {
+		byte_array = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (mem_stream));
+		content = g_bytes_new (byte_array->data, byte_array->len);
+	}
+
+	g_object_unref (stream);
+	g_object_unref (mem_stream);
+
+	return content;
+}
+
 static gpointer
 text_hightlight_read_data_thread (gpointer user_data)
 {
 	TextHighlightClosure *closure = user_data;
 	gint nbuffer = 10240;
 	gssize read;
-	gsize wrote = 0;
 	gchar *buffer;
 
 	g_return_val_if_fail (closure != NULL, NULL);
 
 	buffer = g_new (gchar, nbuffer);
 
-	strcpy (buffer, "<style>body{margin:0; padding:8px;}</style>");
-	read = strlen (buffer);
-
-	if (!g_output_stream_write_all (closure->output_stream, buffer, read, &wrote, closure->cancellable, &closure->error) ||
-	    (gssize) wrote != read || closure->error) {
-		g_free (buffer);
-		return NULL;
-	}
-
 	while (!camel_stream_eos (closure->read_stream) &&
 	       !g_cancellable_set_error_if_cancelled (closure->cancellable, &closure->error)) {
-		wrote = 0;
-
 		read = camel_stream_read (closure->read_stream, buffer, nbuffer, closure->cancellable, &closure->error);
 		if (read < 0 || closure->error)
 			break;
 
 		closure->wrote_anything = closure->wrote_anything || read > 0;
 
-		if (!g_output_stream_write_all (closure->output_stream, buffer, read, &wrote, closure->cancellable, &closure->error) ||
-		    (gssize) wrote != read || closure->error)
-			break;
+		g_byte_array_append (closure->output, (const guint8 *) buffer, read);
 	}
 
 	g_free (buffer);
@@ -160,22 +298,22 @@ text_hightlight_read_data_thread (gpointer user_data)
 }
 
 static gboolean
-text_highlight_feed_data (GOutputStream *output_stream,
-                          CamelDataWrapper *data_wrapper,
+text_highlight_feed_data (GByteArray *output,
+                          GBytes *content,
                           gint pipe_stdin,
                           gint pipe_stdout,
                           GCancellable *cancellable,
                           GError **error)
 {
 	TextHighlightClosure closure;
-	CamelContentType *content_type;
 	CamelStream *write_stream;
 	gboolean success = TRUE;
 	GThread *thread;
+	gssize wrote;
 
 	closure.wrote_anything = FALSE;
 	closure.read_stream = camel_stream_fs_new_with_fd (pipe_stdout);
-	closure.output_stream = output_stream;
+	closure.output = output;
 	closure.cancellable = cancellable;
 	closure.error = NULL;
 
@@ -183,31 +321,11 @@ text_highlight_feed_data (GOutputStream *output_stream,
 
 	thread = g_thread_new (NULL, text_hightlight_read_data_thread, &closure);
 
-	content_type = camel_data_wrapper_get_mime_type_field (data_wrapper);
-	if (content_type) {
-		const gchar *charset = camel_content_type_param (content_type, "charset");
-
-		/* Convert to UTF-8 charset, if needed, which the 'highlight' expects;
-		   it can cope with non-UTF-8 letters, thus no need for a content UTF-8-validation */
-		if (charset && g_ascii_strcasecmp (charset, "utf-8") != 0) {
-			CamelMimeFilter *filter;
-
-			filter = camel_mime_filter_charset_new (charset, "UTF-8");
-			if (filter != NULL) {
-				CamelStream *filtered = camel_stream_filter_new (write_stream);
-
-				if (filtered) {
-					camel_stream_filter_add (CAMEL_STREAM_FILTER (filtered), filter);
-					g_object_unref (write_stream);
-					write_stream = filtered;
-				}
-
-				g_object_unref (filter);
-			}
-		}
-	}
+	wrote = camel_stream_write (write_stream,
+		g_bytes_get_data (content, NULL), g_bytes_get_size (content),
+		cancellable, error);
 
-	if (camel_data_wrapper_decode_to_stream_sync (data_wrapper, write_stream, cancellable, error) < 0) {
+	if (wrote < 0 || (gsize) wrote != g_bytes_get_size (content)) {
 		g_cancellable_cancel (cancellable);
 		success = FALSE;
 	} else {
@@ -232,6 +350,92 @@ text_highlight_feed_data (GOutputStream *output_stream,
 	return success && closure.wrote_anything;
 }
 
+static GBytes *
+text_highlight_run_command (GBytes *content,
+			    const gchar *font_family,
+			    gint font_size,
+			    const gchar *syntax,
+			    const gchar *theme,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	GByteArray *output;
+	gint pipe_stdin, pipe_stdout;
+	GPid pid;
+	gboolean success;
+
+	const gchar *argv[] = {
+		HIGHLIGHT_COMMAND,
+		NULL,	/* --font= */
+		NULL,   /* --font-size= */
+		NULL,   /* --syntax= */
+		NULL,   /* --style= */
+		"--out-format=html",
+		"--include-style",
+		"--inline-css",
+		"--encoding=none",
+		"--force",
+		NULL };
+
+	argv[1] = g_strdup_printf ("--font='%s'", font_family);
+	argv[2] = g_strdup_printf ("--font-size=%d", font_size);
+	argv[3] = g_strdup_printf ("--syntax=%s", syntax);
+	argv[4] = g_strdup_printf ("--style=%s", theme);
+
+	output = g_byte_array_new ();
+	g_byte_array_append (output, (const guint8 *) OUTPUT_HEADER, strlen (OUTPUT_HEADER));
+
+	success = g_spawn_async_with_pipes (
+		NULL, (gchar **) argv, NULL, 0, NULL, NULL,
+		&pid, &pipe_stdin, &pipe_stdout, NULL, NULL);
+
+	if (success) {
+		success = text_highlight_feed_data (
+			output, content,
+			pipe_stdin, pipe_stdout,
+			cancellable, error);
+
+		g_spawn_close_pid (pid);
+	}
+
+	g_free ((gchar *) argv[1]);
+	g_free ((gchar *) argv[2]);
+	g_free ((gchar *) argv[3]);
+	g_free ((gchar *) argv[4]);
+
+	if (!success) {
+		g_byte_array_unref (output);
+		return NULL;
+	}
+
+	return g_byte_array_free_to_bytes (output);
+}
+
+static GBytes *
+text_highlight_run_highlighter (Highlighter highlighter,
+				GBytes *content,
+				const gchar *font_family,
+				gint font_size,
+				gboolean is_dark_theme)
+{
+	GString *html;
+	gsize len;
+
+	len = g_bytes_get_size (content);
+
+	if (!len)
+		return NULL;
+
+	html = g_string_sized_new (len * 2 + 1024);
+	g_string_append (html, OUTPUT_HEADER);
+
+	highlighter_format_html (highlighter,
+		g_bytes_get_data (content, NULL), len,
+		font_family, font_size, is_dark_theme, html);
+
+	return g_string_free_to_bytes (html);
+}
+
 static gboolean
 emfe_text_highlight_format (EMailFormatterExtension *extension,
                             EMailFormatter *formatter,
@@ -265,27 +469,17 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 		goto exit;
 
 	} else if (context->mode == E_MAIL_FORMATTER_MODE_RAW) {
-		gint pipe_stdin, pipe_stdout;
-		GPid pid;
 		CamelDataWrapper *dw;
-		gchar *font_family, *font_size, *syntax, *theme;
+		Highlighter highlighter = HIGHLIGHTER_NONE;
+		GBytes *content, *output = NULL;
+		gchar *font_family, *syntax, *theme;
+		gint font_size;
+		gboolean is_dark_theme = FALSE;
 		PangoFontDescription *fd;
 		GSettings *settings;
+		GError *local_error = NULL;
 		gchar *font = NULL;
 
-		const gchar *argv[] = {
-			HIGHLIGHT_COMMAND,
-			NULL,	/* --font= */
-			NULL,   /* --font-size= */
-			NULL,   /* --syntax= */
-			NULL,   /* --style= */
-			"--out-format=html",
-			"--include-style",
-			"--inline-css",
-			"--encoding=none",
-			"--force",
-			NULL };
-
 		if (!emfe_text_highlight_formatter_is_enabled ()) {
 			gboolean can_process = FALSE;
 
@@ -345,21 +539,22 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 
 		g_free (font);
 
-		font_family = g_strdup_printf (
-			"--font='%s'",
-			pango_font_description_get_family (fd));
-		font_size = g_strdup_printf (
-			"--font-size=%d",
-			pango_font_description_get_size (fd) / PANGO_SCALE);
+		font_family = g_strdup (pango_font_description_get_family (fd));
+		if (!font_family)
+			font_family = g_strdup ("monospace");
+		font_size = pango_font_description_get_size (fd) / PANGO_SCALE;
+
+		pango_font_description_free (fd);
 
 		settings = e_util_ref_settings ("org.gnome.evolution.text-highlight");
 		theme = g_settings_get_string (settings, "theme");
 		g_object_unref (settings);
 
+		/* The in-process highlighters know only the default themes,
+		   a custom theme is left on the 'highlight' binary. */
 		if (!theme || !*theme) {
 			const GdkRGBA *rgba;
 			gdouble brightness;
-			gboolean is_dark_theme;
 
 			g_free (theme);
 
@@ -372,43 +567,55 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 			is_dark_theme = brightness > 140;
 
 			theme = g_strdup (is_dark_theme ? "kellys" : "bclear");
+			highlighter = get_highlighter_for_syntax (syntax);
 		}
 
-		argv[1] = font_family;
-		argv[2] = font_size;
-		argv[3] = g_strdup_printf ("--syntax=%s", syntax);
-		argv[4] = g_strdup_printf ("--style=%s", theme);
-		g_free (syntax);
-		g_free (theme);
+		content = text_highlight_read_content (dw, cancellable, &local_error);
 
-		success = g_spawn_async_with_pipes (
-			NULL, (gchar **) argv, NULL, 0, NULL, NULL,
-			&pid, &pipe_stdin, &pipe_stdout, NULL, NULL);
+		if (content) {
+			gchar *cache_key;
 
-		if (success) {
-			GError *local_error = NULL;
+			cache_key = text_highlight_build_cache_key (content, syntax, theme, font_family, font_size);
+			output = text_highlight_cache_lookup (cache_key);
 
-			success = text_highlight_feed_data (
-				stream, dw,
-				pipe_stdin, pipe_stdout,
-				cancellable, &local_error);
-
-			if (g_error_matches (
-				local_error, G_IO_ERROR,
-				G_IO_ERROR_CANCELLED)) {
-				/* Do nothing. */
+			if (!output) {
+				if (highlighter != HIGHLIGHTER_NONE) {
+					output = text_highlight_run_highlighter (
+						highlighter, content, font_family, font_size,
+						is_dark_theme);
+				} else {
+					output = text_highlight_run_command (
+						content, font_family, font_size, syntax, theme,
+						cancellable, &local_error);
+				}
 
-			} else if (local_error != NULL) {
-				g_warning (
-					"%s: %s", G_STRFUNC,
-					local_error->message);
+				if (output)
+					text_highlight_cache_add (cache_key, output);
 			}
 
-			g_clear_error (&local_error);
+			g_free (cache_key);
+			g_bytes_unref (content);
+		}
 
-			g_spawn_close_pid (pid);
+		success = output && g_output_stream_write_all (
+			stream,
+			g_bytes_get_data (output, NULL),
+			g_bytes_get_size (output),
+			NULL, cancellable, &local_error);
+
+		if (g_error_matches (
+			local_error, G_IO_ERROR,
+			G_IO_ERROR_CANCELLED)) {
+			/* Do nothing. */
+
+		} else if (local_error != NULL) {
+			g_warning (
+				"%s: %s", G_STRFUNC,
+				local_error->message);
 		}
 
+		g_clear_error (&local_error);
+
 		if (!success) {
 			/* We can't call e_mail_formatter_format_as on text/plain,
 			 * because text-highlight is registered as a handler for
@@ -429,11 +636,11 @@ emfe_text_highlight_format (EMailFormatterExtension *extension,
 			}
 		}
 
+		if (output)
+			g_bytes_unref (output);
 		g_free (font_family);
-		g_free (font_size);
-		g_free ((gchar *) argv[3]);
-		g_free ((gchar *) argv[4]);
-		pango_font_description_free (fd);
+		g_free (syntax);
+		g_free (theme);
 
 		if (!success)
 			goto exit;
@@ -0,0 +1,706 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include "evolution-config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "highlighter.h"
+
+typedef enum {
+	TOKEN_TEXT = 0,
+	TOKEN_COMMENT,
+	TOKEN_KEYWORD,
+	TOKEN_STRING,
+	TOKEN_NUMBER,
+	TOKEN_PREPROCESSOR,
+	TOKEN_VARIABLE,
+	TOKEN_TAG,
+	TOKEN_ATTRIBUTE,
+	TOKEN_ENTITY,
+	TOKEN_DIFF_HEADER,
+	TOKEN_DIFF_HUNK,
+	TOKEN_DIFF_ADDED,
+	TOKEN_DIFF_REMOVED,
+	N_TOKENS
+} TokenKind;
+
+/* CSS class names of the tokens, as used in the <span> elements */
+static const gchar *token_classes[N_TOKENS] = {
+	NULL,	/* TOKEN_TEXT */
+	"c",	/* TOKEN_COMMENT */
+	"k",	/* TOKEN_KEYWORD */
+	"s",	/* TOKEN_STRING */
+	"n",	/* TOKEN_NUMBER */
+	"p",	/* TOKEN_PREPROCESSOR */
+	"v",	/* TOKEN_VARIABLE */
+	"t",	/* TOKEN_TAG */
+	"a",	/* TOKEN_ATTRIBUTE */
+	"e",	/* TOKEN_ENTITY */
+	"dh",	/* TOKEN_DIFF_HEADER */
+	"dk",	/* TOKEN_DIFF_HUNK */
+	"da",	/* TOKEN_DIFF_ADDED */
+	"dr"	/* TOKEN_DIFF_REMOVED */
+};
+
+typedef struct _Palette {
+	const gchar *foreground;
+	const gchar *background;
+	const gchar *tokens[N_TOKENS];
+} Palette;
+
+static const Palette light_palette = {
+	"#000000", "#ffffff", {
+	NULL,
+	"color:#707070;font-style:italic",
+	"color:#00008b;font-weight:bold",
+	"color:#a31515",
+	"color:#098658",
+	"color:#7f0055",
+	"color:#008080",
+	"color:#800000;font-weight:bold",
+	"color:#c00000",
+	"color:#b05000",
+	"font-weight:bold",
+	"color:#00008b;background-color:#e8e8ff",
+	"color:#006000;background-color:#e6ffe6",
+	"color:#a00000;background-color:#ffe6e6"
+	}
+};
+
+static const Palette dark_palette = {
+	"#e0e0e0", "#2b2b2b", {
+	NULL,
+	"color:#8a8a8a;font-style:italic",
+	"color:#e9b96e;font-weight:bold",
+	"color:#8ae234",
+	"color:#ad7fa8",
+	"color:#fcaf3e",
+	"color:#729fcf",
+	"color:#729fcf;font-weight:bold",
+	"color:#fce94f",
+	"color:#e9b96e",
+	"font-weight:bold",
+	"color:#729fcf;background-color:#34344a",
+	"color:#8ae234;background-color:#2d3d2d",
+	"color:#ef2929;background-color:#4a2d2d"
+	}
+};
+
+/* Describes a C-like language for highlight_code() */
+typedef struct _CodeSyntax {
+	const gchar *line_comment;
+	const gchar *block_comment_start;
+	const gchar *block_comment_end;
+	const gchar *quotes;
+	gboolean triple_quotes;		/* Python's """ and ''' */
+	gboolean multiline_strings;	/* strings can span lines */
+	gboolean raw_single_quotes;	/* no escapes in '...' */
+	gboolean preprocessor;		/* C #directives */
+	gboolean variables;		/* shell $VAR and ${VAR} */
+	gboolean decorators;		/* Python @decorator */
+	const gchar * const *keywords;	/* sorted */
+	gsize n_keywords;
+} CodeSyntax;
+
+/* The keyword lists are sorted by strcmp(), for bsearch(). */
+static const gchar * const c_keywords[] = {
+	"alignas", "alignof", "auto", "bool", "break", "case", "catch",
+	"char", "class", "const", "const_cast", "constexpr", "continue",
+	"decltype", "default", "delete", "do", "double", "dynamic_cast",
+	"else", "enum", "explicit", "extern", "false", "final", "float",
+	"for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+	"namespace", "new", "noexcept", "nullptr", "operator", "override",
+	"private", "protected", "public", "register", "reinterpret_cast",
+	"restrict", "return", "short", "signed", "sizeof", "static",
+	"static_assert", "static_cast", "struct", "switch", "template",
+	"this", "throw", "true", "try", "typedef", "typename", "union",
+	"unsigned", "using", "virtual", "void", "volatile", "while"
+};
+
+static const gchar * const python_keywords[] = {
+	"False", "None", "True", "and", "as", "assert", "async", "await",
+	"break", "class", "continue", "def", "del", "elif", "else",
+	"except", "finally", "for", "from", "global", "if", "import", "in",
+	"is", "lambda", "nonlocal", "not", "or", "pass", "raise", "return",
+	"try", "while", "with", "yield"
+};
+
+static const gchar * const shell_keywords[] = {
+	"break", "case", "continue", "declare", "do", "done", "elif",
+	"else", "esac", "exit", "export", "fi", "for", "function", "if",
+	"in", "local", "readonly", "return", "select", "set", "shift",
+	"source", "then", "unset", "until", "while"
+};
+
+static const CodeSyntax c_syntax = {
+	"//", "/*", "*/", "\"'",
+	FALSE, FALSE, FALSE, TRUE, FALSE, FALSE,
+	c_keywords, G_N_ELEMENTS (c_keywords)
+};
+
+static const CodeSyntax python_syntax = {
+	"#", NULL, NULL, "\"'",
+	TRUE, FALSE, FALSE, FALSE, FALSE, TRUE,
+	python_keywords, G_N_ELEMENTS (python_keywords)
+};
+
+static const CodeSyntax shell_syntax = {
+	"#", NULL, NULL, "\"'`",
+	FALSE, TRUE, TRUE, FALSE, TRUE, FALSE,
+	shell_keywords, G_N_ELEMENTS (shell_keywords)
+};
+
+static void
+append_escaped (GString *html,
+		const gchar *text,
+		gsize len)
+{
+	const gchar *end = text + len, *plain = text;
+
+	for (; text < end; text++) {
+		const gchar *entity;
+
+		switch (*text) {
+		case '&':
+			entity = "&amp;";
+			break;
+		case '<':
+			entity = "&lt;";
+			break;
+		case '>':
+			entity = "&gt;";
+			break;
+		case '"':
+			entity = "&quot;";
+			break;
+		default:
+			continue;
+		}
+
+		g_string_append_len (html, plain, text - plain);
+		g_string_append (html, entity);
+		plain = text + 1;
+	}
+
+	g_string_append_len (html, plain, end - plain);
+}
+
+static void
+emit_token (GString *html,
+	    TokenKind kind,
+	    const gchar *text,
+	    gsize len)
+{
+	if (!len)
+		return;
+
+	if (kind == TOKEN_TEXT) {
+		append_escaped (html, text, len);
+	} else {
+		g_string_append_printf (html, "<span class=\"%s\">", token_classes[kind]);
+		append_escaped (html, text, len);
+		g_string_append (html, "</span>");
+	}
+}
+
+static gboolean
+has_prefix_at (const gchar *text,
+	       gsize len,
+	       gsize pos,
+	       const gchar *prefix)
+{
+	gsize prefix_len;
+
+	if (!prefix)
+		return FALSE;
+
+	prefix_len = strlen (prefix);
+
+	return pos + prefix_len <= len && strncmp (text + pos, prefix, prefix_len) == 0;
+}
+
+static gsize
+find_line_end (const gchar *text,
+	       gsize len,
+	       gsize pos,
+	       gboolean with_continuation)
+{
+	while (pos < len && text[pos] != '\n') {
+		if (with_continuation && text[pos] == '\\' && pos + 1 < len && text[pos + 1] == '\n')
+			pos++;
+		pos++;
+	}
+
+	return pos;
+}
+
+/* Returns position after the closing 'end' or 'len', when not found */
+static gsize
+find_after (const gchar *text,
+	    gsize len,
+	    gsize pos,
+	    const gchar *end)
+{
+	while (pos < len) {
+		if (has_prefix_at (text, len, pos, end))
+			return pos + strlen (end);
+		pos++;
+	}
+
+	return len;
+}
+
+static gboolean
+is_ident_char (gchar chr)
+{
+	return g_ascii_isalnum (chr) || chr == '_';
+}
+
+static gint
+compare_keywords (gconstpointer key,
+		  gconstpointer member)
+{
+	return strcmp (key, *((const gchar * const *) member));
+}
+
+static gboolean
+is_keyword (const CodeSyntax *syntax,
+	    const gchar *word,
+	    gsize len)
+{
+	gchar buff[32];
+
+	if (!syntax->keywords || len >= sizeof (buff))
+		return FALSE;
+
+	memcpy (buff, word, len);
+	buff[len] = '\0';
+
+	return bsearch (buff, syntax->keywords, syntax->n_keywords, sizeof (gchar *), compare_keywords) != NULL;
+}
+
+static gsize
+scan_string (const CodeSyntax *syntax,
+	     const gchar *text,
+	     gsize len,
+	     gsize pos)
+{
+	gchar quote[4] = { 0, 0, 0, 0 };
+	gboolean escapes, multiline = syntax->multiline_strings;
+
+	quote[0] = text[pos];
+
+	if (syntax->triple_quotes && pos + 2 < len &&
+	    text[pos + 1] == quote[0] && text[pos + 2] == quote[0]) {
+		quote[1] = quote[0];
+		quote[2] = quote[0];
+		multiline = TRUE;
+	}
+
+	escapes = !syntax->raw_single_quotes || quote[0] != '\'';
+
+	pos += strlen (quote);
+
+	while (pos < len) {
+		if (escapes && text[pos] == '\\' && pos + 1 < len) {
+			pos += 2;
+			continue;
+		}
+
+		if (!multiline && text[pos] == '\n')
+			return pos;
+
+		if (has_prefix_at (text, len, pos, quote))
+			return pos + strlen (quote);
+
+		pos++;
+	}
+
+	return len;
+}
+
+static gsize
+scan_number (const gchar *text,
+	     gsize len,
+	     gsize pos)
+{
+	gboolean is_hex;
+
+	is_hex = pos + 1 < len && text[pos] == '0' && (text[pos + 1] == 'x' || text[pos + 1] == 'X');
+
+	while (pos < len) {
+		gchar chr = text[pos];
+
+		if (is_ident_char (chr) || chr == '.') {
+			pos++;
+		} else if ((chr == '+' || chr == '-') && !is_hex &&
+			   (text[pos - 1] == 'e' || text[pos - 1] == 'E')) {
+			pos++;
+		} else {
+			break;
+		}
+	}
+
+	return pos;
+}
+
+static gsize
+scan_variable (const gchar *text,
+	       gsize len,
+	       gsize pos)
+{
+	/* skip the '$' */
+	pos++;
+
+	if (pos >= len)
+		return pos;
+
+	if (text[pos] == '{')
+		return find_after (text, len, pos, "}");
+
+	if (g_ascii_isalpha (text[pos]) || text[pos] == '_') {
+		while (pos < len && is_ident_char (text[pos]))
+			pos++;
+
+		return pos;
+	}
+
+	/* Special parameters, like $1, $@, $? or $# */
+	if (strchr ("0123456789@*#?$!-", text[pos]))
+		return pos + 1;
+
+	return pos;
+}
+
+static void
+highlight_code (const CodeSyntax *syntax,
+		const gchar *text,
+		gsize len,
+		GString *html)
+{
+	gsize pos = 0, plain_start = 0;
+	gboolean line_start = TRUE;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_TEXT;
+		gchar chr = text[pos];
+		gsize end = pos + 1;
+
+		if (chr == '\n') {
+			line_start = TRUE;
+			pos++;
+			continue;
+		}
+
+		if (syntax->variables && chr == '$' && pos + 1 < len) {
+			end = scan_variable (text, len, pos);
+			if (end > pos + 1)
+				kind = TOKEN_VARIABLE;
+		} else if (syntax->preprocessor && line_start && chr == '#') {
+			kind = TOKEN_PREPROCESSOR;
+			end = find_line_end (text, len, pos, TRUE);
+		} else if (has_prefix_at (text, len, pos, syntax->line_comment) &&
+			   /* The shell uses '#' also inside words */
+			   (!syntax->variables || pos == 0 || g_ascii_isspace (text[pos - 1]) || text[pos - 1] == ';')) {
+			kind = TOKEN_COMMENT;
+			end = find_line_end (text, len, pos, FALSE);
+		} else if (has_prefix_at (text, len, pos, syntax->block_comment_start)) {
+			kind = TOKEN_COMMENT;
+			end = find_after (text, len, pos + strlen (syntax->block_comment_start), syntax->block_comment_end);
+		} else if (strchr (syntax->quotes, chr)) {
+			kind = TOKEN_STRING;
+			end = scan_string (syntax, text, len, pos);
+		} else if ((g_ascii_isdigit (chr) || (chr == '.' && pos + 1 < len && g_ascii_isdigit (text[pos + 1]))) &&
+			   (pos == 0 || !is_ident_char (text[pos - 1]))) {
+			kind = TOKEN_NUMBER;
+			end = scan_number (text, len, pos);
+		} else if (g_ascii_isalpha (chr) || chr == '_') {
+			while (end < len && is_ident_char (text[end]))
+				end++;
+
+			if ((pos == 0 || text[pos - 1] != '.') &&
+			    is_keyword (syntax, text + pos, end - pos))
+				kind = TOKEN_KEYWORD;
+		} else if (syntax->decorators && line_start && chr == '@') {
+			while (end < len && (is_ident_char (text[end]) || text[end] == '.'))
+				end++;
+
+			kind = TOKEN_PREPROCESSOR;
+		}
+
+		if (kind != TOKEN_TEXT) {
+			emit_token (html, TOKEN_TEXT, text + plain_start, pos - plain_start);
+			emit_token (html, kind, text + pos, end - pos);
+			plain_start = end;
+		}
+
+		if (!g_ascii_isspace (chr))
+			line_start = FALSE;
+
+		pos = end;
+	}
+
+	emit_token (html, TOKEN_TEXT, text + plain_start, pos - plain_start);
+}
+
+static void
+highlight_xml (const gchar *text,
+	       gsize len,
+	       GString *html)
+{
+	gsize pos = 0, plain_start = 0;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_TEXT;
+		gsize end = pos + 1;
+
+		if (has_prefix_at (text, len, pos, "<!--")) {
+			kind = TOKEN_COMMENT;
+			end = find_after (text, len, pos + 4, "-->");
+		} else if (has_prefix_at (text, len, pos, "<![CDATA[")) {
+			kind = TOKEN_STRING;
+			end = find_after (text, len, pos + 9, "]]>");
+		} else if (text[pos] == '<') {
+			emit_token (html, TOKEN_TEXT, text + plain_start, pos - plain_start);
+
+			/* The tag name, including the '<', '</', '<?' or '<!' */
+			if (end < len && strchr ("/?!", text[end]))
+				end++;
+			while (end < len && !g_ascii_isspace (text[end]) && !strchr ("/?>", text[end]))
+				end++;
+
+			emit_token (html, TOKEN_TAG, text + pos, end - pos);
+			pos = end;
+
+			/* Attributes up to the closing '>' */
+			while (pos < len && text[pos] != '>') {
+				if (g_ascii_isspace (text[pos]) || text[pos] == '=') {
+					end = pos + 1;
+					emit_token (html, TOKEN_TEXT, text + pos, 1);
+				} else if (text[pos] == '"' || text[pos] == '\'') {
+					gchar quote[2] = { text[pos], 0 };
+
+					end = find_after (text, len, pos + 1, quote);
+					emit_token (html, TOKEN_STRING, text + pos, end - pos);
+				} else if ((text[pos] == '/' || text[pos] == '?') && pos + 1 < len && text[pos + 1] == '>') {
+					break;
+				} else {
+					end = pos + 1;
+					while (end < len && !g_ascii_isspace (text[end]) && !strchr ("=/?>", text[end]))
+						end++;
+
+					emit_token (html, TOKEN_ATTRIBUTE, text + pos, end - pos);
+				}
+
+				pos = end;
+			}
+
+			/* The '>', '/>' or '?>' */
+			end = pos;
+			while (end < len && text[end] != '>')
+				end++;
+			if (end < len)
+				end++;
+
+			emit_token (html, TOKEN_TAG, text + pos, end - pos);
+
+			pos = end;
+			plain_start = end;
+			continue;
+		} else if (text[pos] == '&') {
+			while (end < len && end - pos < 16 && (g_ascii_isalnum (text[end]) || text[end] == '#'))
+				end++;
+
+			if (end < len && text[end] == ';' && end > pos + 1) {
+				kind = TOKEN_ENTITY;
+				end++;
+			} else {
+				end = pos + 1;
+			}
+		}
+
+		if (kind != TOKEN_TEXT) {
+			emit_token (html, TOKEN_TEXT, text + plain_start, pos - plain_start);
+			emit_token (html, kind, text + pos, end - pos);
+			plain_start = end;
+		}
+
+		pos = end;
+	}
+
+	emit_token (html, TOKEN_TEXT, text + plain_start, pos - plain_start);
+}
+
+/* Reads "@@ -a[,b] +c[,d] @@"; returns FALSE when it's not a hunk header */
+static gboolean
+parse_hunk_header (const gchar *line,
+		   gint64 *out_n_old,
+		   gint64 *out_n_new)
+{
+	gchar *endptr = NULL;
+
+	if (strncmp (line, "@@ -", 4) != 0)
+		return FALSE;
+
+	line += 4;
+	g_ascii_strtoull (line, &endptr, 10);
+	if (endptr == line)
+		return FALSE;
+
+	line = endptr;
+	if (*line == ',')
+		*out_n_old = g_ascii_strtoll (line + 1, &endptr, 10);
+	else
+		*out_n_old = 1;
+
+	line = endptr;
+	if (strncmp (line, " +", 2) != 0)
+		return FALSE;
+
+	line += 2;
+	g_ascii_strtoull (line, &endptr, 10);
+	if (endptr == line)
+		return FALSE;
+
+	line = endptr;
+	if (*line == ',')
+		*out_n_new = g_ascii_strtoll (line + 1, &endptr, 10);
+	else
+		*out_n_new = 1;
+
+	return TRUE;
+}
+
+static void
+highlight_diff (const gchar *text,
+		gsize len,
+		GString *html)
+{
+	/* Lines remaining in the current hunk; as long as there are any,
+	   the '---' and '+++' are removed and added lines, not headers. */
+	gint64 n_old = 0, n_new = 0;
+	gsize pos = 0;
+
+	while (pos < len) {
+		TokenKind kind = TOKEN_TEXT;
+		gsize end;
+
+		end = find_line_end (text, len, pos, FALSE);
+
+		if (n_old > 0 || n_new > 0) {
+			switch (text[pos]) {
+			case '+':
+				kind = TOKEN_DIFF_ADDED;
+				n_new--;
+				break;
+			case '-':
+				kind = TOKEN_DIFF_REMOVED;
+				n_old--;
+				break;
+			case '\\': /* No newline at end of file */
+				kind = TOKEN_COMMENT;
+				break;
+			default:
+				n_old--;
+				n_new--;
+				break;
+			}
+		} else if (has_prefix_at (text, len, pos, "@@ ")) {
+			gchar *line = g_strndup (text + pos, end - pos);
+
+			if (parse_hunk_header (line, &n_old, &n_new))
+				kind = TOKEN_DIFF_HUNK;
+
+			g_free (line);
+		} else if (has_prefix_at (text, len, pos, "diff ") ||
+			   has_prefix_at (text, len, pos, "index ") ||
+			   has_prefix_at (text, len, pos, "--- ") ||
+			   has_prefix_at (text, len, pos, "+++ ") ||
+			   has_prefix_at (text, len, pos, "new file mode ") ||
+			   has_prefix_at (text, len, pos, "deleted file mode ") ||
+			   has_prefix_at (text, len, pos, "similarity index ") ||
+			   has_prefix_at (text, len, pos, "rename from ") ||
+			   has_prefix_at (text, len, pos, "rename to ")) {
+			kind = TOKEN_DIFF_HEADER;
+		}
+
+		emit_token (html, kind, text + pos, end - pos);
+
+		if (end < len) {
+			g_string_append_c (html, '\n');
+			end++;
+		}
+
+		pos = end;
+	}
+}
+
+void
+highlighter_format_html (Highlighter highlighter,
+			 const gchar *text,
+			 gsize text_len,
+			 const gchar *font_family,
+			 gint font_size,
+			 gboolean is_dark_theme,
+			 GString *html)
+{
+	const Palette *palette;
+	gchar *valid_text, *family;
+	gint ii;
+
+	g_return_if_fail (text != NULL);
+	g_return_if_fail (html != NULL);
+
+	palette = is_dark_theme ? &dark_palette : &light_palette;
+
+	/* Quotes would break the CSS */
+	family = g_strdup (font_family ? font_family : "monospace");
+	g_strdelimit (family, "'\"<>", ' ');
+
+	g_string_append_printf (html,
+		"<style>"
+		"body{background-color:%s;}"
+		"pre.hl{margin:0; font-family:'%s'; font-size:%dpt; color:%s; background-color:%s;}",
+		palette->background, family, font_size > 0 ? font_size : 10,
+		palette->foreground, palette->background);
+
+	for (ii = 0; ii < N_TOKENS; ii++) {
+		if (token_classes[ii] && palette->tokens[ii])
+			g_string_append_printf (html, ".hl .%s{%s}", token_classes[ii], palette->tokens[ii]);
+	}
+
+	g_string_append (html, "</style><pre class=\"hl\">");
+
+	g_free (family);
+
+	valid_text = g_utf8_make_valid (text, text_len);
+	text_len = strlen (valid_text);
+
+	switch (highlighter) {
+	case HIGHLIGHTER_C:
+		highlight_code (&c_syntax, valid_text, text_len, html);
+		break;
+	case HIGHLIGHTER_DIFF:
+		highlight_diff (valid_text, text_len, html);
+		break;
+	case HIGHLIGHTER_PYTHON:
+		highlight_code (&python_syntax, valid_text, text_len, html);
+		break;
+	case HIGHLIGHTER_SHELL:
+		highlight_code (&shell_syntax, valid_text, text_len, html);
+		break;
+	case HIGHLIGHTER_XML:
+		highlight_xml (valid_text, text_len, html);
+		break;
+	case HIGHLIGHTER_NONE:
+		append_escaped (html, valid_text, text_len);
+		break;
+	}
+
+	g_string_append (html, "</pre>");
+
+	g_free (valid_text);
+}
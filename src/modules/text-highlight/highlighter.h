@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#ifndef HIGHLIGHTER_H
+#define HIGHLIGHTER_H
+
+#include <glib.h>
+
+/* In-process tokenizers, used instead of the 'highlight' binary
+ * for the most common languages in the mail. */
+typedef enum {
+	HIGHLIGHTER_NONE = 0,
+	HIGHLIGHTER_C,
+	HIGHLIGHTER_DIFF,
+	HIGHLIGHTER_PYTHON,
+	HIGHLIGHTER_SHELL,
+	HIGHLIGHTER_XML
+} Highlighter;
+
+void		highlighter_format_html		(Highlighter highlighter,
+						 const gchar *text,
+						 gsize text_len,
+						 const gchar *font_family,
+						 gint font_size,
+						 gboolean is_dark_theme,
+						 GString *html);
+
+#endif /* HIGHLIGHTER_H */
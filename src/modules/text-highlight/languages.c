@@ -32,7 +32,8 @@ static Language languages[] = {
 			      (gchar[]) { "application/x-sh" },
 			      (gchar[]) { "application/x-shar" },
 			      (gchar[]) { "application/x-shellscript" },
-			      (gchar[]) { "text/x-script.sh" }, NULL }
+			      (gchar[]) { "text/x-script.sh" }, NULL },
+	  HIGHLIGHTER_SHELL
 	},
 
 	{ "c", N_("_C/C++"),
@@ -41,7 +42,8 @@ static Language languages[] = {
 			      (gchar[]) { "cu" }, (gchar[]) { "cxx" },
 			      (gchar[]) { "h" }, (gchar[]) { "hh" },
 			      (gchar[]) { "hpp" }, (gchar[]) { "hxx" }, NULL },
-	  (const gchar *[]) { (gchar[]) { "text/x-c" }, NULL }
+	  (const gchar *[]) { (gchar[]) { "text/x-c" }, NULL },
+	  HIGHLIGHTER_C
 	},
 
 	{ "csharp", N_("_C#"),
@@ -77,7 +79,8 @@ static Language languages[] = {
 	{ "diff", N_("_Patch/diff"),
 	  (const gchar *[]) { (gchar[]) { "diff" }, (gchar[]) { "patch" }, NULL },
 	  (const gchar *[]) { (gchar[]) { "text/x-diff" },
-			      (gchar[]) { "text/x-patch" }, NULL }
+			      (gchar[]) { "text/x-patch" }, NULL },
+	  HIGHLIGHTER_DIFF
 	},
 
 	{ "markdown", N_("_Markdown"),
@@ -111,7 +114,8 @@ static Language languages[] = {
 
 	{ "python", N_("_Python"),
 	  (const gchar *[]) { (gchar[]) { "py" }, NULL },
-	  (const gchar *[]) { (gchar[]) { "text/x-script.python" }, NULL }
+	  (const gchar *[]) { (gchar[]) { "text/x-script.python" }, NULL },
+	  HIGHLIGHTER_PYTHON
 	},
 
 	{ "ruby", N_("_Ruby"),
@@ -157,7 +161,8 @@ static Language languages[] = {
 			      (gchar[]) { "xsl" }, NULL },
 	  (const gchar *[]) { (gchar[]) { "text/xml" },
 			      (gchar[]) { "application/xml" },
-			      (gchar[]) { "application/x-xml" }, NULL }
+			      (gchar[]) { "application/x-xml" }, NULL },
+	  HIGHLIGHTER_XML
 	}
 };
 
@@ -448,6 +453,27 @@ get_syntax_for_mime_type (const gchar *mime_type)
 	return NULL;
 }
 
+Highlighter
+get_highlighter_for_syntax (const gchar *syntax)
+{
+	gint i;
+
+	if (!syntax)
+		return HIGHLIGHTER_NONE;
+
+	for (i = 0; i < G_N_ELEMENTS (languages); i++) {
+		if (g_strcmp0 (languages[i].action_name, syntax) == 0)
+			return languages[i].highlighter;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (other_languages); i++) {
+		if (g_strcmp0 (other_languages[i].action_name, syntax) == 0)
+			return other_languages[i].highlighter;
+	}
+
+	return HIGHLIGHTER_NONE;
+}
+
 const gchar **
 get_mime_types (void)
 {
@@ -7,15 +7,19 @@
 
 #include <glib.h>
 
+#include "highlighter.h"
+
 typedef struct Language {
 	const gchar *action_name;
 	const gchar *action_label;
 	const gchar **extensions;
 	const gchar **mime_types;
+	Highlighter highlighter; /* in-process one, if any */
 } Language;
 
 const gchar *	get_syntax_for_ext		(const gchar *extension);
 const gchar *	get_syntax_for_mime_type	(const gchar *mime_type);
+Highlighter	get_highlighter_for_syntax	(const gchar *syntax);
 
 Language *	get_default_langauges		(gsize *len);
 Language *	get_additinal_languages		(gsize *len);
@@ -80,6 +80,13 @@ gint e_plugin_lib_enable (EPlugin *ep, gint enable);
 
 static guchar pst_signature[] = { '!', 'B', 'D', 'N' };
 
+/* Contacts and calendar components are written in batches of this many
+ * items, mail folders are synchronized and the resume state is saved
+ * at the same points. Mail is appended one message at a time, thus
+ * a resumed import skips the messages, which are in the folder already,
+ * up to the first one, which is not. */
+#define PST_IMPORT_BATCH_SIZE 200
+
 struct _PstImporter {
 	MailMsg base;
 
@@ -109,6 +116,21 @@ struct _PstImporter {
 	/* progress indicator */
 	gint position;
 	gint total;
+
+	/* items waiting for a batch write */
+	GSList *pending_contacts;	/* EContact * */
+	GSList *pending_events;		/* ICalComponent * */
+	GSList *pending_tasks;		/* ICalComponent * */
+	GSList *pending_journals;	/* ICalComponent * */
+
+	/* resume of an interrupted import and throughput */
+	gchar *state_filename;
+	guint item_index;
+	guint resume_index;
+	gboolean skip_present_mail;
+	guint n_imported;
+	gint64 start_time;
+	gboolean stats_pushed;
 };
 
 gboolean
@@ -690,6 +712,186 @@ pst_import_import (PstImporter *m,
 	pst_import_file (m);
 }
 
+static void
+pst_release_folder (PstImporter *m)
+{
+	if (!m->folder)
+		return;
+
+	/* FIXME Not passing a GCancellable or GError here. */
+	camel_folder_synchronize_sync (m->folder, FALSE, NULL, NULL);
+	camel_folder_thaw (m->folder);
+
+	g_clear_object (&m->folder);
+}
+
+static void
+pst_flush_contacts (PstImporter *m)
+{
+	GSList *contacts, *link;
+	GError *error = NULL;
+
+	if (!m->pending_contacts)
+		return;
+
+	contacts = g_slist_reverse (m->pending_contacts);
+	m->pending_contacts = NULL;
+
+	if (!e_book_client_add_contacts_sync (
+		m->addressbook, contacts, E_BOOK_OPERATION_FLAG_NONE,
+		NULL, m->cancellable, &error) &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_clear_error (&error);
+
+		/* Find out which of the contacts failed. */
+		for (link = contacts; link; link = g_slist_next (link)) {
+			e_book_client_add_contact_sync (
+				m->addressbook, link->data, E_BOOK_OPERATION_FLAG_NONE,
+				NULL, m->cancellable, &error);
+
+			if (error != NULL) {
+				g_warning (
+					"%s: Failed to add contact: %s",
+					G_STRFUNC, error->message);
+				g_clear_error (&error);
+			}
+		}
+	}
+
+	g_clear_error (&error);
+	g_slist_free_full (contacts, g_object_unref);
+}
+
+static void
+pst_flush_components (PstImporter *m,
+                      ECalClient *cal,
+                      GSList **pending,
+                      const gchar *comp_type)
+{
+	GSList *icomps, *link;
+	GError *error = NULL;
+
+	if (!*pending)
+		return;
+
+	icomps = g_slist_reverse (*pending);
+	*pending = NULL;
+
+	if (!e_cal_client_create_objects_sync (
+		cal, icomps, E_CAL_OPERATION_FLAG_NONE,
+		NULL, m->cancellable, &error) &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_clear_error (&error);
+
+		/* Find out which of the components failed. */
+		for (link = icomps; link; link = g_slist_next (link)) {
+			e_cal_client_create_object_sync (
+				cal, link->data, E_CAL_OPERATION_FLAG_NONE,
+				NULL, m->cancellable, &error);
+
+			if (error != NULL) {
+				g_warning (
+					"Creation of %s failed: %s",
+					comp_type, error->message);
+				g_clear_error (&error);
+			}
+		}
+	}
+
+	g_clear_error (&error);
+	g_slist_free_full (icomps, g_object_unref);
+}
+
+static void
+pst_load_state (PstImporter *m,
+                const gchar *filename)
+{
+	GStatBuf st;
+	gchar *key, *checksum, *contents = NULL;
+
+	if (g_stat (filename, &st) == -1)
+		return;
+
+	/* The state belongs to the file and to the import options. */
+	key = g_strdup_printf (
+		"%s\n%" G_GINT64_FORMAT "\n%" G_GINT64_FORMAT "\n%s\n%d%d%d%d%d",
+		filename, (gint64) st.st_size, (gint64) st.st_mtime,
+		((EImportTargetURI *) m->target)->uri_dest,
+		GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-mail")),
+		GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-addr")),
+		GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-appt")),
+		GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-task")),
+		GPOINTER_TO_INT (g_datalist_get_data (&m->target->data, "pst-do-journal")));
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+
+	m->state_filename = g_build_filename (e_get_user_cache_dir (), "pst-import", checksum, NULL);
+
+	if (g_file_get_contents (m->state_filename, &contents, NULL, NULL))
+		m->resume_index = (guint) g_ascii_strtoull (contents, NULL, 10);
+
+	m->skip_present_mail = m->resume_index > 0;
+
+	g_free (contents);
+	g_free (checksum);
+	g_free (key);
+}
+
+static void
+pst_save_state (PstImporter *m)
+{
+	gchar *dirname;
+	gchar contents[32];
+
+	if (!m->state_filename)
+		return;
+
+	dirname = g_path_get_dirname (m->state_filename);
+	g_mkdir_with_parents (dirname, 0700);
+	g_free (dirname);
+
+	g_snprintf (contents, sizeof (contents), "%u\n", m->item_index);
+	g_file_set_contents (m->state_filename, contents, -1, NULL);
+}
+
+/* Writes all pending items and remembers how far the import got,
+ * thus an interrupted import can continue from here. */
+static void
+pst_checkpoint (PstImporter *m)
+{
+	gint64 elapsed;
+
+	pst_flush_contacts (m);
+	pst_flush_components (m, m->calendar, &m->pending_events, "appointment");
+	pst_flush_components (m, m->tasks, &m->pending_tasks, "task");
+	pst_flush_components (m, m->journal, &m->pending_journals, "journal");
+
+	if (m->folder) {
+		/* FIXME Not passing a GCancellable or GError here. */
+		camel_folder_synchronize_sync (m->folder, FALSE, NULL, NULL);
+	}
+
+	if (g_cancellable_is_cancelled (m->cancellable))
+		return;
+
+	pst_save_state (m);
+
+	elapsed = (g_get_monotonic_time () - m->start_time) / G_USEC_PER_SEC;
+
+	if (m->stats_pushed)
+		camel_operation_pop_message (m->cancellable);
+
+	camel_operation_push_message (
+		m->cancellable,
+		ngettext (
+			"Imported %u item (%u per second)",
+			"Imported %u items (%u per second)",
+			m->n_imported),
+		m->n_imported,
+		(guint) (m->n_imported / MAX (elapsed, 1)));
+
+	m->stats_pushed = TRUE;
+}
+
 static void
 count_items (PstImporter *m,
              pst_desc_tree *topitem)
@@ -758,6 +960,9 @@ pst_import_file (PstImporter *m)
 		return;
 	}
 
+	pst_load_state (m, filename);
+	m->start_time = g_get_monotonic_time ();
+
 	g_free (filename);
 
 	camel_operation_progress (m->cancellable, 1);
@@ -778,6 +983,18 @@ pst_import_file (PstImporter *m)
 	count_items (m, d_ptr);
 	pst_import_folders (m, d_ptr);
 
+	pst_checkpoint (m);
+	pst_release_folder (m);
+
+	/* Start from the beginning the next time. */
+	if (!g_cancellable_is_cancelled (m->cancellable) && !m->base.error && m->state_filename)
+		g_unlink (m->state_filename);
+
+	if (m->stats_pushed) {
+		camel_operation_pop_message (m->cancellable);
+		m->stats_pushed = FALSE;
+	}
+
 	camel_operation_progress (m->cancellable, 100);
 
 	camel_operation_pop_message (m->cancellable);
@@ -810,7 +1027,7 @@ pst_import_folders (PstImporter *m,
 		pst_process_item (m, d_ptr, &previous_folder);
 
 		if (d_ptr->child != NULL) {
-			g_clear_object (&m->folder);
+			pst_release_folder (m);
 
 			g_return_if_fail (m->folder_uri != NULL);
 			g_hash_table_insert (node_to_folderuri, d_ptr, g_strdup (m->folder_uri));
@@ -827,7 +1044,7 @@ pst_import_folders (PstImporter *m,
 			d_ptr = d_ptr->next;
 		} else {
 			while (d_ptr && d_ptr != topitem && d_ptr->next == NULL) {
-				g_clear_object (&m->folder);
+				pst_release_folder (m);
 
 				g_free (m->folder_uri);
 				m->folder_uri = NULL;
@@ -878,6 +1095,10 @@ pst_process_item (PstImporter *m,
 		if (previous_folder)
 			*previous_folder = g_strdup (m->folder_uri);
 		pst_process_folder (m, item);
+	} else if (m->item_index < m->resume_index) {
+		/* Imported already by an interrupted import. */
+		m->item_index++;
+		m->current_item++;
 	} else {
 		switch (item->type) {
 		case PST_TYPE_CONTACT:
@@ -905,6 +1126,11 @@ pst_process_item (PstImporter *m,
 		}
 
 		m->current_item++;
+		m->item_index++;
+		m->n_imported++;
+
+		if (m->n_imported % PST_IMPORT_BATCH_SIZE == 0)
+			pst_checkpoint (m);
 	}
 
 	pst_freeItem (item);
@@ -1043,7 +1269,7 @@ pst_process_folder (PstImporter *m,
 	g_free (m->folder_uri);
 	m->folder_uri = uri;
 
-	g_clear_object (&m->folder);
+	pst_release_folder (m);
 
 	m->folder_count = item->folder->item_count;
 	m->current_item = 0;
@@ -1078,7 +1304,7 @@ pst_create_folder (PstImporter *m)
 
 	g_return_if_fail (g_str_has_prefix (dest, parent));
 
-	g_clear_object (&m->folder);
+	pst_release_folder (m);
 
 	dest_len = strlen (dest);
 	dest_end = dest + dest_len;
@@ -1115,6 +1341,10 @@ pst_create_folder (PstImporter *m)
 			m->folder = e_mail_session_uri_to_folder_sync (
 				session, m->folder_uri, CAMEL_STORE_FOLDER_CREATE,
 				m->cancellable, &m->base.error);
+
+		/* Kept frozen until another folder is used. */
+		if (m->folder)
+			camel_folder_freeze (m->folder);
 	}
 }
 
@@ -1221,6 +1451,35 @@ strip_smtp (const gchar *str)
 	return str;
 }
 
+/* Whether the interrupted import appended the message already,
+ * after it saved the resume state the last time */
+static gboolean
+pst_message_is_present (PstImporter *m,
+                        CamelMimeMessage *msg)
+{
+	const gchar *message_id;
+	GPtrArray *uids = NULL;
+	GString *expr;
+	gboolean present;
+
+	message_id = camel_mime_message_get_message_id (msg);
+	if (!message_id || !*message_id)
+		return FALSE;
+
+	expr = g_string_new ("(match-all (header-contains \"Message-ID\" ");
+	camel_sexp_encode_string (expr, message_id);
+	g_string_append (expr, "))");
+
+	present = camel_folder_search_sync (m->folder, expr->str, &uids, m->cancellable, NULL) &&
+		uids && uids->len > 0;
+
+	if (uids)
+		g_ptr_array_unref (uids);
+	g_string_free (expr, TRUE);
+
+	return present;
+}
+
 static void
 pst_process_email (PstImporter *m,
                    pst_item *item)
@@ -1295,8 +1554,6 @@ pst_process_email (PstImporter *m,
 		}
 	}
 
-	camel_folder_freeze (m->folder);
-
 	msg = camel_mime_message_new ();
 
 	if (item->subject.str != NULL) {
@@ -1378,6 +1635,17 @@ pst_process_email (PstImporter *m,
 		camel_mime_message_set_message_id (msg, item->email->messageid.str);
 	}
 
+	if (m->skip_present_mail) {
+		if (pst_message_is_present (m, msg)) {
+			g_object_unref (msg);
+			g_free (comp_str);
+			return;
+		}
+
+		/* The interrupted import did not get further */
+		m->skip_present_mail = FALSE;
+	}
+
 	body_charset = pst_default_charset (item, sizeof (charset_buf), charset_buf);
 	if (!body_charset || !*body_charset || g_ascii_strcasecmp (body_charset, "utf-8") == 0) {
 		cpid = item->message_codepage;
@@ -1494,10 +1762,6 @@ pst_process_email (PstImporter *m,
 	g_clear_object (&info);
 	g_object_unref (msg);
 
-	/* FIXME Not passing a GCancellable or GError here. */
-	camel_folder_synchronize_sync (m->folder, FALSE, NULL, NULL);
-	camel_folder_thaw (m->folder);
-
 	g_free (comp_str);
 	g_free (plain_body_utf8);
 	g_free (html_body_utf8);
@@ -1605,7 +1869,6 @@ pst_process_contact (PstImporter *m,
 	pst_item_contact *c;
 	EContact *ec;
 	GString *notes;
-	GError *error = NULL;
 
 	c = item->contact;
 	notes = g_string_sized_new (2048);
@@ -1745,17 +2008,7 @@ pst_process_contact (PstImporter *m,
 	contact_set_string (ec, E_CONTACT_NOTE, notes->str);
 	g_string_free (notes, TRUE);
 
-	e_book_client_add_contact_sync (
-		m->addressbook, ec, E_BOOK_OPERATION_FLAG_NONE, NULL, NULL, &error);
-
-	g_object_unref (ec);
-
-	if (error != NULL) {
-		g_warning (
-			"%s: Failed to add contact: %s",
-			G_STRFUNC, error->message);
-		g_error_free (error);
-	}
+	m->pending_contacts = g_slist_prepend (m->pending_contacts, ec);
 }
 
 /**
@@ -2149,10 +2402,10 @@ pst_process_component (PstImporter *m,
                        pst_item *item,
                        const gchar *comp_type,
                        ECalComponentVType vtype,
-                       ECalClient *cal)
+                       ECalClient *cal,
+                       GSList **pending)
 {
 	ECalComponent *ec;
-	GError *error = NULL;
 
 	g_return_if_fail (item->appointment != NULL);
 
@@ -2162,16 +2415,8 @@ pst_process_component (PstImporter *m,
 	fill_calcomponent (m, item, ec, comp_type);
 	set_cal_attachments (cal, ec, m, item->attach);
 
-	e_cal_client_create_object_sync (
-		cal, e_cal_component_get_icalcomponent (ec),
-		E_CAL_OPERATION_FLAG_NONE, NULL, NULL, &error);
-
-	if (error != NULL) {
-		g_warning (
-			"Creation of %s failed: %s",
-			comp_type, error->message);
-		g_error_free (error);
-	}
+	*pending = g_slist_prepend (*pending,
+		i_cal_component_clone (e_cal_component_get_icalcomponent (ec)));
 
 	g_object_unref (ec);
 }
@@ -2180,21 +2425,21 @@ static void
 pst_process_appointment (PstImporter *m,
                          pst_item *item)
 {
-	pst_process_component (m, item, "appointment", E_CAL_COMPONENT_EVENT, m->calendar);
+	pst_process_component (m, item, "appointment", E_CAL_COMPONENT_EVENT, m->calendar, &m->pending_events);
 }
 
 static void
 pst_process_task (PstImporter *m,
                   pst_item *item)
 {
-	pst_process_component (m, item, "task", E_CAL_COMPONENT_TODO, m->tasks);
+	pst_process_component (m, item, "task", E_CAL_COMPONENT_TODO, m->tasks, &m->pending_tasks);
 }
 
 static void
 pst_process_journal (PstImporter *m,
                      pst_item *item)
 {
-	pst_process_component (m, item, "journal", E_CAL_COMPONENT_JOURNAL, m->journal);
+	pst_process_component (m, item, "journal", E_CAL_COMPONENT_JOURNAL, m->journal, &m->pending_journals);
 }
 
 /* Print an error message - maybe later bring up an error dialog? */
@@ -2219,6 +2464,12 @@ static void
 pst_import_free (PstImporter *m)
 {
 	/* pst_close (&m->pst); */
+	g_slist_free_full (m->pending_contacts, g_object_unref);
+	g_slist_free_full (m->pending_events, g_object_unref);
+	g_slist_free_full (m->pending_tasks, g_object_unref);
+	g_slist_free_full (m->pending_journals, g_object_unref);
+	g_free (m->state_filename);
+
 	if (m->addressbook)
 		g_object_unref (m->addressbook);
 	if (m->calendar)
@@ -1866,8 +1866,12 @@ shell_constructed (GObject *object)
 static void
 shell_startup (GApplication *application)
 {
+	gint64 trace_begin;
+
 	g_return_if_fail (E_IS_SHELL (application));
 
+	trace_begin = e_trace_begin ();
+
 	e_file_lock_create ();
 
 	/* Destroy the lock file when the EShell is finalized
@@ -1878,6 +1882,8 @@ shell_startup (GApplication *application)
 
 	/* Chain up to parent's startup() method. */
 	G_APPLICATION_CLASS (e_shell_parent_class)->startup (application);
+
+	e_trace_end (trace_begin, "shell", "startup", NULL);
 }
 
 static void
@@ -2009,6 +2015,7 @@ static gboolean quit = FALSE;
 
 static gchar *geometry = NULL;
 static gchar *requested_view = NULL;
+static gchar *trace_file = NULL;
 static gchar **remaining_args;
 
 static GOptionEntry app_options[] = {
@@ -2054,6 +2061,8 @@ static GOptionEntry app_options[] = {
 	  N_("View URIs or filenames given as rest of arguments."), NULL },
 	{ "quit", 'q', 0, G_OPTION_ARG_NONE, &quit,
 	  N_("Request a running Evolution process to quit"), NULL },
+	{ "trace-file", '\0', 0, G_OPTION_ARG_FILENAME, &trace_file,
+	  N_("Record a startup timeline into FILE"), "FILE" },
 	{ "version", 'v', G_OPTION_FLAG_HIDDEN | G_OPTION_FLAG_NO_ARG,
 	  G_OPTION_ARG_CALLBACK, option_version_cb, NULL, NULL },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY,
@@ -2119,6 +2128,11 @@ e_shell_handle_local_options_cb (GApplication *application,
 	g_clear_pointer (&shell->priv->geometry, g_free);
 	shell->priv->geometry = g_strdup (geometry);
 
+	/* Usually turned on already by main(), before the modules are
+	 * loaded and the shell is created; this does nothing then. */
+	if (trace_file && *trace_file)
+		e_trace_init (trace_file);
+
 #ifdef G_OS_WIN32
 	if (register_handlers || reinstall || show_icons) {
 		_e_win32_register_mailer ();
@@ -2253,13 +2267,16 @@ shell_initable_init (GInitable *initable,
 	ESourceRegistry *registry;
 	ESource *proxy_source;
 	gulong handler_id;
+	gint64 trace_begin;
 
 	shell_add_actions (application);
 
 	if (!g_application_register (application, cancellable, error))
 		return FALSE;
 
+	trace_begin = e_trace_begin ();
 	registry = e_source_registry_new_sync (cancellable, error);
+	e_trace_end (trace_begin, "shell", "source-registry", NULL);
 	if (registry == NULL)
 		return FALSE;
 
@@ -2693,12 +2710,15 @@ void
 e_shell_load_modules (EShell *shell)
 {
 	GList *list;
+	gint64 trace_begin;
 
 	g_return_if_fail (E_IS_SHELL (shell));
 
 	if (shell->priv->modules_loaded)
 		return;
 
+	trace_begin = e_trace_begin ();
+
 	/* Process shell backends. */
 
 	list = g_list_sort (
@@ -2709,6 +2729,8 @@ e_shell_load_modules (EShell *shell)
 	shell->priv->loaded_backends = list;
 
 	shell->priv->modules_loaded = TRUE;
+
+	e_trace_end (trace_begin, "shell", "load-shell-backends", NULL);
 }
 
 /**
@@ -2911,12 +2933,15 @@ e_shell_create_shell_window (EShell *shell,
 	GtkWidget *shell_window;
 	GList *link;
 	gboolean can_change_default_view;
+	gint64 trace_begin;
 
 	g_return_val_if_fail (E_IS_SHELL (shell), NULL);
 
 	if (g_application_get_is_remote (G_APPLICATION (shell)))
 		goto remote;
 
+	trace_begin = e_trace_begin ();
+
 	can_change_default_view = !view_name || *view_name != '*';
 	view_name = e_shell_get_canonical_name (shell, can_change_default_view ? view_name : (view_name + 1));
 
@@ -2936,6 +2961,8 @@ e_shell_create_shell_window (EShell *shell,
 		shell->priv->safe_mode,
 		shell->priv->geometry);
 
+	e_trace_end (trace_begin, "shell", "create-shell-window", view_name);
+
 	if (view_name && !can_change_default_view) {
 		GSettings *settings;
 		gchar *active_view;
@@ -199,6 +199,103 @@ shell_force_shutdown (void)
 	g_assert_not_reached ();
 }
 
+/* Loads the modules like e_module_load_all_in_directory() does, only
+ * records a trace span for each of them. */
+static GList *
+load_modules_in_directory (const gchar *dirname)
+{
+	GDir *dir;
+	GList *modules = NULL;
+	const gchar *basename;
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir)
+		return NULL;
+
+	while ((basename = g_dir_read_name (dir)) != NULL) {
+		EModule *module;
+		gchar *filename;
+		gint64 trace_begin;
+
+		if (!g_str_has_suffix (basename, "." G_MODULE_SUFFIX))
+			continue;
+
+		filename = g_build_filename (dirname, basename, NULL);
+
+		trace_begin = e_trace_begin ();
+		module = e_module_load_file (filename);
+		e_trace_end (trace_begin, "shell", "load-module", basename);
+
+		if (module)
+			modules = g_list_prepend (modules, module);
+
+		g_free (filename);
+	}
+
+	g_dir_close (dir);
+
+	return modules;
+}
+
+static GList *
+load_modules (void)
+{
+	GPtrArray *variants;
+	GList *modules = NULL;
+	gint64 trace_begin;
+	guint ii;
+
+	if (!g_module_supported ())
+		return NULL;
+
+	trace_begin = e_trace_begin ();
+
+	variants = e_util_get_directory_variants (EVOLUTION_MODULEDIR, EVOLUTION_PREFIX, TRUE);
+
+	if (variants) {
+		for (ii = 0; ii < variants->len; ii++) {
+			const gchar *dirname = g_ptr_array_index (variants, ii);
+
+			if (dirname && *dirname)
+				modules = g_list_concat (modules, load_modules_in_directory (dirname));
+		}
+
+		g_ptr_array_unref (variants);
+	} else {
+		modules = load_modules_in_directory (EVOLUTION_MODULEDIR);
+	}
+
+	e_trace_end (trace_begin, "shell", "load-modules", NULL);
+
+	return modules;
+}
+
+/* The command line options are parsed by the EShell, which is created
+ * after the modules are loaded, thus look for the --trace-file early,
+ * to have the module loading and the shell creation traced as well. */
+static void
+init_trace_early (gint argc,
+		  gchar **argv)
+{
+	const gchar *trace_file;
+	gint ii;
+
+	trace_file = g_getenv ("EVOLUTION_TRACE_FILE");
+
+	for (ii = 1; ii < argc && (!trace_file || !*trace_file); ii++) {
+		if (!argv[ii] || g_str_equal (argv[ii], "--"))
+			break;
+
+		if (g_str_has_prefix (argv[ii], "--trace-file="))
+			trace_file = argv[ii] + strlen ("--trace-file=");
+		else if (g_str_equal (argv[ii], "--trace-file") && ii + 1 < argc)
+			trace_file = argv[ii + 1];
+	}
+
+	if (trace_file && *trace_file)
+		e_trace_init (trace_file);
+}
+
 static EShell *
 create_default_shell (gint *pargc,
 		      gchar ***pargv)
@@ -206,14 +303,17 @@ create_default_shell (gint *pargc,
 	EShell *shell;
 	GApplicationFlags flags;
 	GList *module_types;
+	gint64 trace_begin;
 	GError *error = NULL;
 
 	/* Load all shared library modules. */
-	module_types = e_module_load_all_in_directory_and_prefixes (EVOLUTION_MODULEDIR, EVOLUTION_PREFIX);
+	module_types = load_modules ();
 	g_list_free_full (module_types, (GDestroyNotify) g_type_module_unuse);
 
 	flags = 0;
 
+	trace_begin = e_trace_begin ();
+
 	shell = g_initable_new (
 		E_TYPE_SHELL, NULL, &error,
 		"application-id", APPLICATION_ID,
@@ -223,6 +323,8 @@ create_default_shell (gint *pargc,
 		"register-session", TRUE,
 		NULL);
 
+	e_trace_end (trace_begin, "shell", "create-shell", NULL);
+
 	/* Failure to register is fatal. */
 	if (error != NULL) {
 		gchar *msg = g_strdup_printf (
@@ -254,6 +356,9 @@ main (gint argc,
 	bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
 	textdomain (GETTEXT_PACKAGE);
 
+	/* Enable the startup timeline as early as possible */
+	init_trace_early (argc, argv);
+
 	/* Do not require Gtk+ for --force-shutdown */
 	if (argc == 2 && argv[1] && g_str_equal (argv[1], "--force-shutdown")) {
 		shell_force_shutdown ();
@@ -368,6 +473,15 @@ main (gint argc,
 
 	ret = g_application_run (G_APPLICATION (shell), argc, argv);
 
+	if (!is_remote) {
+		GError *error = NULL;
+
+		if (!e_trace_write (&error)) {
+			g_warning ("Failed to write startup trace: %s", error ? error->message : "Unknown error");
+			g_clear_error (&error);
+		}
+	}
+
 	/* Drop what should be the last reference to the shell.
 	 * That will cause e_shell_get_default() to henceforth
 	 * return NULL.  Use that to check for reference leaks. */